@@ -69,7 +69,8 @@ elseif (UNIX)
     file(GLOB labsnd_fft_src "${LABSOUND_ROOT}/third_party/kissfft/src/*")
 endif()
 
-# TODO ooura or kissfft? benchmark and choose. Then benchmark vs FFTFrameAppleAccelerate
+# Where Accelerate is not used, FFTFrame uses an FFTPlan backend, of which KissFFT
+# and Ooura are two; LabSoundBench compares them with the in-tree Stockham backend.
 set(ooura_src
     "${LABSOUND_ROOT}/third_party/ooura/src/fftsg.cpp"
     "${LABSOUND_ROOT}/third_party/ooura/fftsg.h")
@@ -84,6 +85,23 @@ add_library(LabSound STATIC
     ${LABSOUND_LSR}
  )
 
+# The AVX2 and AVX-512 VectorMath kernels are compiled for those instruction
+# sets, and selected at runtime only if the CPU supports them, so the library
+# itself still targets the baseline instruction set.
+if (NOT APPLE AND CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64|x64)$")
+    if (MSVC)
+        set(LABSOUND_AVX2_FLAGS "/arch:AVX2")
+        set(LABSOUND_AVX512_FLAGS "/arch:AVX512")
+    else()
+        set(LABSOUND_AVX2_FLAGS "-mavx2;-mfma")
+        set(LABSOUND_AVX512_FLAGS "-mavx512f;-mfma")
+    endif()
+    set_source_files_properties("${LABSOUND_ROOT}/src/internal/src/VectorMathAVX2.cpp"
+        PROPERTIES COMPILE_OPTIONS "${LABSOUND_AVX2_FLAGS}")
+    set_source_files_properties("${LABSOUND_ROOT}/src/internal/src/VectorMathAVX512.cpp"
+        PROPERTIES COMPILE_OPTIONS "${LABSOUND_AVX512_FLAGS}")
+endif()
+
  #--- CONFIGURE RTAUDIO
 if (NOT IOS)
     add_library(LabSoundRtAudio STATIC
@@ -223,6 +241,13 @@ target_include_directories(LabSound PRIVATE
     ${LABSOUND_ROOT}/third_party/libsamplerate/include
 )
 
+# Debugging aid: report every heap allocation made on the render thread,
+# with the node being processed and the call site. Not for release builds.
+option(LABSOUND_TRACE_RENDER_ALLOCATIONS "Report heap allocations made on the render thread" OFF)
+if (LABSOUND_TRACE_RENDER_ALLOCATIONS)
+    target_compile_definitions(LabSound PRIVATE LABSOUND_TRACE_RENDER_ALLOCATIONS=1)
+endif()
+
 if (NOT IOS)
     target_include_directories(LabSoundRtAudio PUBLIC
         $<BUILD_INTERFACE:${CMAKE_CURRENT_SOURCE_DIR}/include>  
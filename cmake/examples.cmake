@@ -148,3 +148,127 @@ set_property(TARGET audiotexture PROPERTY FOLDER "examples")
 install(TARGETS audiotexture
     BUNDLE DESTINATION bin
     RUNTIME DESTINATION bin)
+
+#-------------------------------------------------------------------------------
+# quantumbench - command line tool: offline throughput vs render quantum size
+#-------------------------------------------------------------------------------
+
+add_executable(quantumbench "${LABSOUND_ROOT}/examples/src/QuantumBench.cpp")
+
+if(UNIX AND NOT APPLE)
+    target_link_libraries(quantumbench pthread)
+elseif(APPLE)
+    target_link_libraries(quantumbench ${DARWIN_LIBS})
+endif()
+
+if (NOT IOS)
+    target_link_libraries(quantumbench LabSound ${LABSOUND_DEFAULT_BACKEND})
+endif()
+
+if(MINGW)
+    target_link_libraries(quantumbench mfuuid mfplat ksuser wmcodecdspuuid)
+endif(MINGW)
+
+set_target_properties(quantumbench PROPERTIES
+                      RUNTIME_OUTPUT_DIRECTORY bin)
+
+set_property(TARGET quantumbench PROPERTY FOLDER "examples")
+
+#-------------------------------------------------------------------------------
+# vectormathbench - command line tool: VectorMath kernels at each SIMD level
+#-------------------------------------------------------------------------------
+
+add_executable(vectormathbench "${LABSOUND_ROOT}/examples/src/VectorMathBench.cpp")
+
+if(UNIX AND NOT APPLE)
+    target_link_libraries(vectormathbench pthread)
+elseif(APPLE)
+    target_link_libraries(vectormathbench ${DARWIN_LIBS})
+endif()
+
+if (NOT IOS)
+    target_link_libraries(vectormathbench LabSound)
+endif()
+
+set_target_properties(vectormathbench PROPERTIES
+                      RUNTIME_OUTPUT_DIRECTORY bin)
+
+set_property(TARGET vectormathbench PROPERTY FOLDER "examples")
+
+#-------------------------------------------------------------------------------
+# LabSoundBench - benchmark suite: nodes, graphs, FFT, convolution, HRTF, and
+# offline render throughput, with Google Benchmark compatible JSON output
+#-------------------------------------------------------------------------------
+
+add_executable(LabSoundBench "${LABSOUND_ROOT}/examples/src/LabSoundBench.cpp")
+
+set(proj LabSoundBench)
+
+# the FFT benchmarks use the library's internal FFTFrame
+target_include_directories(${proj} PRIVATE
+    "${LABSOUND_ROOT}/src"
+    "${LABSOUND_ROOT}/third_party")
+
+if(WIN32)
+    if(MSVC)
+        target_compile_options(${proj} PRIVATE /Zi)
+    endif(MSVC)
+elseif(APPLE)
+    target_link_libraries(${proj} ${DARWIN_LIBS})
+elseif(UNIX)
+    target_link_libraries(${proj} pthread)
+    target_compile_options(${proj} PRIVATE -fPIC)
+    # must match the library, for FFTFrame's layout
+    target_compile_definitions(${proj} PRIVATE USE_KISS_FFT=1)
+endif()
+
+# everything renders through the null device, so no backend is linked
+if (NOT IOS)
+    target_link_libraries(${proj} LabSound)
+endif()
+
+target_compile_definitions(${proj} PRIVATE SAMPLE_SRC_DIR="${LABSOUND_ROOT}/assets")
+
+set_target_properties(${proj} PROPERTIES
+                      RUNTIME_OUTPUT_DIRECTORY bin)
+
+set_property(TARGET ${proj} PROPERTY FOLDER "examples")
+
+#-------------------------------------------------------------------------------
+# hrtfpack - command line tool: packs the HRTF database for memory mapping
+#-------------------------------------------------------------------------------
+
+add_executable(hrtfpack "${LABSOUND_ROOT}/examples/src/HRTFPackTool.cpp")
+
+set(proj hrtfpack)
+
+# the pack is written by the library's internal HRTFDatabase
+target_include_directories(${proj} PRIVATE
+    "${LABSOUND_ROOT}/src"
+    "${LABSOUND_ROOT}/third_party")
+
+if(WIN32)
+    if(MSVC)
+        target_compile_options(${proj} PRIVATE /Zi)
+    endif(MSVC)
+elseif(APPLE)
+    target_link_libraries(${proj} ${DARWIN_LIBS})
+elseif(UNIX)
+    target_link_libraries(${proj} pthread)
+    target_compile_options(${proj} PRIVATE -fPIC)
+    # must match the library, for FFTFrame's layout
+    target_compile_definitions(${proj} PRIVATE USE_KISS_FFT=1)
+endif()
+
+if (NOT IOS)
+    target_link_libraries(${proj} LabSound)
+endif()
+
+set_target_properties(${proj} PROPERTIES
+                      RUNTIME_OUTPUT_DIRECTORY bin)
+
+set_property(TARGET ${proj} PROPERTY FOLDER "examples")
+
+install(TARGETS ${proj}
+    BUNDLE DESTINATION bin
+    RUNTIME DESTINATION bin)
@@ -114,7 +114,7 @@ int main(int argc, char ** argv)
     }
 
     fixture->startRecording();
-    auto scratch = std::make_shared<lab::AudioBus>(1, AudioNode::ProcessingSizeInFrames);
+    auto scratch = std::make_shared<lab::AudioBus>(1, context->renderQuantumSize());
     renderNode->offlineRender(scratch.get(), clip->length());
     fixture->stopRecording();
 
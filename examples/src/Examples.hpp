@@ -291,7 +291,7 @@ struct ex_offline_rendering : public labsound_example
             musicClipNode->schedule(0.0);
         }
 
-        auto bus = std::make_shared<lab::AudioBus>(2, 128);
+        auto bus = std::make_shared<lab::AudioBus>(2, ac.renderQuantumSize());
         renderNode->offlineRender(bus.get(), musicClip->length());
         recorder->stopRecording();
         printf("Recorded %f seconds of audio\n", recorder->recordedLengthInSeconds());
@@ -299,6 +299,72 @@ struct ex_offline_rendering : public labsound_example
     }
 };
 
+//------------------------------
+//    ex_offline_batch_rendering
+//------------------------------
+
+// This sample renders a batch of stems concurrently. Each stem has its own offline
+// context, and an OfflineRenderer renders the contexts on a pool of threads. Each
+// stem streams to a WAV file as it renders, so no stem is ever held in memory.
+struct ex_offline_batch_rendering : public labsound_example
+{
+    ex_offline_batch_rendering(std::shared_ptr<lab::AudioContext> context, bool with_input)
+    : labsound_example(context, with_input) {}
+    virtual ~ex_offline_batch_rendering() = default;
+
+    virtual void play(int argc, char ** argv) override
+    {
+        const int stemCount = 8;
+        const float stemSeconds = 10.f;
+
+        AudioStreamConfig offlineConfig;
+        offlineConfig.device_index = 0;
+        offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+        offlineConfig.desired_channels = LABSOUND_DEFAULT_CHANNELS;
+        AudioStreamConfig inputConfig = {};
+
+        lab::OfflineRenderer renderer;
+        std::vector<std::future<lab::OfflineRenderStats>> results;
+        std::vector<std::shared_ptr<AudioNode>> stemNodes; // the contexts don't own their nodes
+
+        for (int i = 0; i < stemCount; ++i)
+        {
+            auto context = std::make_shared<lab::AudioContext>(true /*isOffline*/, false /*autoDispatchEvents*/);
+            auto renderNode = std::make_shared<lab::AudioDestinationNode>(*context,
+                std::make_unique<lab::AudioDevice_Null>(inputConfig, offlineConfig));
+            context->setDestinationNode(renderNode);
+
+            // osc -> gain -> destination, a fifth higher for each stem
+            auto oscillator = std::make_shared<OscillatorNode>(*context);
+            auto gain = std::make_shared<GainNode>(*context);
+            oscillator->frequency()->setValue(110.f * std::pow(1.5f, static_cast<float>(i)));
+            oscillator->setType(OscillatorType::SAWTOOTH);
+            oscillator->start(0.0f);
+            gain->gain()->setValue(0.f);
+            gain->gain()->linearRampToValueAtTime(0.25f, stemSeconds);
+            context->connect(gain, oscillator);
+            context->connect(renderNode, gain);
+            stemNodes.push_back(oscillator);
+            stemNodes.push_back(gain);
+
+            auto sink = std::make_shared<lab::OfflineRenderWavSink>("ex_offline_batch_" + std::to_string(i) + ".wav");
+            results.push_back(renderer.render(context, sink, static_cast<uint64_t>(stemSeconds * offlineConfig.desired_samplerate)));
+        }
+
+        for (int i = 0; i < stemCount; ++i)
+        {
+            lab::OfflineRenderStats stats = results[i].get();
+            printf("stem %d: %llu frames in %.3f seconds, %.0f frames/second\n",
+                   i, (unsigned long long) stats.frames, stats.seconds, stats.framesPerSecond);
+        }
+
+        lab::OfflineRenderStats totals = renderer.totals();
+        printf("%d stems on %d threads: %.0f frames/second, %.1fx realtime\n",
+               stemCount, renderer.threadCount(), totals.framesPerSecond,
+               totals.framesPerSecond / offlineConfig.desired_samplerate);
+    }
+};
+
 //------------------------------
 //    ex_audio_texture
 //------------------------------
@@ -353,7 +419,7 @@ struct ex_audio_texture : public labsound_example
         }
 
         fixture->startRecording();
-        auto bus = std::make_shared<lab::AudioBus>(1, AudioNode::ProcessingSizeInFrames);
+        auto bus = std::make_shared<lab::AudioBus>(1, _context->renderQuantumSize());
         renderNode->offlineRender(bus.get(), musicClip->length());
         fixture->stopRecording();
 
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+//
+// hrtfpack - a command line utility that packs the IRCAM HRTF database.
+//
+// Loading the database from its 240 WAV files means decoding, resampling and
+// transforming each of them, and interpolating the azimuths between them, which
+// takes seconds. hrtfpack does that once, on every core, and writes the kernels'
+// spectra and delays for each sample rate to a pack in the database's directory.
+// AudioContext::loadHrtfDatabase() maps a pack for its sample rate if it finds
+// one, and uses it in place.
+//
+// A pack holds FFTFrame's own layout, so it must be built by the same platform
+// and FFT configuration as the library that loads it; a pack that doesn't match
+// is ignored, and the WAV files are loaded instead.
+//
+// Usage:
+//   hrtfpack <hrtf-directory> [sample-rate ...] [--output=<directory>]
+//
+//   hrtf-directory  the directory of IRC_Composite_C_R0195_T*_P*.wav files
+//   sample-rate     rates to build packs for, 44100 to 96000 (default: 44100 48000)
+//   --output        where to write the packs (default: the hrtf-directory)
+
+#include "LabSound/LabSound.h"
+
+#include "internal/HRTFDatabase.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace lab;
+
+static void print_usage(const char * argv0)
+{
+    printf("usage: %s <hrtf-directory> [sample-rate ...] [--output=<directory>]\n", argv0);
+    printf("  hrtf-directory  the directory of IRC_Composite_C_R0195_T*_P*.wav files\n");
+    printf("  sample-rate     rates to build packs for, 44100 to 96000 (default: 44100 48000)\n");
+    printf("  --output        where to write the packs  (default: the hrtf-directory)\n");
+}
+
+int main(int argc, char ** argv)
+{
+    std::string searchPath;
+    std::string outputPath;
+    std::vector<float> sampleRates;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--output=") == 0)
+            outputPath = arg.substr(9);
+        else if (arg == "-h" || arg == "--help")
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        else if (searchPath.empty())
+            searchPath = arg;
+        else
+        {
+            float rate = static_cast<float>(atof(arg.c_str()));
+            if (rate < 44100.f || rate > 96000.f)
+            {
+                fprintf(stderr, "sample rate %s is outside 44100 to 96000\n", arg.c_str());
+                return 1;
+            }
+            sampleRates.push_back(rate);
+        }
+    }
+
+    if (searchPath.empty())
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (outputPath.empty())
+        outputPath = searchPath;
+    if (sampleRates.empty())
+        sampleRates = {44100.f, 48000.f};
+
+    for (float sampleRate : sampleRates)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        HRTFDatabase database(sampleRate, searchPath, false);
+        if (!database.files_found_and_loaded())
+        {
+            fprintf(stderr, "the HRTF files were not found in %s\n", searchPath.c_str());
+            return 1;
+        }
+
+        std::string packPath = HRTFDatabase::packPath(outputPath, sampleRate);
+        if (!database.writePack(packPath))
+        {
+            fprintf(stderr, "could not write %s\n", packPath.c_str());
+            return 1;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%s: %d elevations of %u azimuths, in %.2f s\n", packPath.c_str(),
+               database.numberOfElevations(), HRTFDatabase::numberOfAzimuths(), seconds);
+    }
+
+    return 0;
+}
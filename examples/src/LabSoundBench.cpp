@@ -0,0 +1,1538 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+//
+// LabSoundBench - the benchmark suite. Everything renders offline, through the
+// null device, so results are independent of audio hardware.
+//
+// Benchmark families:
+//
+//   Node/<name>                 every node in the NodeRegistry, fed by an oscillator
+//   Graph/Baseline              an oscillator connected to the destination
+//   Graph/DeepChain/<n>         an oscillator through n gain nodes in series
+//   Graph/WideFanIn/<n>         n oscillators summed into one gain node
+//   Graph/ChannelStrips/<n>     an oscillator through n gain nodes in parallel,
+//                               summed into one; /compiled renders the compiled
+//                               schedule, which applies their gains as it sums
+//   Graph/ParamModulation/<n>   n voices, each with low frequency oscillators on
+//                               its frequency and gain parameters
+//   Oscillator/<type>/<n>       n oscillators of a type, each at its own pitch,
+//                               summed into one gain node; all but FastSine play
+//                               band-limited tables, Custom those of its own wave
+//   Sampled/<quality>/<n>       n looping stereo samples, each at its own pitch,
+//                               resampled at that quality
+//   Filter/EQ/<c>x<b>/<engine>  c channels through b peaking bands each, by a Biquad
+//                               per band and channel, or by a BiquadBank of each
+//                               precision
+//   Delay/Chorus/<n>/<engine>  n voices of a chorus on a stereo sample, each a
+//                               delay modulated by its own oscillator, by a
+//                               DelayNode per voice or by a MultiTapDelayNode of
+//                               n taps
+//   Dynamics/<mode>/<c>         c channels of loud noise through a
+//                               DynamicsCompressorNode in each mode
+//   FFT/<size>                  a forward and inverse transform by an FFTFrame
+//   FFT/<backend>/<size>        the same by each FFTPlan backend, where Accelerate
+//                               is not used, with the round trip's largest error
+//   Convolver/IR/<ms>           a convolver with an impulse response of that length
+//   Convolver/IR/<ms>/background  the same, with the tail convolved on the background
+//                               thread
+//   Convolver/TrueStereo/<ms>   a convolver with a four channel impulse response
+//   Convolver/Prepare/<n>       n convolvers given the same two second impulse
+//                               response, until all of them are ready
+//   HRTF/Panners/<n>            n HRTF panners, at different azimuths
+//   HRTF/Ambisonic/<order>/<n>  n sources at different azimuths, encoded at that
+//                               ambisonic order and decoded to the ears together
+//   HRTF/Load/files             loading the HRTF database from its WAV files
+//   HRTF/Load/pack              mapping the same database from a pack
+//   Offline/Throughput          a mixed graph, rendered by the caller
+//   Offline/Renderer/<jobs>     independent graphs, rendered by an OfflineRenderer
+//
+// The command line follows Google Benchmark, and the JSON output uses its
+// schema, so results can be compared with the tools written for it. Each
+// benchmark runs for at least the minimum time; rendering benchmarks report
+// custom counters alongside the time per iteration:
+//
+//   x_realtime           seconds of audio rendered per second of wall time
+//   frames_per_second    frames rendered per second of wall time
+//   ns_per_quantum       wall time per render quantum
+//   node_ns_per_quantum  for Node/, ns_per_quantum less that of the same graph
+//                        without the node
+//
+// cpu_time is the CPU time of the whole process, so for the benchmarks that
+// render on several threads it may exceed real_time.
+//
+// Usage:
+//   LabSoundBench [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>]
+//                 [--benchmark_repetitions=<n>] [--benchmark_format=console|json]
+//                 [--benchmark_out=<file>] [--benchmark_out_format=console|json]
+//                 [--benchmark_list_tests] [--render_quantum=<frames>]
+
+#include "LabSound/LabSound.h"
+#include "LabSound/extended/Registry.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include "internal/Biquad.h"
+#include "internal/BiquadBank.h"
+#include "internal/FFTFrame.h"
+#include "internal/HRTFDatabase.h"
+#if !USE_ACCELERATE_FFT
+#include "internal/FFTPlan.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lab;
+
+//-------------------------------------------
+//   benchmark harness
+//-------------------------------------------
+
+namespace
+{
+
+struct Options
+{
+    std::string filter = ".";
+    double minTime = 0.5;
+    int repetitions = 1;
+    std::string format = "console";
+    std::string out;
+    std::string outFormat = "json";
+    bool listTests = false;
+    int renderQuantum = 128;
+};
+
+Options g_options;
+
+// The timing loop of a benchmark; the benchmark body runs until keepRunning()
+// returns false. Setup before the first call to keepRunning() is not timed.
+class State
+{
+    using Clock = std::chrono::steady_clock;
+
+    double _minTime;
+    int64_t _iterations = 0;
+    bool _started = false;
+    bool _paused = false;
+    Clock::time_point _start;
+    Clock::duration _elapsed {};
+    std::clock_t _cpuStart = 0;
+    std::clock_t _cpuElapsed = 0;
+    std::string _error;
+
+public:
+    // rendering benchmarks describe one iteration, for the realtime counters
+    uint64_t framesPerIteration = 0;
+    int renderQuantum = 0;
+    float sampleRate = LABSOUND_DEFAULT_SAMPLERATE;
+
+    std::map<std::string, double> counters;
+
+    explicit State(double minTime) : _minTime(minTime) {}
+
+    bool keepRunning()
+    {
+        if (!_error.empty())
+            return false;
+
+        if (!_started)
+        {
+            _started = true;
+            resumeTiming();
+            return true;
+        }
+
+        ++_iterations;
+        if (std::chrono::duration<double>(_elapsed + (Clock::now() - _start)).count() < _minTime)
+            return true;
+
+        pauseTiming();
+        return false;
+    }
+
+    // excludes per-iteration setup from the measurement
+    void pauseTiming()
+    {
+        if (_paused)
+            return;
+        _elapsed += Clock::now() - _start;
+        _cpuElapsed += std::clock() - _cpuStart;
+        _paused = true;
+    }
+
+    void resumeTiming()
+    {
+        _start = Clock::now();
+        _cpuStart = std::clock();
+        _paused = false;
+    }
+
+    void skipWithError(const std::string & message) { _error = message; }
+
+    const std::string & error() const { return _error; }
+    int64_t iterations() const { return _iterations; }
+    double realSeconds() const { return std::chrono::duration<double>(_elapsed).count(); }
+    double cpuSeconds() const { return static_cast<double>(_cpuElapsed) / CLOCKS_PER_SEC; }
+};
+
+struct Benchmark
+{
+    std::string name;
+    std::function<void(State &)> run;
+};
+
+std::vector<Benchmark> & benchmarks()
+{
+    static std::vector<Benchmark> registered;
+    return registered;
+}
+
+void addBenchmark(const std::string & name, std::function<void(State &)> run)
+{
+    benchmarks().push_back({name, std::move(run)});
+}
+
+struct Run
+{
+    std::string name;
+    std::string runName;
+    int familyIndex = 0;
+    int repetitionIndex = 0;
+    std::string aggregate;  // empty for an iteration run
+    int64_t iterations = 0;
+    double realTime = 0;  // ns per iteration
+    double cpuTime = 0;
+    std::map<std::string, double> counters;
+    std::string error;
+};
+
+Run runBenchmark(const Benchmark & benchmark, int familyIndex, int repetition)
+{
+    State state(g_options.minTime);
+    benchmark.run(state);
+
+    Run run;
+    run.name = benchmark.name;
+    run.runName = benchmark.name;
+    run.familyIndex = familyIndex;
+    run.repetitionIndex = repetition;
+    run.error = state.error();
+    run.iterations = state.iterations();
+    if (!run.error.empty() || !run.iterations)
+    {
+        if (run.error.empty())
+            run.error = "the benchmark did not run";
+        return run;
+    }
+
+    run.realTime = 1.e9 * state.realSeconds() / run.iterations;
+    run.cpuTime = 1.e9 * state.cpuSeconds() / run.iterations;
+    run.counters = state.counters;
+
+    if (state.framesPerIteration)
+    {
+        const double frames = static_cast<double>(state.framesPerIteration) * run.iterations;
+        run.counters["frames_per_second"] = frames / state.realSeconds();
+        run.counters["x_realtime"] = frames / state.sampleRate / state.realSeconds();
+        run.counters["ns_per_quantum"] = 1.e9 * state.realSeconds() / (frames / state.renderQuantum);
+    }
+    return run;
+}
+
+std::vector<Run> aggregates(const std::vector<Run> & runs)
+{
+    std::vector<Run> result;
+    if (runs.size() < 2)
+        return result;
+
+    auto statistic = [&](const std::string & name, std::function<double(std::vector<double>)> fn) {
+        Run aggregate = runs.front();
+        aggregate.name = runs.front().runName + "_" + name;
+        aggregate.aggregate = name;
+        aggregate.iterations = static_cast<int64_t>(runs.size());
+
+        auto collect = [&](std::function<double(const Run &)> field) {
+            std::vector<double> values;
+            for (const Run & r : runs)
+                values.push_back(field(r));
+            return fn(values);
+        };
+        aggregate.realTime = collect([](const Run & r) { return r.realTime; });
+        aggregate.cpuTime = collect([](const Run & r) { return r.cpuTime; });
+        for (auto & counter : aggregate.counters)
+        {
+            const std::string & key = counter.first;
+            counter.second = collect([&key](const Run & r) { return r.counters.at(key); });
+        }
+        result.push_back(aggregate);
+    };
+
+    auto mean = [](std::vector<double> v) {
+        double sum = 0;
+        for (double x : v)
+            sum += x;
+        return sum / v.size();
+    };
+    auto median = [](std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        size_t mid = v.size() / 2;
+        return v.size() & 1 ? v[mid] : 0.5 * (v[mid - 1] + v[mid]);
+    };
+    auto stddev = [mean](std::vector<double> v) {
+        double m = mean(v);
+        double sum = 0;
+        for (double x : v)
+            sum += (x - m) * (x - m);
+        return std::sqrt(sum / (v.size() - 1));
+    };
+
+    statistic("mean", mean);
+    statistic("median", median);
+    statistic("stddev", stddev);
+    return result;
+}
+
+//-------------------------------------------
+//   reporters
+//-------------------------------------------
+
+std::string formatTime(double ns)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.0f ns", ns);
+    return buf;
+}
+
+std::string formatCounter(double value)
+{
+    char buf[32];
+    if (std::fabs(value) >= 1.e9)
+        snprintf(buf, sizeof(buf), "%.4gG", value * 1.e-9);
+    else if (std::fabs(value) >= 1.e6)
+        snprintf(buf, sizeof(buf), "%.4gM", value * 1.e-6);
+    else if (std::fabs(value) >= 1.e3)
+        snprintf(buf, sizeof(buf), "%.4gk", value * 1.e-3);
+    else
+        snprintf(buf, sizeof(buf), "%.4g", value);
+    return buf;
+}
+
+void writeConsoleHeader(FILE * out, int width)
+{
+    const std::string rule(width + 48, '-');
+    fprintf(out, "%s\n", rule.c_str());
+    fprintf(out, "%-*s %15s %15s %12s UserCounters...\n", width, "Benchmark", "Time", "CPU", "Iterations");
+    fprintf(out, "%s\n", rule.c_str());
+}
+
+void writeConsoleRow(FILE * out, const Run & r, int width)
+{
+    if (!r.error.empty())
+    {
+        fprintf(out, "%-*s ERROR OCCURRED: '%s'\n", width, r.name.c_str(), r.error.c_str());
+        return;
+    }
+    fprintf(out, "%-*s %15s %15s %12lld", width, r.name.c_str(),
+            formatTime(r.realTime).c_str(), formatTime(r.cpuTime).c_str(), static_cast<long long>(r.iterations));
+    for (const auto & counter : r.counters)
+        fprintf(out, " %s=%s", counter.first.c_str(), formatCounter(counter.second).c_str());
+    fprintf(out, "\n");
+}
+
+void writeConsole(FILE * out, const std::vector<Run> & runs)
+{
+    size_t width = 10;
+    for (const Run & r : runs)
+        width = std::max(width, r.name.size());
+
+    writeConsoleHeader(out, static_cast<int>(width));
+    for (const Run & r : runs)
+        writeConsoleRow(out, r, static_cast<int>(width));
+}
+
+std::string jsonString(const std::string & s)
+{
+    std::string result = "\"";
+    for (char c : s)
+    {
+        switch (c)
+        {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    result += buf;
+                }
+                else
+                    result += c;
+        }
+    }
+    return result + "\"";
+}
+
+std::string jsonNumber(double value)
+{
+    if (!std::isfinite(value))
+        return "0";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", value);
+    return buf;
+}
+
+void writeJson(FILE * out, const std::vector<Run> & runs, const std::string & executable)
+{
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": %s,\n", jsonString(date).c_str());
+    fprintf(out, "    \"executable\": %s,\n", jsonString(executable).c_str());
+    fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#if defined(NDEBUG)
+    fprintf(out, "    \"library_build_type\": \"release\",\n");
+#else
+    fprintf(out, "    \"library_build_type\": \"debug\",\n");
+#endif
+    fprintf(out, "    \"simd_level\": %s,\n", jsonString(VectorMath::simdLevelName(VectorMath::simdLevel())).c_str());
+    fprintf(out, "    \"sample_rate\": %d,\n", static_cast<int>(LABSOUND_DEFAULT_SAMPLERATE));
+    fprintf(out, "    \"render_quantum\": %d\n", g_options.renderQuantum);
+    fprintf(out, "  },\n  \"benchmarks\": [");
+
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const Run & r = runs[i];
+        fprintf(out, "%s\n    {\n", i ? "," : "");
+        fprintf(out, "      \"name\": %s,\n", jsonString(r.name).c_str());
+        fprintf(out, "      \"family_index\": %d,\n", r.familyIndex);
+        fprintf(out, "      \"per_family_instance_index\": 0,\n");
+        fprintf(out, "      \"run_name\": %s,\n", jsonString(r.runName).c_str());
+        fprintf(out, "      \"run_type\": \"%s\",\n", r.aggregate.empty() ? "iteration" : "aggregate");
+        fprintf(out, "      \"repetitions\": %d,\n", g_options.repetitions);
+        if (r.aggregate.empty())
+            fprintf(out, "      \"repetition_index\": %d,\n", r.repetitionIndex);
+        else
+            fprintf(out, "      \"aggregate_name\": %s,\n      \"aggregate_unit\": \"time\",\n", jsonString(r.aggregate).c_str());
+        fprintf(out, "      \"threads\": 1,\n");
+        if (!r.error.empty())
+        {
+            fprintf(out, "      \"error_occurred\": true,\n");
+            fprintf(out, "      \"error_message\": %s\n    }", jsonString(r.error).c_str());
+            continue;
+        }
+        fprintf(out, "      \"iterations\": %lld,\n", static_cast<long long>(r.iterations));
+        fprintf(out, "      \"real_time\": %s,\n", jsonNumber(r.realTime).c_str());
+        fprintf(out, "      \"cpu_time\": %s,\n", jsonNumber(r.cpuTime).c_str());
+        fprintf(out, "      \"time_unit\": \"ns\"");
+        for (const auto & counter : r.counters)
+            fprintf(out, ",\n      %s: %s", jsonString(counter.first).c_str(), jsonNumber(counter.second).c_str());
+        fprintf(out, "\n    }");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+//-------------------------------------------
+//   rendering
+//-------------------------------------------
+
+// An offline context rendering to the null device. Nodes are owned by their
+// creators rather than the context, so the rig keeps the graph alive.
+struct Rig
+{
+    std::shared_ptr<AudioContext> context;
+    std::shared_ptr<AudioDestinationNode> destination;
+    std::vector<std::shared_ptr<AudioNode>> nodes;
+    std::vector<std::shared_ptr<AudioNode>> pulled;
+
+    explicit Rig(int renderThreadCount = 0)
+    {
+        context = std::make_shared<AudioContext>(true /*isOffline*/, false /*autoDispatchEvents*/,
+                                                 renderThreadCount, g_options.renderQuantum);
+
+        AudioStreamConfig offlineConfig;
+        offlineConfig.device_index = 0;
+        offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+        offlineConfig.desired_channels = 2;
+        AudioStreamConfig inputConfig = {};
+
+        destination = std::make_shared<AudioDestinationNode>(
+            *context, std::make_unique<AudioDevice_Null>(inputConfig, offlineConfig));
+        context->setDestinationNode(destination);
+    }
+
+    ~Rig()
+    {
+        if (pulled.empty())
+            return;
+
+        for (auto & node : pulled)
+            context->removeAutomaticPullNode(node);
+        settle();
+    }
+
+    template <typename T>
+    std::shared_ptr<T> add(std::shared_ptr<T> node)
+    {
+        nodes.push_back(node);
+        return node;
+    }
+
+    // a node without outputs is processed by the context
+    void pull(std::shared_ptr<AudioNode> node)
+    {
+        context->addAutomaticPullNode(node);
+        pulled.push_back(node);
+    }
+
+    std::shared_ptr<OscillatorNode> oscillator(float frequency, OscillatorType type = OscillatorType::SAWTOOTH)
+    {
+        auto osc = add(std::make_shared<OscillatorNode>(*context));
+        osc->setType(type);
+        osc->frequency()->setValue(frequency);
+        osc->start(0);
+        return osc;
+    }
+
+    // renders for the minimum time, a block of quanta per iteration
+    void measure(State & state)
+    {
+        const uint64_t frames = 32 * static_cast<uint64_t>(context->renderQuantumSize());
+        state.framesPerIteration = frames;
+        state.renderQuantum = context->renderQuantumSize();
+        state.sampleRate = context->sampleRate();
+
+        // the sink reads each quantum, as a consumer would
+        volatile float sink = 0;
+        OfflineRenderCallbackSink consumer([&sink](const AudioBus & bus, int) {
+            sink = sink + bus.channel(0)->data()[0];
+            return true;
+        });
+
+        // settle the graph, so that the first iteration doesn't pay for its setup
+        destination->offlineRender(consumer, frames);
+
+        while (state.keepRunning())
+            destination->offlineRender(consumer, frames);
+    }
+
+    // renders a quantum, so that pending connections and disconnections take effect
+    void settle()
+    {
+        OfflineRenderCallbackSink discard([](const AudioBus &, int) { return true; });
+        destination->offlineRender(discard, context->renderQuantumSize());
+    }
+};
+
+std::shared_ptr<AudioBus> noiseBus(int channels, float seconds, float decay)
+{
+    const int length = static_cast<int>(seconds * LABSOUND_DEFAULT_SAMPLERATE);
+    auto bus = std::make_shared<AudioBus>(channels, length);
+    bus->setSampleRate(LABSOUND_DEFAULT_SAMPLERATE);
+
+    uint32_t seed = 0x1234567;
+    for (int c = 0; c < channels; ++c)
+    {
+        float * data = bus->channel(c)->mutableData();
+        for (int i = 0; i < length; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            float white = static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * 2.f - 1.f;
+            data[i] = white * std::exp(-decay * i / length);
+        }
+    }
+    return bus;
+}
+
+//-------------------------------------------
+//   Node/
+//-------------------------------------------
+
+// Nodes under test reach the destination through a gain node, as they would
+// in an application; the dynamics compressor, for one, can't drive the
+// destination directly.
+std::shared_ptr<GainNode> addOutputGain(Rig & rig)
+{
+    auto gain = rig.add(std::make_shared<GainNode>(*rig.context));
+    rig.context->connect(rig.destination, gain);
+    return gain;
+}
+
+// Creates the named node in the rig, with whatever it needs to make sound,
+// and connects it to the destination. Sources are measured alone, processors
+// with an oscillator driving them. Returns null, and the reason, if the node
+// can't be measured.
+std::shared_ptr<AudioNode> addRegisteredNode(Rig & rig, const std::string & name, std::string & error)
+{
+    AudioNode * created = NodeRegistry::Instance().Create(name, *rig.context);
+    if (!created)
+    {
+        error = "the registry does not create this node";
+        return {};
+    }
+
+    auto node = rig.add(std::shared_ptr<AudioNode>(created));
+
+    if (name == "SampledAudio")
+    {
+        auto sampled = std::dynamic_pointer_cast<SampledAudioNode>(node);
+        sampled->setBus(noiseBus(2, 1.f, 0.f));
+        sampled->schedule(0.f, -1);
+    }
+    else
+    {
+        if (name == "Convolver")
+        {
+            auto convolver = std::dynamic_pointer_cast<ConvolverNode>(node);
+            convolver->setImpulse(noiseBus(2, 1.f, 8.f));
+            convolver->waitForImpulse();
+        }
+        else if (name == "Function")
+        {
+            std::dynamic_pointer_cast<FunctionNode>(node)->setFunction(
+                [phase = 0.0](ContextRenderLock & r, FunctionNode *, int channel, float * buffer, int frames) mutable {
+                    const double step = 2.0 * 3.14159265358979 * 220.0 / r.context()->sampleRate();
+                    double p = phase;
+                    for (int i = 0; i < frames; ++i, p += step)
+                        buffer[i] = static_cast<float>(std::sin(p));
+                    if (channel == 0)
+                        phase = std::fmod(p, 2.0 * 3.14159265358979);
+                });
+        }
+        else if (name == "Granulation")
+        {
+            ContextRenderLock r(rig.context.get(), "LabSoundBench");
+            std::dynamic_pointer_cast<GranulationNode>(node)->setGrainSource(r, noiseBus(1, 1.f, 0.f));
+        }
+        else if (name == "ADSR")
+            std::dynamic_pointer_cast<ADSRNode>(node)->gate()->setValue(1.f);
+
+        if (node->isScheduledNode())
+            std::static_pointer_cast<AudioScheduledSourceNode>(node)->start(0.f);
+    }
+
+    // sinks are pulled by the context; a processor without an output can't be
+    // pulled at all
+    const bool isSink = std::dynamic_pointer_cast<AudioBasicInspectorNode>(node) ||
+                        std::dynamic_pointer_cast<RecorderNode>(node) ||
+                        std::dynamic_pointer_cast<TextureRecorderNode>(node);
+    if (!node->numberOfOutputs() && !isSink)
+    {
+        error = "the node has no outputs";
+        return {};
+    }
+
+    auto output = addOutputGain(rig);
+    if (node->numberOfInputs() > 0)
+    {
+        auto driver = rig.oscillator(220.f);
+        rig.context->connect(node, driver);
+
+        // a sink's driver is heard, as the driver is in the baseline
+        if (!node->numberOfOutputs())
+            rig.context->connect(output, driver);
+    }
+
+    if (node->numberOfOutputs() > 0)
+        rig.context->connect(output, node);
+    else
+        rig.pull(node);
+
+    return node;
+}
+
+// the cost of the rig without the node under test, measured once
+double baselineNsPerQuantum(bool withDriver)
+{
+    static std::map<bool, double> cache;
+    auto cached = cache.find(withDriver);
+    if (cached != cache.end())
+        return cached->second;
+
+    Rig rig;
+    auto gain = addOutputGain(rig);
+    if (withDriver)
+        rig.context->connect(gain, rig.oscillator(220.f));
+
+    State state(g_options.minTime);
+    rig.measure(state);
+    const double frames = static_cast<double>(state.framesPerIteration) * state.iterations();
+    const double ns = state.iterations() ? 1.e9 * state.realSeconds() / (frames / state.renderQuantum) : 0;
+    cache[withDriver] = ns;
+    return ns;
+}
+
+void registerNodeBenchmarks()
+{
+    for (const std::string & name : NodeRegistry::Instance().Names())
+    {
+        addBenchmark("Node/" + name, [name](State & state) {
+            Rig rig;
+            std::string error;
+            auto node = addRegisteredNode(rig, name, error);
+            if (!node)
+            {
+                state.skipWithError(error);
+                return;
+            }
+
+            rig.measure(state);
+
+            if (state.iterations())
+            {
+                const double frames = static_cast<double>(state.framesPerIteration) * state.iterations();
+                const double ns = 1.e9 * state.realSeconds() / (frames / state.renderQuantum);
+                state.counters["node_ns_per_quantum"] = ns - baselineNsPerQuantum(node->numberOfInputs() > 0);
+            }
+        });
+    }
+}
+
+//-------------------------------------------
+//   Graph/
+//-------------------------------------------
+
+void registerGraphBenchmarks()
+{
+    addBenchmark("Graph/Baseline", [](State & state) {
+        Rig rig;
+        rig.context->connect(rig.destination, rig.oscillator(220.f));
+        rig.measure(state);
+    });
+
+    for (int length : {16, 64, 256})
+    {
+        addBenchmark("Graph/DeepChain/" + std::to_string(length), [length](State & state) {
+            Rig rig;
+            std::shared_ptr<AudioNode> tail = rig.oscillator(220.f);
+            for (int i = 0; i < length; ++i)
+            {
+                auto gain = rig.add(std::make_shared<GainNode>(*rig.context));
+                gain->gain()->setValue(0.999f);
+                rig.context->connect(gain, tail);
+                tail = gain;
+            }
+            rig.context->connect(rig.destination, tail);
+            rig.measure(state);
+        });
+    }
+
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    for (int width : {16, 64, 256})
+    {
+        for (int threads : {0, 4})
+        {
+            if (threads > cores)
+                continue;
+
+            std::string name = "Graph/WideFanIn/" + std::to_string(width);
+            if (threads)
+                name += "/threads:" + std::to_string(threads);
+
+            addBenchmark(name, [width, threads](State & state) {
+                Rig rig(threads);
+                auto mix = rig.add(std::make_shared<GainNode>(*rig.context));
+                mix->gain()->setValue(1.f / width);
+                for (int i = 0; i < width; ++i)
+                    rig.context->connect(mix, rig.oscillator(55.f * (1 + i % 32)));
+                rig.context->connect(rig.destination, mix);
+                rig.measure(state);
+            });
+        }
+    }
+
+    for (int width : {16, 64, 256})
+    {
+        for (bool compiled : {false, true})
+        {
+            std::string name = "Graph/ChannelStrips/" + std::to_string(width);
+            if (compiled)
+                name += "/compiled";
+
+            addBenchmark(name, [width, compiled](State & state) {
+                Rig rig;
+                rig.context->setCompiledRendering(compiled);
+                auto mix = rig.add(std::make_shared<GainNode>(*rig.context));
+                auto osc = rig.oscillator(220.f);
+                for (int i = 0; i < width; ++i)
+                {
+                    auto fader = rig.add(std::make_shared<GainNode>(*rig.context));
+                    fader->gain()->setValue(1.f / (width + i));
+                    rig.context->connect(fader, osc);
+                    rig.context->connect(mix, fader);
+                }
+                rig.context->connect(rig.destination, mix);
+                rig.measure(state);
+            });
+        }
+    }
+
+    for (int voices : {4, 16, 64})
+    {
+        addBenchmark("Graph/ParamModulation/" + std::to_string(voices), [voices](State & state) {
+            Rig rig;
+            auto mix = rig.add(std::make_shared<GainNode>(*rig.context));
+            mix->gain()->setValue(1.f / voices);
+            for (int i = 0; i < voices; ++i)
+            {
+                auto osc = rig.oscillator(110.f * (1 + i % 8));
+
+                // vibrato, in Hz around the oscillator's frequency
+                auto vibrato = rig.oscillator(5.f + 0.1f * i, OscillatorType::SINE);
+                vibrato->amplitude()->setValue(3.f);
+                rig.context->connectParam(osc->frequency(), vibrato, 0);
+
+                // tremolo, around a gain of one half
+                auto tremolo = rig.oscillator(3.f + 0.2f * i, OscillatorType::TRIANGLE);
+                tremolo->amplitude()->setValue(0.25f);
+                auto gain = rig.add(std::make_shared<GainNode>(*rig.context));
+                gain->gain()->setValue(0.5f);
+                rig.context->connectParam(gain->gain(), tremolo, 0);
+
+                rig.context->connect(gain, osc);
+                rig.context->connect(mix, gain);
+            }
+            rig.context->connect(rig.destination, mix);
+            rig.measure(state);
+        });
+    }
+}
+
+//-------------------------------------------
+//   Oscillator/
+//-------------------------------------------
+
+void registerOscillatorBenchmarks()
+{
+    const std::pair<const char *, OscillatorType> types[] = {
+        {"Sine", OscillatorType::SINE},
+        {"FastSine", OscillatorType::FAST_SINE},
+        {"Square", OscillatorType::SQUARE},
+        {"Sawtooth", OscillatorType::SAWTOOTH},
+        {"Triangle", OscillatorType::TRIANGLE},
+        {"Custom", OscillatorType::CUSTOM},
+    };
+
+    for (const auto & type : types)
+    {
+        for (int count : {1, 64})
+        {
+            addBenchmark(std::string("Oscillator/") + type.first + "/" + std::to_string(count), [type, count](State & state) {
+                Rig rig;
+
+                // an organ stop, its partials falling away as 1/n^2
+                std::shared_ptr<PeriodicWave> wave;
+                if (type.second == OscillatorType::CUSTOM)
+                {
+                    std::vector<float> real(32, 0.f);
+                    std::vector<float> imag(32, 0.f);
+                    for (int n = 1; n < 32; ++n)
+                        imag[n] = 1.f / (n * n);
+                    wave = std::make_shared<PeriodicWave>(rig.context->sampleRate(), OscillatorType::CUSTOM, real, imag);
+                }
+
+                auto mix = rig.add(std::make_shared<GainNode>(*rig.context));
+                mix->gain()->setValue(1.f / count);
+                for (int i = 0; i < count; ++i)
+                {
+                    auto osc = rig.oscillator(55.f * std::pow(2.f, i / 12.f), type.second);
+                    if (wave)
+                        osc->setPeriodicWave(wave);
+                    rig.context->connect(mix, osc);
+                }
+                rig.context->connect(rig.destination, mix);
+                rig.measure(state);
+            });
+        }
+    }
+}
+
+//-------------------------------------------
+//   Sampled/
+//-------------------------------------------
+
+void registerSampledBenchmarks()
+{
+    const std::pair<const char *, SampledAudioNode::ResamplingQuality> qualities[] = {
+        {"Linear", SampledAudioNode::RESAMPLE_LINEAR},
+        {"Cubic", SampledAudioNode::RESAMPLE_CUBIC},
+        {"Sinc16", SampledAudioNode::RESAMPLE_SINC16},
+        {"Sinc32", SampledAudioNode::RESAMPLE_SINC32},
+        {"Sinc64", SampledAudioNode::RESAMPLE_SINC64},
+    };
+
+    for (const auto & quality : qualities)
+    {
+        for (int voices : {16, 256})
+        {
+            addBenchmark(std::string("Sampled/") + quality.first + "/" + std::to_string(voices), [quality, voices](State & state) {
+                Rig rig;
+                auto bus = noiseBus(2, 1.f, 0.f);
+                auto mix = rig.add(std::make_shared<GainNode>(*rig.context));
+                mix->gain()->setValue(1.f / voices);
+                for (int i = 0; i < voices; ++i)
+                {
+                    auto sampled = rig.add(std::make_shared<SampledAudioNode>(*rig.context));
+                    sampled->setQuality(quality.second);
+                    sampled->setBus(bus);
+                    sampled->playbackRate()->setValue(0.5f + 0.041f * (i % 37));
+                    sampled->schedule(0.f, -1);
+                    rig.context->connect(mix, sampled);
+                }
+                rig.context->connect(rig.destination, mix);
+                rig.measure(state);
+            });
+        }
+    }
+}
+
+//-------------------------------------------
+//   Filter/
+//-------------------------------------------
+
+void registerFilterBenchmarks()
+{
+    const int quantum = 128;
+
+    for (int channels : {2, 64})
+    {
+        for (int bands : {1, 10})
+        {
+            std::string name = "Filter/EQ/" + std::to_string(channels) + "x" + std::to_string(bands);
+
+            // bands an octave apart from 40Hz, alternately cut and boosted
+            auto bandCoefficients = [](int band) {
+                return BiquadBank::design(FilterType::PEAKING, 40.0 * std::pow(2.0, band) / (0.5 * LABSOUND_DEFAULT_SAMPLERATE),
+                                          1.0, band & 1 ? 6.0 : -6.0);
+            };
+
+            auto makeSignal = [channels]() {
+                std::vector<std::vector<float>> signal(channels, std::vector<float>(quantum));
+                for (int ch = 0; ch < channels; ++ch)
+                    for (int i = 0; i < quantum; ++i)
+                        signal[ch][i] = std::sin(0.05f * (ch + 1) * i) + 0.25f * std::sin(0.31f * i);
+                return signal;
+            };
+
+            auto report = [channels, bands](State & state) {
+                if (state.iterations())
+                    state.counters["ns_per_band_sample"] = 1.e9 * state.realSeconds() / (double(state.iterations()) * quantum * channels * bands);
+            };
+
+            addBenchmark(name + "/Biquad", [=](State & state) {
+                std::vector<Biquad> filters(channels * bands);
+                for (int band = 0; band < bands; ++band)
+                    for (int ch = 0; ch < channels; ++ch)
+                        filters[band * channels + ch].setPeakingParams(40.0 * std::pow(2.0, band) / (0.5 * LABSOUND_DEFAULT_SAMPLERATE),
+                                                                       1.0, band & 1 ? 6.0 : -6.0);
+                auto signal = makeSignal();
+                while (state.keepRunning())
+                    for (int band = 0; band < bands; ++band)
+                        for (int ch = 0; ch < channels; ++ch)
+                            filters[band * channels + ch].process(signal[ch].data(), signal[ch].data(), quantum);
+                report(state);
+            });
+
+            for (auto precision : {BiquadBank::Precision::Single, BiquadBank::Precision::Double})
+            {
+                const char * suffix = precision == BiquadBank::Precision::Single ? "/BiquadBank" : "/BiquadBank/double";
+                addBenchmark(name + suffix, [=](State & state) {
+                    BiquadBank bank;
+                    bank.setSize(channels, bands);
+                    bank.setPrecision(precision);
+                    for (int band = 0; band < bands; ++band)
+                        bank.setCoefficients(band, bandCoefficients(band));
+                    auto signal = makeSignal();
+                    std::vector<float *> data(channels);
+                    for (int ch = 0; ch < channels; ++ch)
+                        data[ch] = signal[ch].data();
+                    while (state.keepRunning())
+                        bank.process(data.data(), data.data(), quantum, false);
+                    report(state);
+                });
+            }
+        }
+    }
+}
+
+//-------------------------------------------
+//   Delay/
+//-------------------------------------------
+
+void registerDelayBenchmarks()
+{
+    for (int voices : {2, 8})
+    {
+        const std::string name = "Delay/Chorus/" + std::to_string(voices);
+
+        // each voice's delay swings 2ms around its own, at its own rate
+        auto lfo = [](Rig & rig, int voice) {
+            auto osc = rig.oscillator(0.3f + 0.17f * voice, OscillatorType::SINE);
+            osc->amplitude()->setValue(0.002f);
+            return osc;
+        };
+
+        auto source = [](Rig & rig) {
+            auto sampled = rig.add(std::make_shared<SampledAudioNode>(*rig.context));
+            sampled->setBus(noiseBus(2, 1.f, 0.f));
+            sampled->schedule(0.f, -1);
+            return sampled;
+        };
+
+        addBenchmark(name + "/DelayNode", [=](State & state) {
+            Rig rig;
+            auto sampled = source(rig);
+            auto mix = rig.add(std::make_shared<GainNode>(*rig.context));
+            mix->gain()->setValue(1.f / voices);
+            for (int i = 0; i < voices; ++i)
+            {
+                auto delay = rig.add(std::make_shared<DelayNode>(*rig.context, 0.1));
+                delay->delayTime()->setFloat(0.010f + 0.003f * i);
+                rig.context->connectParam(delay->modulation(), lfo(rig, i), 0);
+                rig.context->connect(delay, sampled);
+                rig.context->connect(mix, delay);
+            }
+            rig.context->connect(rig.destination, mix);
+            rig.measure(state);
+        });
+
+        addBenchmark(name + "/MultiTapDelayNode", [=](State & state) {
+            Rig rig;
+            auto sampled = source(rig);
+            auto delay = rig.add(std::make_shared<MultiTapDelayNode>(*rig.context, 0.1));
+            delay->setTapCount(voices);
+            for (int i = 0; i < voices; ++i)
+            {
+                delay->delayTime(i)->setValue(0.010f + 0.003f * i);
+                delay->gain(i)->setValue(1.f / voices);
+                rig.context->connectParam(delay->delayTime(i), lfo(rig, i), 0);
+            }
+            rig.context->connect(delay, sampled);
+            rig.context->connect(rig.destination, delay);
+            rig.measure(state);
+        });
+    }
+}
+
+//-------------------------------------------
+//   Dynamics/
+//-------------------------------------------
+
+void registerDynamicsBenchmarks()
+{
+    const std::pair<const char *, DynamicsCompressorNode::CompressorMode> modes[] = {
+        {"Classic", DynamicsCompressorNode::COMPRESSOR_CLASSIC},
+        {"Lookahead", DynamicsCompressorNode::COMPRESSOR_LOOKAHEAD},
+    };
+
+    for (const auto & mode : modes)
+    {
+        for (int channels : {2, 8})
+        {
+            addBenchmark(std::string("Dynamics/") + mode.first + "/" + std::to_string(channels), [mode, channels](State & state) {
+                Rig rig;
+                auto sampled = rig.add(std::make_shared<SampledAudioNode>(*rig.context));
+                sampled->setBus(noiseBus(channels, 1.f, 0.f));
+                sampled->schedule(0.f, -1);
+
+                auto compressor = rig.add(std::make_shared<DynamicsCompressorNode>(*rig.context));
+                compressor->setMode(mode.second);
+                compressor->knee()->setValue(6.f);
+                rig.context->connect(compressor, sampled);
+                rig.context->connect(rig.destination, compressor);
+                rig.measure(state);
+            });
+        }
+    }
+}
+
+//-------------------------------------------
+//   FFT/
+//-------------------------------------------
+
+void registerFFTBenchmarks()
+{
+    for (int size = 256; size <= 16384; size *= 2)
+    {
+        addBenchmark("FFT/" + std::to_string(size), [size](State & state) {
+            FFTFrame frame(size);
+            std::vector<float> signal(size);
+            for (int i = 0; i < size; ++i)
+                signal[i] = std::sin(0.05f * i) + 0.25f * std::sin(0.31f * i);
+            std::vector<float> result(size);
+
+            while (state.keepRunning())
+            {
+                frame.computeForwardFFT(signal.data());
+                frame.computeInverseFFT(result.data());
+            }
+            if (state.iterations())
+                state.counters["ns_per_sample"] = 1.e9 * state.realSeconds() / (double(state.iterations()) * size);
+        });
+    }
+
+#if !USE_ACCELERATE_FFT
+    for (FFTBackend backend : {FFTBackend::Kiss, FFTBackend::Ooura, FFTBackend::Stockham})
+    {
+        for (int size = 64; size <= 65536; size *= 2)
+        {
+            std::string name = std::string("FFT/") + FFTPlan::backendName(backend) + "/" + std::to_string(size);
+            addBenchmark(name, [size, backend](State & state) {
+                std::shared_ptr<const FFTPlan> plan = FFTPlan::get(size, backend);
+                std::vector<float> signal(size);
+                for (int i = 0; i < size; ++i)
+                    signal[i] = std::sin(0.05f * i) + 0.25f * std::sin(0.31f * i);
+                std::vector<float> real(size / 2 + 1), imag(size / 2 + 1);
+                std::vector<float> work(plan->workSize());
+                std::vector<float> result(size);
+
+                while (state.keepRunning())
+                {
+                    plan->forward(signal.data(), real.data(), imag.data(), work.data());
+                    plan->inverse(real.data(), imag.data(), result.data(), work.data());
+                }
+                if (state.iterations())
+                    state.counters["ns_per_sample"] = 1.e9 * state.realSeconds() / (double(state.iterations()) * size);
+
+                double error = 0;
+                for (int i = 0; i < size; ++i)
+                    error = std::max(error, std::abs(double(result[i]) / size - signal[i]));
+                state.counters["max_error"] = error;
+            });
+        }
+    }
+#endif
+}
+
+//-------------------------------------------
+//   Convolver/
+//-------------------------------------------
+
+void registerConvolverBenchmarks()
+{
+    for (bool background : {false, true})
+    {
+        for (int ms : {100, 500, 1000, 2000, 4000})
+        {
+            std::string name = "Convolver/IR/" + std::to_string(ms) + "ms" + (background ? "/background" : "");
+            addBenchmark(name, [ms, background](State & state) {
+                Rig rig;
+                auto convolver = rig.add(std::make_shared<ConvolverNode>(*rig.context));
+                convolver->setBackgroundTail(background);
+                convolver->setImpulse(noiseBus(2, ms * 0.001f, 8.f));
+                convolver->waitForImpulse();
+                rig.context->connect(convolver, rig.oscillator(220.f));
+                rig.context->connect(rig.destination, convolver);
+                rig.measure(state);
+            });
+        }
+    }
+
+    for (int ms : {1000, 4000})
+    {
+        addBenchmark("Convolver/TrueStereo/" + std::to_string(ms) + "ms", [ms](State & state) {
+            Rig rig;
+            auto convolver = rig.add(std::make_shared<ConvolverNode>(*rig.context));
+            convolver->setImpulse(noiseBus(4, ms * 0.001f, 8.f));
+            convolver->waitForImpulse();
+            rig.context->connect(convolver, rig.oscillator(220.f));
+            rig.context->connect(rig.destination, convolver);
+            rig.measure(state);
+        });
+    }
+
+    // The prepared response is shared while any convolver holds it, so each
+    // iteration prepares it once, and the rest of the convolvers find it.
+    for (int n : {1, 40})
+    {
+        addBenchmark("Convolver/Prepare/" + std::to_string(n), [n](State & state) {
+            Rig rig;
+            auto response = noiseBus(2, 2.f, 8.f);
+            double setSeconds = 0;
+            while (state.keepRunning())
+            {
+                std::vector<std::shared_ptr<ConvolverNode>> convolvers;
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < n; ++i)
+                {
+                    convolvers.push_back(std::make_shared<ConvolverNode>(*rig.context));
+                    convolvers.back()->setImpulse(response);
+                }
+                setSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                for (auto & convolver : convolvers)
+                    convolver->waitForImpulse();
+            }
+            if (state.iterations())
+                state.counters["set_ms"] = 1.e3 * setSeconds / double(state.iterations());
+        });
+    }
+}
+
+//-------------------------------------------
+//   HRTF/
+//-------------------------------------------
+
+// The HRTF database is loaded once per process, into a context that outlives
+// the benchmarks; each benchmark connects its panners for the duration of its
+// measurement. The rig keeps the disconnected panners for the lifetime of the
+// process, rather than destroy nodes the context has rendered.
+Rig * hrtfRig()
+{
+    static std::unique_ptr<Rig> rig;
+    static bool loaded = false;
+    if (!rig)
+    {
+        rig.reset(new Rig());
+        loaded = rig->context->loadHrtfDatabase(SAMPLE_SRC_DIR "/hrtf");
+    }
+    return loaded ? rig.get() : nullptr;
+}
+
+void registerHRTFBenchmarks()
+{
+    for (int panners : {1, 8, 32})
+    {
+        addBenchmark("HRTF/Panners/" + std::to_string(panners), [panners](State & state) {
+            Rig * rig = hrtfRig();
+            if (!rig)
+            {
+                state.skipWithError("the HRTF database was not found in " SAMPLE_SRC_DIR "/hrtf");
+                return;
+            }
+
+            auto mix = rig->add(std::make_shared<GainNode>(*rig->context));
+            mix->gain()->setValue(1.f / panners);
+            for (int i = 0; i < panners; ++i)
+            {
+                auto osc = rig->oscillator(110.f * (1 + i % 8));
+                auto panner = rig->add(std::make_shared<PannerNode>(*rig->context));
+                panner->setPanningModel(PanningModel::HRTF);
+                const float azimuth = 2.f * 3.14159265f * i / panners;
+                panner->setPosition(2.f * std::sin(azimuth), 0.f, -2.f * std::cos(azimuth));
+
+                rig->context->connect(panner, osc);
+                rig->context->connect(mix, panner);
+            }
+            rig->context->connect(rig->destination, mix);
+
+            rig->measure(state);
+
+            rig->context->disconnect(rig->destination, mix);
+            rig->settle();
+        });
+    }
+
+    for (int order : {1, 3})
+    {
+        for (int sources : {8, 32, 256, 1024})
+        {
+            addBenchmark("HRTF/Ambisonic/" + std::to_string(order) + "/" + std::to_string(sources), [order, sources](State & state) {
+                Rig * rig = hrtfRig();
+                if (!rig)
+                {
+                    state.skipWithError("the HRTF database was not found in " SAMPLE_SRC_DIR "/hrtf");
+                    return;
+                }
+
+                auto decoder = rig->add(std::make_shared<AmbisonicDecoderNode>(*rig->context));
+                for (int i = 0; i < sources; ++i)
+                {
+                    auto osc = rig->oscillator(110.f * (1 + i % 8));
+                    auto encoder = rig->add(std::make_shared<AmbisonicEncoderNode>(*rig->context));
+                    encoder->setOrder(order);
+                    const float azimuth = 2.f * 3.14159265f * i / sources;
+                    encoder->setPosition(2.f * std::sin(azimuth), 0.f, -2.f * std::cos(azimuth));
+
+                    rig->context->connect(encoder, osc);
+                    rig->context->connect(decoder, encoder);
+                }
+                rig->context->connect(rig->destination, decoder);
+
+                rig->measure(state);
+
+                rig->context->disconnect(rig->destination, decoder);
+                rig->settle();
+            });
+        }
+    }
+
+    // The pack is written to the working directory by the files benchmark, and
+    // removed by the pack benchmark.
+    addBenchmark("HRTF/Load/files", [](State & state) {
+        std::unique_ptr<HRTFDatabase> database;
+        while (state.keepRunning())
+            database.reset(new HRTFDatabase(LABSOUND_DEFAULT_SAMPLERATE, SAMPLE_SRC_DIR "/hrtf", false));
+        if (!database || !database->files_found_and_loaded())
+            state.skipWithError("the HRTF database was not found in " SAMPLE_SRC_DIR "/hrtf");
+        else if (!database->writePack(HRTFDatabase::packPath(".", LABSOUND_DEFAULT_SAMPLERATE)))
+            state.skipWithError("could not write the HRTF pack to the working directory");
+    });
+
+    addBenchmark("HRTF/Load/pack", [](State & state) {
+        std::string packPath = HRTFDatabase::packPath(".", LABSOUND_DEFAULT_SAMPLERATE);
+        std::unique_ptr<HRTFDatabase> database;
+        while (state.keepRunning())
+            database.reset(new HRTFDatabase(LABSOUND_DEFAULT_SAMPLERATE, "."));
+        if (!database || !database->isPacked())
+            state.skipWithError("no HRTF pack; run HRTF/Load/files first");
+        database.reset();
+        std::remove(packPath.c_str());
+    });
+}
+
+//-------------------------------------------
+//   Offline/
+//-------------------------------------------
+
+// a representative game or music mix: voices with envelopes, through a
+// filter and a compressor
+void buildMix(Rig & rig, int voices)
+{
+    auto filter = rig.add(std::make_shared<BiquadFilterNode>(*rig.context));
+    auto compressor = rig.add(std::make_shared<DynamicsCompressorNode>(*rig.context));
+    auto master = rig.add(std::make_shared<GainNode>(*rig.context));
+    filter->frequency()->setValue(2000.f);
+    rig.context->connect(compressor, filter);
+    rig.context->connect(master, compressor);
+    rig.context->connect(rig.destination, master);
+
+    for (int i = 0; i < voices; ++i)
+    {
+        auto osc = rig.oscillator(110.f * (1 + i), i & 1 ? OscillatorType::SAWTOOTH : OscillatorType::SINE);
+        auto gain = rig.add(std::make_shared<GainNode>(*rig.context));
+        gain->gain()->setValue(0.f);
+        gain->gain()->linearRampToValueAtTime(1.f / voices, 0.5f);
+        rig.context->connect(gain, osc);
+        rig.context->connect(filter, gain);
+    }
+}
+
+void registerOfflineBenchmarks()
+{
+    addBenchmark("Offline/Throughput", [](State & state) {
+        Rig rig;
+        buildMix(rig, 16);
+        rig.measure(state);
+    });
+
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> jobCounts = {1};
+    if (cores > 1)
+        jobCounts.push_back(cores);
+
+    for (int jobs : jobCounts)
+    {
+
+        addBenchmark("Offline/Renderer/" + std::to_string(jobs), [jobs, cores](State & state) {
+            const uint64_t framesPerJob = static_cast<uint64_t>(LABSOUND_DEFAULT_SAMPLERATE);
+            state.framesPerIteration = framesPerJob * jobs;
+            state.renderQuantum = g_options.renderQuantum;
+
+            OfflineRenderer renderer(std::min(jobs, cores));
+            auto sink = std::make_shared<OfflineRenderCallbackSink>([](const AudioBus &, int) { return true; });
+
+            while (state.keepRunning())
+            {
+                // building the graphs is not part of the measurement
+                state.pauseTiming();
+                std::vector<std::unique_ptr<Rig>> rigs;
+                for (int i = 0; i < jobs; ++i)
+                {
+                    rigs.emplace_back(new Rig());
+                    buildMix(*rigs.back(), 16);
+                }
+                state.resumeTiming();
+
+                std::vector<std::future<OfflineRenderStats>> results;
+                for (auto & rig : rigs)
+                    results.push_back(renderer.render(rig->context, sink, framesPerJob));
+                for (auto & result : results)
+                    result.get();
+
+                state.pauseTiming();
+                rigs.clear();
+                state.resumeTiming();
+            }
+        });
+    }
+}
+
+//-------------------------------------------
+//   command line
+//-------------------------------------------
+
+bool parseFlag(const char * arg, const char * flag, std::string & value)
+{
+    const size_t length = std::strlen(flag);
+    if (std::strncmp(arg, flag, length) != 0)
+        return false;
+    if (arg[length] == '\0')
+    {
+        value = "true";
+        return true;
+    }
+    if (arg[length] != '=')
+        return false;
+    value = arg + length + 1;
+    return true;
+}
+
+bool parseOptions(int argc, char ** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string value;
+        if (parseFlag(argv[i], "--benchmark_filter", value))
+            g_options.filter = value;
+        else if (parseFlag(argv[i], "--benchmark_min_time", value))
+            g_options.minTime = std::atof(value.c_str());  // a trailing "s" is accepted, and ignored
+        else if (parseFlag(argv[i], "--benchmark_repetitions", value))
+            g_options.repetitions = std::max(1, std::atoi(value.c_str()));
+        else if (parseFlag(argv[i], "--benchmark_format", value))
+            g_options.format = value;
+        else if (parseFlag(argv[i], "--benchmark_out_format", value))
+            g_options.outFormat = value;
+        else if (parseFlag(argv[i], "--benchmark_out", value))
+            g_options.out = value;
+        else if (parseFlag(argv[i], "--benchmark_list_tests", value))
+            g_options.listTests = value != "false";
+        else if (parseFlag(argv[i], "--render_quantum", value))
+            g_options.renderQuantum = std::atoi(value.c_str());
+        else
+        {
+            fprintf(stderr, "unrecognized argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    auto validFormat = [](const std::string & f) { return f == "console" || f == "json"; };
+    return validFormat(g_options.format) && validFormat(g_options.outFormat) && g_options.minTime >= 0;
+}
+
+void report(FILE * out, const std::string & format, const std::vector<Run> & runs, const char * executable)
+{
+    if (format == "json")
+        writeJson(out, runs, executable);
+    else
+        writeConsole(out, runs);
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+    if (!parseOptions(argc, argv))
+    {
+        fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>]\n"
+                        "       [--benchmark_repetitions=<n>] [--benchmark_format=console|json]\n"
+                        "       [--benchmark_out=<file>] [--benchmark_out_format=console|json]\n"
+                        "       [--benchmark_list_tests] [--render_quantum=<frames>]\n", argv[0]);
+        return 1;
+    }
+
+    // the offline renders trace each call
+    log_set_level(LOGLEVEL_WARN);
+
+    registerNodeBenchmarks();
+    registerGraphBenchmarks();
+    registerOscillatorBenchmarks();
+    registerSampledBenchmarks();
+    registerFilterBenchmarks();
+    registerDelayBenchmarks();
+    registerDynamicsBenchmarks();
+    registerFFTBenchmarks();
+    registerConvolverBenchmarks();
+    registerHRTFBenchmarks();
+    registerOfflineBenchmarks();
+
+    std::regex filter;
+    try
+    {
+        filter = std::regex(g_options.filter);
+    }
+    catch (const std::regex_error &)
+    {
+        fprintf(stderr, "invalid --benchmark_filter: %s\n", g_options.filter.c_str());
+        return 1;
+    }
+
+    std::vector<const Benchmark *> selected;
+    size_t width = 10;
+    for (const Benchmark & benchmark : benchmarks())
+    {
+        if (!std::regex_search(benchmark.name, filter))
+            continue;
+        selected.push_back(&benchmark);
+        width = std::max(width, benchmark.name.size() + (g_options.repetitions > 1 ? 7 : 0));
+    }
+
+    if (g_options.listTests)
+    {
+        for (const Benchmark * benchmark : selected)
+            printf("%s\n", benchmark->name.c_str());
+        return 0;
+    }
+
+    const bool console = g_options.format == "console";
+    if (console)
+        writeConsoleHeader(stdout, static_cast<int>(width));
+
+    std::vector<Run> runs;
+    int familyIndex = 0;
+    for (const Benchmark * benchmark : selected)
+    {
+        std::vector<Run> repetitions;
+        for (int i = 0; i < g_options.repetitions; ++i)
+        {
+            repetitions.push_back(runBenchmark(*benchmark, familyIndex, i));
+            if (console)
+            {
+                writeConsoleRow(stdout, repetitions.back(), static_cast<int>(width));
+                fflush(stdout);
+            }
+        }
+        runs.insert(runs.end(), repetitions.begin(), repetitions.end());
+
+        if (repetitions.front().error.empty())
+        {
+            std::vector<Run> statistics = aggregates(repetitions);
+            if (console)
+                for (const Run & r : statistics)
+                    writeConsoleRow(stdout, r, static_cast<int>(width));
+            runs.insert(runs.end(), statistics.begin(), statistics.end());
+        }
+        ++familyIndex;
+    }
+
+    if (!console)
+        report(stdout, "json", runs, argv[0]);
+
+    if (!g_options.out.empty())
+    {
+        FILE * out = fopen(g_options.out.c_str(), "w");
+        if (!out)
+        {
+            fprintf(stderr, "could not open %s for writing\n", g_options.out.c_str());
+            return 1;
+        }
+        report(out, g_options.outFormat, runs, argv[0]);
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+//
+// quantumbench - measures offline render throughput as a function of the
+// render quantum size.
+//
+// A fixed graph (oscillators -> gains with automation -> filter -> compressor)
+// is built in an offline context for each quantum size, and rendered for the
+// requested duration. Smaller quanta lower the latency of a realtime device
+// at the cost of per-quantum graph overhead; this tool makes that cost visible.
+//
+// Before measuring, it checks that the nodes with buffers sized by the quantum
+// render correctly at a small and a large quantum, and fails if they do not.
+//
+// Usage:
+//   quantumbench [seconds] [voices]
+//
+//   seconds   audio seconds rendered per quantum size  (default: 20)
+//   voices    number of oscillator voices in the graph (default: 16)
+
+#include "LabSound/LabSound.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+using namespace lab;
+
+static double render_seconds(int quantum, int voices, float seconds)
+{
+    auto context = std::make_shared<lab::AudioContext>(true /*isOffline*/, false /*autoDispatchEvents*/,
+                                                       0 /*renderThreadCount*/, quantum);
+
+    AudioStreamConfig offlineConfig;
+    offlineConfig.device_index = 0;
+    offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+    offlineConfig.desired_channels = 2;
+    AudioStreamConfig inputConfig = {};
+
+    auto renderNode = std::make_shared<lab::AudioDestinationNode>(
+        *context, std::make_unique<lab::AudioDevice_Null>(inputConfig, offlineConfig));
+    context->setDestinationNode(renderNode);
+
+    auto filter = std::make_shared<BiquadFilterNode>(*context);
+    auto compressor = std::make_shared<DynamicsCompressorNode>(*context);
+    auto master = std::make_shared<GainNode>(*context);
+    filter->frequency()->setValue(2000.f);
+    context->connect(compressor, filter);
+    context->connect(master, compressor);
+    context->connect(renderNode, master);
+
+    // keep the voices alive for the duration of the render
+    std::vector<std::shared_ptr<AudioNode>> graph;
+    for (int i = 0; i < voices; ++i)
+    {
+        auto osc = std::make_shared<OscillatorNode>(*context);
+        auto gain = std::make_shared<GainNode>(*context);
+        osc->setType(i & 1 ? OscillatorType::SAWTOOTH : OscillatorType::SINE);
+        osc->frequency()->setValue(110.f * (1 + i));
+        osc->start(0);
+        gain->gain()->setValue(0.f);
+        gain->gain()->linearRampToValueAtTime(1.f / voices, seconds * 0.5f);
+        context->connect(gain, osc);
+        context->connect(filter, gain);
+        graph.push_back(osc);
+        graph.push_back(gain);
+    }
+
+    const int frames = static_cast<int>(seconds * LABSOUND_DEFAULT_SAMPLERATE);
+    auto scratch = std::make_shared<lab::AudioBus>(2, context->renderQuantumSize());
+
+    auto start = std::chrono::steady_clock::now();
+    renderNode->offlineRender(scratch.get(), frames);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// A sine through an oversampling WaveShaperNode with an identity curve should
+// come out delayed, but at the same level
+static bool check_waveshaper(int quantum, OverSampleType oversample)
+{
+    auto context = std::make_shared<lab::AudioContext>(true /*isOffline*/, false /*autoDispatchEvents*/,
+                                                       0 /*renderThreadCount*/, quantum);
+
+    AudioStreamConfig offlineConfig;
+    offlineConfig.device_index = 0;
+    offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+    offlineConfig.desired_channels = 1;
+    AudioStreamConfig inputConfig = {};
+
+    auto renderNode = std::make_shared<lab::AudioDestinationNode>(
+        *context, std::make_unique<lab::AudioDevice_Null>(inputConfig, offlineConfig));
+    context->setDestinationNode(renderNode);
+
+    auto osc = std::make_shared<OscillatorNode>(*context);
+    osc->frequency()->setValue(1000.f);
+    osc->amplitude()->setValue(0.5f);
+    osc->frequency()->resetSmoothedValue();
+    osc->amplitude()->resetSmoothedValue();
+    osc->start(0);
+
+    std::vector<float> curve(4097);
+    for (size_t i = 0; i < curve.size(); ++i)
+        curve[i] = -1.f + 2.f * i / (curve.size() - 1);
+
+    auto shaper = std::make_shared<WaveShaperNode>(*context);
+    shaper->setCurve(curve);
+    shaper->setOversample(oversample);
+    context->connect(shaper, osc);
+    context->connect(renderNode, shaper);
+
+    // skip the first quarter second, past the oversampling latency
+    const int frames = static_cast<int>(LABSOUND_DEFAULT_SAMPLERATE);
+    auto scratch = std::make_shared<lab::AudioBus>(1, quantum);
+    double sum = 0;
+    int counted = 0;
+    for (int frame = 0; frame < frames; frame += quantum)
+    {
+        renderNode->offlineRender(scratch.get(), quantum);
+        if (frame < frames / 4)
+            continue;
+
+        const float * data = scratch->channel(0)->data();
+        for (int i = 0; i < quantum; ++i)
+            sum += data[i] * data[i];
+        counted += quantum;
+    }
+
+    const double rms = std::sqrt(sum / counted);
+    const double expected = 0.5 / std::sqrt(2.0);
+    const bool good = std::fabs(rms - expected) < 0.005 * expected;
+    printf("waveshaper %dx at quantum %4d: rms %.4f (expected %.4f) %s\n",
+           oversample == OverSampleType::_2X ? 2 : 4, quantum, rms, expected, good ? "ok" : "FAILED");
+    return good;
+}
+
+int main(int argc, char ** argv)
+{
+    const float seconds = (argc >= 2) ? static_cast<float>(std::atof(argv[1])) : 20.f;
+    const int voices = (argc >= 3) ? std::atoi(argv[2]) : 16;
+
+    if (seconds <= 0 || voices <= 0)
+    {
+        printf("usage: %s [seconds] [voices]\n", argv[0]);
+        return 1;
+    }
+
+    bool good = true;
+    for (int quantum : {64, 1024})
+        for (OverSampleType oversample : {OverSampleType::_2X, OverSampleType::_4X})
+            good = check_waveshaper(quantum, oversample) && good;
+    if (!good)
+        return 1;
+
+    printf("%8s %12s %14s %14s\n", "quantum", "wall (s)", "x realtime", "ns / frame");
+    for (int quantum = AudioContext::MinRenderQuantumSize; quantum <= 2048; quantum *= 2)
+    {
+        double wall = render_seconds(quantum, voices, seconds);
+        double frames = seconds * LABSOUND_DEFAULT_SAMPLERATE;
+        printf("%8d %12.3f %14.1f %14.1f\n", quantum, wall, seconds / wall, 1.e9 * wall / frames);
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+//
+// vectormathbench - measures each VectorMath kernel at every SIMD level the
+// machine supports (scalar, the compile time baseline, AVX2, AVX-512).
+//
+// Each kernel is run repeatedly over buffers of the given length, and the time
+// per frame is reported, with the largest difference from the scalar result
+// as a sanity check; the fused multiply-add kernels, and the sums, may differ
+// from scalar in the last few bits.
+//
+// Usage:
+//   vectormathbench [frames] [iterations]
+//
+//   frames      buffer length in frames   (default: 128, a render quantum)
+//   iterations  calls per measurement     (default: 200000)
+
+#include "LabSound/extended/VectorMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace lab;
+using namespace lab::VectorMath;
+
+struct Buffers
+{
+    std::vector<float> a, b, c, d, e;
+    std::vector<float> interleaved;
+
+    explicit Buffers(int frames)
+        : a(frames), b(frames), c(frames), d(frames), e(frames), interleaved(frames * 2)
+    {
+        // a deterministic signal, with peaks beyond the clip thresholds
+        for (int i = 0; i < frames; ++i)
+        {
+            a[i] = 1.5f * std::sin(0.01f * i);
+            b[i] = 0.5f * std::cos(0.013f * i);
+            c[i] = 0.25f * std::sin(0.007f * i + 1.f);
+        }
+        for (int i = 0; i < frames * 2; ++i)
+            interleaved[i] = 1.2f * std::sin(0.011f * i);
+    }
+};
+
+struct Kernel
+{
+    const char * name;
+    // runs the kernel once; returns a scalar result, for kernels that have one
+    std::function<float(Buffers &, int)> run;
+};
+
+static const float kLow = -1.f;
+static const float kHigh = 1.f;
+
+static std::vector<Kernel> kernels()
+{
+    return {
+        {"vsma", [](Buffers & x, int n) { float k = 0.5f; vsma(x.a.data(), 1, &k, x.d.data(), 1, n); return 0.f; }},
+        {"vsmul", [](Buffers & x, int n) { float k = 0.5f; vsmul(x.a.data(), 1, &k, x.d.data(), 1, n); return 0.f; }},
+        {"vadd", [](Buffers & x, int n) { vadd(x.a.data(), 1, x.b.data(), 1, x.d.data(), 1, n); return 0.f; }},
+        {"vmul", [](Buffers & x, int n) { vmul(x.a.data(), 1, x.b.data(), 1, x.d.data(), 1, n); return 0.f; }},
+        {"vma", [](Buffers & x, int n) { vma(x.a.data(), 1, x.b.data(), 1, x.c.data(), 1, x.d.data(), 1, n); return 0.f; }},
+        {"zvmul", [](Buffers & x, int n) { zvmul(x.a.data(), x.b.data(), x.c.data(), x.a.data(), x.d.data(), x.e.data(), n); return 0.f; }},
+        {"zvmuladd", [](Buffers & x, int n) { zvmuladd(x.a.data(), x.b.data(), x.c.data(), x.a.data(), x.d.data(), x.e.data(), n); return 0.f; }},
+        {"vsvesq", [](Buffers & x, int n) { float sum; vsvesq(x.a.data(), 1, &sum, n); return sum; }},
+        {"vmaxmgv", [](Buffers & x, int n) { float max; vmaxmgv(x.a.data(), 1, &max, n); return max; }},
+        {"vclip", [](Buffers & x, int n) { vclip(x.a.data(), 1, &kLow, &kHigh, x.d.data(), 1, n); return 0.f; }},
+        {"vramp", [](Buffers & x, int n) { float start = 0.f, step = 1.f / n; vramp(&start, &step, x.d.data(), 1, n); return 0.f; }},
+        {"vrampmul", [](Buffers & x, int n) { float start = 0.f, step = 1.f / n; vrampmul(x.a.data(), 1, &start, &step, x.d.data(), 1, n); return 0.f; }},
+        {"vrampmuladd", [](Buffers & x, int n) { float start = 1.f, step = -1.f / n; vrampmuladd(x.a.data(), 1, &start, &step, x.d.data(), 1, n); return 0.f; }},
+        {"vintlvclip", [](Buffers & x, int n) {
+            const float * sources[2] = {x.a.data(), x.b.data()};
+            vintlvclip(sources, 2, &kLow, &kHigh, x.interleaved.data(), n);
+            return 0.f; }},
+        {"vdeintlvclip", [](Buffers & x, int n) {
+            float * dests[2] = {x.d.data(), x.e.data()};
+            vdeintlvclip(x.interleaved.data(), 2, &kLow, &kHigh, dests, n);
+            return 0.f; }},
+    };
+}
+
+// runs the kernel once on fresh buffers, and returns its outputs, for comparison between levels
+static std::vector<float> reference(const Kernel & kernel, int frames)
+{
+    Buffers x(frames);
+    float result = kernel.run(x, frames);
+    std::vector<float> out;
+    out.insert(out.end(), x.d.begin(), x.d.end());
+    out.insert(out.end(), x.e.begin(), x.e.end());
+    out.insert(out.end(), x.interleaved.begin(), x.interleaved.end());
+    out.push_back(result);
+    return out;
+}
+
+int main(int argc, char ** argv)
+{
+    const int frames = (argc >= 2) ? std::atoi(argv[1]) : 128;
+    const int iterations = (argc >= 3) ? std::atoi(argv[2]) : 200000;
+
+    if (frames <= 0 || iterations <= 0)
+    {
+        printf("usage: %s [frames] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<SimdLevel> levels = {SimdLevel::Scalar, SimdLevel::Baseline};
+    if (supportedSimdLevel() >= SimdLevel::AVX2)
+        levels.push_back(SimdLevel::AVX2);
+    if (supportedSimdLevel() >= SimdLevel::AVX512)
+        levels.push_back(SimdLevel::AVX512);
+
+    const SimdLevel initialLevel = simdLevel();
+    printf("supported: %s, frames: %d, iterations: %d\n\n", simdLevelName(supportedSimdLevel()), frames, iterations);
+
+    printf("%-14s", "ns / frame");
+    for (SimdLevel level : levels)
+        printf("%12s", simdLevelName(level));
+    printf("%12s %14s\n", "vs scalar", "max |error|");
+
+    for (const Kernel & kernel : kernels())
+    {
+        setSimdLevel(SimdLevel::Scalar);
+        std::vector<float> expected = reference(kernel, frames);
+
+        printf("%-14s", kernel.name);
+        double scalarTime = 0, widestTime = 0;
+        float maxError = 0;
+        for (SimdLevel level : levels)
+        {
+            if (setSimdLevel(level) != level)
+                continue;
+
+            std::vector<float> actual = reference(kernel, frames);
+            for (size_t i = 0; i < expected.size(); ++i)
+                maxError = std::max(maxError, std::fabs(actual[i] - expected[i]));
+
+            Buffers x(frames);
+            volatile float sink = 0;  // keeps the results of the reductions alive
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+                sink += kernel.run(x, frames);
+            auto end = std::chrono::steady_clock::now();
+
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() / (double(iterations) * frames);
+            if (level == SimdLevel::Scalar)
+                scalarTime = ns;
+            widestTime = ns;
+            printf("%12.3f", ns);
+        }
+        printf("%11.1fx %14.3g\n", scalarTime / widestTime, maxError);
+    }
+
+    setSimdLevel(initialLevel);
+    return 0;
+}
@@ -33,13 +33,17 @@
 #include "LabSound/core/ConstantSourceNode.h"
 // LabSound Extended Public API
 #include "LabSound/extended/ADSRNode.h"
+#include "LabSound/extended/AmbisonicDecoderNode.h"
+#include "LabSound/extended/AmbisonicEncoderNode.h"
 #include "LabSound/extended/AudioFileReader.h"
 #include "LabSound/extended/BPMDelayNode.h"
 #include "LabSound/extended/ClipNode.h"
 #include "LabSound/extended/DiodeNode.h"
 #include "LabSound/extended/FunctionNode.h"
 #include "LabSound/extended/GranulationNode.h"
+#include "LabSound/extended/MultiTapDelayNode.h"
 #include "LabSound/extended/NoiseNode.h"
+#include "LabSound/extended/OfflineRenderer.h"
 //#include "LabSound/extended/PdNode.h"
 #include "LabSound/extended/PeakCompNode.h"
 #include "LabSound/extended/PingPongDelayNode.h"
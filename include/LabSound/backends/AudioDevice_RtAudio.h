@@ -20,6 +20,7 @@ class AudioDevice_RtAudio : public AudioDevice
     std::unique_ptr<AudioBus> _renderBus;
     std::unique_ptr<AudioBus> _inputBus;
     SamplingInfo samplingInfo;
+    int _remainder = 0; // rendered frames not yet delivered to the hardware
 
     void createContext();
 
@@ -27,6 +27,9 @@ class AudioBasicInspectorNode : public AudioNode
 public:
     AudioBasicInspectorNode(AudioContext & ac, AudioNodeDescriptor const & desc);
     virtual ~AudioBasicInspectorNode() = default;
+
+    // an inspector has to see silence too, so it is processed even when its inputs are silent
+    virtual bool propagatesSilence(ContextRenderLock & r) const override { return false; }
 };
 
 }  // namespace lab
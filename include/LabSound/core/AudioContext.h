@@ -32,6 +32,7 @@ class AudioScheduledSourceNode;
 class ContextGraphLock;
 class ContextRenderLock;
 class HRTFDatabaseLoader;
+class HRTFRenderer;
 
 
 
@@ -255,8 +256,19 @@ public:
 
 
     // ctor/dtor
+    //
+    // If renderThreadCount is greater than zero, that many worker threads are
+    // started to render independent parts of the graph in parallel with the
+    // audio thread, and compiled rendering is enabled. Graphs too small to
+    // benefit are rendered on the audio thread alone.
+    //
+    // renderQuantumSize is the number of frames rendered per quantum. Larger
+    // quanta amortize the per-node cost of rendering, smaller ones reduce
+    // latency. It must be a power of two from MinRenderQuantumSize to
+    // MaxRenderQuantumSize, and is fixed for the lifetime of the context.
     explicit AudioContext(bool isOffline);
-    explicit AudioContext(bool isOffline, bool autoDispatchEvents);
+    explicit AudioContext(bool isOffline, bool autoDispatchEvents, int renderThreadCount = 0,
+                          int renderQuantumSize = AudioNode::ProcessingSizeInFrames);
     ~AudioContext();
 
     // External users shouldn't use this; it should be called by
@@ -268,11 +280,26 @@ public:
     // configuration
     bool isAutodispatchingEvents() const;
     bool isOfflineContext() const;
+
+    // HRTF databases are shared by every context of the same sample rate in the
+    // process, and loaded in the background. loadHrtfDatabase() waits for the
+    // database and returns whether it was found; loadHrtfDatabaseAsync() returns at
+    // once, and HRTF panners are silent until the database is ready.
     bool loadHrtfDatabase(const std::string & searchPath);
+    void loadHrtfDatabaseAsync(const std::string & searchPath);
+    bool isHrtfDatabaseLoaded() const;
     std::shared_ptr<HRTFDatabaseLoader> hrtfDatabaseLoader() const;
 
+    // Renders the context's HRTF panners together; null until the database has loaded.
+    // The render thread has its own handoff; this is for preparing nodes off it.
+    std::shared_ptr<HRTFRenderer> hrtfRenderer() const;
+
     float sampleRate() const;
 
+    static const int MinRenderQuantumSize = 16;
+    static const int MaxRenderQuantumSize = 4096;
+    int renderQuantumSize() const { return m_renderQuantumSize; }
+
     void setDestinationNode(std::shared_ptr<AudioDestinationNode> node);
     std::shared_ptr<AudioDestinationNode> destinationNode();
     std::shared_ptr<AudioListener> listener();
@@ -343,6 +370,41 @@ public:
     // Only an AudioDestinationNode should call this.
     void processAutomaticPullNodes(ContextRenderLock &, int framesToProcess);
 
+    // rendering
+    //
+    // By default the graph is rendered by recursively pulling on the destination's
+    // input every quantum. With compiled rendering enabled, the context instead
+    // flattens the graph into a topologically sorted schedule whenever connections
+    // change, and processes that schedule linearly every quantum.
+    void setCompiledRendering(bool enable);
+    bool isCompiledRendering() const;
+
+    // The number of worker threads the context was constructed with.
+    int renderThreadCount() const;
+
+    // Processes every node in the compiled schedule, recompiling it first if the
+    // graph has changed, and returns the bus gathered at inlet. Returns nullptr if
+    // compiled rendering is not enabled, in which case inlet should be pulled instead.
+    // Only pull_graph should call this.
+    AudioBus * renderCompiledSchedule(ContextRenderLock &, AudioNodeInput * inlet, int framesToProcess);
+
+    // True while renderCompiledSchedule processes the schedule. Every output in it
+    // has been prepared beforehand, and is processed before anything reading it, so
+    // an output must be read rather than pulled, as it may be on several threads.
+    bool isRenderingSchedule() const;
+
+    // Called on the audio thread when a connection change is discovered that the
+    // compiled schedule does not reflect. The schedule is rebuilt next quantum.
+    void invalidateRenderSchedule();
+
+    // Replaces bus with a zeroed bus of numberOfChannels, for use on the audio
+    // thread. Buses are drawn from a pool that the graph update thread keeps
+    // stocked, and the replaced bus is recycled there, so in the steady state
+    // nothing is allocated or freed on the audio thread. If the pool has no
+    // stock for numberOfChannels, the bus is allocated directly and the pool
+    // stocks that channel count from then on.
+    void exchangeBus(ContextRenderLock &, std::unique_ptr<AudioBus> & bus, int numberOfChannels);
+
     // graph management
     //
     void connect(std::shared_ptr<AudioNode> destination, std::shared_ptr<AudioNode> source, int destIdx = 0, int srcIdx = 0);
@@ -406,13 +468,40 @@ private:
     std::atomic<int> _contextIsInitialized{0};
     bool m_isAudioThreadFinished = false;
     bool m_isOfflineContext = false;
+    int m_renderQuantumSize = AudioNode::ProcessingSizeInFrames;
     bool m_automaticPullNodesNeedUpdating = false;  // indicates m_automaticPullNodes was modified.
 
     friend class NullDeviceNode; // needs to be able to call update()
     void update();
+
+    // Offline contexts have no update thread. The offline renderer calls this
+    // between quanta, once per graph tick, to do the update thread's work.
+    void serviceOfflineRender();
+
+    // Calls prepare() on a connected node, and keeps it to prepare again from the
+    // update thread if it asks; prepareNodes() does so for the nodes kept.
+    void prepareNode(std::shared_ptr<AudioNode> node);
+    void prepareNodes();
+
+    // Makes the HRTF renderer once the database has loaded, and hands it to the render thread
+    void prepareHrtfRenderer();
     void updateAutomaticPullNodes();
     void uninitialize();
 
+    // Appends the nodes reachable from inlet and roots to schedule, ordered such that
+    // every node follows all of the nodes feeding its inputs and parameters.
+    void sortRenderGraph(ContextRenderLock &, AudioNodeInput * inlet,
+                         const std::vector<AudioNode *> & roots, std::vector<AudioNode *> & schedule);
+    void compileRenderSchedule(ContextRenderLock &, AudioNodeInput * inlet);
+
+    // Has the gain nodes that the compiled schedule folded into summing junctions
+    // render their own outputs again, as they must when the graph is pulled.
+    void unfoldScheduledGains();
+
+    // Groups the compiled schedule into tasks for the render threads. Returns
+    // false if the schedule can't be rendered in parallel.
+    bool partitionRenderSchedule(ContextRenderLock &);
+
     std::shared_ptr<AudioDestinationNode> _destinationNode;
 
     std::shared_ptr<AudioListener> m_listener;
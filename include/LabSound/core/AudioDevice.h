@@ -25,6 +25,7 @@ class AudioContext;
 class AudioNodeInput;
 class AudioHardwareInput;
 class AudioSourceProvider;
+class OfflineRenderSink;
 struct AudioStreamConfig;
 struct AudioDeviceInfo;
 
@@ -157,6 +158,10 @@ class AudioDestinationNode : public AudioNode {
 protected:
     AudioContext * _context;
     SamplingInfo _last_info = {};
+    uint64_t _offlineQuanta = 0;
+
+    // renders one quantum of an offline render into dst
+    void renderOfflineQuantum(AudioBus * dst, int quantum);
 
     // AudioNode interface
     virtual double tailTime(ContextRenderLock & r) const override { return 0; }
@@ -185,10 +190,17 @@ public:
                 AudioBus * src, AudioBus * dst,
                 int frames,
                 const SamplingInfo & info);
-    
-    
+
+    // Renders framesToProcess frames into dst, a quantum at a time. Only the
+    // final quantum remains in dst.
     void offlineRender(AudioBus * dst, int framesToProcess);
 
+    // Renders framesToProcess frames, handing each quantum to sink as soon as
+    // it is rendered, so that memory use doesn't grow with the length of the
+    // render. Returns the number of frames delivered, which is fewer than
+    // requested if the sink ended the render early.
+    uint64_t offlineRender(OfflineRenderSink & sink, uint64_t framesToProcess);
+
     const SamplingInfo & getSamplingInfo() const { return _last_info; }
     
     
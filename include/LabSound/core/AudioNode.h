@@ -98,11 +98,17 @@ protected:
         ProfileSample totalTime;    // total time spent by the node. total-graph is the self time.
 
         int color = 0;
+        AudioNodeInput * foldedInto = nullptr;  // the junction rendering this node in the compiled schedule, see GainNode
+        int renderQuantumSize;  // the context's, fixed at construction
+        double lastNonSilentTime = -1.;  // end of the last quantum with non-silent input, in seconds
         bool m_isInitialized {false};
     };
     std::shared_ptr<Internal> _self;
     
 public :
+    // The default number of frames rendered per quantum. A context may be
+    // created with a different size, which its nodes report through
+    // renderQuantumSize().
     enum : int
     {
         ProcessingSizeInFrames = 128
@@ -121,6 +127,9 @@ public :
 
     SchedulingState schedulingState() const { return _self->_scheduler.playbackState(); }
 
+    // The number of frames the node renders per quantum, as set by its context.
+    int renderQuantumSize() const { return _self->renderQuantumSize; }
+
     //--------------------------------------------------
     // required interface
     //
@@ -161,6 +170,13 @@ public :
     virtual void initialize();
     virtual void uninitialize();
 
+    // prepare() is called off the render thread for nodes that have been connected; as
+    // they connect, and then by the graph update thread, or between offline quanta. Here
+    // a node makes what it can't make while rendering, such as anything that needs the
+    // context's sample rate, which isn't known until the context has a destination.
+    // Returns true if the node should be prepared again.
+    virtual bool prepare(AudioContext &) { return false; }
+
     //--------------------------------------------------
     // rendering
     bool inputsAreSilent(ContextRenderLock &);
@@ -169,6 +185,8 @@ public :
 
     // propagatesSilence() should return true if the node will generate silent output when given silent input. By default, AudioNode
     // will take tailTime() and latencyTime() into account when determining whether the node will propagate silence.
+    // A node with silent inputs that propagates silence is not processed at all; its outputs are flagged silent instead.
+    // Nodes that must observe every quantum, or that have state which advances without input, should return false.
     virtual bool propagatesSilence(ContextRenderLock & r) const;
 
     // processIfNecessary() is called by our output(s) when the rendering graph needs this AudioNode to process.
@@ -177,6 +195,14 @@ public :
     // Called from context's audio thread.
     void processIfNecessary(ContextRenderLock & r, int bufferSize);
 
+    // processScheduled() is called by the context's compiled render schedule. The schedule is
+    // topologically sorted, so every node feeding this node has already processed this quantum,
+    // and the inputs are gathered from their busses instead of being pulled recursively.
+    // updateScheduledRenderingState() must have been called for every node in the schedule
+    // beforehand. When rendering in parallel, processScheduled() is called from a render worker.
+    void updateScheduledRenderingState(ContextRenderLock & r);
+    void processScheduled(ContextRenderLock & r, int bufferSize);
+
     //--------------------------------------------------
     // inputs and outputs
     bool isInitialized() const { return _self->m_isInitialized; }
@@ -251,6 +277,13 @@ protected:
     // Called from context's audio thread.
     void pullInputs(ContextRenderLock &, int bufferSize);
 
+    // Called by processIfNecessary() in place of processing when the node is silent, so that
+    // the nodes connected to its params keep rendering, as they would have if it had processed.
+    void pullParamInputs(ContextRenderLock &, int bufferSize);
+
+    // Called by processScheduled() in place of pullInputs(); upstream nodes have already processed.
+    void gatherInputs(ContextRenderLock &, int bufferSize);
+
     friend class AudioContext;
 
     // starts an immediate ramp to zero in preparation for disconnection
@@ -264,6 +297,9 @@ protected:
     static void _printGraph(const AudioNode * root,
                         std::function<void(const char *)> prnln, int indent);
 
+private:
+    void _processIfNecessary(ContextRenderLock & r, int bufferSize, bool recursive);
+
 };
 
 }  // namespace lab
@@ -16,6 +16,7 @@ namespace lab
 class AudioNode;
 class AudioNodeOutput;
 class AudioBus;
+class GainNode;
 
 // An AudioNodeInput represents an input to an AudioNode and can be connected from one or more AudioNodeOutputs.
 // In the case of multiple connections, the input will act as a unity-gain summing junction, mixing all the outputs.
@@ -26,8 +27,15 @@ class AudioNodeInput : public AudioSummingJunction
     std::unique_ptr<AudioBus> m_internalSummingBus;
     std::string _name;
 
+    // the rendering connections as of the last compile of the context's render schedule
+    std::vector<AudioNodeOutput *> m_scheduledOutputs;
+
+    // for each scheduled output, the gain node folded into this junction that produces it, or null
+    std::vector<GainNode *> m_scheduledGains;
+
 public:
-    explicit AudioNodeInput(AudioNode * audioNode, int processingSizeInFrames = AudioNode::ProcessingSizeInFrames);
+    // processingSizeInFrames defaults to the node's render quantum size.
+    explicit AudioNodeInput(AudioNode * audioNode, int processingSizeInFrames = 0);
     virtual ~AudioNodeInput();
 
     // Can be called from any thread.
@@ -44,6 +52,19 @@ public:
     // It returns the bus which it rendered into, returning inPlaceBus if in-place processing was performed.
     AudioBus * pull(ContextRenderLock &, AudioBus * inPlaceBus, int bufferSize);
 
+    // gather() is the compiled render schedule's counterpart to pull(). The nodes connected to this
+    // input have already been processed, so their busses are summed without recursing into them.
+    AudioBus * gather(ContextRenderLock &, int bufferSize);
+
+    // Snapshots the rendering connections for use by gather().
+    // Called by the context when it compiles its render schedule.
+    void updateScheduledOutputs(ContextRenderLock &);
+    const std::vector<AudioNodeOutput *> & scheduledOutputs() const { return m_scheduledOutputs; }
+
+    // Folds the gain nodes that feed this input, and nothing else, into its sum, see GainNode.
+    // Called by the context once its render schedule has been compiled.
+    void foldScheduledGains(ContextRenderLock &);
+
     // bus() contains the rendered audio after pull() has been called for each time quantum.
     AudioBus * bus(ContextRenderLock &);
 
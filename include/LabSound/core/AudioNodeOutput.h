@@ -23,8 +23,9 @@ class AudioNodeOutput
 {
 public:
     // It's OK to pass 0 for numberOfChannels in which case setNumberOfChannels() must be called later on.
-    AudioNodeOutput(AudioNode * audioNode, int numberOfChannels, int processingSizeInFrames = AudioNode::ProcessingSizeInFrames);
-    AudioNodeOutput(AudioNode * audioNode, char const*const name, int numberOfChannels, int processingSizeInFrames = AudioNode::ProcessingSizeInFrames);
+    // processingSizeInFrames defaults to the node's render quantum size.
+    AudioNodeOutput(AudioNode * audioNode, int numberOfChannels, int processingSizeInFrames = 0);
+    AudioNodeOutput(AudioNode * audioNode, char const*const name, int numberOfChannels, int processingSizeInFrames = 0);
     virtual ~AudioNodeOutput();
 
     // Can be called from any thread.
@@ -46,6 +47,10 @@ public:
     // Unlike paramFanOutCount() it will not change during the course of a render quantum.
     int renderingParamFanOutCount() const;
 
+    // renderingSoleInput() is the AudioNodeInput we're connected to during rendering, if it is our only
+    // connection, and null otherwise. Like renderingFanOutCount(), it only changes between render quanta.
+    AudioNodeInput * renderingSoleInput() const { return m_renderingSoleInput; }
+
     void setNumberOfChannels(ContextRenderLock &, int);
     int numberOfChannels() const { return m_numberOfChannels; }
     bool isChannelCountKnown() const { return numberOfChannels() > 0; }
@@ -55,6 +60,10 @@ public:
     // updateRenderingState() is called in the audio thread at the start or end of the render quantum to handle any recent changes to the graph state.
     void updateRenderingState(ContextRenderLock &);
 
+    // Called by a compiled render schedule in place of pull(), before the source node processes.
+    // In-place processing is never used by a compiled schedule.
+    void updateScheduledRenderingState(ContextRenderLock &);
+
     const std::string& name() const { return m_name; }
 
     // Must be called within the context's graph lock.
@@ -86,8 +95,8 @@ private:
     int paramFanOutCount();
 
     // updateInternalBus() updates m_internalBus appropriately for the number of channels.
-    // It is called in the constructor or in the audio thread with the context's graph lock.
-    void updateInternalBus();
+    // It is called in the audio thread, and takes its buses from the context's pool.
+    void updateInternalBus(ContextRenderLock &);
 
     // Announce to any nodes we're connected to that we changed our channel count for its input.
     void propagateChannelCount(ContextRenderLock &);
@@ -112,6 +121,7 @@ private:
     // These value should only be changed at the very start or end of the rendering quantum.
     int m_renderingFanOutCount;
     int m_renderingParamFanOutCount;
+    AudioNodeInput * m_renderingSoleInput = nullptr;
 
     // connected params
     std::set<std::shared_ptr<AudioParam>> m_params;
@@ -61,6 +61,7 @@ public:
 
     int _renderOffset = 0; // where rendering starts in the current frame
     int _renderLength = 0; // number of rendered frames in the current frame 
+    int _fadeInRemaining = 0; // frames of the start envelope still to apply; may span several quanta
 
     float _sampleRate = 1;
 
@@ -6,7 +6,7 @@
 #define AudioParamTimeline_h
 
 #include "LabSound/core/AudioContext.h"
-#include <mutex>
+#include <memory>
 #include <vector>
 
 namespace lab
@@ -16,8 +16,12 @@ class AudioParamTimeline
 {
 
 public:
-    AudioParamTimeline() {}
+    AudioParamTimeline();
+    ~AudioParamTimeline();
 
+    // Automation may be scheduled from any thread. Scheduling never blocks the
+    // audio thread; the events take effect when the audio thread next evaluates
+    // the timeline.
     void setValueAtTime(float value, float time);
     void linearRampToValueAtTime(float value, float time);
     void exponentialRampToValueAtTime(float value, float time);
@@ -37,7 +41,8 @@ public:
     float valuesForTimeRange(double startTime, double endTime, float defaultValue,
                              float * values, size_t numberOfValues, double sampleRate, double controlRate);
 
-    bool hasValues() { return m_events.size() > 0; }
+    // true if events are scheduled, or waiting to be scheduled
+    bool hasValues() const;
 
 private:
 
@@ -67,27 +72,10 @@ private:
         {
         }
 
-        ParamEvent(const ParamEvent & rhs)
-            : m_type(rhs.m_type)
-            , m_value(rhs.m_value)
-            , m_time(rhs.m_time)
-            , m_timeConstant(rhs.m_timeConstant)
-            , m_duration(rhs.m_duration)
-            , m_curve(rhs.m_curve)
-        {
-        }
-
-        const ParamEvent & operator=(const ParamEvent & rhs)
-        {
-
-            m_type = rhs.m_type;
-            m_value = rhs.m_value;
-            m_time = rhs.m_time;
-            m_timeConstant = rhs.m_timeConstant;
-            m_duration = rhs.m_duration;
-            m_curve = rhs.m_curve;
-            return *this;
-        }
+        ParamEvent(const ParamEvent &) = default;
+        ParamEvent(ParamEvent &&) = default;
+        ParamEvent & operator=(const ParamEvent &) = default;
+        ParamEvent & operator=(ParamEvent &&) = default;
 
         unsigned type() const { return m_type; }
         float value() const { return m_value; }
@@ -105,11 +93,25 @@ private:
         std::vector<float> m_curve;
     };
 
-    void insertEvent(const ParamEvent &);
+    // Events travel from the scheduling threads to the audio thread through a
+    // lock-free queue of commands owned by each timeline. Only the audio thread
+    // applies them, so m_events belongs to the audio thread alone.
+    struct PendingCommands;
+    std::unique_ptr<PendingCommands> m_pending;
+
+    void enqueueEvent(ParamEvent &&);
+    void applyPendingCommands();
+    void insertEvent(ParamEvent &&);
+    void cancelEvents(float startTime);
+
     float valuesForTimeRangeImpl(double startTime, double endTime, float defaultValue,
                                  float * values, size_t numberOfValues, double sampleRate, double controlRate);
 
     std::vector<ParamEvent> m_events;
+
+    // The index of the event whose span contains the time last rendered, and that time.
+    size_t m_cursor = 0;
+    double m_cursorTime = 0;
 };
 
 }  // namespace lab
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <condition_variable>
@@ -4,23 +4,19 @@
 #ifndef ConvolverNode_h
 #define ConvolverNode_h
 
+#include "LabSound/core/AudioArray.h"
 #include "LabSound/core/AudioScheduledSourceNode.h"
 #include "LabSound/core/AudioSetting.h"
 
 #include <memory>
-#include <mutex>
+#include <vector>
 
 namespace lab
 {
 
 class AudioBus;
 class AudioSetting;
-class Reverb;
-
-// private data for reverb computations
-struct sp_data;
-struct sp_conv;
-struct sp_ftbl;
+class PartitionedConvolver;
 
 class ConvolverNode final : public AudioScheduledSourceNode
 {
@@ -35,10 +31,26 @@ public:
     bool normalize() const;
     void setNormalize(bool new_n);
 
+    // When set, the late partitions of the impulse response are convolved on a
+    // background thread, ahead of the quantum that needs them, so that the render
+    // thread's load is even. The render thread convolves a partition itself if the
+    // background thread falls behind. Off by default.
+    bool backgroundTail() const;
+    void setBackgroundTail(bool value);
+
     // set impulse will schedule the convolver to begin processing immediately
     // The supplied bus is copied for use as an impulse response.
+    //
+    // The impulse response is resampled to the context's rate, normalized, and
+    // transformed on a background job, and the convolver switches to it at the start
+    // of a quantum once it is ready, so until then the previous one is heard. The
+    // transformed response is shared with every convolver given the same one.
     void setImpulse(std::shared_ptr<AudioBus> bus);
     std::shared_ptr<AudioBus> getImpulse() const;
+
+    // Blocks until the impulse response most recently set, or the most recent change
+    // to the settings, has been prepared.
+    void waitForImpulse();
     virtual void process(ContextRenderLock & r, int bufferSize) override;
     virtual void reset(ContextRenderLock &) override;
 
@@ -49,27 +61,39 @@ protected:
     double now() const { return _now; }
 
     void _activateNewImpulse();
+    void _createKernels();
 
     double _now = 0.0;
-    float _scale = 1.f;  // normalization value
-    sp_data * _sp = nullptr;
+    float _sampleRate = 0.f;
 
     // Normalize the impulse response or not. Must default to true.
     std::shared_ptr<AudioSetting> _normalize;
     std::shared_ptr<AudioSetting> _impulseResponseClip;
+    std::shared_ptr<AudioSetting> _backgroundTail;
 
+    // The convolver, and how the input channels are routed to it. An impulse response
+    // of four channels is true stereo, convolving each of two input channels for each
+    // of two output channels; otherwise each channel of the response convolves one
+    // channel of the input, a mono response convolving every channel of a stereo one.
     struct ReverbKernel
     {
-        ReverbKernel() = default;
-        ReverbKernel(ReverbKernel && rh) noexcept;
+        ReverbKernel(int responseChannels, int quantum);
         ~ReverbKernel();
-        sp_conv * conv = nullptr;
-        sp_ftbl * ft = nullptr;
+        std::unique_ptr<PartitionedConvolver> convolver;
+        int responseChannels = 0;
+        bool trueStereo = false;
+        int channels = 0;          // the convolver's inputs and outputs
+        std::vector<int> routing;  // routing[output * channels + input] is the response that convolves the input
+        std::vector<const float *> sources;
+        std::vector<float *> dests;
+        AudioFloatArray input;   // the scheduled part of each input channel
+        AudioFloatArray output;  // the convolver's outputs beyond the output bus's channels
     };
-    std::vector<ReverbKernel> _kernels;  // one per impulse response channel
-    std::vector<ReverbKernel> _pending_kernels; // new kernels when an impulse has been computed
-    bool _swap_ready;
-    std::mutex _kernel_mutex;
+    std::unique_ptr<ReverbKernel> _kernel;
+
+    // shared by the node and its preparation jobs, which may outlive it
+    struct Preparation;
+    std::shared_ptr<Preparation> _preparation;
 };
 
 }  // namespace lab
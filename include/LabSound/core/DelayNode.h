@@ -47,7 +47,12 @@ public:
     virtual const char* name() const override { return static_name(); }
     static AudioNodeDescriptor * desc();
 
+    // In seconds, approached smoothly when it is changed.
     std::shared_ptr<AudioSetting> delayTime();
+
+    // In seconds, added to the delay time sample accurately; connect an
+    // oscillator to it for a chorus or a flanger. Zero by default.
+    std::shared_ptr<AudioParam> modulation();
 };
 
 }  // namespace lab
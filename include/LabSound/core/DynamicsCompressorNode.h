@@ -7,11 +7,13 @@
 
 #include "LabSound/core/AudioNode.h"
 #include "LabSound/core/AudioParam.h"
+#include "LabSound/core/AudioSetting.h"
 
 namespace lab
 {
 
 class DynamicsCompressor;
+class LookaheadCompressor;
 
 // Fun trick:
 //
@@ -24,6 +26,18 @@ class DynamicsCompressorNode : public AudioNode
 {
 
 public:
+    // How the signal is compressed. COMPRESSOR_CLASSIC is the Web Audio compressor, with its
+    // emphasis filters, adaptive release and automatic makeup gain. COMPRESSOR_LOOKAHEAD is a
+    // plain peak compressor, several times cheaper: the threshold, ratio, attack and release
+    // are applied as given, the knee is the width in dB of a soft knee centered on the
+    // threshold, and there is no makeup gain. The signal is delayed by the lookahead, so
+    // that the gain is already reduced when a transient arrives.
+    enum CompressorMode
+    {
+        COMPRESSOR_CLASSIC = 0,
+        COMPRESSOR_LOOKAHEAD = 1,
+    };
+
     DynamicsCompressorNode(AudioContext& ac);
     virtual ~DynamicsCompressorNode();
 
@@ -47,17 +61,27 @@ public:
     // Amount by which the compressor is currently compressing the signal in decibels.
     std::shared_ptr<AudioParam> reduction() { return m_reduction; }
 
+    // COMPRESSOR_CLASSIC by default
+    CompressorMode mode() const { return static_cast<CompressorMode>(m_mode->valueUint32()); }
+    void setMode(CompressorMode mode) { m_mode->setUint32(static_cast<uint32_t>(mode)); }
+
+    // In seconds, for COMPRESSOR_LOOKAHEAD; 5ms by default, at most 4096 frames.
+    std::shared_ptr<AudioSetting> lookahead() { return m_lookahead; }
+
 private:
     virtual double tailTime(ContextRenderLock & r) const override;
     virtual double latencyTime(ContextRenderLock & r) const override;
 
     std::unique_ptr<DynamicsCompressor> m_dynamicsCompressor;
+    std::unique_ptr<LookaheadCompressor> m_lookaheadCompressor;
     std::shared_ptr<AudioParam> m_threshold;
     std::shared_ptr<AudioParam> m_knee;
     std::shared_ptr<AudioParam> m_ratio;
     std::shared_ptr<AudioParam> m_reduction;
     std::shared_ptr<AudioParam> m_attack;
     std::shared_ptr<AudioParam> m_release;
+    std::shared_ptr<AudioSetting> m_mode;
+    std::shared_ptr<AudioSetting> m_lookahead;
 };
 
 }  // namespace lab
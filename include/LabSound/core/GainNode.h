@@ -12,7 +12,9 @@
 namespace lab
 {
 
+class AudioBus;
 class AudioContext;
+class AudioNodeInput;
 
 // GainNode is an AudioNode with one input and one output which applies a gain (volume) change to the audio signal.
 // De-zippering (smoothing) is applied when the gain value is changed dynamically.
@@ -36,14 +38,32 @@ public:
 
     std::shared_ptr<AudioParam> gain() const { return m_gain; }
 
+    // Gain on the edge. When the compiled render schedule finds a plain gain node whose
+    // output feeds one summing junction and nothing else, the schedule skips the node, and
+    // the junction calls sumInto() to apply the gain as it sums the node's input. The
+    // node's own output is left silent. These are called on the render thread.
+
+    // The gain node producing output, if it may be folded into the junction it feeds,
+    // or if it is folded into junction.
+    static GainNode * foldable(ContextRenderLock &, AudioNodeOutput * output);
+    static GainNode * foldedInto(AudioNodeOutput * output, AudioNodeInput * junction);
+    void foldInto(AudioNodeInput * junction) { _self->foldedInto = junction; }
+
+    // Gathers the input, and sums it into destination scaled by the gain.
+    void sumInto(ContextRenderLock &, AudioBus & destination, int bufferSize);
+
 protected:
     virtual double tailTime(ContextRenderLock & r) const override { return 0; }
     virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
 
+    // fills m_sampleAccurateGainValues from the gain param for the quantum
+    bool calculateSampleAccurateGains(ContextRenderLock &, int bufferSize);
+
     float m_lastGain;  // for de-zippering
     std::shared_ptr<AudioParam> m_gain;
 
     AudioFloatArray m_sampleAccurateGainValues;
+    bool m_dezipperStarted = false;  // by sumInto(), which has no bus to keep track
 };
 
 }  // namespace lab
@@ -9,16 +9,23 @@
 #include "LabSound/core/Macros.h"
 #include "LabSound/core/PeriodicWave.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace lab
 {
 
 class AudioBus;
 class AudioContext;
 class AudioSetting;
+class WavetableOscillator;
 
 // params: frequency, detune, amplitude, and bias
 // settings: type
 //
+// Every type but FAST_SINE is played from the band-limited tables of a
+// PeriodicWave; the basic waveforms share theirs with every other oscillator at
+// the same sample rate. A CUSTOM oscillator plays the wave given to setPeriodicWave.
 
 // @TODO add duty param for the square wave to complete the oscillator, default value is 0.5
 
@@ -30,6 +37,17 @@ class OscillatorNode : public AudioScheduledSourceNode
     virtual bool propagatesSilence(ContextRenderLock & r) const override;
     std::shared_ptr<AudioSetting> m_type;
 
+    void updatePeriodicWave();
+
+    std::atomic<float> m_sampleRate;  // zero until the context knows it
+    std::unique_ptr<WavetableOscillator> m_wavetable;
+    std::shared_ptr<PeriodicWave> m_periodicWave;  // being played, exchanged atomically
+
+    // guards the custom wave, and orders the waves published by the control thread's
+    // changes of type and prepare()
+    std::mutex m_waveMutex;
+    std::shared_ptr<PeriodicWave> m_customWave;
+
 public:
     OscillatorNode(AudioContext& ac);
     virtual ~OscillatorNode();
@@ -41,9 +59,16 @@ public:
     virtual void process(ContextRenderLock &, int bufferSize) override;
     virtual void reset(ContextRenderLock &) override { }
 
+    // Acquires the wave's tables if the node was made before the context knew its sample rate
+    virtual bool prepare(AudioContext &) override;
+
     OscillatorType type() const;
     void setType(OscillatorType type);
 
+    // Sets the type to CUSTOM, playing wave, which should be at the context's sample rate
+    void setPeriodicWave(std::shared_ptr<PeriodicWave> wave);
+    std::shared_ptr<PeriodicWave> periodicWave() const;
+
     std::shared_ptr<AudioParam> amplitude() { return m_amplitude; }
     std::shared_ptr<AudioParam> frequency() { return m_frequency; }
     std::shared_ptr<AudioParam> detune() { return m_detune; }
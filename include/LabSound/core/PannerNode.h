@@ -73,6 +73,9 @@ public:
     virtual void initialize() override;
     virtual void uninitialize() override;
 
+    // Makes the HRTF panner, once the context's database has loaded
+    virtual bool prepare(AudioContext &) override;
+
     // Panning model
     PanningModel panningModel() const;
     void setPanningModel(PanningModel m);
@@ -135,6 +138,10 @@ public:
     virtual double latencyTime(ContextRenderLock & r) const override;
 
 protected:
+    // For nodes that position a sound differently; desc must have the panner's params
+    // and settings, and may add to them.
+    PannerNode(AudioContext & ac, AudioNodeDescriptor const & desc);
+
     // Returns the combined distance and cone gain attenuation.
     virtual float distanceConeGain(ContextRenderLock & r);
 
@@ -143,7 +150,12 @@ protected:
     // @tofix - broken?
     void notifyAudioSourcesConnectedToNode(ContextRenderLock & r, AudioNode *);
 
-    std::unique_ptr<Panner> m_panner;
+    // The panner of the panning model, made off the render thread and handed to it
+    struct Panners;
+    std::unique_ptr<Panners> m_panners;
+
+    // the input scaled by the distance and cone gain, for the HRTF panner
+    std::unique_ptr<AudioBus> m_gainedInput;
     std::unique_ptr<DistanceEffect> m_distanceEffect;
     std::unique_ptr<ConeEffect> m_coneEffect;
 
@@ -14,9 +14,19 @@
 namespace lab
 {
 
+// The band-limited wavetables of a periodic waveform: one table for each range of
+// fundamental frequencies, a third of an octave wide, each with the partials that
+// do not alias when played in its range. The tables are not changed once they are
+// built, so a wave may be shared by any number of oscillators, on any thread.
 class PeriodicWave
 {
 public:
+    // The tables of one of the basic waveforms, SINE, SQUARE, SAWTOOTH,
+    // FALLING_SAWTOOTH, or TRIANGLE, at a sample rate. They are built the first time
+    // they are acquired, which takes some milliseconds, and kept for the life of the
+    // process; nullptr for other types, or without a sample rate.
+    static std::shared_ptr<PeriodicWave> acquire(float sampleRate, OscillatorType basicWaveform);
+
     PeriodicWave(const float sampleRate, OscillatorType basicWaveform);
     PeriodicWave(const float sampleRate, OscillatorType basicWaveform, std::vector<float> & real, std::vector<float> & imag);
 
@@ -28,7 +38,8 @@ public:
     // at this fundamental frequency. The lower wavetable is the next range containing fewer partials than the higher wavetable.
     // Interpolation between these two tables can be made according to tableInterpolationFactor.
     // Where values from 0 -> 1 interpolate between lower -> higher.
-    void waveDataForFundamentalFrequency(float, float *& lowerWaveData, float *& higherWaveData, float & tableInterpolationFactor);
+    // Each table is followed by its first frame, so that interpolation need not wrap.
+    void waveDataForFundamentalFrequency(float, const float *& lowerWaveData, const float *& higherWaveData, float & tableInterpolationFactor) const;
 
     // Returns the scalar multiplier to the oscillator frequency to calculate wave table phase increment.
     float rateScale() const { return m_rateScale; }
@@ -18,7 +18,6 @@ class AudioBus;
 class AudioParam;
 class ContextRenderLock;
 class SampledAudioNode;
-struct SRC_Resampler;
 
 // SampledAudioNode is intended for in-memory sounds. It provides a high degree of scheduling 
 // flexibility (can playback in rhythmically exact ways).
@@ -41,8 +40,7 @@ class SampledAudioNode final : public AudioScheduledSourceNode
     std::shared_ptr<AudioParam> m_detune;
     std::shared_ptr<AudioParam> m_dopplerRate;
     std::shared_ptr<AudioSetting> m_sourceBus;
-
-    std::vector<std::shared_ptr<SRC_Resampler>> _resamplers;
+    std::shared_ptr<AudioSetting> m_quality;
 
     // totalPitchRate() returns the instantaneous pitch rate (non-time preserving).
     // It incorporates the base pitch rate, any sample-rate conversion factor from the buffer, 
@@ -53,6 +51,18 @@ class SampledAudioNode final : public AudioScheduledSourceNode
     virtual void process(ContextRenderLock&, int framesToProcess) override;
 
 public:
+    // How the sound is interpolated when it plays at a rate other than its own,
+    // from the cheapest to the cleanest. Linear interpolation dulls and aliases
+    // the highs; the sincs filter them with 16, 32, or 64 taps.
+    enum ResamplingQuality
+    {
+        RESAMPLE_LINEAR = 0,
+        RESAMPLE_CUBIC = 1,
+        RESAMPLE_SINC16 = 2,
+        RESAMPLE_SINC32 = 3,
+        RESAMPLE_SINC64 = 4,
+    };
+
     SampledAudioNode() = delete;
     explicit SampledAudioNode(AudioContext&);
     virtual ~SampledAudioNode();
@@ -93,6 +103,11 @@ public:
     std::shared_ptr<AudioParam> detune() { return m_detune; }
     std::shared_ptr<AudioParam> dopplerRate() { return m_dopplerRate; }
 
+    // RESAMPLE_SINC16 by default. Choosing a sinc quality for the first time
+    // computes its filter tables, so it should not be done on the audio thread.
+    ResamplingQuality quality() const;
+    void setQuality(ResamplingQuality quality);
+
     // returns the greatest sample index played back by any of the scheduled
     // instances in the most recent render quantum. A value less than zero
     // indicates nothing's playing.
@@ -35,6 +35,9 @@ public:
     virtual double tailTime(ContextRenderLock& r) const override { return 0.; }
     virtual double latencyTime(ContextRenderLock& r) const override { return 0.f; }
 
+    // the envelope follows the gate whether or not the input is silent
+    virtual bool propagatesSilence(ContextRenderLock& r) const override { return false; }
+
     // gate is a two state signal. Changing the gate signal to one means that the attack/decay segment will start
     // If oneShot is false, sustainTime is ignored, and sustain is held until gain goes to zero.
     // If oneShot is true, transitioning the gate to zero has no effect.
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef AMBISONIC_DECODER_NODE_H
+#define AMBISONIC_DECODER_NODE_H
+
+#include "LabSound/core/AudioNode.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace lab
+{
+
+class AmbisonicBinauralDecoder;
+class HRTFDatabaseLoader;
+
+// AmbisonicDecoderNode renders an ambisonic signal to the ears, with the context's HRTF
+// database. Its input sums the AmbisonicEncoderNodes connected to it, so however many
+// sources there are, they are rendered with one set of convolutions, a pair for each
+// ambisonic channel.
+//
+// The order is that of the input: 1 for 4 channels, 2 for 9, and 3 for 16. The decoder
+// for an order is prepared on a background job, started off the render thread the first
+// time it is needed, and until then the node is silent, as it is until the context's
+// HRTF database has loaded.
+//
+class AmbisonicDecoderNode : public AudioNode
+{
+public:
+    AmbisonicDecoderNode(AudioContext & ac);
+    virtual ~AmbisonicDecoderNode();
+
+    static const char* static_name() { return "AmbisonicDecoder"; }
+    virtual const char* name() const override { return static_name(); }
+    static AudioNodeDescriptor * desc();
+
+    // AudioNode
+    virtual void process(ContextRenderLock &, int bufferSize) override;
+    virtual void reset(ContextRenderLock &) override;
+
+    // Starts preparing a decoder for the input's order, and releases the one retired
+    virtual bool prepare(AudioContext &) override;
+
+    virtual double tailTime(ContextRenderLock & r) const override;
+    virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
+
+private:
+    void prepareDecoder(std::shared_ptr<HRTFDatabaseLoader> loader, int order);
+
+    std::unique_ptr<AmbisonicBinauralDecoder> m_decoder;
+
+    // the database and order of the decoder most recently asked for, by prepare()
+    std::shared_ptr<HRTFDatabaseLoader> m_requestedLoader;
+    int m_requestedOrder = 0;
+
+    // the order of the input, as the render thread last saw it
+    std::atomic<int> m_inputOrder;
+
+    std::vector<const float *> m_sources;
+
+    // shared by the node and its preparation jobs, which may outlive it
+    struct Preparation;
+    std::shared_ptr<Preparation> m_preparation;
+};
+
+}  // namespace lab
+
+#endif
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef AMBISONIC_ENCODER_NODE_H
+#define AMBISONIC_ENCODER_NODE_H
+
+#include "LabSound/core/PannerNode.h"
+
+namespace lab
+{
+
+// AmbisonicEncoderNode positions a sound like a PannerNode, relative to the context's
+// AudioListener, with the same distance and cone effects, but encodes it into an
+// ambisonic signal rather than panning it to the ears. Encoding costs a gain per
+// channel, so any number of encoders may be connected to one AmbisonicDecoderNode,
+// whose input sums them, and which renders them all to the ears at once. The panning
+// model is not used.
+//
+// The output has (order + 1)^2 channels, in ACN order with SN3D normalization; the input
+// is mixed down to mono.
+//
+// settings: those of PannerNode, and order
+//
+class AmbisonicEncoderNode : public PannerNode
+{
+    std::shared_ptr<AudioSetting> m_order;
+
+    // the gains the last quantum ended with, for the highest order's 16 channels; each
+    // quantum ramps from them to its own
+    float m_gains[16];
+    int m_gainCount = 0;
+
+public:
+    AmbisonicEncoderNode(AudioContext & ac);
+    virtual ~AmbisonicEncoderNode() = default;
+
+    static const char* static_name() { return "AmbisonicEncoder"; }
+    virtual const char* name() const override { return static_name(); }
+    static AudioNodeDescriptor * desc();
+
+    // AudioNode
+    virtual void process(ContextRenderLock &, int bufferSize) override;
+    virtual void reset(ContextRenderLock &) override;
+
+    // The ambisonic order, 1 to 3; 1 by default.
+    int order() const;
+    void setOrder(int order);
+
+    virtual double tailTime(ContextRenderLock & r) const override { return 0; }
+    virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
+};
+
+}  // namespace lab
+
+#endif
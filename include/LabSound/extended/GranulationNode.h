@@ -101,6 +101,7 @@ class GranulationNode : public AudioScheduledSourceNode
 
     std::vector<grain> grain_pool;
     std::shared_ptr<lab::AudioBus> window_bus;
+    std::vector<float> grain_sum_buffer; // sized once, at construction, to the longest render RenderGranulation accepts
 
 public:
     GranulationNode(AudioContext & ac);
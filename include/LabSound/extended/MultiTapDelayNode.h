@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef MULTI_TAP_DELAY_NODE_H
+#define MULTI_TAP_DELAY_NODE_H
+
+#include "LabSound/core/AudioBasicProcessorNode.h"
+#include "LabSound/core/AudioParam.h"
+#include "LabSound/core/AudioSetting.h"
+
+namespace lab
+{
+
+// MultiTapDelayNode delays its input by up to eight taps reading one delay line
+// for each channel, and sums them. Each tap's delay time is an audio rate param,
+// so a chorus, a flanger, or the heads of a tape echo need only this one node,
+// and one line, rather than a DelayNode for each voice.
+//
+// A tap's delay is followed sample accurately while it is modulated, and
+// approached smoothly when it is set; its gain is taken once per quantum.
+//
+// params: delayTime0 - delayTime7, gain0 - gain7
+// settings: taps, interpolation
+//
+class MultiTapDelayNode : public AudioBasicProcessorNode
+{
+    class MultiTapDelayNodeInternal;
+    MultiTapDelayNodeInternal * internalNode = nullptr;  // We do not own this!
+
+public:
+    enum
+    {
+        MaxTaps = 8
+    };
+
+    // How a delay between frames is read. Linear is the cheapest, and dulls the
+    // highs when the delay is modulated; cubic keeps more of them; allpass has
+    // a flat response, but smears a delay that changes quickly.
+    enum Interpolation
+    {
+        INTERPOLATE_LINEAR = 0,
+        INTERPOLATE_CUBIC = 1,
+        INTERPOLATE_ALLPASS = 2,
+    };
+
+    MultiTapDelayNode(AudioContext & ac, double maxDelayTime = 2.0);
+    virtual ~MultiTapDelayNode();
+
+    static const char* static_name() { return "MultiTapDelay"; }
+    virtual const char* name() const override { return static_name(); }
+    static AudioNodeDescriptor * desc();
+
+    // The number of taps read, 1 to MaxTaps; 1 by default.
+    int tapCount() const;
+    void setTapCount(int taps);
+
+    // INTERPOLATE_LINEAR by default
+    Interpolation interpolation() const;
+    void setInterpolation(Interpolation interpolation);
+
+    // In seconds, at most the maximum delay time; 0 by default.
+    std::shared_ptr<AudioParam> delayTime(int tap) const;
+
+    // 1 by default
+    std::shared_ptr<AudioParam> gain(int tap) const;
+
+    double maxDelayTime() const;
+};
+
+}  // namespace lab
+
+#endif
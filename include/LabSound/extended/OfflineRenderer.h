@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef OFFLINE_RENDERER_H
+#define OFFLINE_RENDERER_H
+
+#include "LabSound/core/ConcurrentQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lab
+{
+class AudioBus;
+class AudioContext;
+
+// An OfflineRenderSink receives the output of an offline render one block at a
+// time, as it is rendered. See AudioDestinationNode::offlineRender.
+class OfflineRenderSink
+{
+public:
+    virtual ~OfflineRenderSink() = default;
+
+    // called once before the first block. Returning false cancels the render.
+    virtual bool begin(int channelCount, float sampleRate) { return true; }
+
+    // called for each rendered block. frames is the bus length, except for the
+    // final block of a render. Returning false ends the render early.
+    virtual bool write(const AudioBus & bus, int frames) = 0;
+
+    // called once after the last block, including when a render ends early.
+    virtual void end() {}
+};
+
+// Streams a 32 bit float WAV file to disk. The header's sizes are written
+// when the render ends.
+class OfflineRenderWavSink : public OfflineRenderSink
+{
+    std::string _path;
+    std::ofstream _file;
+    std::vector<float> _interleaved;
+    int _channelCount = 0;
+    uint64_t _dataBytes = 0;
+
+public:
+    explicit OfflineRenderWavSink(const std::string & path);
+    virtual ~OfflineRenderWavSink();
+
+    virtual bool begin(int channelCount, float sampleRate) override;
+    virtual bool write(const AudioBus & bus, int frames) override;
+    virtual void end() override;
+};
+
+// Hands each block to a function.
+class OfflineRenderCallbackSink : public OfflineRenderSink
+{
+    std::function<bool(const AudioBus &, int)> _callback;
+
+public:
+    explicit OfflineRenderCallbackSink(std::function<bool(const AudioBus & bus, int frames)> callback)
+        : _callback(std::move(callback)) {}
+
+    virtual bool write(const AudioBus & bus, int frames) override { return _callback ? _callback(bus, frames) : false; }
+};
+
+// Writes interleaved samples into a ring buffer that is drained by another
+// thread. When the ring is full, the render waits for the reader to catch up,
+// so the ring must hold at least one block.
+class OfflineRenderRingBufferSink : public OfflineRenderSink
+{
+    RingBufferT<float> & _ring;
+    std::vector<float> _interleaved;
+    int _channelCount = 0;
+    std::atomic<bool> _cancelled{false};
+
+public:
+    explicit OfflineRenderRingBufferSink(RingBufferT<float> & ring) : _ring(ring) {}
+
+    // ends a render that is waiting for the reader
+    void cancel() { _cancelled = true; }
+
+    virtual bool begin(int channelCount, float sampleRate) override;
+    virtual bool write(const AudioBus & bus, int frames) override;
+};
+
+struct OfflineRenderStats
+{
+    uint64_t frames = 0;          // frames delivered to the sink
+    double seconds = 0;           // wall clock duration of the render
+    double framesPerSecond = 0;   // frames / seconds; a realtime render achieves the sample rate
+};
+
+// OfflineRenderer renders independent offline contexts concurrently, each on
+// one of a pool of threads. Each context must be offline, and have a
+// destination node. A context must not be shared between jobs in flight, but
+// the caller can continue to hold it, to inspect it after the job completes.
+class OfflineRenderer
+{
+public:
+    // threadCount of zero uses one thread per hardware thread
+    explicit OfflineRenderer(int threadCount = 0);
+
+    // waits for all jobs to complete
+    ~OfflineRenderer();
+
+    int threadCount() const { return static_cast<int>(_threads.size()); }
+
+    // queues framesToProcess frames of context's output to be rendered into sink
+    std::future<OfflineRenderStats> render(std::shared_ptr<AudioContext> context,
+                                           std::shared_ptr<OfflineRenderSink> sink,
+                                           uint64_t framesToProcess);
+
+    // blocks until every queued job has completed
+    void wait();
+
+    // the totals of every job completed so far. framesPerSecond is the
+    // aggregate throughput across all threads while jobs were in flight.
+    OfflineRenderStats totals() const;
+
+private:
+    struct Job
+    {
+        std::shared_ptr<AudioContext> context;
+        std::shared_ptr<OfflineRenderSink> sink;
+        uint64_t frames = 0;
+        std::promise<OfflineRenderStats> result;
+    };
+
+    void workerThread();
+
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    mutable std::mutex _mutex;
+    std::condition_variable _jobReady;
+    std::condition_variable _jobsDone;
+    int _inFlight = 0;
+    bool _shouldRun = true;
+
+    OfflineRenderStats _totals;
+    double _busySeconds = 0;
+    std::chrono::steady_clock::time_point _busySince;
+};
+
+}  // namespace lab
+
+#endif
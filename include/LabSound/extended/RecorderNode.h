@@ -17,6 +17,9 @@ class RecorderNode : public AudioNode
     virtual double tailTime(ContextRenderLock & r) const override { return 0; }
     virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
 
+    // silence is recorded too
+    virtual bool propagatesSilence(ContextRenderLock & r) const override { return false; }
+
     bool m_recording{false};
 
     std::vector<std::vector<float>> m_data;  // non-interleaved
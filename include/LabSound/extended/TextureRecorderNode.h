@@ -38,6 +38,9 @@ class TextureRecorderNode : public AudioNode
     virtual double tailTime(ContextRenderLock & r) const override { return 0; }
     virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
 
+    // silence is recorded too
+    virtual bool propagatesSilence(ContextRenderLock & r) const override { return false; }
+
     bool m_recording{false};
 
     // one stream per input: 0 = R (low), 1 = G (band), 2 = B (high)
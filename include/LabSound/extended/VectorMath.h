@@ -34,9 +34,66 @@ namespace VectorMath
     // Multiplies two complex vectors.
     void zvmul(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P, float * realDestP, float * imagDestP, int framesToProcess);
 
+    // Multiplies two complex vectors and sums the product into a third, as for the spectral
+    // accumulation of a partitioned convolution. The accumulator must not be one of the sources.
+    void zvmuladd(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P, float * realAccP, float * imagAccP, int framesToProcess);
+
     // Copies elements while clipping values to the threshold inputs.
     void vclip(const float * sourceP, int sourceStride, const float * lowThresholdP, const float * highThresholdP, float * destP, int destStride, int framesToProcess);
 
+    // Fills a float vector with a scalar.
+    void vfill(const float * valueP, float * destP, int destStride, int framesToProcess);
+
+    // Fills a float vector with a linear ramp, destP[i] = start + i * step.
+    // Each element is computed from its index, so error does not accumulate along the ramp.
+    void vramp(const float * startP, const float * stepP, float * destP, int destStride, int framesToProcess);
+
+    // Multiplies a float vector by a linear ramp, destP[i] = sourceP[i] * (start + i * step), as for a fade.
+    // On return, *startP is the ramp's value for the frame after the last one processed.
+    void vrampmul(const float * sourceP, int sourceStride, float * startP, const float * stepP, float * destP, int destStride, int framesToProcess);
+
+    // As vrampmul, but sums the result into destP.
+    void vrampmuladd(const float * sourceP, int sourceStride, float * startP, const float * stepP, float * destP, int destStride, int framesToProcess);
+
+    // Multiplies two float vectors and adds a third, destP[i] = source1P[i] * source2P[i] + source3P[i].
+    // source3P may be destP, to accumulate a product.
+    void vma(const float * source1P, int sourceStride1, const float * source2P, int sourceStride2,
+             const float * source3P, int sourceStride3, float * destP, int destStride, int framesToProcess);
+
+    // Interleaves channelCount channels into destP while clipping values to the thresholds.
+    void vintlvclip(const float * const * sourceChannels, int channelCount, const float * lowThresholdP, const float * highThresholdP,
+                    float * destP, int framesToProcess);
+
+    // De-interleaves channelCount channels from sourceP while clipping values to the thresholds.
+    void vdeintlvclip(const float * sourceP, int channelCount, const float * lowThresholdP, const float * highThresholdP,
+                      float * const * destChannels, int framesToProcess);
+
+    // The instruction sets the kernels above may run on. Baseline is the implementation chosen at
+    // compile time; SSE2 on x86-64, NEON on ARM, and Accelerate on Apple platforms. On x86-64, the
+    // AVX2 and AVX-512 implementations are selected at runtime when the CPU supports them, so a
+    // single binary runs on any x86-64 machine. Only contiguous (unit stride) vectors are
+    // dispatched; strided vectors are processed by the baseline implementation. On Apple platforms,
+    // the level is always Baseline.
+    enum class SimdLevel
+    {
+        Scalar = 0,
+        Baseline,
+        AVX2,
+        AVX512
+    };
+
+    // The highest level supported by both the build and the CPU.
+    SimdLevel supportedSimdLevel();
+
+    // The level in use. Initially, supportedSimdLevel().
+    SimdLevel simdLevel();
+
+    // Selects a level, limited to supportedSimdLevel(), and returns the level selected. Intended for
+    // benchmarks and for diagnosing numerical differences; call it while no context is rendering.
+    SimdLevel setSimdLevel(SimdLevel level);
+
+    const char * simdLevelName(SimdLevel level);
+
 }  // namespace VectorMath
 
 }  // namespace lab
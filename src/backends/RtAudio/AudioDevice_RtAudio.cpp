@@ -13,6 +13,8 @@
 
 #include "RtAudio.h"
 
+#include <algorithm>
+
 namespace lab
 {
 
@@ -274,84 +276,124 @@ void AudioDevice_RtAudio::render(
     float * fltOutputBuffer = reinterpret_cast<float *>(outputBuffer);
     float * fltInputBuffer = reinterpret_cast<float *>(inputBuffer);
 
+    auto dn = _destinationNode; // up the ref count
+    if (!dn)
+        return;
+
+    // The graph renders in quanta of the context's size, which need not match
+    // the hardware buffer size.
+    const int quantum = dn->renderQuantumSize();
+
     if (_outConfig.desired_channels)
     {
-        if (!_renderBus || _renderBus->length() < numberOfFrames)
+        if (!_renderBus || _renderBus->length() != quantum)
         {
-            _renderBus.reset(new AudioBus(_outConfig.desired_channels, numberOfFrames, true));
+            _renderBus.reset(new AudioBus(_outConfig.desired_channels, quantum, true));
             _renderBus->setSampleRate(authoritativeDeviceSampleRateAtRuntime);
+            _remainder = 0;
         }
     }
 
     if (_inConfig.desired_channels)
     {
-        if (!_inputBus || _inputBus->length() < numberOfFrames)
+        if (!_inputBus || _inputBus->length() != quantum)
         {
-            _inputBus.reset(new AudioBus(_inConfig.desired_channels, numberOfFrames, true));
+            _inputBus.reset(new AudioBus(_inConfig.desired_channels, quantum, true));
             _inputBus->setSampleRate(authoritativeDeviceSampleRateAtRuntime);
         }
     }
 
-    // copy the input buffer
-    if (_inConfig.desired_channels)
+    // copies count input frames starting at frame into the input bus at offset
+    auto copyInput = [&](int frame, int offset, int count)
     {
-        if (kInterleaved)
+        if (!_inConfig.desired_channels || !fltInputBuffer)
+            return;
+
+        for (uint32_t i = 0; i < _inConfig.desired_channels; ++i)
         {
-            for (uint32_t i = 0; i < _inConfig.desired_channels; ++i)
+            AudioChannel * channel = _inputBus->channel(i);
+            if (kInterleaved)
+            {
+                float * src = &fltInputBuffer[frame * _inConfig.desired_channels + i];
+                VectorMath::vclip(src, _inConfig.desired_channels, &kLowThreshold, &kHighThreshold,
+                                  channel->mutableData() + offset, 1, count);
+            }
+            else
             {
-                AudioChannel * channel = _inputBus->channel(i);
-                float * src = &fltInputBuffer[i];
-                VectorMath::vclip(src, 1, &kLowThreshold, &kHighThreshold,
-                                  channel->mutableData(), _inConfig.desired_channels,
-                                  numberOfFrames);
+                float * src = &fltInputBuffer[i * numberOfFrames + frame];
+                VectorMath::vclip(src, 1, &kLowThreshold, &kHighThreshold, channel->mutableData() + offset, 1, count);
             }
         }
-        else
+    };
+
+    // Clamp values at 0db (i.e., [-1.0, 1.0]) and copy count rendered frames
+    // starting at offset to the DAC output buffer at frame
+    auto copyOutput = [&](int offset, int frame, int count)
+    {
+        if (!_outConfig.desired_channels)
+            return;
+
+        for (uint32_t i = 0; i < _outConfig.desired_channels; ++i)
         {
-            for (uint32_t i = 0; i < _inConfig.desired_channels; ++i)
+            AudioChannel * channel = _renderBus->channel(i);
+            if (kInterleaved)
+            {
+                float * dst = &fltOutputBuffer[frame * _outConfig.desired_channels + i];
+                VectorMath::vclip(channel->data() + offset, 1, &kLowThreshold, &kHighThreshold, dst,
+                                  _outConfig.desired_channels, count);
+            }
+            else
             {
-                AudioChannel * channel = _inputBus->channel(i);
-                float * src = &fltInputBuffer[i * numberOfFrames];
-                VectorMath::vclip(src, 1, &kLowThreshold, &kHighThreshold, channel->mutableData(), 1, numberOfFrames);
+                float * dst = &fltOutputBuffer[i * numberOfFrames + frame];
+                VectorMath::vclip(channel->data() + offset, 1, &kLowThreshold, &kHighThreshold, dst, 1, count);
             }
         }
-    }
+    };
 
-    // Update sampling info
-    const int32_t index = 1 - (samplingInfo.current_sample_frame & 1);
-    const uint64_t t = samplingInfo.current_sample_frame & ~1;
-    samplingInfo.sampling_rate = authoritativeDeviceSampleRateAtRuntime;
-    samplingInfo.current_sample_frame = t + numberOfFrames + index;
-    samplingInfo.current_time = samplingInfo.current_sample_frame / static_cast<double>(samplingInfo.sampling_rate);
-    samplingInfo.epoch[index] = std::chrono::high_resolution_clock::now();
+    auto renderQuantum = [&]()
+    {
+        // Update sampling info
+        const int32_t index = 1 - (samplingInfo.current_sample_frame & 1);
+        const uint64_t t = samplingInfo.current_sample_frame & ~1;
+        samplingInfo.sampling_rate = authoritativeDeviceSampleRateAtRuntime;
+        samplingInfo.current_sample_frame = t + quantum + index;
+        samplingInfo.current_time = samplingInfo.current_sample_frame / static_cast<double>(samplingInfo.sampling_rate);
+        samplingInfo.epoch[index] = std::chrono::high_resolution_clock::now();
+
+        // Pull on the graph
+        dn->render(provider, _inputBus.get(), _renderBus.get(), quantum, samplingInfo);
+    };
 
-    // Pull on the graph
-    auto dn = _destinationNode; // up the ref count
-    if (dn)
-        dn->render(provider, _inputBus.get(), _renderBus.get(), numberOfFrames, samplingInfo);
+    if (!_remainder && numberOfFrames % quantum == 0)
+    {
+        // the hardware buffer holds a whole number of quanta, so each quantum
+        // is rendered from its own input with no added latency
+        for (int frame = 0; frame < numberOfFrames; frame += quantum)
+        {
+            copyInput(frame, 0, quantum);
+            renderQuantum();
+            copyOutput(0, frame, quantum);
+        }
+        return;
+    }
 
-    // Then deliver the rendered audio back to rtaudio, ready for the next callback
-    if (_outConfig.desired_channels)
+    // otherwise, quanta straddle hardware buffers. Input is gathered while the
+    // previous quantum's output drains, and rendered one quantum later.
+    int frame = 0;
+    while (frame < numberOfFrames)
     {
-        // Clamp values at 0db (i.e., [-1.0, 1.0]) and also copy result to the DAC output buffer
-        if (kInterleaved)
+        if (_remainder > 0)
         {
-            for (uint32_t i = 0; i < _outConfig.desired_channels; ++i)
-            {
-                AudioChannel * channel = _renderBus->channel(i);
-                float * dst = &fltOutputBuffer[i];
-                VectorMath::vclip(channel->data(), 1, &kLowThreshold, &kHighThreshold, dst,
-                                  _outConfig.desired_channels, numberOfFrames);
-            }
+            int count = std::min(_remainder, numberOfFrames - frame);
+            copyInput(frame, quantum - _remainder, count);
+            copyOutput(quantum - _remainder, frame, count);
+            frame += count;
+            _remainder -= count;
         }
         else
         {
-            for (uint32_t i = 0; i < _outConfig.desired_channels; ++i)
-            {
-                AudioChannel * channel = _renderBus->channel(i);
-                float * dst = &fltOutputBuffer[i * numberOfFrames];
-                VectorMath::vclip(channel->data(), 1, &kLowThreshold, &kHighThreshold, dst, 1, numberOfFrames);
-            }
+            renderQuantum();
+            _remainder = quantum;
         }
     }
 }
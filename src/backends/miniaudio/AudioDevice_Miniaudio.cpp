@@ -39,7 +39,7 @@ namespace lab
 
 const float kLowThreshold = -1.0f;
 const float kHighThreshold = 1.0f;
-const int kRenderQuantum = AudioNode::ProcessingSizeInFrames;
+const int kMaxChannels = 32;  // the most an AudioBus can have
 
 /// @TODO - the AudioDeviceInfo wants to support specific sample rates, but miniaudio only tells min and max
 ///         miniaudio also has a concept of minChannels, which LabSound ignores
@@ -231,7 +231,6 @@ AudioDevice_Miniaudio::AudioDevice_Miniaudio(const AudioStreamConfig & _inputCon
 
     _ring = new lab::RingBufferT<float>();
     _ring->resize(static_cast<int>(authoritativeDeviceSampleRateAtRuntime));  // ad hoc. hold one second
-    _scratch = reinterpret_cast<float *>(malloc(sizeof(float) * kRenderQuantum * _inConfig.desired_channels));
 }
 
 AudioDevice_Miniaudio::~AudioDevice_Miniaudio()
@@ -303,16 +302,21 @@ bool AudioDevice_Miniaudio::isRunning() const
 int AudioDevice_Miniaudio::render(int numberOfFrames_, void * outputBuffer, void * inputBuffer)
 {
     int numberOfFrames = numberOfFrames_;
+
+    // the graph renders in quanta of the context's size, which is fixed when
+    // the context is created, so the buses are sized on the first render
+    const int quantum = _destinationNode->renderQuantumSize();
     if (!_renderBus)
     {
-        _renderBus = new AudioBus(_outConfig.desired_channels, kRenderQuantum, true);
+        _renderBus = new AudioBus(_outConfig.desired_channels, quantum, true);
         _renderBus->setSampleRate(authoritativeDeviceSampleRateAtRuntime);
     }
 
     if (!_inputBus && _inConfig.desired_channels)
     {
-        _inputBus = new AudioBus(_inConfig.desired_channels, kRenderQuantum, true);
+        _inputBus = new AudioBus(_inConfig.desired_channels, quantum, true);
         _inputBus->setSampleRate(authoritativeDeviceSampleRateAtRuntime);
+        _scratch = reinterpret_cast<float *>(malloc(sizeof(float) * quantum * _inConfig.desired_channels));
     }
 
     float * pIn = static_cast<float *>(inputBuffer);
@@ -332,19 +336,13 @@ int AudioDevice_Miniaudio::render(int numberOfFrames_, void * outputBuffer, void
             // left over from the previous numberOfFrames, so start by moving those into
             // the output buffer.
 
-            // miniaudio expects interleaved data, this loop leverages the vclip operation
-            // to copy, interleave, and clip in one pass.
+            // miniaudio expects interleaved data; copy, interleave, and clip in one pass.
 
             int samples = _remainder < numberOfFrames ? _remainder : numberOfFrames;
+            const float * sources[kMaxChannels];
             for (int i = 0; i < out_channels; ++i)
-            {
-                int src_stride = 1;  // de-interleaved
-                int dst_stride = out_channels;  // interleaved
-                AudioChannel * channel = _renderBus->channel(i);
-                VectorMath::vclip(channel->data() + kRenderQuantum - _remainder, src_stride,
-                                  &kLowThreshold, &kHighThreshold,
-                                  pOut + i, dst_stride, samples);
-            }
+                sources[i] = _renderBus->channel(i)->data() + quantum - _remainder;
+            VectorMath::vintlvclip(sources, out_channels, &kLowThreshold, &kHighThreshold, pOut, samples);
             pOut += out_channels * samples;
 
             numberOfFrames -= samples;  // deduct samples actually copied to output
@@ -354,31 +352,26 @@ int AudioDevice_Miniaudio::render(int numberOfFrames_, void * outputBuffer, void
         {
             if (in_channels)
             {
-                // miniaudio provides the input data in interleaved form, vclip is used here to de-interleave
+                // miniaudio provides the input data in interleaved form; de-interleave and clip it
 
-                _ring->read(_scratch, in_channels * kRenderQuantum);
+                _ring->read(_scratch, in_channels * quantum);
+                float * destinations[kMaxChannels];
                 for (int i = 0; i < in_channels; ++i)
-                {
-                    int src_stride = in_channels;  // interleaved
-                    int dst_stride = 1;  // de-interleaved
-                    AudioChannel * channel = _inputBus->channel(i);
-                    VectorMath::vclip(_scratch + i, src_stride,
-                                      &kLowThreshold, &kHighThreshold,
-                                      channel->mutableData(), dst_stride, kRenderQuantum);
-                }
+                    destinations[i] = _inputBus->channel(i)->mutableData();
+                VectorMath::vdeintlvclip(_scratch, in_channels, &kLowThreshold, &kHighThreshold, destinations, quantum);
             }
 
             // Update sampling info for use by the render graph
             const int32_t index = 1 - (samplingInfo.current_sample_frame & 1);
             const uint64_t t = samplingInfo.current_sample_frame & ~1;
             samplingInfo.sampling_rate = authoritativeDeviceSampleRateAtRuntime;
-            samplingInfo.current_sample_frame = t + kRenderQuantum + index;
+            samplingInfo.current_sample_frame = t + quantum + index;
             samplingInfo.current_time = samplingInfo.current_sample_frame / static_cast<double>(samplingInfo.sampling_rate);
             samplingInfo.epoch[index] = std::chrono::high_resolution_clock::now();
 
             // generate new data
-            _destinationNode->render(sourceProvider(), _inputBus, _renderBus, kRenderQuantum, samplingInfo);
-            _remainder = kRenderQuantum;
+            _destinationNode->render(sourceProvider(), _inputBus, _renderBus, quantum, samplingInfo);
+            _remainder = quantum;
         }
     }
     return numberOfFrames_;
@@ -30,7 +30,7 @@ namespace lab
 
 const float kLowThreshold = -1.0f;
 const float kHighThreshold = 1.0f;
-const int kRenderQuantum = AudioNode::ProcessingSizeInFrames;
+const int kMaxChannels = 32;  // the most an AudioBus can have
 
 std::vector<AudioDeviceInfo> AudioDevice_Mockaudio::MakeAudioDeviceList()
 {
@@ -173,14 +173,16 @@ int AudioDevice_Mockaudio::render(int numberOfFrames, void * outputBuffer, void
         return 0;
     }
     
+    // the graph renders in quanta of the context's size
+    const int quantum = _destinationNode->renderQuantumSize();
     if (!_renderBus) {
-        _renderBus = new AudioBus(_outConfig.desired_channels, kRenderQuantum, true);
+        _renderBus = new AudioBus(_outConfig.desired_channels, quantum, true);
         _renderBus->setSampleRate(authoritativeDeviceSampleRateAtRuntime);
     }
     
     // We don't use input in mock device
     if (!_inputBus && _inConfig.desired_channels) {
-        _inputBus = new AudioBus(_inConfig.desired_channels, kRenderQuantum, true);
+        _inputBus = new AudioBus(_inConfig.desired_channels, quantum, true);
         _inputBus->setSampleRate(authoritativeDeviceSampleRateAtRuntime);
     }
     
@@ -195,20 +197,16 @@ int AudioDevice_Mockaudio::render(int numberOfFrames, void * outputBuffer, void
             rendered += samples;
             
             // Copy to output buffer (similar to miniaudio implementation)
-            for (int i = 0; i < out_channels; ++i) {
-                int src_stride = 1;  // de-interleaved
-                int dst_stride = out_channels;  // interleaved
-                AudioChannel * channel = _renderBus->channel(i);
-                VectorMath::vclip(channel->data() + kRenderQuantum - _remainder, src_stride,
-                                  &kLowThreshold, &kHighThreshold,
-                                  pOut + i, dst_stride, samples);
-            }
+            const float * sources[kMaxChannels];
+            for (int i = 0; i < out_channels; ++i)
+                sources[i] = _renderBus->channel(i)->data() + quantum - _remainder;
+            VectorMath::vintlvclip(sources, out_channels, &kLowThreshold, &kHighThreshold, pOut, samples);
             
             // Append only the first channel to our memory buffer
             AudioChannel * firstChannel = _renderBus->channel(0);
             for (int i = 0; i < samples; ++i) {
                 if (_currentBufferPosition < _bufferSize) {
-                    _memoryBuffer[_currentBufferPosition++] = firstChannel->data()[kRenderQuantum - _remainder + i];
+                    _memoryBuffer[_currentBufferPosition++] = firstChannel->data()[quantum - _remainder + i];
                 }
                 else {
                     // Buffer is full, write to WAV file and stop processing
@@ -227,14 +225,14 @@ int AudioDevice_Mockaudio::render(int numberOfFrames, void * outputBuffer, void
             const int32_t index = 1 - (samplingInfo.current_sample_frame & 1);
             const uint64_t t = samplingInfo.current_sample_frame & ~1;
             samplingInfo.sampling_rate = authoritativeDeviceSampleRateAtRuntime;
-            samplingInfo.current_sample_frame = t + kRenderQuantum + index;
+            samplingInfo.current_sample_frame = t + quantum + index;
             samplingInfo.current_time = samplingInfo.current_sample_frame / static_cast<double>(samplingInfo.sampling_rate);
             samplingInfo.epoch[index] = std::chrono::high_resolution_clock::now();
             
             // Generate new data
-            _destinationNode->render(sourceProvider(), _inputBus, _renderBus, kRenderQuantum, samplingInfo);
-            _remainder = kRenderQuantum;
-            rendered += kRenderQuantum;
+            _destinationNode->render(sourceProvider(), _inputBus, _renderBus, quantum, samplingInfo);
+            _remainder = quantum;
+            rendered += quantum;
         }
     }
     return rendered;
@@ -9,7 +9,11 @@
 #include "LabSound/core/AudioNodeInput.h"
 #include "LabSound/core/AudioNodeOutput.h"
 #include "LabSound/core/OscillatorNode.h"
+#include "internal/AudioBusPool.h"
 #include "internal/HRTFDatabase.h"
+#include "internal/HRTFRenderer.h"
+#include "internal/RenderHandoff.h"
+#include "internal/RenderThreadPool.h"
 
 #include "LabSound/extended/AudioContextLock.h"
 
@@ -23,9 +27,11 @@
 #include "concurrentqueue/concurrentqueue.h"
 #include "libnyquist/Encoders.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <queue>
 #include <stdio.h>
+#include <unordered_map>
 
 namespace lab {
 
@@ -62,8 +68,9 @@ struct PendingParamConnection
 
 struct AudioContext::Internals
 {
-    Internals(bool a)
+    Internals(bool a, int renderQuantumSize)
         : autoDispatchEvents(a)
+        , busPool(renderQuantumSize)
     {
     }
     ~Internals() = default;
@@ -75,6 +82,43 @@ struct AudioContext::Internals
 
     std::shared_ptr<HRTFDatabaseLoader> hrtfDatabaseLoader;
 
+    // Renders the HRTF panners together; made off the render thread once the database has
+    // loaded, by prepareHrtfRenderer(), and handed to it. The pointer is exchanged atomically.
+    std::shared_ptr<HRTFRenderer> hrtfRenderer;
+    RenderHandoff<HRTFRenderer> hrtfRenderers;
+
+    // buses for channel count changes on the audio thread
+    AudioBusPool busPool;
+
+    // connected nodes that asked to be prepared again, off the render thread; the
+    // mutex guards the HRTF renderer's handoff too
+    std::mutex preparedNodesMutex;
+    std::vector<std::weak_ptr<AudioNode>> preparedNodes;
+
+    // compiled rendering
+    struct ScheduledNode
+    {
+        AudioNode * node;
+        std::weak_ptr<AudioNode::Internal> alive; // expires if the node is released
+    };
+
+    std::atomic<bool> useRenderSchedule{false};
+    std::atomic<bool> renderScheduleNeedsUpdate{true};
+    AudioNodeInput * renderScheduleInlet = nullptr;
+    std::vector<ScheduledNode> renderSchedule;
+    std::vector<AudioNode *> sortedNodes;
+    int traversalColor = 0;
+
+    // parallel rendering. Chains of nodes in the schedule that have no other
+    // connections are grouped into a single task, so tasks fork and join only
+    // where the graph does.
+    static const int ParallelRenderMinimumNodes = 16;
+    std::unique_ptr<RenderThreadPool> renderThreads;
+    std::vector<RenderTask> renderTasks;
+    std::vector<std::vector<int>> renderTaskNodes;
+    bool renderInParallel = false;
+    bool renderingSchedule = false;
+
     
     std::vector<float> debugBuffer;
     const int debugBufferCapacity = 1024 * 1024;
@@ -131,7 +175,7 @@ AudioContext::AudioContext(bool isOffline)
     : m_isOfflineContext(isOffline)
 {
     static std::atomic<int> id {1};
-    m_internal.reset(new AudioContext::Internals(true));
+    m_internal.reset(new AudioContext::Internals(true, m_renderQuantumSize));
     m_listener.reset(new AudioListener());
     m_audioContextInterface = std::make_shared<AudioContextInterface>(this, id);
     ++id;
@@ -143,11 +187,20 @@ AudioContext::AudioContext(bool isOffline)
     }
 }
 
-AudioContext::AudioContext(bool isOffline, bool autoDispatchEvents)
+AudioContext::AudioContext(bool isOffline, bool autoDispatchEvents, int renderThreadCount, int renderQuantumSize)
     : m_isOfflineContext(isOffline)
 {
+    // the FFT based nodes process in power of two blocks that must divide evenly
+    int quantum = MinRenderQuantumSize;
+    while (quantum < renderQuantumSize && quantum < MaxRenderQuantumSize)
+        quantum *= 2;
+    if (quantum != renderQuantumSize)
+        LOG_ERROR("AudioContext: render quantum size %d is not a power of two from %d to %d, using %d",
+                  renderQuantumSize, MinRenderQuantumSize, MaxRenderQuantumSize, quantum);
+    m_renderQuantumSize = quantum;
+
     static std::atomic<int> id {1};
-    m_internal.reset(new AudioContext::Internals(autoDispatchEvents));
+    m_internal.reset(new AudioContext::Internals(autoDispatchEvents, m_renderQuantumSize));
     m_listener.reset(new AudioListener());
     m_audioContextInterface = std::make_shared<AudioContextInterface>(this, id);
     ++id;
@@ -157,6 +210,12 @@ AudioContext::AudioContext(bool isOffline, bool autoDispatchEvents)
         updateThreadShouldRun = 1;
         graphKeepAlive = 0;
     }
+
+    if (renderThreadCount > 0)
+    {
+        m_internal->renderThreads.reset(new RenderThreadPool(renderThreadCount));
+        m_internal->useRenderSchedule = true;
+    }
 }
 
 bool AudioContext::isAutodispatchingEvents() const
@@ -197,29 +256,39 @@ AudioContext::~AudioContext()
 
 bool AudioContext::loadHrtfDatabase(const std::string & searchPath)
 {
-    //auto db = new HRTFDatabaseLoader(sampleRate(), searchPath);
-    //m_internal->hrtfDatabaseLoader.reset(db);
-    //db->loadAsynchronously();
-    //db->waitForLoaderThreadCompletion();
-    //return db->database()->numberOfElevations() > 0 && db->database()->numberOfAzimuths() > 0;
-    bool loaded = true;
-    auto db = HRTFDatabaseLoader::MakeHRTFLoaderSingleton(sampleRate(), searchPath);
-    // auto db = new HRTFDatabaseLoader(sampleRate(), searchPath);
-    if (!db->database() || !db->database()->files_found_and_loaded())
-    {
-        m_internal->hrtfDatabaseLoader.reset(db);
-        db->loadAsynchronously();
-        db->waitForLoaderThreadCompletion();
-        printf("db files found and loaded %d", db->database()->files_found_and_loaded() ? 1 : 0);
-        printf("num elevs %d num az %d\n", db->database()->numberOfElevations(), db->database()->numberOfAzimuths());
-        loaded = db->database()->files_found_and_loaded();
-        loaded = loaded && db->database()->numberOfElevations() > 0 && db->database()->numberOfAzimuths() > 0;
-    }
-    return loaded;
+    loadHrtfDatabaseAsync(searchPath);
+
+    auto db = hrtfDatabaseLoader();
+    db->waitUntilLoaded();
+
+    // the panners connected already are ready to render at once
+    prepareNodes();
+
+    const HRTFDatabase * database = db->database();
+    LOG_INFO("db files found and loaded %d", database->files_found_and_loaded() ? 1 : 0);
+    LOG_INFO("num elevs %d num az %d", database->numberOfElevations(), database->numberOfAzimuths());
+    return database->files_found_and_loaded() && database->numberOfElevations() > 0 && database->numberOfAzimuths() > 0;
+}
+
+void AudioContext::loadHrtfDatabaseAsync(const std::string & searchPath)
+{
+    // the render thread reads the loader without a lock
+    std::atomic_store(&m_internal->hrtfDatabaseLoader, HRTFDatabaseLoader::acquire(sampleRate(), searchPath));
+}
+
+bool AudioContext::isHrtfDatabaseLoaded() const
+{
+    auto db = hrtfDatabaseLoader();
+    return db && db->isLoaded() && db->database()->files_found_and_loaded();
 }
 
 std::shared_ptr<HRTFDatabaseLoader> AudioContext::hrtfDatabaseLoader() const {
-    return m_internal->hrtfDatabaseLoader;
+    return std::atomic_load(&m_internal->hrtfDatabaseLoader);
+}
+
+std::shared_ptr<HRTFRenderer> AudioContext::hrtfRenderer() const
+{
+    return std::atomic_load(&m_internal->hrtfRenderer);
 }
 
 void AudioContext::lazyInitialize()
@@ -320,6 +389,8 @@ void AudioContext::handlePreRenderTasks(ContextRenderLock & r)
                 AudioParam::disconnect(gLock,
                                        param_connection.destination,
                                        param_connection.source->output(param_connection.destIndex));
+
+            m_internal->renderScheduleNeedsUpdate = true;
         }
 
         // resolve node connections
@@ -337,6 +408,8 @@ void AudioContext::handlePreRenderTasks(ContextRenderLock & r)
 
                     if (!node_connection.source->isScheduledNode())
                         node_connection.source->_self->_scheduler.start(0);
+
+                    m_internal->renderScheduleNeedsUpdate = true;
                 }
                 break;
 
@@ -362,11 +435,13 @@ void AudioContext::handlePreRenderTasks(ContextRenderLock & r)
                 {
                     if (node_connection.duration > 0)
                     {
-                        node_connection.duration -= AudioNode::ProcessingSizeInFrames / sampleRate();
+                        node_connection.duration -= m_renderQuantumSize / sampleRate();
                         requeued_connections.push_back(node_connection);
                         continue;
                     }
 
+                    m_internal->renderScheduleNeedsUpdate = true;
+
                     if (node_connection.source && node_connection.destination)
                     {
                         //if (!node_connection.destination->disconnectionReady() || !node_connection.source->disconnectionReady())
@@ -415,6 +490,14 @@ void AudioContext::handlePreRenderTasks(ContextRenderLock & r)
 void AudioContext::handlePostRenderTasks(ContextRenderLock & r)
 {
     ASSERT(r.context());
+
+    // convolve the HRTF blocks this quantum completed, for the panners to read from the next
+    {
+        RenderHandoff<HRTFRenderer>::Use renderer(m_internal->hrtfRenderers);
+        if (renderer)
+            renderer->processBlocks(r);
+    }
+
     AudioSummingJunction::handleDirtyAudioSummingJunctions(r);
     updateAutomaticPullNodes();
 }
@@ -447,6 +530,8 @@ void AudioContext::connect(std::shared_ptr<AudioNode> destination, std::shared_p
         throw std::out_of_range("Output index greater than available outputs");
     if (destIdx > destination->numberOfInputs())
         throw std::out_of_range("Input index greater than available inputs");
+    prepareNode(source);
+    prepareNode(destination);
     m_internal->pendingNodeConnections.enqueue({ConnectionOperationKind::Connect, destination, source, destIdx, srcIdx});
 }
 
@@ -493,6 +578,7 @@ void AudioContext::connectParam(std::shared_ptr<AudioParam> param, std::shared_p
         throw std::invalid_argument("No driving node supplied");
     if (index >= driver->numberOfOutputs())
         throw std::out_of_range("Output index greater than available outputs on the driver");
+    prepareNode(driver);
     m_internal->pendingParamConnections.enqueue({ConnectionOperationKind::Connect, param, driver, index});
 }
 
@@ -514,6 +600,7 @@ void AudioContext::connectParam(std::shared_ptr<AudioNode> destinationNode, char
     if (index >= driver->numberOfOutputs())
         throw std::out_of_range("Output index greater than available outputs on the driver");
 
+    prepareNode(driver);
     m_internal->pendingParamConnections.enqueue({ConnectionOperationKind::Connect, param, driver, index});
 }
 
@@ -533,7 +620,7 @@ void AudioContext::update()
 {
     if (!m_isOfflineContext) { LOG_TRACE("Begin UpdateGraphThread"); }
 
-    const float frameLengthInMilliseconds = (sampleRate() / (float) AudioNode::ProcessingSizeInFrames) / 1000.f;  // = ~0.345ms @ 44.1k/128
+    const float frameLengthInMilliseconds = (sampleRate() / (float) m_renderQuantumSize) / 1000.f;  // = ~0.345ms @ 44.1k/128
     const float graphTickDurationMs = frameLengthInMilliseconds * 16;  // = ~5.5ms
     const uint32_t graphTickDurationUs = static_cast<uint32_t>(graphTickDurationMs * 1000.f);  // = ~5550us
 
@@ -562,6 +649,9 @@ void AudioContext::update()
         if (m_internal->autoDispatchEvents)
             dispatchEvents();
 
+        m_internal->busPool.service();
+        prepareNodes();
+
         {
             const double now = currentTime();
             const float delta = static_cast<float>(now - lastGraphUpdateTime);
@@ -584,6 +674,61 @@ void AudioContext::update()
     }
 }
 
+void AudioContext::serviceOfflineRender()
+{
+    if (m_internal->autoDispatchEvents)
+        dispatchEvents();
+
+    m_internal->busPool.service();
+    prepareNodes();
+}
+
+void AudioContext::prepareHrtfRenderer()
+{
+    // HRTF panners prepared from now on use the current database
+    auto loader = hrtfDatabaseLoader();
+    auto & renderers = m_internal->hrtfRenderers;
+    auto renderer = renderers.current();
+    if (loader && loader->isLoaded() && sampleRate() > 0 && (!renderer || renderer->databaseLoader() != loader.get()))
+    {
+        renderer = std::make_shared<HRTFRenderer>(sampleRate(), m_renderQuantumSize, loader);
+        std::atomic_store(&m_internal->hrtfRenderer, renderer);
+        renderers.publish(renderer);
+    }
+
+    renderers.collect();
+    if (renderer)
+        renderer->collect();
+}
+
+void AudioContext::prepareNode(std::shared_ptr<AudioNode> node)
+{
+    std::lock_guard<std::mutex> lock(m_internal->preparedNodesMutex);
+    prepareHrtfRenderer();
+
+    auto & nodes = m_internal->preparedNodes;
+    for (auto & n : nodes)
+    {
+        if (n.lock() == node)
+            return;
+    }
+
+    if (node->prepare(*this))
+        nodes.push_back(node);
+}
+
+void AudioContext::prepareNodes()
+{
+    std::lock_guard<std::mutex> lock(m_internal->preparedNodesMutex);
+    prepareHrtfRenderer();
+
+    auto & nodes = m_internal->preparedNodes;
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [this](const std::weak_ptr<AudioNode> & n) {
+        auto node = n.lock();
+        return !node || !node->prepare(*this);
+    }), nodes.end());
+}
+
 void AudioContext::addAutomaticPullNode(std::shared_ptr<AudioNode> node)
 {
     std::lock_guard<std::mutex> lock(m_updateMutex);
@@ -630,6 +775,7 @@ void AudioContext::updateAutomaticPullNodes()
         }
 
         m_automaticPullNodesNeedUpdating = false;
+        m_internal->renderScheduleNeedsUpdate = true;
     }
 }
 
@@ -641,6 +787,331 @@ void AudioContext::processAutomaticPullNodes(ContextRenderLock & r, int framesTo
     }
 }
 
+namespace
+{
+    // the quantum a RenderThreadPool is working on
+    struct ParallelRenderJob
+    {
+        ContextRenderLock & r;
+        const std::vector<AudioNode *> & nodes;
+        const std::vector<std::vector<int>> & taskNodes;
+        int framesToProcess;
+
+        static void process(void * user, int task)
+        {
+            auto job = reinterpret_cast<ParallelRenderJob *>(user);
+            for (int i : job->taskNodes[task])
+                job->nodes[i]->processScheduled(job->r, job->framesToProcess);
+        }
+    };
+}
+
+void AudioContext::setCompiledRendering(bool enable)
+{
+    m_internal->useRenderSchedule = enable;
+}
+
+bool AudioContext::isCompiledRendering() const
+{
+    return m_internal->useRenderSchedule;
+}
+
+bool AudioContext::isRenderingSchedule() const
+{
+    return m_internal->renderingSchedule;
+}
+
+int AudioContext::renderThreadCount() const
+{
+    return m_internal->renderThreads ? m_internal->renderThreads->threadCount() : 0;
+}
+
+void AudioContext::invalidateRenderSchedule()
+{
+    m_internal->renderScheduleNeedsUpdate = true;
+}
+
+void AudioContext::exchangeBus(ContextRenderLock & r, std::unique_ptr<AudioBus> & bus, int numberOfChannels)
+{
+    ASSERT(r.context());
+
+    if (m_internal->busPool.exchange(bus, numberOfChannels))
+        return;
+
+    // the pool can't help this time, but it has noted the request
+    bus.reset(new AudioBus(numberOfChannels, m_renderQuantumSize));
+}
+
+void AudioContext::sortRenderGraph(ContextRenderLock & r, AudioNodeInput * inlet,
+                                   const std::vector<AudioNode *> & roots, std::vector<AudioNode *> & schedule)
+{
+    // Nodes are colored visiting when first reached, and visited once every node
+    // they depend on has been scheduled. Reaching a visiting node again means the
+    // graph has a cycle; the edge is skipped, and the node closing the cycle reads
+    // the output produced on the previous quantum, as it does when pulled.
+    m_internal->traversalColor += 2;
+    const int visiting = m_internal->traversalColor;
+    const int visited = visiting + 1;
+
+    struct Entry
+    {
+        AudioNode * node;
+        bool expanded;
+    };
+    std::vector<Entry> node_stack;
+
+    auto pushSources = [&](AudioNodeInput * in)
+    {
+        in->updateScheduledOutputs(r);
+        for (AudioNodeOutput * output : in->scheduledOutputs())
+        {
+            AudioNode * node = output->sourceNode();
+            if (node && node->_self->color < visiting)
+                node_stack.push_back({node, false});
+        }
+    };
+
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+        node_stack.push_back({*it, false});
+
+    if (inlet)
+        pushSources(inlet);
+
+    while (!node_stack.empty())
+    {
+        Entry current = node_stack.back();
+        node_stack.pop_back();
+        AudioNode * node = current.node;
+
+        if (current.expanded)
+        {
+            // everything upstream has been scheduled, so this node may run
+            node->_self->color = visited;
+            schedule.push_back(node);
+            continue;
+        }
+
+        if (node->_self->color >= visiting)
+            continue;
+
+        node->_self->color = visiting;
+        node_stack.push_back({node, true});
+
+        for (auto & p : node->_self->_params)
+        {
+            // if there are rendering connections, be sure they are ready
+            p->updateRenderingState(r);
+
+            int connectionCount = p->numberOfRenderingConnections(r);
+            for (int i = 0; i < connectionCount; ++i)
+            {
+                std::shared_ptr<AudioNodeOutput> output = p->renderingOutput(r, i);
+                AudioNode * source = output ? output->sourceNode() : nullptr;
+                if (source && source->_self->color < visiting)
+                    node_stack.push_back({source, false});
+            }
+        }
+
+        for (auto & in : node->_self->m_inputs)
+        {
+            if (in)
+                pushSources(in.get());
+        }
+    }
+}
+
+void AudioContext::compileRenderSchedule(ContextRenderLock & r, AudioNodeInput * inlet)
+{
+    unfoldScheduledGains();
+
+    // nodes such as analysers are processed even if nothing downstream pulls them
+    std::vector<AudioNode *> roots;
+    roots.reserve(m_renderingAutomaticPullNodes.size());
+    for (auto & n : m_renderingAutomaticPullNodes)
+        roots.push_back(n.get());
+
+    auto & sorted = m_internal->sortedNodes;
+    sorted.clear();
+    sortRenderGraph(r, inlet, roots, sorted);
+
+    auto & schedule = m_internal->renderSchedule;
+    schedule.clear();
+    for (AudioNode * node : sorted)
+        schedule.push_back({node, node->_self});
+
+    // gain nodes feeding a summing junction alone are processed by the junction. They stay
+    // in the schedule, so that their inputs and params are ordered before the junction.
+    for (AudioNode * node : sorted)
+    {
+        for (auto & in : node->_self->m_inputs)
+        {
+            if (in)
+                in->foldScheduledGains(r);
+        }
+    }
+
+    m_internal->renderScheduleInlet = inlet;
+    m_internal->renderScheduleNeedsUpdate = false;
+
+    m_internal->renderInParallel = false;
+    if (m_internal->renderThreads && static_cast<int>(sorted.size()) >= Internals::ParallelRenderMinimumNodes)
+        m_internal->renderInParallel = partitionRenderSchedule(r);
+}
+
+void AudioContext::unfoldScheduledGains()
+{
+    for (auto & s : m_internal->renderSchedule)
+    {
+        if (!s.alive.expired())
+            s.node->_self->foldedInto = nullptr;
+    }
+}
+
+bool AudioContext::partitionRenderSchedule(ContextRenderLock & r)
+{
+    const auto & sorted = m_internal->sortedNodes;
+    const int nodeCount = static_cast<int>(sorted.size());
+
+    std::unordered_map<AudioNode *, int> scheduleIndex;
+    for (int i = 0; i < nodeCount; ++i)
+        scheduleIndex[sorted[i]] = i;
+
+    // find the scheduled nodes feeding each node's inputs and parameters
+    std::vector<std::vector<int>> sources(nodeCount);
+    std::vector<int> dependentCount(nodeCount, 0);
+    auto addSource = [&](int i, AudioNodeOutput * output) -> bool
+    {
+        auto it = output ? scheduleIndex.find(output->sourceNode()) : scheduleIndex.end();
+        if (it == scheduleIndex.end())
+            return true;
+
+        // a cycle reads the previous quantum's output, which is only safe serially
+        if (it->second >= i)
+            return false;
+
+        if (std::find(sources[i].begin(), sources[i].end(), it->second) == sources[i].end())
+        {
+            sources[i].push_back(it->second);
+            ++dependentCount[it->second];
+        }
+        return true;
+    };
+
+    for (int i = 0; i < nodeCount; ++i)
+    {
+        AudioNode * node = sorted[i];
+        for (auto & in : node->_self->m_inputs)
+        {
+            if (!in)
+                continue;
+            for (AudioNodeOutput * output : in->scheduledOutputs())
+                if (!addSource(i, output))
+                    return false;
+        }
+        for (auto & p : node->_self->_params)
+        {
+            int connectionCount = p->numberOfRenderingConnections(r);
+            for (int j = 0; j < connectionCount; ++j)
+                if (!addSource(i, p->renderingOutput(r, j).get()))
+                    return false;
+        }
+    }
+
+    // a node continues its source's task if it is that source's only dependent
+    auto & tasks = m_internal->renderTasks;
+    auto & taskNodes = m_internal->renderTaskNodes;
+    tasks.clear();
+    taskNodes.clear();
+    std::vector<int> taskOf(nodeCount, -1);
+    for (int i = 0; i < nodeCount; ++i)
+    {
+        if (sources[i].size() == 1 && dependentCount[sources[i][0]] == 1)
+        {
+            taskOf[i] = taskOf[sources[i][0]];
+            taskNodes[taskOf[i]].push_back(i);
+            continue;
+        }
+
+        int task = static_cast<int>(tasks.size());
+        taskOf[i] = task;
+        tasks.emplace_back();
+        taskNodes.push_back({i});
+
+        for (int src : sources[i])
+        {
+            auto & dependents = tasks[taskOf[src]].dependents;
+            if (std::find(dependents.begin(), dependents.end(), task) == dependents.end())
+            {
+                dependents.push_back(task);
+                ++tasks[task].dependencies;
+            }
+        }
+    }
+
+    if (tasks.size() < 2)
+        return false;
+
+    // a folded node keeps its place in the task graph, but is processed by the junction
+    // it's folded into
+    for (auto & nodes : taskNodes)
+        nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [&](int i) { return sorted[i]->_self->foldedInto != nullptr; }), nodes.end());
+
+    m_internal->renderThreads->reserve(static_cast<int>(tasks.size()));
+    return true;
+}
+
+AudioBus * AudioContext::renderCompiledSchedule(ContextRenderLock & r, AudioNodeInput * inlet, int framesToProcess)
+{
+    if (!m_internal->useRenderSchedule || !inlet)
+    {
+        // the graph is pulled, so the schedule's folded gains must render themselves
+        if (!m_internal->renderSchedule.empty())
+        {
+            unfoldScheduledGains();
+            m_internal->renderSchedule.clear();
+            m_internal->renderScheduleNeedsUpdate = true;
+        }
+        return nullptr;
+    }
+
+    bool needsUpdate = m_internal->renderScheduleNeedsUpdate || m_internal->renderScheduleInlet != inlet;
+    if (!needsUpdate)
+    {
+        for (auto & s : m_internal->renderSchedule)
+        {
+            if (s.alive.expired())
+            {
+                needsUpdate = true;
+                break;
+            }
+        }
+    }
+
+    if (needsUpdate)
+        compileRenderSchedule(r, inlet);
+
+    for (auto & s : m_internal->renderSchedule)
+        s.node->updateScheduledRenderingState(r);
+
+    m_internal->renderingSchedule = true;
+    if (m_internal->renderInParallel)
+    {
+        ParallelRenderJob job {r, m_internal->sortedNodes, m_internal->renderTaskNodes, framesToProcess};
+        m_internal->renderThreads->run(m_internal->renderTasks, &ParallelRenderJob::process, &job);
+    }
+    else
+    {
+        for (auto & s : m_internal->renderSchedule)
+        {
+            if (!s.node->_self->foldedInto)
+                s.node->processScheduled(r, framesToProcess);
+        }
+    }
+    m_internal->renderingSchedule = false;
+
+    return inlet->gather(r, framesToProcess);
+}
+
 void AudioContext::enqueueEvent(std::function<void()> & fn)
 {
     m_internal->enqueuedEvents.enqueue(fn);
@@ -660,6 +1131,9 @@ void AudioContext::setDestinationNode(std::shared_ptr<AudioDestinationNode> devi
 {
     _destinationNode = device;
     lazyInitialize();
+
+    // nodes connected before the context knew its sample rate can prepare now
+    prepareNodes();
 }
 
 std::shared_ptr<AudioDestinationNode> AudioContext::destinationNode()
@@ -777,129 +1251,24 @@ void AudioContext::debugTraverse(AudioNode * root)
     // Let the context take care of any business at the start of each render quantum.
     ctx->handlePreRenderTasks(renderLock);
 
-    /* pass two, implement hardware input
-    // Prepare the local audio input provider for this render quantum.
-    if (optional_hardware_input && src)
-    {
-        optional_hardware_input->set(src);
-    }
-     */
-
-    // process the graph by pulling the inputs, which will recurse the
-    // entire processing graph.
+    // report the nodes feeding root in the order a compiled schedule would process them
+    std::vector<AudioNode *> work;
+    sortRenderGraph(renderLock, nullptr, {root}, work);
 
-    enum WorkType
-    {
-        processNode,
-        silenceOutputs,
-        unsilenceOutputs,
-        setOutputChannels,
-        sumInputs,
-        setZeroes,
-        manageEnvelope,
-    };
-
-    struct Work
-    {
-        AudioNode * node = nullptr;
-        WorkType type;
-    };
-
-    std::vector<Work> work;
-
-    std::vector<AudioNode *> node_stack;
-    static int color = 1;
-    root->_self->color = color;
-    ++color;
-
-    // start the traversal at the root node
-    node_stack.push_back(root);
-
-    static std::map<int, std::vector<AudioBus *>> summing_busses;
-    std::vector<AudioBus *> in_use;
-    std::vector<std::pair<AudioNode *, const char*>> by_whom;
-
-    AudioNode * current_node = nullptr;
-    while (!node_stack.empty())
+    for (AudioNode * node : work)
     {
-        current_node = node_stack.back();
-
-        auto sz = node_stack.size();
-        for (auto & p : current_node->_self->_params)
-        {
-            // if there are rendering connections, be sure they are ready
-            p->updateRenderingState(renderLock);
-
-            int connectionCount = p->numberOfRenderingConnections(renderLock);
-            if (!connectionCount)
-                continue;
-
-            for (int i = 0; i < connectionCount; ++i)
-            {
-                std::shared_ptr<AudioNodeOutput> output = p->renderingOutput(renderLock, i);
-                if (!output)
-                    continue;
-                
-                AudioNode* node = output->sourceNode();
-                if (!node || node->_self->color >= color)
-                    continue;
-
-                by_whom.push_back({current_node, "param input"});
-                node_stack.push_back(node);
-            }
-        }
-
-        // if there were parameters with inputs, queue up their work next
-        if (node_stack.size() > sz)
-            continue;
-
-        // Process all of the AudioNodes connected to our inputs.
-        sz = node_stack.size();
-        int inputCount = current_node->numberOfInputs();
-        for (int i = 0; i < inputCount; ++i)
-        {
-            auto in = current_node->input(i);
-            if (!in)
-                continue;
-
-            int connectionCount = in->numberOfConnections();
-            for (int j = 0; j < connectionCount; ++j) {
-                if (auto destNode = in->connection(renderLock, i)) {
-                    if (destNode->sourceNode()->_self->color < color)
-                    {
-                        node_stack.push_back(destNode->sourceNode());
-                    }
-                }
-            }
+        if (auto adsr = dynamic_cast<ADSRNode*>(node)) {
+            printf("%s %s %s Inputs silent: %s\n",
+                   node->name(),
+                   schedulingStateName(node->_self->_scheduler.playbackState()),
+                   adsr->finished(renderLock)? "Finished": "Playing",
+                   node->inputsAreSilent(renderLock) ? "yes" : "no");
         }
-
-        // if there were inputs on the node current node, queue up their work next
-        if (node_stack.size() > sz)
-            continue;
-
-        // move current_node to the work stack and retire it from the node stack
-        current_node->_self->color = color;
-        work.push_back({current_node, processNode});
-        node_stack.pop_back();
-    }
-
-
-    for (auto& w : work) {
-        // actually do the things in graph order
-        if (w.type == processNode) {
-            if (auto adsr = dynamic_cast<ADSRNode*>(w.node)) {
-                printf("%s %s %s Inputs silent: %s\n",
-                       w.node->name(),
-                       schedulingStateName(w.node->_self->_scheduler.playbackState()),
-                       adsr->finished(renderLock)? "Finished": "Playing",
-                       w.node->inputsAreSilent(renderLock) ? "yes" : "no");
-            }
-            else {
-                printf("%s %s Inputs silent: %s\n",
-                       w.node->name(),
-                       schedulingStateName(w.node->_self->_scheduler.playbackState()),
-                       w.node->inputsAreSilent(renderLock) ? "yes" : "no");
-            }
+        else {
+            printf("%s %s Inputs silent: %s\n",
+                   node->name(),
+                   schedulingStateName(node->_self->_scheduler.playbackState()),
+                   node->inputsAreSilent(renderLock) ? "yes" : "no");
         }
     }
 }
@@ -8,9 +8,13 @@
 #include "LabSound/core/AudioNodeOutput.h"
 #include "LabSound/core/AudioSourceProvider.h"
 #include "LabSound/extended/AudioContextLock.h"
+#include "LabSound/extended/OfflineRenderer.h"
 
 #include "internal/Assertions.h"
 #include "internal/DenormalDisabler.h"
+#include "internal/RenderAllocationTracer.h"
+
+#include <algorithm>
 
 // Non platform-specific helper functions
 
@@ -57,6 +61,7 @@ void lab::pull_graph(
     /// signal processing should not produce denormalized values.
 
     DenormalDisabler denormalDisabler;
+    RenderAllocationScope allocationScope("lab::pull_graph");
 
     // Let the context take care of any business at the start of each render quantum.
     ctx->handlePreRenderTasks(renderLock);
@@ -67,8 +72,11 @@ void lab::pull_graph(
         optional_hardware_input->set(src);
     }
 
-    // process the graph by pulling the inputs, which will recurse the entire processing graph.
-    AudioBus * renderedBus = required_inlet->pull(renderLock, dst, frames);
+    // process the graph. If the context has a compiled schedule, the nodes are
+    // processed in order; otherwise, pulling the inputs recurses the entire graph.
+    AudioBus * renderedBus = ctx->renderCompiledSchedule(renderLock, required_inlet, frames);
+    if (!renderedBus)
+        renderedBus = required_inlet->pull(renderLock, dst, frames);
 
     if (dst) {
         if (!renderedBus)
@@ -134,13 +142,34 @@ void AudioDestinationNode::render(AudioSourceProvider* provider,
     selfProfile.finalize();
 }
 
-void AudioDestinationNode::offlineRender(AudioBus * dst, int framesToProcess)
+// An offline context has no update thread, so the context is serviced once per
+// graph tick of this many quanta, as the update thread would be.
+static const int kOfflineQuantaPerGraphTick = 16;
+
+void AudioDestinationNode::renderOfflineQuantum(AudioBus * dst, int quantum)
 {
-    static const int offlineRenderSizeQuantum = AudioNode::ProcessingSizeInFrames;
+    if (!(_offlineQuanta++ % kOfflineQuantaPerGraphTick))
+        _context->serviceOfflineRender();
+
+    AudioSourceProvider* asp = nullptr;
+    render(asp, 0, dst, quantum, _last_info);
+
+    // Update sampling info
+    const int index = 1 - (_last_info.current_sample_frame & 1);
+    const uint64_t t = _last_info.current_sample_frame & ~1;
+    _last_info.current_sample_frame = t + quantum + index;
+    _last_info.current_time = _last_info.current_sample_frame / static_cast<double>(_last_info.sampling_rate);
+    _last_info.epoch[index] += std::chrono::nanoseconds {
+            static_cast<uint64_t>(1.e9 * (double) quantum / (double) _last_info.sampling_rate)};
+}
 
+void AudioDestinationNode::offlineRender(AudioBus * dst, int framesToProcess)
+{
     if (!dst || !framesToProcess || !_context || !_context->isInitialized())
         return;
 
+    const int offlineRenderSizeQuantum = _context->renderQuantumSize();
+
     bool isRenderBusAllocated = dst->length() >= offlineRenderSizeQuantum;
     ASSERT(isRenderBusAllocated);
     if (!isRenderBusAllocated)
@@ -150,22 +179,44 @@ void AudioDestinationNode::offlineRender(AudioBus * dst, int framesToProcess)
 
     while (framesToProcess > 0)
     {
-        _context->update();
-        AudioSourceProvider* asp = nullptr;
-        render(asp, 0, dst, offlineRenderSizeQuantum, _last_info);
-
-        // Update sampling info
-        const int index = 1 - (_last_info.current_sample_frame & 1);
-        const uint64_t t = _last_info.current_sample_frame & ~1;
-        _last_info.current_sample_frame = t + offlineRenderSizeQuantum + index;
-        _last_info.current_time = _last_info.current_sample_frame / static_cast<double>(_last_info.sampling_rate);
-        _last_info.epoch[index] += std::chrono::nanoseconds {
-                static_cast<uint64_t>(1.e9 * (double) framesToProcess / (double) offlineRenderSizeQuantum)};
-
+        renderOfflineQuantum(dst, offlineRenderSizeQuantum);
         framesToProcess -= offlineRenderSizeQuantum;
     }
 }
 
+uint64_t AudioDestinationNode::offlineRender(OfflineRenderSink & sink, uint64_t framesToProcess)
+{
+    if (!framesToProcess || !_context || !_context->isInitialized())
+        return 0;
+
+    const int quantum = _context->renderQuantumSize();
+    const int channels = std::max(1, static_cast<int>(_platformAudioDevice->getOutputConfig().desired_channels));
+
+    // the only audio held is the quantum in flight
+    AudioBus dst(channels, quantum);
+    dst.setSampleRate(_last_info.sampling_rate);
+
+    if (!sink.begin(channels, _last_info.sampling_rate))
+        return 0;
+
+    LOG_TRACE("offline rendering started");
+
+    uint64_t delivered = 0;
+    while (delivered < framesToProcess)
+    {
+        renderOfflineQuantum(&dst, quantum);
+
+        const int frames = static_cast<int>(std::min<uint64_t>(quantum, framesToProcess - delivered));
+        if (!sink.write(dst, frames))
+            break;
+
+        delivered += frames;
+    }
+
+    sink.end();
+    return delivered;
+}
+
 void AudioDestinationNode::initialize()
 {
     if (!isInitialized())
@@ -11,8 +11,12 @@
 #include "LabSound/core/AudioParam.h"
 #include "LabSound/core/AudioSetting.h"
 #include "LabSound/extended/AudioContextLock.h"
+#include "LabSound/extended/VectorMath.h"
 
 #include "internal/Assertions.h"
+#include "internal/RenderAllocationTracer.h"
+
+#include <algorithm>
 
 using namespace std;
 
@@ -30,6 +34,7 @@ namespace lab
 
 AudioNode::Internal::Internal(AudioContext & ac)
 :  _scheduler(ac.sampleRate())
+,  renderQuantumSize(ac.renderQuantumSize())
 {}
 
 // static
@@ -143,6 +148,7 @@ bool AudioNodeScheduler::update(ContextRenderLock & r, int epoch_length, const c
                 // exactly on start, or late, get going straight away
                 _renderOffset = 0;
                 _renderLength = epoch_length;
+                _fadeInRemaining = start_envelope;
                 LOG_PLAYBACK_STATE_TRANSITION(node_name, _playbackState, SchedulingState::FADE_IN);
                 _playbackState = SchedulingState::FADE_IN;
             }
@@ -151,6 +157,7 @@ bool AudioNodeScheduler::update(ContextRenderLock & r, int epoch_length, const c
                 // start falls within the frame
                 _renderOffset = static_cast<int>(_startWhen - _epoch);
                 _renderLength = epoch_length - _renderOffset;
+                _fadeInRemaining = start_envelope;
                 LOG_PLAYBACK_STATE_TRANSITION(node_name, _playbackState, SchedulingState::FADE_IN);
                 _playbackState = SchedulingState::FADE_IN;
             }
@@ -162,7 +169,8 @@ bool AudioNodeScheduler::update(ContextRenderLock & r, int epoch_length, const c
             break;
 
         case SchedulingState::FADE_IN:
-            // start time has been achieved, there'll be one quantum with fade in applied.
+            // start time has been achieved, and the first quantum has begun the fade in.
+            // If the quantum is shorter than the envelope, the fade continues while PLAYING.
             _renderOffset = 0;
             LOG_PLAYBACK_STATE_TRANSITION(node_name, _playbackState, SchedulingState::PLAYING);
             _playbackState = SchedulingState::PLAYING;
@@ -468,6 +476,23 @@ void AudioNode::setChannelCountMode(ContextGraphLock & g, ChannelCountMode mode)
 }
 
 void AudioNode::processIfNecessary(ContextRenderLock & r, int bufferSize)
+{
+    _processIfNecessary(r, bufferSize, true);
+}
+
+void AudioNode::updateScheduledRenderingState(ContextRenderLock & r)
+{
+    // the outputs are not pulled by a compiled schedule, so prepare them here
+    for (auto & out : _self->m_outputs)
+        out->updateScheduledRenderingState(r);
+}
+
+void AudioNode::processScheduled(ContextRenderLock & r, int bufferSize)
+{
+    _processIfNecessary(r, bufferSize, false);
+}
+
+void AudioNode::_processIfNecessary(ContextRenderLock & r, int bufferSize, bool recursive)
 {
     auto ac = r.context();
     if (!ac)
@@ -489,6 +514,8 @@ void AudioNode::processIfNecessary(ContextRenderLock & r, int bufferSize)
         return;
     }
 
+    RenderAllocationScope allocationScope(name());
+
     // outputs cache results in their busses.
     // if the scheduler's recorded epoch is the same as the context's, the node
     // shall bail out as it has been processed once already this epoch.
@@ -526,7 +553,10 @@ void AudioNode::processIfNecessary(ContextRenderLock & r, int bufferSize)
     // get inputs in preparation for processing
     {
         ProfileScope scope(_self->graphTime);
-        pullInputs(r, bufferSize);
+        if (recursive)
+            pullInputs(r, bufferSize);
+        else
+            gatherInputs(r, bufferSize);
         scope.finalize();   // ensure the scope is not prematurely destructed
     }
 
@@ -534,6 +564,29 @@ void AudioNode::processIfNecessary(ContextRenderLock & r, int bufferSize)
     for (auto& out : _self->m_outputs)
         out->updateRenderingState(r);
 
+    // A node whose inputs are silent, and whose tail has run out, would only compute
+    // silence, so it isn't processed. Its outputs are flagged silent; they are zeroed
+    // on the first silent quantum only, and consumers see the flag rather than the data.
+    if (inputsAreSilent(r))
+    {
+        if (propagatesSilence(r))
+        {
+            // the compiled schedule renders every node, so in the recursive
+            // walk, keep the nodes modulating this one's params advancing too
+            if (recursive)
+                pullParamInputs(r, bufferSize);
+
+            silenceOutputs(r);
+            if (diagnosing_silence)
+                ac->diagnosed_silence("Inputs are silent, and the tail has elapsed");
+            return;
+        }
+    }
+    else
+    {
+        _self->lastNonSilentTime = static_cast<double>(ac->currentSampleFrame() + bufferSize) / ac->sampleRate();
+    }
+
     //  initialize the busses with start and final zeroes.
     if (start_zero_count)
     {
@@ -556,25 +609,27 @@ void AudioNode::processIfNecessary(ContextRenderLock & r, int bufferSize)
     // clean pops resulting from starting or stopping
 
     #define OOS(x) (float(x) / float(steps))
-    if (start_zero_count > 0 || _self->_scheduler._playbackState == SchedulingState::FADE_IN)
+    AudioNodeScheduler & scheduler = _self->_scheduler;
+    if (scheduler._fadeInRemaining > 0 &&
+        scheduler._playbackState >= SchedulingState::FADE_IN && scheduler._playbackState <= SchedulingState::STOPPING)
     {
+        // the envelope has a fixed length in frames, so with a render quantum shorter
+        // than the envelope, the fade in carries on into the following quanta.
         int steps = start_envelope;
+        int applied = steps - scheduler._fadeInRemaining;
         int damp_start = start_zero_count;
-        int damp_end = start_zero_count + steps;
-        if (damp_end > bufferSize)
-        {
-            damp_end = bufferSize;
-            steps = bufferSize - start_zero_count;
-        }
+        int damp_end = std::min(bufferSize, damp_start + scheduler._fadeInRemaining);
+        scheduler._fadeInRemaining -= damp_end - damp_start;
 
         // damp out the first samples
-        if (damp_end > 0)
+        if (damp_end > damp_start)
             for (auto & out : _self->m_outputs)
                 for (int i = 0; i < out->bus(r)->numberOfChannels(); ++i)
                 {
-                    float* data = out->bus(r)->channel(i)->mutableData();
-                    for (int j = damp_start; j < damp_end; ++j)
-                        data[j] *= OOS(j - damp_start);
+                    float* data = out->bus(r)->channel(i)->mutableData() + damp_start;
+                    float gain = OOS(applied);
+                    float step = OOS(1);
+                    VectorMath::vrampmul(data, 1, &gain, &step, data, 1, damp_end - damp_start);
                 }
     }
 
@@ -606,9 +661,10 @@ void AudioNode::processIfNecessary(ContextRenderLock & r, int bufferSize)
             for (auto& out : _self->m_outputs)
                 for (int i = 0; i < out->numberOfChannels(); ++i)
                 {
-                    float* data = out->bus(r)->channel(i)->mutableData();
-                    for (int j = damp_start; j < damp_end; ++j)
-                        data[j] *= OOS(damp_end - j);
+                    float* data = out->bus(r)->channel(i)->mutableData() + damp_start;
+                    float gain = OOS(damp_end - damp_start);
+                    float step = -OOS(1);
+                    VectorMath::vrampmul(data, 1, &gain, &step, data, 1, damp_end - damp_start);
                 }
         }
     }
@@ -663,8 +719,13 @@ void AudioNode::checkNumberOfChannelsForInput(ContextRenderLock & r, AudioNodeIn
 
 bool AudioNode::propagatesSilence(ContextRenderLock& r) const
 {
-    return _self->_scheduler._playbackState < SchedulingState::FADE_IN ||
-           _self->_scheduler._playbackState == SchedulingState::FINISHED;
+    // a scheduled node is silent whenever it isn't playing
+    if (isScheduledNode())
+        return _self->_scheduler._playbackState < SchedulingState::FADE_IN ||
+               _self->_scheduler._playbackState == SchedulingState::FINISHED;
+
+    // any other node is silent once its tail has run out after its inputs fell silent
+    return _self->lastNonSilentTime + latencyTime(r) + tailTime(r) < r.context()->currentTime();
 }
 
 void AudioNode::pullInputs(ContextRenderLock & r, int bufferSize)
@@ -678,6 +739,30 @@ void AudioNode::pullInputs(ContextRenderLock & r, int bufferSize)
     }
 }
 
+void AudioNode::pullParamInputs(ContextRenderLock & r, int bufferSize)
+{
+    for (auto & p : _self->_params)
+    {
+        p->updateRenderingState(r);
+        int count = p->numberOfRenderingConnections(r);
+        for (int i = 0; i < count; ++i)
+        {
+            if (auto output = p->renderingOutput(r, i))
+                output->pull(r, nullptr, bufferSize);
+        }
+    }
+}
+
+void AudioNode::gatherInputs(ContextRenderLock & r, int bufferSize)
+{
+    ASSERT(r.context());
+
+    for (auto & in : _self->m_inputs)
+    {
+        in->gather(r, bufferSize);
+    }
+}
+
 bool AudioNode::inputsAreSilent(ContextRenderLock & r)
 {    
     for (auto & in : _self->m_inputs)
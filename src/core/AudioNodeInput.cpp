@@ -7,6 +7,7 @@
 #include "LabSound/core/AudioContext.h"
 #include "LabSound/core/AudioNode.h"
 #include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/GainNode.h"
 #include "LabSound/core/Mixing.h"
 
 #include "LabSound/extended/AudioContextLock.h"
@@ -26,6 +27,8 @@ AudioNodeInput::AudioNodeInput(AudioNode * node, int processingSizeInFrames)
     , m_destinationNode(node)
 {
     // Set to mono by default.
+    if (!processingSizeInFrames)
+        processingSizeInFrames = node->renderQuantumSize();
     m_internalSummingBus = std::unique_ptr<AudioBus>(new AudioBus(Channels::Mono, processingSizeInFrames));
 }
 
@@ -84,7 +87,7 @@ void AudioNodeInput::updateInternalBus(ContextRenderLock & r)
     if (numberOfInputChannels == m_internalSummingBus->numberOfChannels())
         return;
 
-    m_internalSummingBus = std::unique_ptr<AudioBus>(new AudioBus(numberOfInputChannels, AudioNode::ProcessingSizeInFrames));
+    r.context()->exchangeBus(r, m_internalSummingBus, numberOfInputChannels);
 }
 
 int AudioNodeInput::numberOfChannels(ContextRenderLock & r) const
@@ -160,8 +163,8 @@ AudioBus * AudioNodeInput::pull(ContextRenderLock & r, AudioBus * inPlaceBus, in
 
     if (num_connections == 0)
     {
-        // Generate silence if we're not connected to anything, and return the silent bus
-        /// @TODO a possible optimization is to flag silence and propagate it to consumers of this input.
+        // Generate silence if we're not connected to anything, and return the silent bus.
+        // The bus is only cleared once; after that, its silent flag propagates to consumers.
         m_internalSummingBus->zero();
         return m_internalSummingBus.get();
     }
@@ -184,4 +187,70 @@ AudioBus * AudioNodeInput::pull(ContextRenderLock & r, AudioBus * inPlaceBus, in
     return m_internalSummingBus.get();
 }
 
+void AudioNodeInput::updateScheduledOutputs(ContextRenderLock & r)
+{
+    updateRenderingState(r);
+
+    m_scheduledOutputs.clear();
+    m_scheduledGains.clear();
+    int c = numberOfRenderingConnections(r);
+    for (int i = 0; i < c; ++i)
+    {
+        auto output = renderingOutput(r, i);
+        if (output)
+        {
+            m_scheduledOutputs.push_back(output.get());
+            m_scheduledGains.push_back(GainNode::foldedInto(output.get(), this));
+        }
+    }
+}
+
+void AudioNodeInput::foldScheduledGains(ContextRenderLock & r)
+{
+    // a single connection is consumed in place, which is cheaper still
+    if (m_scheduledOutputs.size() < 2)
+        return;
+
+    for (size_t i = 0; i < m_scheduledOutputs.size(); ++i)
+    {
+        GainNode * gain = GainNode::foldable(r, m_scheduledOutputs[i]);
+        if (gain)
+        {
+            gain->foldInto(this);
+            m_scheduledGains[i] = gain;
+        }
+    }
+}
+
+AudioBus * AudioNodeInput::gather(ContextRenderLock & r, int bufferSize)
+{
+    // If the connections changed since the schedule was compiled, the scheduled outputs can't be
+    // trusted. Pull for this quantum, and have the schedule recompiled for the next.
+    if (m_renderingStateNeedUpdating)
+    {
+        r.context()->invalidateRenderSchedule();
+        return pull(r, nullptr, bufferSize);
+    }
+
+    m_destinationNode->checkNumberOfChannelsForInput(r, this);
+
+    size_t num_connections = m_scheduledOutputs.size();
+
+    // A single connection is consumed directly from the output's bus, see bus()
+    if (num_connections == 1)
+        return m_scheduledOutputs[0]->bus(r);
+
+    m_internalSummingBus->zero();
+
+    for (size_t i = 0; i < num_connections; ++i)
+    {
+        // Sum, with the gain of a folded gain node, or unity-gain.
+        if (m_scheduledGains[i])
+            m_scheduledGains[i]->sumInto(r, *m_internalSummingBus, bufferSize);
+        else
+            m_internalSummingBus->sumFrom(*m_scheduledOutputs[i]->bus(r));
+    }
+    return m_internalSummingBus.get();
+}
+
 }  // namespace lab
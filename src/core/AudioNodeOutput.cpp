@@ -32,6 +32,8 @@ AudioNodeOutput::AudioNodeOutput(AudioNode * node, int numberOfChannels, int pro
     , m_renderingFanOutCount(0)
     , m_renderingParamFanOutCount(0)
 {
+    if (!processingSizeInFrames)
+        processingSizeInFrames = node->renderQuantumSize();
     m_internalBus.reset(new AudioBus(numberOfChannels, processingSizeInFrames));
 }
 
@@ -44,6 +46,8 @@ AudioNodeOutput::AudioNodeOutput(AudioNode * node, char const * const name, int
     , m_renderingFanOutCount(0)
     , m_renderingParamFanOutCount(0)
 {
+    if (!processingSizeInFrames)
+        processingSizeInFrames = node->renderQuantumSize();
     m_internalBus.reset(new AudioBus(numberOfChannels, processingSizeInFrames));
 }
 
@@ -55,15 +59,20 @@ void AudioNodeOutput::setNumberOfChannels(ContextRenderLock & r, int numberOfCha
 {
     if (m_numberOfChannels == numberOfChannels) return;
     m_desiredNumberOfChannels = numberOfChannels;
-    m_internalBus.reset(new AudioBus(numberOfChannels, AudioNode::ProcessingSizeInFrames));
+    if (m_internalBus->numberOfChannels() == numberOfChannels) return;
+
+    if (r.context())
+        r.context()->exchangeBus(r, m_internalBus, numberOfChannels);
+    else
+        m_internalBus.reset(new AudioBus(numberOfChannels, m_internalBus->length()));
 }
 
-void AudioNodeOutput::updateInternalBus()
+void AudioNodeOutput::updateInternalBus(ContextRenderLock & r)
 {
     if (numberOfChannels() == m_internalBus->numberOfChannels())
         return;
 
-    m_internalBus.reset(new AudioBus(numberOfChannels(), AudioNode::ProcessingSizeInFrames));
+    r.context()->exchangeBus(r, m_internalBus, numberOfChannels());
 }
 
 void AudioNodeOutput::updateRenderingState(ContextRenderLock & r)
@@ -72,11 +81,12 @@ void AudioNodeOutput::updateRenderingState(ContextRenderLock & r)
     {
         ASSERT(r.context());
         m_numberOfChannels = m_desiredNumberOfChannels;
-        updateInternalBus();
+        updateInternalBus(r);
         propagateChannelCount(r);
     }
     m_renderingFanOutCount = fanOutCount();
     m_renderingParamFanOutCount = paramFanOutCount();
+    m_renderingSoleInput = m_renderingFanOutCount == 1 && !m_renderingParamFanOutCount ? m_inputs.front().get() : nullptr;
 }
 
 void AudioNodeOutput::propagateChannelCount(ContextRenderLock & r)
@@ -100,7 +110,6 @@ AudioBus * AudioNodeOutput::pull(ContextRenderLock & r, AudioBus * inPlaceBus, i
     ASSERT(m_renderingFanOutCount > 0 || m_renderingParamFanOutCount > 0);
 
     m_internalBus->setSampleRate(r.context()->sampleRate());
-    bus(r)->setSampleRate(r.context()->sampleRate());
 
     // Causes our AudioNode to process if it hasn't already for this render quantum.
     // We try to do in-place processing (using inPlaceBus) if at all possible,
@@ -113,7 +122,10 @@ AudioBus * AudioNodeOutput::pull(ContextRenderLock & r, AudioBus * inPlaceBus, i
     bool useInPlaceBus = inPlaceBus && inPlaceBus->numberOfChannels() == numberOfChannels() && (m_renderingFanOutCount + m_renderingParamFanOutCount) == 1;
 
     // Setup the actual destination bus for processing when our node's process() method gets called in processIfNecessary() below.
+    // The previous quantum's in-place bus may no longer exist, so it's not
+    // touched until it has been replaced.
     m_inPlaceBus = useInPlaceBus ? inPlaceBus : 0;
+    bus(r)->setSampleRate(r.context()->sampleRate());
 
     auto n = sourceNode();
     if (!n)
@@ -123,6 +135,16 @@ AudioBus * AudioNodeOutput::pull(ContextRenderLock & r, AudioBus * inPlaceBus, i
     return bus(r);
 }
 
+void AudioNodeOutput::updateScheduledRenderingState(ContextRenderLock & r)
+{
+    ASSERT(r.context());
+
+    updateRenderingState(r);
+
+    m_inPlaceBus = nullptr;
+    m_internalBus->setSampleRate(r.context()->sampleRate());
+}
+
 AudioBus * AudioNodeOutput::bus(ContextRenderLock & r) const
 {
     // only legal during rendering because an in-place bus might have been supplied to pull
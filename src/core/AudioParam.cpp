@@ -30,6 +30,7 @@ AudioParam::AudioParam(AudioParamDescriptor const * const desc) noexcept
     , m_value(desc->defaultValue)
     , m_smoothedValue(desc->defaultValue)
     , m_smoothingConstant(DefaultSmoothingConstant)
+    , m_internalSummingBus(new AudioBus(1, AudioNode::ProcessingSizeInFrames, false))
 {
 }
 
@@ -121,7 +122,10 @@ void AudioParam::calculateFinalValues(ContextRenderLock & r, float * values, int
         values[0] = static_cast<float>(m_value);
     }
 
-    // if there are rendering connections, be sure they are ready
+    // if there are rendering connections, be sure they are ready. A compiled schedule
+    // that doesn't reflect a change is rebuilt for the next quantum.
+    if (m_renderingStateNeedUpdating && r.context()->isRenderingSchedule())
+        r.context()->invalidateRenderSchedule();
     updateRenderingState(r);
 
     int connectionCount = numberOfRenderingConnections(r);
@@ -133,13 +137,8 @@ void AudioParam::calculateFinalValues(ContextRenderLock & r, float * values, int
 
     // LabSound: For some reason a bus was temporarily created here and the results discarded.
     // Bug still exists in WebKit top of tree.
-    if (m_internalSummingBus && m_internalSummingBus->length() < numberOfValues)
-        m_internalSummingBus.reset();
-
-    if (!m_internalSummingBus)
-        m_internalSummingBus.reset(new AudioBus(1, numberOfValues));
-
-    // point the summing bus at the values array
+    // The summing bus owns no storage; it is pointed at the values array, so
+    // nothing is allocated here regardless of numberOfValues.
     m_internalSummingBus->setChannelMemory(0, values, numberOfValues);
 
     for (int i = 0; i < connectionCount; ++i)
@@ -148,8 +147,11 @@ void AudioParam::calculateFinalValues(ContextRenderLock & r, float * values, int
 
         ASSERT(output);
 
-        // Render audio from this output.
-        AudioBus * connectionBus = output->pull(r, nullptr, AudioNode::ProcessingSizeInFrames);
+        // Render audio from this output. A compiled schedule has already rendered it,
+        // and pulling could race with other render threads reading the same output.
+        AudioBus * connectionBus = r.context()->isRenderingSchedule()
+            ? output->bus(r)
+            : output->pull(r, nullptr, r.context()->renderQuantumSize());
 
         // Sum, with unity-gain.
         /// @TODO it was surprising in practice that the inputs are summed, as opposed to simply overriding.
@@ -166,8 +168,7 @@ void AudioParam::calculateTimelineValues(ContextRenderLock & r,
     float * values, int numberOfValues)
 {
     // Calculate values for this render quantum.
-    // Normally numberOfValues will equal AudioNode::ProcessingSizeInFrames 
-    // (the render quantum size).
+    // Normally numberOfValues will equal the context's render quantum size.
     double sampleRate = r.context()->sampleRate();
     double startTime = r.context()->currentTime();
     double endTime = startTime + numberOfValues / sampleRate;
@@ -8,10 +8,15 @@
 #include "LabSound/core/Macros.h"
 
 #include "LabSound/extended/AudioContextLock.h"
+#include "LabSound/extended/Logging.h"
+
+#include "LabSound/extended/VectorMath.h"
 
 #include "internal/Assertions.h"
 #include "internal/AudioUtilities.h"
 
+#include "concurrentqueue/concurrentqueue.h"
+
 #include <algorithm>
 
 using namespace std;
@@ -19,35 +24,78 @@ using namespace std;
 namespace lab
 {
 
-//@tofix - is there any reason this should be per object instead of static?
-namespace
+struct AudioParamTimeline::PendingCommands
+{
+    struct Command
+    {
+        enum Kind
+        {
+            Insert,
+            Cancel
+        };
+
+        Command()
+            : kind(Cancel)
+            , event(ParamEvent::SetValue, 0, 0, 0, 0, {})
+        {
+        }
+
+        Command(Kind kind, ParamEvent && event)
+            : kind(kind)
+            , event(std::move(event))
+        {
+        }
+
+        Kind kind;
+        ParamEvent event;
+    };
+
+    // Nothing is preallocated, as most parameters are never automated.
+    // Blocks are allocated by the scheduling thread as needed, and recycled.
+    moodycamel::ConcurrentQueue<Command> commands {0};
+};
+
+AudioParamTimeline::AudioParamTimeline()
+    : m_pending(new PendingCommands())
 {
-    std::mutex m_eventsMutex;
 }
 
+AudioParamTimeline::~AudioParamTimeline() = default;
+
 void AudioParamTimeline::setValueAtTime(float value, float time)
 {
-    insertEvent(ParamEvent(ParamEvent::SetValue, value, time, 0, 0, {}));
+    enqueueEvent(ParamEvent(ParamEvent::SetValue, value, time, 0, 0, {}));
 }
 
 void AudioParamTimeline::linearRampToValueAtTime(float value, float time)
 {
-    insertEvent(ParamEvent(ParamEvent::LinearRampToValue, value, time, 0, 0, {}));
+    enqueueEvent(ParamEvent(ParamEvent::LinearRampToValue, value, time, 0, 0, {}));
 }
 
 void AudioParamTimeline::exponentialRampToValueAtTime(float value, float time)
 {
-    insertEvent(ParamEvent(ParamEvent::ExponentialRampToValue, value, time, 0, 0, {}));
+    enqueueEvent(ParamEvent(ParamEvent::ExponentialRampToValue, value, time, 0, 0, {}));
 }
 
 void AudioParamTimeline::setTargetAtTime(float target, float time, float timeConstant)
 {
-    insertEvent(ParamEvent(ParamEvent::SetTarget, target, time, timeConstant, 0, {}));
+    enqueueEvent(ParamEvent(ParamEvent::SetTarget, target, time, timeConstant, 0, {}));
 }
 
 void AudioParamTimeline::setValueCurveAtTime(std::vector<float> & curve, float time, float duration)
 {
-    insertEvent(ParamEvent(ParamEvent::SetValueCurve, 0, time, 0, duration, curve));
+    enqueueEvent(ParamEvent(ParamEvent::SetValueCurve, 0, time, 0, duration, curve));
+}
+
+void AudioParamTimeline::cancelScheduledValues(float startTime)
+{
+    m_pending->commands.enqueue(PendingCommands::Command(PendingCommands::Command::Cancel,
+        ParamEvent(ParamEvent::SetValue, 0, startTime, 0, 0, {})));
+}
+
+bool AudioParamTimeline::hasValues() const
+{
+    return m_events.size() > 0 || m_pending->commands.size_approx() > 0;
 }
 
 static bool isValidNumber(float x)
@@ -55,7 +103,7 @@ static bool isValidNumber(float x)
     return !std::isnan(x) && !std::isinf(x);
 }
 
-void AudioParamTimeline::insertEvent(const ParamEvent & event)
+void AudioParamTimeline::enqueueEvent(ParamEvent && event)
 {
     // Sanity check the event. Be super careful we're not getting infected with NaN or Inf.
     bool isValid = event.type() < ParamEvent::LastType
@@ -70,67 +118,86 @@ void AudioParamTimeline::insertEvent(const ParamEvent & event)
     if (!isValid)
         return;
 
-    std::lock_guard<std::mutex> lock(m_eventsMutex);
+    m_pending->commands.enqueue(PendingCommands::Command(PendingCommands::Command::Insert, std::move(event)));
+}
+
+void AudioParamTimeline::applyPendingCommands()
+{
+    PendingCommands::Command command;
+    while (m_pending->commands.try_dequeue(command))
+    {
+        if (command.kind == PendingCommands::Command::Insert)
+            insertEvent(std::move(command.event));
+        else
+            cancelEvents(command.event.time());
+    }
+}
 
-    unsigned i = 0;
+void AudioParamTimeline::insertEvent(ParamEvent && event)
+{
     float insertTime = event.time();
 
-    for (i = 0; i < m_events.size(); ++i)
-    {
+    // Events are kept sorted by time, with events at the same time in the order they were
+    // scheduled, so the new event goes after every event at or before its time.
+    auto pos = std::upper_bound(m_events.begin(), m_events.end(), insertTime,
+        [](float t, const ParamEvent & e) { return t < e.time(); });
 
-        if (event.type() == ParamEvent::SetValueCurve)
+    if (event.type() == ParamEvent::SetValueCurve)
+    {
+        // If this event is a SetValueCurve, make sure it doesn't overlap any existing
+        // event. It's ok if the SetValueCurve starts at the same time as the end of some other
+        // duration. Only the first later event needs to be checked.
+        double endTime = event.time() + event.duration();
+        if (pos != m_events.end() && pos->time() < endTime)
         {
-            // If this event is a SetValueCurve, make sure it doesn't overlap any existing
-            // event. It's ok if the SetValueCurve starts at the same time as the end of some other
-            // duration.
-            double endTime = event.time() + event.duration();
-            if (m_events[i].time() > event.time() && m_events[i].time() < endTime)
-            {
-                throw std::runtime_error("ParamEvent::SetValueCurve overlaps existing");
-            }
+            LOG_ERROR("ParamEvent::SetValueCurve overlaps existing");
+            return;
         }
-        else
+    }
+    else if (pos != m_events.begin())
+    {
+        // Otherwise, make sure this event doesn't overlap any existing SetValueCurve event.
+        // Since no event may start within a curve, only a curve at the time of the
+        // preceding events can overlap.
+        float precedingTime = (pos - 1)->time();
+        for (auto i = pos; i != m_events.begin() && (i - 1)->time() == precedingTime; --i)
         {
-            // Otherwise, make sure this event doesn't overlap any existing SetValueCurve event.
-            if (m_events[i].type() == ParamEvent::SetValueCurve)
+            const ParamEvent & e = *(i - 1);
+            if (e.type() == ParamEvent::SetValueCurve &&
+                event.time() >= e.time() && event.time() < e.time() + e.duration())
             {
-                double endTime = m_events[i].time() + m_events[i].duration();
-                if (event.time() >= m_events[i].time() && event.time() < endTime)
-                {
-                    throw std::runtime_error("ParamEvent::SetValueCurve overlaps existing");
-                }
+                LOG_ERROR("ParamEvent::SetValueCurve overlaps existing");
+                return;
             }
         }
+    }
 
-        // Overwrite same event type and time.
-        if (m_events[i].time() == insertTime && m_events[i].type() == event.type())
+    // Overwrite same event type and time.
+    for (auto i = pos; i != m_events.begin() && (i - 1)->time() == insertTime; --i)
+    {
+        if ((i - 1)->type() == event.type())
         {
-            m_events[i] = event;
+            *(i - 1) = std::move(event);
             return;
         }
-
-        if (m_events[i].time() > insertTime)
-        {
-            break;
-        }
     }
 
-    m_events.insert(m_events.begin() + i, event);
+    // an event inserted at or before the cursor changes the current span
+    if (static_cast<size_t>(pos - m_events.begin()) <= m_cursor)
+        m_cursor = 0;
+
+    m_events.insert(pos, std::move(event));
 }
 
-void AudioParamTimeline::cancelScheduledValues(float startTime)
+void AudioParamTimeline::cancelEvents(float startTime)
 {
-    std::lock_guard<std::mutex> lock(m_eventsMutex);
-
     // Remove all events starting at startTime.
-    for (unsigned i = 0; i < m_events.size(); ++i)
-    {
-        if (m_events[i].time() >= startTime)
-        {
-            m_events.erase(m_events.begin() + i, m_events.end());
-            break;
-        }
-    }
+    auto first = std::lower_bound(m_events.begin(), m_events.end(), startTime,
+        [](const ParamEvent & e, float t) { return e.time() < t; });
+    m_events.erase(first, m_events.end());
+
+    if (m_cursor >= m_events.size())
+        m_cursor = 0;
 }
 
 float AudioParamTimeline::valueForContextTime(
@@ -141,8 +208,9 @@ float AudioParamTimeline::valueForContextTime(
     if (!context)
         return defaultValue;
 
-    std::unique_lock<std::mutex> lock(m_eventsMutex, std::try_to_lock);
-    if (!lock.owns_lock() || !m_events.size() || context->currentTime() < m_events[0].time())
+    applyPendingCommands();
+
+    if (!m_events.size() || context->currentTime() < m_events[0].time())
     {
         hasValue = false;
         return defaultValue;
@@ -152,7 +220,7 @@ float AudioParamTimeline::valueForContextTime(
     double sampleRate = context->sampleRate();
     double startTime = context->currentTime();
     double endTime = startTime + 1.1 / sampleRate;  // time just beyond one sample-frame
-    double controlRate = sampleRate / AudioNode::ProcessingSizeInFrames;  // one parameter change per render quantum
+    double controlRate = sampleRate / context->renderQuantumSize();  // one parameter change per render quantum
     float value = valuesForTimeRange(startTime, endTime, defaultValue, &value, 1, sampleRate, controlRate);
 
     hasValue = true;
@@ -184,15 +252,34 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
     if (!values)
         return defaultValue;
 
+    applyPendingCommands();
+
     // Return default value if there are no events matching the desired time range.
-    std::unique_lock<std::mutex> lock(m_eventsMutex, std::try_to_lock);
-    if (!lock.owns_lock() || !m_events.size() || endTime <= m_events[0].time())
+    if (!m_events.size() || endTime <= m_events[0].time())
     {
         for (unsigned i = 0; i < numberOfValues; ++i)
             values[i] = defaultValue;
         return defaultValue;
     }
 
+    // The cursor is the event whose span contains startTime. Rendering only moves forward
+    // in time, so the search resumes where the previous call left off.
+    if (startTime < m_cursorTime)
+        m_cursor = 0;
+    m_cursorTime = startTime;
+
+    while (m_cursor + 1 < m_events.size() && m_events[m_cursor + 1].time() < startTime)
+        ++m_cursor;
+
+    // Retire the events that are entirely in the past. The cursor's event starts the
+    // current span, so it stays as the baseline. Retiring in bulk keeps the cost constant
+    // when amortized over the events.
+    if (m_cursor > 0 && m_cursor >= m_events.size() / 2)
+    {
+        m_events.erase(m_events.begin(), m_events.begin() + m_cursor);
+        m_cursor = 0;
+    }
+
     // Maintain a running time and index for writing the values buffer.
     double currentTime = startTime;
     unsigned writeIndex = 0;
@@ -205,20 +292,21 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
         double fillToTime = std::min(endTime, firstEventTime);
         size_t fillToFrame = AudioUtilities::timeToSampleFrame(fillToTime - startTime, sampleRate);
         fillToFrame = std::min(fillToFrame, numberOfValues);
-        for (; writeIndex < fillToFrame; ++writeIndex)
-            values[writeIndex] = defaultValue;
+        if (writeIndex < fillToFrame)
+        {
+            VectorMath::vfill(&defaultValue, values + writeIndex, 1, static_cast<int>(fillToFrame - writeIndex));
+            writeIndex = static_cast<unsigned>(fillToFrame);
+        }
 
         currentTime = fillToTime;
     }
 
     float value = defaultValue;
 
-    // Go through each event and render the value buffer where the times overlap,
+    // Go through each event from the cursor on and render the value buffer where the times overlap,
     // stopping when we've rendered all the requested values.
-    // FIXME: could try to optimize by avoiding having to iterate starting from the very first event
-    // and keeping track of a "current" event index.
     int n = static_cast<int>(m_events.size());
-    for (int i = 0; i < n && writeIndex < numberOfValues; ++i)
+    for (int i = static_cast<int>(m_cursor); i < n && writeIndex < numberOfValues; ++i)
     {
         ParamEvent & event = m_events[i];
         ParamEvent * nextEvent = i < n - 1 ? &(m_events[i + 1]) : 0;
@@ -245,12 +333,18 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
         // First handle linear and exponential ramps which require looking ahead to the next event.
         if (nextEventType == ParamEvent::LinearRampToValue)
         {
-            for (; writeIndex < fillToFrame; ++writeIndex)
+            if (writeIndex < fillToFrame)
             {
+                // The ramp is linear in the frame index, so fill it in closed form.
+                int frames = static_cast<int>(fillToFrame - writeIndex);
                 float x = static_cast<float>(currentTime - time1) * k;
-                value = (1 - x) * value1 + x * value2;
-                values[writeIndex] = value;
-                currentTime += sampleFrameTimeIncr;
+                float start = (1 - x) * value1 + x * value2;
+                float step = static_cast<float>((value2 - value1) * k * sampleFrameTimeIncr);
+                VectorMath::vramp(&start, &step, values + writeIndex, 1, frames);
+
+                writeIndex += frames;
+                value = values[writeIndex - 1];
+                currentTime += frames * sampleFrameTimeIncr;
             }
         }
         else if (nextEventType == ParamEvent::ExponentialRampToValue)
@@ -258,8 +352,11 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
             if (value1 <= 0 || value2 <= 0)
             {
                 // Handle negative values error case by propagating previous value.
-                for (; writeIndex < fillToFrame; ++writeIndex)
-                    values[writeIndex] = value;
+                if (writeIndex < fillToFrame)
+                {
+                    VectorMath::vfill(&value, values + writeIndex, 1, static_cast<int>(fillToFrame - writeIndex));
+                    writeIndex = static_cast<unsigned>(fillToFrame);
+                }
             }
             else
             {
@@ -273,11 +370,11 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
                 // accurate, especially if multiplier is close to 1.
                 value = value1 * powf(value2 / value1, AudioUtilities::timeToSampleFrame(currentTime - time1, sampleRate) / numSampleFrames);
 
+                currentTime += (fillToFrame - std::min(fillToFrame, static_cast<size_t>(writeIndex))) * sampleFrameTimeIncr;
                 for (; writeIndex < fillToFrame; ++writeIndex)
                 {
                     values[writeIndex] = value;
                     value *= multiplier;
-                    currentTime += sampleFrameTimeIncr;
                 }
             }
         }
@@ -294,8 +391,11 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
 
                     // Simply stay at a constant value.
                     value = event.value();
-                    for (; writeIndex < fillToFrame; ++writeIndex)
-                        values[writeIndex] = value;
+                    if (writeIndex < fillToFrame)
+                    {
+                        VectorMath::vfill(&value, values + writeIndex, 1, static_cast<int>(fillToFrame - writeIndex));
+                        writeIndex = static_cast<unsigned>(fillToFrame);
+                    }
 
                     break;
                 }
@@ -309,11 +409,15 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
                     float timeConstant = event.timeConstant();
                     float discreteTimeConstant = static_cast<float>(AudioUtilities::discreteTimeConstantForSampleRate(timeConstant, controlRate));
 
+                    // The distance to the target shrinks by a constant factor each frame.
+                    float multiplier = 1 - discreteTimeConstant;
+                    float delta = value - target;
                     for (; writeIndex < fillToFrame; ++writeIndex)
                     {
-                        values[writeIndex] = value;
-                        value += (target - value) * discreteTimeConstant;
+                        values[writeIndex] = target + delta;
+                        delta *= multiplier;
                     }
+                    value = target + delta;
 
                     break;
                 }
@@ -399,8 +503,8 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
 
     // If there's any time left after processing the last event then just propagate the last value
     // to the end of the values buffer.
-    for (; writeIndex < numberOfValues; ++writeIndex)
-        values[writeIndex] = value;
+    if (writeIndex < numberOfValues)
+        VectorMath::vfill(&value, values + writeIndex, 1, static_cast<int>(numberOfValues - writeIndex));
 
     return value;
 }
@@ -10,12 +10,16 @@
 #include "LabSound/extended/AudioContextLock.h"
 #include "LabSound/extended/Registry.h"
 
-#include "internal/Biquad.h"
+#include "internal/BiquadBank.h"
 #include <algorithm>
+#include <cmath>
 
 namespace lab
 {
 
+const int kMaxChannels = 32;  // the most an AudioBus can have
+const int SampleAccurateSpan = 16;  // frames between designs of sample-accurate coefficients
+
 static char const * const s_filter_types[FilterType::_FilterTypeCount + 1] = {
     "None",
     "Low Pass", "High Pass", "Band Pass", "Low Shelf", "High Shelf", "Peaking", "Notch", "All Pass",
@@ -45,6 +49,7 @@ public:
 
     BiquadFilterNodeInternal(BiquadFilterNode* self)
         : AudioProcessor()
+        , m_renderQuantumSize(self->renderQuantumSize())
     {
         m_frequency = self->param("frequency");
         m_q = self->param("Q");
@@ -63,140 +68,155 @@ public:
     {
     }
 
-    virtual void initialize() override {}
-    virtual void uninitialize() override {}
+    // Everything process() needs is sized here, for as many channels as a bus can have, so
+    // that a change in the channel count on the render thread only re-points the lanes
+    virtual void initialize() override
+    {
+        m_filters.reserve(kMaxChannels, 1, m_renderQuantumSize);
+        m_sources.resize(kMaxChannels);
+        m_destinations.resize(kMaxChannels);
+        for (auto & values : m_values)
+            values.resize(m_renderQuantumSize);
+        m_spans.resize((m_renderQuantumSize + SampleAccurateSpan - 1) / SampleAccurateSpan);
+        m_initialized = true;
+    }
+
+    virtual void uninitialize() override { m_initialized = false; }
 
     virtual void process(ContextRenderLock & r,  const lab::AudioBus * sourceBus, lab::AudioBus * destinationBus, int framesToProcess) override
     {
         int numberOfChannels = std::min(sourceBus->numberOfChannels(), destinationBus->numberOfChannels());
-        for (int i = m_filters.size(); i < numberOfChannels; ++i)
-        {
-            m_filters.emplace_back(std::make_unique<Biquad>());
-        }
-
-        checkForDirtyCoefficients(r);
-        updateCoefficientsIfNecessary(r, true, false);
+        if (m_filters.lanes() != numberOfChannels)
+            m_filters.setSize(numberOfChannels, 1);
+        if (!numberOfChannels)
+            return;
 
         for (int ch = 0; ch < numberOfChannels; ++ch)
         {
-            m_filters[ch]->process(sourceBus->channel(ch)->data(), destinationBus->channel(ch)->mutableData(), framesToProcess);
+            m_sources[ch] = sourceBus->channel(ch)->data();
+            m_destinations[ch] = destinationBus->channel(ch)->mutableData();
         }
-    }
-
-    virtual void reset() override {}
-    virtual double tailTime(ContextRenderLock & r) const override { return 0.25f; } // fixed 250ms
-    virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
-
-    // To prevent audio glitches when parameters are changed,
-    // dezippering is used to slowly change the parameters.
-    // |useSmoothing| implies that we want to update using the
-    // smoothed values. Otherwise the final target values are
-    // used. If |forceUpdate| is true, we update the coefficients even
-    // if they are not dirty. (Used when computing the frequency
-    // response.)
-    void checkForDirtyCoefficients(ContextRenderLock & r)
-    {
-        // Deal with smoothing / de-zippering. Start out assuming filter parameters are not changing.
-        // The BiquadDSPKernel objects rely on this value to see if they need to re-compute their internal filter coefficients.
-        m_filterCoefficientsDirty = false;
-        m_hasSampleAccurateValues = false;
 
         if (m_frequency->hasSampleAccurateValues() || m_q->hasSampleAccurateValues() || m_gain->hasSampleAccurateValues() || m_detune->hasSampleAccurateValues())
         {
+            processSampleAccurate(r, framesToProcess);
+            return;
+        }
+
+        // Snap to exact values first time after reset, then smooth for subsequent changes. The
+        // coefficients of the smoothed values are reached at the end of the quantum.
+        bool ramp = true;
+        if (m_hasJustReset)
+        {
+            m_frequency->resetSmoothedValue();
+            m_q->resetSmoothedValue();
+            m_gain->resetSmoothedValue();
+            m_detune->resetSmoothedValue();
+            m_hasJustReset = false;
             m_filterCoefficientsDirty = true;
-            m_hasSampleAccurateValues = true;
+            ramp = false;
         }
         else
         {
-            // Snap to exact values first time after reset, then smooth for subsequent changes.
-            if (m_hasJustReset)
-            {
-                m_frequency->resetSmoothedValue();
-                m_q->resetSmoothedValue();
-                m_gain->resetSmoothedValue();
-                m_detune->resetSmoothedValue();
-                m_filterCoefficientsDirty = true;
-                m_hasJustReset = false;
-            }
-            else
-            {
-                // Smooth all of the filter parameters. If they haven't yet converged to their target value then mark coefficients as dirty.
-                bool isStable1 = m_frequency->smooth(r);
-                bool isStable2 = m_q->smooth(r);
-                bool isStable3 = m_gain->smooth(r);
-                bool isStable4 = m_detune->smooth(r);
-                if (!(isStable1 && isStable2 && isStable3 && isStable4)) m_filterCoefficientsDirty = true;
-            }
+            // Smooth all of the filter parameters. If they haven't yet converged to their target value then mark coefficients as dirty.
+            bool isStable1 = m_frequency->smooth(r);
+            bool isStable2 = m_q->smooth(r);
+            bool isStable3 = m_gain->smooth(r);
+            bool isStable4 = m_detune->smooth(r);
+            if (!(isStable1 && isStable2 && isStable3 && isStable4)) m_filterCoefficientsDirty = true;
+        }
+
+        if (m_filterCoefficientsDirty)
+        {
+            double frequency = normalizedFrequency(r, m_frequency->smoothedValue(), m_detune->smoothedValue());
+            m_filters.setPrecision(precisionFor(frequency));
+            m_filters.setCoefficients(0, design(frequency, m_q->smoothedValue(), m_gain->smoothedValue()));
+            m_filterCoefficientsDirty = false;
         }
+
+        m_filters.process(m_sources.data(), m_destinations.data(), framesToProcess, ramp);
     }
 
-    void updateCoefficientsIfNecessary(ContextRenderLock & r, bool useSmoothing, bool forceUpdate)
+    // The coefficients are designed for the parameters' values every span of
+    // frames, and ramp from one span's to the next's, so that they follow
+    // the parameters sample by sample without a design for every frame.
+    void processSampleAccurate(ContextRenderLock & r, int framesToProcess)
     {
-        /* bool isStable1 = */ m_frequency->smooth(r);
-        /* bool isStable2 = */ m_q->smooth(r);
-        /* bool isStable3 = */ m_gain->smooth(r);
-        /* bool isStable4 = */ m_detune->smooth(r);
-        
-        if (forceUpdate || m_filterCoefficientsDirty)
-        {
-            double freq;
-            double q_val;
-            double gain;
-            double detune;
+        if (m_values[0].size() < static_cast<size_t>(framesToProcess))
+            for (auto & values : m_values)
+                values.resize(framesToProcess);
 
-            if (m_hasSampleAccurateValues)
-            {
-                /// @fixme these values should be per sample, not per quantum
-                freq = m_frequency->finalValue(r);
-                q_val = m_q->finalValue(r);
-                gain = m_gain->finalValue(r);
-                detune = m_detune->finalValue(r);
-            }
-            else if (useSmoothing)
-            {
-                /// @fixme these values should be per sample, not per quantum
-                freq = m_frequency->smoothedValue();
-                q_val = m_q->smoothedValue();
-                gain = m_gain->smoothedValue();
-                detune = m_detune->smoothedValue();
-            }
+        AudioParam * params[4] = {m_frequency.get(), m_q.get(), m_gain.get(), m_detune.get()};
+        for (int i = 0; i < 4; ++i)
+        {
+            if (params[i]->hasSampleAccurateValues())
+                params[i]->calculateSampleAccurateValues(r, m_values[i].data(), framesToProcess);
             else
-            {
-                freq = m_frequency->value();
-                q_val = m_q->value();
-                gain = m_gain->value();
-                detune = m_detune->value();
-            }
-
-            // Convert from Hertz to normalized frequency 0 -> 1.
-            double nyquist = r.context()->sampleRate() * 0.5f;
-            double normalizedFrequency = freq / nyquist;
+                std::fill(m_values[i].begin(), m_values[i].begin() + framesToProcess, params[i]->finalValue(r));
+        }
 
-            // Offset frequency by detune
-            if (detune)
-            {
-                normalizedFrequency *= std::pow(2.0, detune / 1200.0);
-            }
+        // Design every span first, as the precision depends on the lowest frequency
+        const int spans = (framesToProcess + SampleAccurateSpan - 1) / SampleAccurateSpan;
+        if (m_spans.size() < static_cast<size_t>(spans))
+            m_spans.resize(spans);
+        double lowest = 1;
+        for (int span = 0; span < spans; ++span)
+        {
+            const int last = std::min((span + 1) * SampleAccurateSpan, framesToProcess) - 1;
+            double frequency = normalizedFrequency(r, m_values[0][last], m_values[3][last]);
+            lowest = std::min(lowest, frequency);
+            m_spans[span] = design(frequency, m_values[1][last], m_values[2][last]);
+        }
+        m_filters.setPrecision(precisionFor(lowest));
 
-            // Configure all biquad filters with the new filter parameters for the appropriate type of filter.
-            // clang-format off
-            for (auto& filter : m_filters)
+        for (int span = 0; span < spans; ++span)
+        {
+            const int offset = span * SampleAccurateSpan;
+            const int frames = std::min(SampleAccurateSpan, framesToProcess - offset);
+            if (span)
             {
-                switch (m_type->valueUint32())
+                for (int ch = 0; ch < m_filters.lanes(); ++ch)
                 {
-                    case FilterType::LOWPASS:   filter->setLowpassParams(normalizedFrequency, q_val);       break;
-                    case FilterType::HIGHPASS:  filter->setHighpassParams(normalizedFrequency, q_val);      break;
-                    case FilterType::BANDPASS:  filter->setBandpassParams(normalizedFrequency, q_val);      break;
-                    case FilterType::LOWSHELF:  filter->setLowShelfParams(normalizedFrequency, gain);       break;
-                    case FilterType::HIGHSHELF: filter->setHighShelfParams(normalizedFrequency, gain);      break;
-                    case FilterType::PEAKING:   filter->setPeakingParams(normalizedFrequency, q_val, gain); break;
-                    case FilterType::NOTCH:     filter->setNotchParams(normalizedFrequency, q_val);         break;
-                    case FilterType::ALLPASS:   filter->setAllpassParams(normalizedFrequency, q_val);        break;
-                    default: break;
+                    m_sources[ch] += SampleAccurateSpan;
+                    m_destinations[ch] += SampleAccurateSpan;
                 }
             }
-            // clang-format on
+
+            m_filters.setCoefficients(0, m_spans[span]);
+            m_filters.process(m_sources.data(), m_destinations.data(), frames, !m_hasJustReset);
+            m_hasJustReset = false;
+        }
+
+        // the smoothed values pick up from here when the automation ends
+        m_filterCoefficientsDirty = true;
+    }
+
+    virtual void reset() override { m_filters.reset(); }
+    virtual double tailTime(ContextRenderLock & r) const override { return 0.25f; } // fixed 250ms
+    virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
+
+    // Convert from Hertz to normalized frequency 0 -> 1, offset by detune
+    double normalizedFrequency(ContextRenderLock & r, double freq, double detune) const
+    {
+        double nyquist = r.context()->sampleRate() * 0.5f;
+        double normalizedFrequency = freq / nyquist;
+        if (detune)
+        {
+            normalizedFrequency *= std::pow(2.0, detune / 1200.0);
         }
+        return normalizedFrequency;
+    }
+
+    BiquadBank::Coefficients design(double normalizedFrequency, double q_val, double gain) const
+    {
+        return BiquadBank::design(static_cast<FilterType>(m_type->valueUint32()), normalizedFrequency, q_val, gain);
+    }
+
+    // Biquads need double precision at 48khz for frequencies less than about 500Hz, according to multiple
+    // references, as their poles come close to the unit circle.
+    static BiquadBank::Precision precisionFor(double normalizedFrequency)
+    {
+        return normalizedFrequency < 0.02 ? BiquadBank::Precision::Double : BiquadBank::Precision::Single;
     }
 
     void getFrequencyResponse(ContextRenderLock & r, const std::vector<float> & frequencyHz, std::vector<float> & magResponse, std::vector<float> & phaseResponse)
@@ -206,21 +226,20 @@ public:
 
         size_t n = std::min(frequencyHz.size(), std::min(magResponse.size(), phaseResponse.size()));
 
-        // @todo
-        if (n)
-        {
-            // std::unique_ptr<BiquadDSPKernel> responseKernel(new BiquadDSPKernel(this));
-            // responseKernel->getFrequencyResponse(r, nFrequencies, frequencyHz, magResponse, phaseResponse);
-            //biquadProcessor()->getFrequencyResponse(r, n, &frequencyHz[0], &magResponse[0], &phaseResponse[0]);
-        }
+        // The response of the filter at the parameters' current values
+        BiquadBank::Coefficients coefficients = design(normalizedFrequency(r, m_frequency->value(), m_detune->value()), m_q->value(), m_gain->value());
+
+        double nyquist = r.context()->sampleRate() * 0.5f;
+        std::vector<float> normalizedFrequencies(n);
+        for (size_t i = 0; i < n; ++i)
+            normalizedFrequencies[i] = static_cast<float>(frequencyHz[i] / nyquist);
+
+        BiquadBank::getFrequencyResponse(&coefficients, 1, n, normalizedFrequencies.data(), &magResponse[0], &phaseResponse[0]);
     }
 
-    // so DSP kernels know when to re-compute coefficients
+    // Set when the parameters have changed since the coefficients were designed
     bool m_filterCoefficientsDirty {true};
 
-    // Set to true if any of the filter parameters are sample-accurate.
-    bool m_hasSampleAccurateValues {false};
-
     bool m_hasJustReset {true};
 
     std::shared_ptr<AudioSetting> m_type;
@@ -229,7 +248,14 @@ public:
     std::shared_ptr<AudioParam> m_gain;
     std::shared_ptr<AudioParam> m_detune;
 
-    std::vector<std::unique_ptr<Biquad>> m_filters;
+    // a lane for each channel
+    BiquadBank m_filters;
+    std::vector<const float *> m_sources;
+    std::vector<float *> m_destinations;
+
+    std::vector<float> m_values[4];  // frequency, Q, gain and detune, when sample accurate
+    std::vector<BiquadBank::Coefficients> m_spans;
+    int m_renderQuantumSize;
 };
  
 BiquadFilterNode::BiquadFilterNode(AudioContext & ac)
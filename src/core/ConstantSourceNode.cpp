@@ -27,7 +27,7 @@ AudioNodeDescriptor * ConstantSourceNode::desc()
 
 ConstantSourceNode::ConstantSourceNode(AudioContext & ac)
 : AudioScheduledSourceNode(ac, *desc())
-, m_sampleAccurateOffsetValues(AudioNode::ProcessingSizeInFrames)
+, m_sampleAccurateOffsetValues(ac.renderQuantumSize())
 {
     addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
     m_offset = param("offset");
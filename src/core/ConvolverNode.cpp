@@ -9,7 +9,16 @@
 #include "LabSound/extended/AudioContextLock.h"
 #include "LabSound/extended/Registry.h"
 #include "LabSound/extended/VectorMath.h"
+
+#include "internal/JobQueue.h"
+#include "internal/PartitionedConvolver.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 
 namespace lab
 {
@@ -17,20 +26,6 @@ namespace lab
 using std::isinf;
 using std::isnan;
 
-// from _SoundPipe_FFT.cpp
-struct sp_conv;
-struct sp_data;
-struct sp_ftbl;
-typedef float SPFLOAT;
-int sp_create(sp_data ** spp);
-int sp_destroy(sp_data ** spp);
-int sp_conv_compute(sp_data * sp, sp_conv * p, SPFLOAT * in, SPFLOAT * out);
-int sp_conv_create(sp_conv ** p);
-int sp_conv_destroy(sp_conv ** p);
-int sp_conv_init(sp_data * sp, sp_conv * p, sp_ftbl * ft, SPFLOAT iPartLen);
-int sp_ftbl_destroy(sp_ftbl ** ft);
-int sp_ftbl_bind(sp_data * sp, sp_ftbl ** ft, SPFLOAT * tbl, size_t size);
-
 //------------------------------------------------------------------------------
 // calculateNormalizationScale is adapted from webkit's Reverb.cpp, and carried the license:
 // calculateNormalizationScale license: BSD 3 Clause, Copyright (C) 2010, Google Inc. All rights reserved.
@@ -43,7 +38,7 @@ const float GainCalibrationSampleRate = 44100;
 // A minimum power value to when normalizing a silent (or very quiet) impulse response
 const float MinPower = 0.000125f;
 
-static float calculateNormalizationScale(AudioBus * response)
+static float calculateNormalizationScale(const AudioBus * response)
 {
     // Normalize by RMS power
     size_t numberOfChannels = response->numberOfChannels();
@@ -81,27 +76,47 @@ static float calculateNormalizationScale(AudioBus * response)
 
 //------------------------------------------------------------------------------
 
-ConvolverNode::ReverbKernel::ReverbKernel(ReverbKernel && rh) noexcept
-    : conv(rh.conv)
-    , ft(rh.ft)
+ConvolverNode::ReverbKernel::ReverbKernel(int responseChannels, int quantum)
+    : responseChannels(responseChannels)
+    , trueStereo(responseChannels == Channels::Quad)
 {
-    rh.conv = nullptr;
-    rh.ft = nullptr;
+    if (trueStereo)
+    {
+        channels = Channels::Stereo;
+        routing = {0, 2,   // left:  left * IR 0 + right * IR 2
+                   1, 3};  // right: left * IR 1 + right * IR 3
+    }
+    else
+    {
+        channels = std::max(responseChannels, static_cast<int>(Channels::Stereo));
+        routing.assign(channels * channels, -1);
+        for (int i = 0; i < channels; ++i)
+            routing[i * channels + i] = std::min(i, responseChannels - 1);
+    }
+
+    sources.resize(channels);
+    dests.resize(channels);
+    input.allocate(channels * quantum);
+    output.allocate(channels * quantum);
 }
 
-ConvolverNode::ReverbKernel::~ReverbKernel()
-{
-    if (ft)
-        lab::sp_ftbl_destroy(&ft);
+ConvolverNode::ReverbKernel::~ReverbKernel() = default;
 
-    if (conv)
-        lab::sp_conv_destroy(&conv);
-}
+struct ConvolverNode::Preparation
+{
+    std::mutex mutex;
+    std::condition_variable prepared;
+    std::unique_ptr<ReverbKernel> kernel;  // a new kernel when one has been prepared, or a retired one
+    std::atomic<bool> ready {false};
+    uint64_t requested = 0;  // the most recent preparation asked for
+    uint64_t completed = 0;  // and the most recent one completed
+};
 
 //------------------------------------------------------------------------------
 
 lab::AudioSettingDescriptor s_cSettings[] = {{"normalize", "NRML", SettingType::Bool},
-                                             {"impulseResponse", "IMPL", SettingType::Bus}, nullptr};
+                                             {"impulseResponse", "IMPL", SettingType::Bus},
+                                             {"backgroundTail", "BGTL", SettingType::Bool}, nullptr};
 AudioNodeDescriptor * ConvolverNode::desc()
 {
     static AudioNodeDescriptor d {nullptr, s_cSettings, 1};
@@ -111,27 +126,35 @@ AudioNodeDescriptor * ConvolverNode::desc()
 ConvolverNode::ConvolverNode(AudioContext& ac)
 : AudioScheduledSourceNode(ac, *desc())
 {
-    _swap_ready = false;
+    _preparation = std::make_shared<Preparation>();
+    _sampleRate = ac.sampleRate();
 
     _normalize = setting("normalize");
     _normalize->setBool(true);
     _impulseResponseClip = setting("impulseResponse");
+    _backgroundTail = setting("backgroundTail");
+    _backgroundTail->setBool(false);
 
     addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
 
-    lab::sp_create(&_sp);
-
     _impulseResponseClip->setValueChanged([this]() {
         this->_activateNewImpulse();
     });
+    _normalize->setValueChanged([this]() {
+        if (this->_impulseResponseClip->valueBus())
+            this->_createKernels();
+    });
+    _backgroundTail->setValueChanged([this]() {
+        if (this->_impulseResponseClip->valueBus())
+            this->_createKernels();
+    });
 
     initialize();
 }
 
 ConvolverNode::~ConvolverNode()
 {
-    _kernels.clear();
-    lab::sp_destroy(&_sp);
+    _kernel.reset();
     uninitialize();
 }
 
@@ -141,39 +164,17 @@ bool ConvolverNode::normalize() const
 }
 void ConvolverNode::setNormalize(bool new_n)
 {
-    bool n = normalize();
-    if (new_n == n)
-        return;
+    _normalize->setBool(new_n);
+}
 
-    auto clip = _impulseResponseClip->valueBus();
-    if (clip)
-    {
-        size_t len = clip->length();
-        if (n && _scale != 1.f)
-        {
-            // undo previous normalization
-            float s = 1.f / _scale;
-            for (int i = 0; i < clip->numberOfChannels(); ++i)
-            {
-                float * data = clip->channel(i)->mutableData();
-                for (int j = 0; j < len; ++j)
-                    data[j] *= s;
-            }
-        }
-        if (!n)
-        {
-            // wasn't previously normalized, so normalize
-            _scale = calculateNormalizationScale(clip.get());
-            for (int i = 0; i < clip->numberOfChannels(); ++i)
-            {
-                float * data = clip->channel(i)->mutableData();
-                for (int j = 0; j < len; ++j)
-                    data[j] *= _scale;
-            }
-        }
-    }
+bool ConvolverNode::backgroundTail() const
+{
+    return _backgroundTail->valueBool();
+}
 
-    _normalize->setBool(new_n);
+void ConvolverNode::setBackgroundTail(bool value)
+{
+    _backgroundTail->setBool(value);
 }
 
 void ConvolverNode::setImpulse(std::shared_ptr<AudioBus> bus)
@@ -190,43 +191,97 @@ void ConvolverNode::setImpulse(std::shared_ptr<AudioBus> bus)
 
 void ConvolverNode::_activateNewImpulse()
 {
-    /// @TODO Create the kernels on the main work thread, activate should simply copy
-    /// the data from the work thread.
-    auto clip = _impulseResponseClip->valueBus();
-    size_t len = clip->length();
-    _scale = 1;
-    if (normalize())
+    _createKernels();
+    start(0);
+}
+
+void ConvolverNode::_createKernels()
+{
+    std::shared_ptr<AudioBus> clip = _impulseResponseClip->valueBus();
+    std::shared_ptr<Preparation> preparation = _preparation;
+    uint64_t generation;
     {
-        _scale = calculateNormalizationScale(clip.get());
-        for (int i = 0; i < clip->numberOfChannels(); ++i)
+        std::lock_guard<std::mutex> lock(preparation->mutex);
+        generation = ++preparation->requested;
+    }
+
+    // The job holds the clip and the preparation, but not the node, which may be
+    // destroyed before the job runs. The clip is never modified once it is set.
+    const bool normalized = normalize();
+    const bool background = backgroundTail();
+    const int quantum = renderQuantumSize();
+    const float sampleRate = _sampleRate;
+    JobQueue::shared().post([clip, preparation, generation, normalized, background, quantum, sampleRate]() {
+        std::unique_ptr<ReverbKernel> kernel;
         {
-            float * data = clip->channel(i)->mutableData();
-            for (int j = 0; j < len; ++j)
-                data[j] *= _scale;
+            // a newer request supersedes this one
+            std::lock_guard<std::mutex> lock(preparation->mutex);
+            if (generation != preparation->requested)
+                return;
         }
-    }
 
-    {
-        std::unique_lock<std::mutex> kernel_guard(_kernel_mutex);
-        int c = static_cast<int>(clip->numberOfChannels());
-        for (int i = 0; i < c; ++i)
+        // The transformed response is cached under the key of the clip as given, and of
+        // how it is resampled and normalized, so that only the first convolver given
+        // the clip does either.
+        const int channels = static_cast<int>(clip->numberOfChannels());
+        std::vector<const float *> responses(channels);
+        for (int i = 0; i < channels; ++i)
+            responses[i] = clip->channel(i)->data();
+
+        const bool resample = sampleRate > 0 && clip->sampleRate() > 0 && clip->sampleRate() != sampleRate;
+        uint32_t rates[2] = {0, 0};
+        if (resample)
         {
-            // create one kernel per IR channel
-            ReverbKernel kernel;
+            float from = clip->sampleRate();
+            memcpy(&rates[0], &from, sizeof(float));
+            memcpy(&rates[1], &sampleRate, sizeof(float));
+        }
+        const uint64_t salt = ((uint64_t(rates[0]) << 32) | rates[1]) ^ uint64_t(normalized);
+        const uint64_t key = PartitionedConvolver::responseKey(responses.data(), channels, clip->length(), salt,
+                                                               quantum, background);
 
-            // ft doesn't own the data; it does retain a pointer to it.
-            sp_ftbl_bind(_sp, &kernel.ft,
-                         clip->channel(0)->mutableData(), clip->channel(0)->length());
+        auto prepared = PartitionedConvolver::findResponses(key);
+        if (!prepared)
+        {
+            std::unique_ptr<AudioBus> resampled;
+            const AudioBus * response = clip.get();
+            if (resample)
+            {
+                resampled = AudioBus::createBySampleRateConverting(response, false, sampleRate);
+                if (resampled)
+                    response = resampled.get();
+            }
 
-            sp_conv_create(&kernel.conv);
-            sp_conv_init(_sp, kernel.conv, kernel.ft, 8192);
+            for (int i = 0; i < channels; ++i)
+                responses[i] = response->channel(i)->data();
 
-            _pending_kernels.emplace_back(std::move(kernel));
+            float gain = normalized ? calculateNormalizationScale(response) : 1.f;
+            prepared = PartitionedConvolver::prepareResponses(key, responses.data(), channels, response->length(),
+                                                              gain, quantum, background);
         }
-        _swap_ready = true;
-    }
 
-    start(0);
+        kernel.reset(new ReverbKernel(channels, quantum));
+        kernel->convolver.reset(new PartitionedConvolver(prepared, kernel->channels, kernel->channels, kernel->routing.data()));
+
+        // Replacing the pending kernel releases the one the render thread retired,
+        // if it has swapped since the last impulse, or the one it never picked up.
+        {
+            std::lock_guard<std::mutex> lock(preparation->mutex);
+            if (generation != preparation->requested)
+                return;
+
+            std::swap(preparation->kernel, kernel);
+            preparation->completed = generation;
+            preparation->ready = true;
+        }
+        preparation->prepared.notify_all();
+    });
+}
+
+void ConvolverNode::waitForImpulse()
+{
+    std::unique_lock<std::mutex> lock(_preparation->mutex);
+    _preparation->prepared.wait(lock, [this]() { return _preparation->completed == _preparation->requested; });
 }
 
 std::shared_ptr<AudioBus> ConvolverNode::getImpulse() const
@@ -236,37 +291,48 @@ std::shared_ptr<AudioBus> ConvolverNode::getImpulse() const
 
 void ConvolverNode::process(ContextRenderLock & r, int bufferSize)
 {
-    if (_swap_ready) {
-        // this could cause an audio hiccough when swapping, but it's necessary to avoid a race
-        std::unique_lock<std::mutex> kernel_guard(_kernel_mutex);
-        _swap_ready = false;
-        std::swap(_kernels, _pending_kernels);
-        _pending_kernels.clear();
+    if (_preparation->ready)
+    {
+        // If a new kernel is being installed at this moment, it is picked up
+        // next quantum. The previous kernel is retired to the preparation, to be
+        // released off the render thread, as a convolver with a background tail must
+        // wait for the background thread to let go of it.
+        std::unique_lock<std::mutex> kernel_guard(_preparation->mutex, std::try_to_lock);
+        if (kernel_guard.owns_lock())
+        {
+            std::swap(_kernel, _preparation->kernel);
+            _preparation->ready = false;
+        }
     }
 
     AudioBus * outputBus = output(0)->bus(r);
     AudioBus * inputBus = input(0)->bus(r);
 
-    if (!isInitialized() || !outputBus || !inputBus || !inputBus->numberOfChannels() || !_kernels.size())
+    if (!isInitialized() || !outputBus || !inputBus || !inputBus->numberOfChannels() || !_kernel)
     {
         if (outputBus)
             outputBus->zero();
         return;
     }
 
-    // if the user never specified the number of output channels, make it match the input
-    if (!outputBus->numberOfChannels())
+    ReverbKernel & kernel = *_kernel;
+    const int numInputChannels = static_cast<int>(inputBus->numberOfChannels());
+    const int numReverbChannels = kernel.convolver->outputCount();
+
+    // A true stereo response always yields stereo; otherwise the output has a channel
+    // for each channel of the input or of the response, whichever is more.
+    int outputChannels = kernel.trueStereo ? numReverbChannels
+                                           : std::min(numReverbChannels, std::max(numInputChannels, kernel.responseChannels));
+    if (static_cast<int>(outputBus->numberOfChannels()) != outputChannels)
     {
-        output(0)->setNumberOfChannels(r, inputBus->numberOfChannels());
+        output(0)->setNumberOfChannels(r, outputChannels);
         outputBus = output(0)->bus(r);  // set number of channels invalidates the pointer
     }
 
     int quantumFrameOffset = _self->_scheduler._renderOffset;
     int nonSilentFramesToProcess = _self->_scheduler._renderLength;
 
-    int numInputChannels = static_cast<int>(inputBus->numberOfChannels());
     int numOutputChannels = static_cast<int>(outputBus->numberOfChannels());
-    int numReverbChannels = static_cast<int>(_kernels.size());
 
     if (!nonSilentFramesToProcess)
     {
@@ -274,40 +340,72 @@ void ConvolverNode::process(ContextRenderLock & r, int bufferSize)
         return;
     }
 
-    /// @todo should a situation such as 1:2:1 be invalid, or should it be powersum(1:1:1, 1:2:1)?
-    /// at the moment, this routine trivially does 1:1:1 only.
-
-    for (int i = 0; i < numOutputChannels; ++i)
+    // The convolver processes whole quanta, so the input outside of the scheduled
+    // frames is silenced rather than skipped, and so is the output.
+    const int quantum = renderQuantumSize();
+    const bool partial = quantumFrameOffset > 0 || nonSilentFramesToProcess < quantum;
+    const bool silent = inputBus->isSilent();
+
+    // Each of the convolver's inputs takes the input channel of the same index; the
+    // last channel of the input feeds the rest, except for the right of a true stereo
+    // response, which is silent. Inputs fed the same channel are given the same
+    // pointer, so that the convolver transforms it once.
+    for (int i = 0; i < numReverbChannels; ++i)
     {
-        int kernel = i < numReverbChannels ? i : numReverbChannels - 1;
-        lab::sp_conv * conv = _kernels[kernel].conv;
-        float* destP = outputBus->channel(i)->mutableData();
-        if (destP) {
-            destP += _self->_scheduler._renderOffset;
-
-            // Start rendering at the correct offset.
-            destP += quantumFrameOffset;
-            AudioBus * input_bus = input(0)->bus(r);
-            int in_channel = i < numInputChannels ? i : numInputChannels - 1;
-            float const* data = input_bus->channel(in_channel)->data() + quantumFrameOffset;
-            size_t c = input_bus->channel(in_channel)->length();
-            for (int j = 0; j < _self->_scheduler._renderLength; ++j)
+        int in_channel = std::min(i, numInputChannels - 1);
+        if (silent || (kernel.trueStereo && i >= numInputChannels))
+        {
+            kernel.sources[i] = nullptr;
+            continue;
+        }
+
+        const float * sourceP = inputBus->channel(in_channel)->data();
+        if (partial)
+        {
+            float * scratch = kernel.input.data() + in_channel * quantum;
+            if (in_channel == i)
             {
-                lab::SPFLOAT in = j < c ? data[j] : 0.f;  // don't read off the end of the input buffer
-                lab::SPFLOAT out = 0.f;
-                lab::sp_conv_compute(_sp, conv, &in, &out);
-                *destP++ = out;
+                memset(scratch, 0, sizeof(float) * quantum);
+                memcpy(scratch + quantumFrameOffset, sourceP + quantumFrameOffset, sizeof(float) * nonSilentFramesToProcess);
             }
+            sourceP = scratch;
+        }
+        kernel.sources[i] = sourceP;
+    }
+
+    for (int i = 0; i < numReverbChannels; ++i)
+    {
+        kernel.dests[i] = i < numOutputChannels ? outputBus->channel(i)->mutableData()
+                                                : kernel.output.data() + i * quantum;
+    }
+
+    kernel.convolver->process(kernel.sources.data(), kernel.dests.data(), quantum);
+
+    for (int i = 0; i < numOutputChannels; ++i)
+    {
+        if (i >= numReverbChannels)
+        {
+            outputBus->channel(i)->zero();
+            continue;
+        }
+
+        if (partial)
+        {
+            float * destP = outputBus->channel(i)->mutableData();
+            memset(destP, 0, sizeof(float) * quantumFrameOffset);
+            int end = quantumFrameOffset + nonSilentFramesToProcess;
+            memset(destP + end, 0, sizeof(float) * (quantum - end));
         }
     }
 
-    _now += double(_self->_scheduler._renderLength) / r.context()->sampleRate();
+    _now += double(nonSilentFramesToProcess) / r.context()->sampleRate();
     outputBus->clearSilentFlag();
 }
 
 void ConvolverNode::reset(ContextRenderLock &)
 {
-    _kernels.clear();
+    if (_kernel)
+        _kernel->convolver->reset();
 }
 
 bool ConvolverNode::propagatesSilence(ContextRenderLock & r) const
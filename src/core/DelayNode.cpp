@@ -7,17 +7,17 @@
 #include "LabSound/core/AudioProcessor.h"
 #include "LabSound/extended/Registry.h"
 
-#include "internal/AudioDSPKernel.h"
 #include "internal/DelayProcessor.h"
 
 namespace lab
 {
 
+static AudioParamDescriptor s_delayParams[] = {{"modulation", "MODU", 0.0, -1e6, 1e6}, nullptr};
 static AudioSettingDescriptor s_delayTimeSettings[] = {{"delayTime", "DELY", SettingType::Float}, nullptr};
 
 AudioNodeDescriptor * DelayNode::desc()
 {
-    static AudioNodeDescriptor d {nullptr, s_delayTimeSettings, 0};
+    static AudioNodeDescriptor d {s_delayParams, s_delayTimeSettings, 1};
     return &d;
 }
 
@@ -27,8 +27,8 @@ DelayNode::DelayNode(AudioContext& ac, double maxDelayTime)
     if (maxDelayTime < 0)
         maxDelayTime = 0;  // delay node can't predict the future
 
-    m_processor = std::make_unique<DelayProcessor>(ac.sampleRate(), 
-        maxDelayTime, setting("delayTime"));
+    m_processor = std::make_unique<DelayProcessor>(ac.sampleRate(), ac.renderQuantumSize(),
+        maxDelayTime, setting("delayTime"), param("modulation"));
 
     initialize();
 }
@@ -38,6 +38,11 @@ std::shared_ptr<AudioSetting> DelayNode::delayTime()
     return delayProcessor()->delayTime();
 }
 
+std::shared_ptr<AudioParam> DelayNode::modulation()
+{
+    return delayProcessor()->modulation();
+}
+
 DelayProcessor * DelayNode::delayProcessor()
 {
     return static_cast<DelayProcessor *>(processor());
@@ -13,6 +13,7 @@
 
 #include "internal/Assertions.h"
 #include "internal/DynamicsCompressor.h"
+#include "internal/LookaheadCompressor.h"
 
 using namespace std;
 
@@ -28,9 +29,16 @@ static AudioParamDescriptor s_dcParams[] = {
     {"release",   "RELS",   0.250, 0,  1},
     nullptr};
 
+static char const * const s_compressorModes[] = {"Classic", "Lookahead", nullptr};
+
+static AudioSettingDescriptor s_dcSettings[] = {
+    {"mode",      "MODE", SettingType::Enum, s_compressorModes},
+    {"lookahead", "LKAH", SettingType::Float},
+    nullptr};
+
 AudioNodeDescriptor * DynamicsCompressorNode::desc()
 {
-    static AudioNodeDescriptor d {s_dcParams, nullptr, 2};
+    static AudioNodeDescriptor d {s_dcParams, s_dcSettings, 2};
     return &d;
 }
 
@@ -46,6 +54,11 @@ DynamicsCompressorNode::DynamicsCompressorNode(AudioContext& ac)
     m_attack = param("attack");
     m_release = param("release");
 
+    m_mode = setting("mode");
+    m_mode->setEnumeration(COMPRESSOR_CLASSIC);
+    m_lookahead = setting("lookahead");
+    m_lookahead->setFloat(0.005f);
+
     initialize();
 }
 
@@ -64,12 +77,6 @@ void DynamicsCompressorNode::process(ContextRenderLock &r, int bufferSize)
     float attack = m_attack->value();
     float release = m_release->value();
 
-    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamThreshold, threshold);
-    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamKnee, knee);
-    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamRatio, ratio);
-    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamAttack, attack);
-    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamRelease, release);
-
     int numberOfSourceChannels = input(0)->numberOfChannels(r);
     int numberOfActiveBusChannels = input(0)->bus(r)->numberOfChannels();
     if (numberOfActiveBusChannels != numberOfSourceChannels)
@@ -88,6 +95,27 @@ void DynamicsCompressorNode::process(ContextRenderLock &r, int bufferSize)
     AudioBus* outputBus = output(0)->bus(r);
     ASSERT(outputBus && outputBus->numberOfChannels() == numberOfDestChannels);
 
+    if (mode() == COMPRESSOR_LOOKAHEAD)
+    {
+        LookaheadCompressor::Parameters parameters;
+        parameters.threshold = threshold;
+        parameters.knee = knee;
+        parameters.ratio = ratio;
+        parameters.attack = attack;
+        parameters.release = release;
+        parameters.lookahead = m_lookahead->valueFloat();
+
+        m_lookaheadCompressor->process(parameters, r.context()->sampleRate(), input(0)->bus(r), outputBus, bufferSize);
+        m_reduction->setValue(m_lookaheadCompressor->reduction());
+        return;
+    }
+
+    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamThreshold, threshold);
+    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamKnee, knee);
+    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamRatio, ratio);
+    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamAttack, attack);
+    m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamRelease, release);
+
     m_dynamicsCompressor->process(r, input(0)->bus(r), outputBus, bufferSize, _self->_scheduler._renderOffset, _self->_scheduler._renderLength);
 
     float reduction = m_dynamicsCompressor->parameterValue(DynamicsCompressor::ParamReduction);
@@ -97,6 +125,7 @@ void DynamicsCompressorNode::process(ContextRenderLock &r, int bufferSize)
 void DynamicsCompressorNode::reset(ContextRenderLock &)
 {
     m_dynamicsCompressor->reset();
+    m_lookaheadCompressor->reset();
 }
 
 void DynamicsCompressorNode::initialize()
@@ -105,6 +134,7 @@ void DynamicsCompressorNode::initialize()
         return;
 
     m_dynamicsCompressor.reset(new DynamicsCompressor(2));
+    m_lookaheadCompressor.reset(new LookaheadCompressor());
 
     AudioNode::initialize();
 }
@@ -117,6 +147,7 @@ void DynamicsCompressorNode::uninitialize()
     AudioNode::uninitialize();
 
     m_dynamicsCompressor.reset();
+    m_lookaheadCompressor.reset();
 }
 
 double DynamicsCompressorNode::tailTime(ContextRenderLock & r) const
@@ -126,6 +157,8 @@ double DynamicsCompressorNode::tailTime(ContextRenderLock & r) const
 
 double DynamicsCompressorNode::latencyTime(ContextRenderLock & r) const
 {
+    if (mode() == COMPRESSOR_LOOKAHEAD)
+        return m_lookaheadCompressor->latencyFrames() / static_cast<double>(r.context()->sampleRate());
     return m_dynamicsCompressor->latencyTime(r);
 }
 
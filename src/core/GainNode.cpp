@@ -5,13 +5,18 @@
 #include "LabSound/core/GainNode.h"
 #include "LabSound/core/AudioArray.h"
 #include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioContext.h"
 #include "LabSound/core/AudioNodeInput.h"
 #include "LabSound/core/AudioNodeOutput.h"
 
 #include "LabSound/extended/AudioContextLock.h"
 #include "LabSound/extended/Registry.h"
+#include "LabSound/extended/VectorMath.h"
 
 #include "internal/Assertions.h"
+#include "internal/DenormalDisabler.h"
+
+#include <typeinfo>
 
 namespace lab
 {
@@ -26,7 +31,7 @@ AudioNodeDescriptor * GainNode::desc()
 GainNode::GainNode(AudioContext& ac)
     : AudioNode(ac, *desc())
     , m_lastGain(1.f)
-    , m_sampleAccurateGainValues(AudioNode::ProcessingSizeInFrames)  // FIXME: can probably share temp buffer in context
+    , m_sampleAccurateGainValues(ac.renderQuantumSize())  // FIXME: can probably share temp buffer in context
 {
     addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
 
@@ -40,12 +45,26 @@ GainNode::~GainNode()
     uninitialize();
 }
 
-void GainNode::process(ContextRenderLock &r, int bufferSize)
+bool GainNode::calculateSampleAccurateGains(ContextRenderLock & r, int bufferSize)
 {
-    // FIXME: for some cases there is a nice optimization to avoid processing here, and let the gain change
-    // happen in the summing junction input of the AudioNode we're connected to.
-    // Then we can avoid all of the following:
+    // Apply sample-accurate gain scaling for precise envelopes, grain windows, etc.
+    ASSERT(bufferSize <= m_sampleAccurateGainValues.size());
+    if (bufferSize > m_sampleAccurateGainValues.size())
+        return false;
+
+    float* gainValues_base = m_sampleAccurateGainValues.data();
+    float* gainValues = gainValues_base + _self->_scheduler._renderOffset;
+    gain()->calculateSampleAccurateValues(r, gainValues, _self->_scheduler._renderLength);
+    if (_self->_scheduler._renderOffset > 0)
+        memset(gainValues_base, 0, sizeof(float) * _self->_scheduler._renderOffset);
+    int bzero_start = _self->_scheduler._renderOffset + _self->_scheduler._renderLength;
+    if (bzero_start < bufferSize)
+        memset(gainValues_base + bzero_start, 0, sizeof(float) * (bufferSize - bzero_start));
+    return true;
+}
 
+void GainNode::process(ContextRenderLock &r, int bufferSize)
+{
     AudioBus * outputBus = output(0)->bus(r);
     ASSERT(outputBus);
 
@@ -75,20 +94,8 @@ void GainNode::process(ContextRenderLock &r, int bufferSize)
 
     if (gain()->hasSampleAccurateValues())
     {
-        // Apply sample-accurate gain scaling for precise envelopes, grain windows, etc.
-        ASSERT(bufferSize <= m_sampleAccurateGainValues.size());
-        if (bufferSize <= m_sampleAccurateGainValues.size())
-        {
-            float* gainValues_base = m_sampleAccurateGainValues.data();
-            float* gainValues = gainValues_base + _self->_scheduler._renderOffset;
-            gain()->calculateSampleAccurateValues(r, gainValues, _self->_scheduler._renderLength);
-            if (_self->_scheduler._renderOffset > 0)
-                memset(gainValues_base, 0, sizeof(float) * _self->_scheduler._renderOffset);
-            int bzero_start = _self->_scheduler._renderOffset + _self->_scheduler._renderLength;
-            if (bzero_start < bufferSize)
-                memset(gainValues_base + bzero_start, 0, sizeof(float) * bufferSize - bzero_start);
+        if (calculateSampleAccurateGains(r, bufferSize))
             outputBus->copyWithSampleAccurateGainValuesFrom(*inputBus, m_sampleAccurateGainValues.data(), bufferSize);
-        }
     }
     else
     {
@@ -99,6 +106,145 @@ void GainNode::process(ContextRenderLock &r, int bufferSize)
     outputBus->clearSilentFlag();
 }
 
+GainNode * GainNode::foldable(ContextRenderLock & r, AudioNodeOutput * output)
+{
+    // a subclass may process differently, so only a GainNode itself is folded
+    AudioNode * node = output ? output->sourceNode() : nullptr;
+    if (!node || typeid(*node) != typeid(GainNode))
+        return nullptr;
+
+    // the connections may have changed since the last quantum
+    output->updateRenderingState(r);
+    if (output->renderingFanOutCount() != 1 || output->renderingParamFanOutCount())
+        return nullptr;
+
+    return static_cast<GainNode *>(node);
+}
+
+GainNode * GainNode::foldedInto(AudioNodeOutput * output, AudioNodeInput * junction)
+{
+    AudioNode * node = output->sourceNode();
+    if (!node || typeid(*node) != typeid(GainNode))
+        return nullptr;
+
+    GainNode * gain = static_cast<GainNode *>(node);
+    return gain->_self->foldedInto == junction ? gain : nullptr;
+}
+
+void GainNode::sumInto(ContextRenderLock & r, AudioBus & destination, int bufferSize)
+{
+    if (!isInitialized())
+        return;
+
+    // The node isn't processed by the schedule, so this stands in for processing it. While
+    // the scheduler has an envelope to apply to the output, or a stop to make, it's
+    // processed after all.
+    const AudioNodeScheduler & scheduler = _self->_scheduler;
+    if (scheduler._fadeInRemaining > 0 || scheduler._stopWhen != std::numeric_limits<uint64_t>::max() ||
+        (scheduler._playbackState != SchedulingState::UNSCHEDULED && scheduler._playbackState != SchedulingState::FADE_IN &&
+         scheduler._playbackState != SchedulingState::PLAYING))
+    {
+        processScheduled(r, bufferSize);
+        destination.sumFrom(*output(0)->bus(r));
+        return;
+    }
+
+    AudioBus * inputBus = _self->m_inputs[0]->gather(r, bufferSize);
+    const int numberOfChannels = inputBus->numberOfChannels();
+
+    // the output keeps the input's channel count, as the junction's follows it
+    AudioNodeOutput * out = _self->m_outputs[0].get();
+    AudioBus * outputBus = out->bus(r);
+    if (outputBus->numberOfChannels() != numberOfChannels)
+    {
+        out->setNumberOfChannels(r, numberOfChannels);
+        outputBus = out->bus(r);
+    }
+    outputBus->zero();
+
+    if (inputBus->isSilent())
+        return;
+
+    const int framesToProcess = std::min(bufferSize, std::min(inputBus->length(), destination.length()));
+    if (framesToProcess > m_sampleAccurateGainValues.size())
+        return;
+
+    // the gains of the first rampLength frames are in m_sampleAccurateGainValues,
+    // and the rest are m_lastGain
+    int rampLength = 0;
+    if (gain()->hasSampleAccurateValues())
+    {
+        if (calculateSampleAccurateGains(r, framesToProcess))
+            rampLength = framesToProcess;
+        else
+        {
+            // refresh the gain, so the next de-zippered quantum doesn't ramp from a stale one
+            m_lastGain = gain()->value();
+            m_dezipperStarted = true;
+        }
+    }
+    else
+    {
+        // the de-zippering of AudioBus::copyWithGainFrom()
+        const float targetGain = gain()->value();
+        float g = !m_dezipperStarted && outputBus->isFirstTime() ? targetGain : m_lastGain;
+        m_dezipperStarted = true;
+
+        const float DezipperRate = 0.005f;
+        const float epsilon = 0.001f;
+        if (fabsf(targetGain - g) >= epsilon)
+        {
+            float * gainValues = m_sampleAccurateGainValues.data();
+            for (int i = 0; i < framesToProcess; ++i)
+            {
+                g += (targetGain - g) * DezipperRate;
+                g = DenormalDisabler::flushDenormalFloatToZero(g);
+                gainValues[i] = g;
+            }
+            rampLength = framesToProcess;
+        }
+        else
+            g = targetGain;
+
+        m_lastGain = g;
+    }
+
+    const float * gainValues = m_sampleAccurateGainValues.data();
+    auto applyGain = [&](AudioBus & bus)
+    {
+        for (int i = 0; i < numberOfChannels; ++i)
+        {
+            const float * source = inputBus->channel(i)->data();
+            AudioChannel * channel = bus.channel(i);
+
+            // a silent channel is overwritten rather than summed into
+            bool overwrite = channel->isSilent();
+            float * dest = channel->mutableData();
+            if (overwrite)
+            {
+                VectorMath::vmul(source, 1, gainValues, 1, dest, 1, rampLength);
+                VectorMath::vsmul(source + rampLength, 1, &m_lastGain, dest + rampLength, 1, framesToProcess - rampLength);
+            }
+            else
+            {
+                VectorMath::vma(source, 1, gainValues, 1, dest, 1, dest, 1, rampLength);
+                VectorMath::vsma(source + rampLength, 1, &m_lastGain, dest + rampLength, 1, framesToProcess - rampLength);
+            }
+        }
+    };
+
+    if (destination.numberOfChannels() == numberOfChannels)
+    {
+        applyGain(destination);
+        return;
+    }
+
+    // mixing between channel layouts is left to the bus, from the output the node
+    // would have rendered
+    applyGain(*outputBus);
+    destination.sumFrom(*outputBus);
+}
+
 void GainNode::reset(ContextRenderLock & r)
 {
     // Snap directly to desired gain.
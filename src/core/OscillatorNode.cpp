@@ -17,9 +17,11 @@
 
 #include "internal/Assertions.h"
 #include "internal/AudioUtilities.h"
+#include "internal/WavetableOscillator.h"
 #include "LabSound/extended/VectorMath.h"
 
 #include <algorithm>
+#include <atomic>
 //#include <emmintrin.h>
 
 using namespace lab;
@@ -69,8 +71,12 @@ AudioNodeDescriptor * OscillatorNode::desc()
 
 OscillatorNode::OscillatorNode(AudioContext & ac)
 : AudioScheduledSourceNode(ac, *desc())
-, m_phaseIncrements(AudioNode::ProcessingSizeInFrames)
-, m_detuneValues(AudioNode::ProcessingSizeInFrames)
+, m_sampleRate(ac.sampleRate())
+, m_wavetable(new WavetableOscillator())
+, m_phaseIncrements(ac.renderQuantumSize())
+, m_biasValues(ac.renderQuantumSize())
+, m_detuneValues(ac.renderQuantumSize())
+, m_amplitudeValues(ac.renderQuantumSize())
 {
     m_frequency = param("frequency");
     m_detune = param("detune");
@@ -78,7 +84,7 @@ OscillatorNode::OscillatorNode(AudioContext & ac)
     m_bias = param("bias");
 
     m_type = setting("type");
-    m_type->setValueChanged([this]() { setType(OscillatorType(m_type->valueUint32())); });
+    m_type->setValueChanged([this]() { updatePeriodicWave(); });
 
     setType(OscillatorType::SINE);
     initialize();
@@ -99,6 +105,45 @@ void OscillatorNode::setType(OscillatorType type)
     m_type->setUint32(static_cast<uint32_t>(type));
 }
 
+void OscillatorNode::setPeriodicWave(std::shared_ptr<PeriodicWave> wave)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_waveMutex);
+        m_customWave = wave;
+    }
+    if (type() == OscillatorType::CUSTOM)
+        updatePeriodicWave();
+    else
+        setType(OscillatorType::CUSTOM);
+}
+
+std::shared_ptr<PeriodicWave> OscillatorNode::periodicWave() const
+{
+    return std::atomic_load(&m_periodicWave);
+}
+
+bool OscillatorNode::prepare(AudioContext & ac)
+{
+    // until the context has a destination, there's no rate to make the tables at
+    const float sampleRate = ac.sampleRate();
+    if (sampleRate <= 0)
+        return true;
+
+    float unknown = 0.f;
+    if (m_sampleRate.compare_exchange_strong(unknown, sampleRate))
+        updatePeriodicWave();
+    return false;
+}
+
+void OscillatorNode::updatePeriodicWave()
+{
+    // the wave is exchanged whole, so the render thread sees either the old tables or the new
+    std::lock_guard<std::mutex> lock(m_waveMutex);
+    OscillatorType t = type();
+    std::shared_ptr<PeriodicWave> wave = t == OscillatorType::CUSTOM ? m_customWave : PeriodicWave::acquire(m_sampleRate.load(), t);
+    std::atomic_store(&m_periodicWave, wave);
+}
+
 void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, int offset, int count)
 {
     AudioBus * outputBus = output(0)->bus(r);
@@ -130,13 +175,12 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
     if (bufferSize > m_biasValues.size())
         m_biasValues.allocate(bufferSize);
     
-    // calculate phase increments
+    // calculate the frequencies; for FAST_SINE they become phase increments below
     float* phaseIncrements = m_phaseIncrements.data();
     
     if (m_frequency->hasSampleAccurateValues())
     {
-        // Get the sample-accurate frequency values in preparation for conversion to phase increments.
-        // They will be converted to phase increments below.
+        // Get the sample-accurate frequency values.
         m_frequency->calculateSampleAccurateValues(r, phaseIncrements, nonSilentFramesToProcess);
     }
     else
@@ -144,10 +188,7 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
         // Handle ordinary parameter smoothing/de-zippering if there are no scheduled changes.
         m_frequency->smooth(r);
         float frequency = m_frequency->smoothedValue();
-        for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-        {
-            phaseIncrements[i] = frequency;
-        }
+        VectorMath::vfill(&frequency, phaseIncrements + quantumFrameOffset, 1, nonSilentFramesToProcess - quantumFrameOffset);
     }
     
     if (m_detune->hasSampleAccurateValues())
@@ -173,17 +214,11 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
         if (fabsf(detune) > 0.01f)
         {
             float detuneScale = powf(2, detune / 1200);
-            for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-                phaseIncrements[i] *= detuneScale;
+            VectorMath::vsmul(phaseIncrements + quantumFrameOffset, 1, &detuneScale,
+                              phaseIncrements + quantumFrameOffset, 1, nonSilentFramesToProcess - quantumFrameOffset);
         }
     }
     
-    // convert frequencies to phase increments
-    for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-    {
-        phaseIncrements[i] = static_cast<float>(2.f * static_cast<float>(LAB_PI)* phaseIncrements[i] / sample_rate);
-    }
-    
     // fetch the amplitudes
     float* amplitudes = m_amplitudeValues.data();
     if (m_amplitude->hasSampleAccurateValues())
@@ -194,8 +229,7 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
     {
         m_amplitude->smooth(r);
         float amp = m_amplitude->smoothedValue();
-        for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-            amplitudes[i] = amp;
+        VectorMath::vfill(&amp, amplitudes + quantumFrameOffset, 1, nonSilentFramesToProcess - quantumFrameOffset);
     }
     
     // fetch the bias values
@@ -208,30 +242,25 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
     {
         m_bias->smooth(r);
         float b = m_bias->smoothedValue();
-        for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-        {
-            bias[i] = b;
-        }
+        VectorMath::vfill(&b, bias + quantumFrameOffset, 1, nonSilentFramesToProcess - quantumFrameOffset);
     }
     
-    // calculate and write the wave
+    // calculate and write the wave. Each waveform is first written at unit amplitude,
+    // then scaled and biased in one vector pass.
     float* destP = outputBus->channel(0)->mutableData();
     const float pi = static_cast<float>(LAB_PI);
+    bool scaleAndBias = true;
     
     OscillatorType type = static_cast<OscillatorType>(m_type->valueUint32());
     switch (type)
     {
-        case OscillatorType::SINE:
-            for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-            {
-                destP[i] = static_cast<float>(bias[i] + amplitudes[i] * static_cast<float>(sin(phase)));
-                phase += phaseIncrements[i];
-                if (phase > 2.f * pi)
-                    phase -= 2.f * pi;
-            }
-            break;
-            
         case OscillatorType::FAST_SINE:
+        {
+            // convert frequencies to phase increments
+            float radiansPerCycle = static_cast<float>(2.f * pi / sample_rate);
+            VectorMath::vsmul(phaseIncrements + quantumFrameOffset, 1, &radiansPerCycle,
+                              phaseIncrements + quantumFrameOffset, 1, nonSilentFramesToProcess - quantumFrameOffset);
+
             for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
             {
                 destP[i] = burk_fast_sine(phase);
@@ -239,57 +268,38 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
                 if (phase > pi)
                     phase -= 0.5f * pi;
             }
+            scaleAndBias = false;
             break;
+        }
             
+        case OscillatorType::SINE:
         case OscillatorType::SQUARE:
-            for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-            {
-                float amp = amplitudes[i];
-                destP[i] = static_cast<float>(bias[i] + (phase < pi ? amp : -amp));
-                phase += phaseIncrements[i];
-                if (phase > 2.f * pi)
-                    phase -= 2.f * pi;
-            }
-            break;
-            
         case OscillatorType::SAWTOOTH:
-            for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-            {
-                float amp = amplitudes[i];
-                destP[i] = static_cast<float>(bias[i] + amp - (amp / pi * phase));
-                phase += phaseIncrements[i];
-                if (phase > 2.f * pi)
-                    phase -= 2.f * pi;
-            }
-            break;
-            
         case OscillatorType::FALLING_SAWTOOTH:
-            for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
-            {
-                float amp = amplitudes[i];
-                destP[i] = static_cast<float>(bias[i] - (amp / pi * phase));
-                phase += phaseIncrements[i];
-                if (phase > 2. * pi)
-                    phase -= 2. * pi;
-            }
-            break;
-            
         case OscillatorType::TRIANGLE:
-            for (int i = quantumFrameOffset; i < nonSilentFramesToProcess; ++i)
+        case OscillatorType::CUSTOM:
+        {
+            // tables are never built here; a node made before the context knew its sample rate
+            // is silent until it is prepared, once the context knows it, as is a custom oscillator without a wave
+            std::shared_ptr<PeriodicWave> wave = std::atomic_load(&m_periodicWave);
+            if (!wave)
             {
-                float amp = amplitudes[i];
-                if (phase < pi)
-                    destP[i] = static_cast<float>(bias[i] - amp + (2.f * amp / pi * phase));
-                else
-                    destP[i] = static_cast<float>(bias[i] + 3.f * amp - (2.f * amp / pi *  phase));
-                
-                phase += phaseIncrements[i];
-                if (phase > 2.f * pi)
-                    phase -= 2.f * pi;
+                outputBus->zero();
+                return;
             }
+            m_wavetable->render(*wave, phaseIncrements + quantumFrameOffset, destP + quantumFrameOffset,
+                                nonSilentFramesToProcess - quantumFrameOffset);
             break;
+        }
             
-        default: break; // other types do nothing
+        default: scaleAndBias = false; break; // other types do nothing
+    }
+
+    if (scaleAndBias)
+    {
+        float* waveP = destP + quantumFrameOffset;
+        VectorMath::vma(waveP, 1, amplitudes + quantumFrameOffset, 1, bias + quantumFrameOffset, 1,
+                        waveP, 1, nonSilentFramesToProcess - quantumFrameOffset);
     }
     
     outputBus->clearSilentFlag();
@@ -297,14 +307,7 @@ void OscillatorNode::process_oscillator(ContextRenderLock & r, int bufferSize, i
 
 void OscillatorNode::process(ContextRenderLock & r, int bufferSize)
 {
-    OscillatorType type = static_cast<OscillatorType>(m_type->valueUint32());
-    if (type != OscillatorType::CUSTOM)
-    {
-        process_oscillator(r, bufferSize, _self->_scheduler._renderOffset, _self->_scheduler._renderLength);
-        return;
-    }
-
-    return;
+    process_oscillator(r, bufferSize, _self->_scheduler._renderOffset, _self->_scheduler._renderLength);
 }
 
 bool OscillatorNode::propagatesSilence(ContextRenderLock & r) const
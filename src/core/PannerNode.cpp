@@ -21,12 +21,22 @@
 #include "internal/HRTFDatabase.h"
 #include "internal/HRTFPanner.h"
 #include "internal/Panner.h"
+#include "internal/RenderHandoff.h"
+
+#include <mutex>
 
 using namespace std;
 
 namespace lab
 {
 
+struct PannerNode::Panners
+{
+    // guards the handoff's owner, off the render thread, which never takes it
+    std::mutex mutex;
+    RenderHandoff<Panner> handoff;
+};
+
 template <typename T>
 static void fixNANs(T & x)
 {
@@ -71,7 +81,13 @@ AudioNodeDescriptor * PannerNode::desc()
 }
 
 PannerNode::PannerNode(AudioContext & ac)
-: AudioNode(ac, *desc())
+: PannerNode(ac, *desc())
+{
+}
+
+PannerNode::PannerNode(AudioContext & ac, AudioNodeDescriptor const & desc)
+: AudioNode(ac, desc)
+, m_panners(new Panners())
 , m_sampleRate(ac.sampleRate())
 {
     /// @TODO in the future a panner could be multi-channel beyond stereo
@@ -164,16 +180,19 @@ void PannerNode::initialize()
 {
     if (isInitialized()) return;
 
-    switch (static_cast<PanningModel>(m_panningModel->valueUint32()))
     {
-        case PanningModel::EQUALPOWER:
-            m_panner = std::unique_ptr<Panner>(new EqualPowerPanner(m_sampleRate));
-            break;
-        case PanningModel::HRTF:
-            //m_panner = std::unique_ptr<Panner>(new HRTFPanner(m_sampleRate));
-            break;
-        default:
-            throw std::runtime_error("invalid panning model");
+        std::lock_guard<std::mutex> lock(m_panners->mutex);
+        switch (static_cast<PanningModel>(m_panningModel->valueUint32()))
+        {
+            case PanningModel::EQUALPOWER:
+                m_panners->handoff.publish(std::make_shared<EqualPowerPanner>(m_sampleRate));
+                break;
+            case PanningModel::HRTF:
+                // made by prepare(), once the context's database has loaded
+                break;
+            default:
+                throw std::runtime_error("invalid panning model");
+        }
     }
 
     AudioNode::initialize();
@@ -184,11 +203,34 @@ void PannerNode::uninitialize()
     if (!isInitialized())
         return;
 
-    m_panner.reset();
+    {
+        std::lock_guard<std::mutex> lock(m_panners->mutex);
+        m_panners->handoff.publish(nullptr);
+    }
 
     AudioNode::uninitialize();
 }
 
+bool PannerNode::prepare(AudioContext & ac)
+{
+    std::lock_guard<std::mutex> lock(m_panners->mutex);
+    RenderHandoff<Panner> & handoff = m_panners->handoff;
+
+    // the panner is remade if the context has loaded another database
+    auto renderer = ac.hrtfRenderer();
+    if (renderer && isInitialized() && panningModel() == PanningModel::HRTF)
+    {
+        const std::shared_ptr<Panner> & panner = handoff.current();
+        if (!panner || panner->panningModel() != PanningModel::HRTF ||
+            static_cast<HRTFPanner *>(panner.get())->renderer() != renderer.get())
+            handoff.publish(std::make_shared<HRTFPanner>(renderer->sampleRate(), renderer));
+    }
+    handoff.collect();
+
+    // the panning model may change, and the context may load another database
+    return true;
+}
+
 void PannerNode::setOrientation(const FloatPoint3D & fwd)
 {
     m_orientationX->setValue(fwd.x);
@@ -228,32 +270,12 @@ void PannerNode::process(ContextRenderLock & r, int bufferSize)
         return;
     }
 
-    PanningModel curr = static_cast<PanningModel>(m_panningModel->valueUint32());
-    auto db = r.context()->hrtfDatabaseLoader();
-    if (curr == PanningModel::HRTF) {
-        if (!db) {
-            destination->zero();
-            return;
-        }
-        if (!db->isLoaded()) {
-            if (r.context()->isOfflineContext()) {
-                // HRTFDatabase should be loaded before proceeding for offline audio context
-                if (db)
-                    db->waitForLoaderThreadCompletion();
-            }
-            else {
-                destination->zero();
-                return;
-            }
-        }
-
-        if (!m_panner) {
-            //uint32_t fftSize = HRTFPanner::fftSizeForSampleLength(db->database()->sampleSize());
-            m_panner = std::unique_ptr<Panner>(new HRTFPanner(m_sampleRate)); //, fftSize));
-        }
-    }
-    
-    if (!m_panner)
+    // The panner is made off the render thread, and the node is silent until it has one
+    // for its panning model. An HRTF node is silent until the database has loaded, rather
+    // than block the render thread; an offline context that must not start silent loads
+    // it beforehand, with AudioContext::loadHrtfDatabase().
+    RenderHandoff<Panner>::Use panner(m_panners->handoff);
+    if (!panner || panner->panningModel() != panningModel())
     {
         destination->zero();
         return;
@@ -264,8 +286,28 @@ void PannerNode::process(ContextRenderLock & r, int bufferSize)
     double azimuth;
     double elevation;
     getAzimuthElevation(r, &azimuth, &elevation);
-    
-    m_panner->pan(r, azimuth, elevation,
+
+    if (panner->panningModel() == PanningModel::HRTF)
+    {
+        // The distance and cone gain is applied to the input, rather than the output, so
+        // that the renderer may sum the spectra of panners mixed into the same input.
+        float totalGain = distanceConeGain(r);
+        if (m_lastGain == -1.f)
+            m_lastGain = totalGain;
+
+        if (!m_gainedInput || m_gainedInput->numberOfChannels() != source->numberOfChannels())
+            r.context()->exchangeBus(r, m_gainedInput, source->numberOfChannels());
+        m_gainedInput->copyWithGainFrom(*source, &m_lastGain, totalGain);
+
+        HRTFPanner * hrtfPanner = static_cast<HRTFPanner *>(panner.get());
+        hrtfPanner->setMixTarget(output(0)->renderingSoleInput());
+        hrtfPanner->pan(r, azimuth, elevation,
+                        *m_gainedInput, *destination,
+                        _self->_scheduler._renderOffset, _self->_scheduler._renderLength);
+        return;
+    }
+
+    panner->pan(r, azimuth, elevation,
                   *source, *destination,
                   _self->_scheduler._renderOffset, _self->_scheduler._renderLength);
 
@@ -283,8 +325,9 @@ void PannerNode::process(ContextRenderLock & r, int bufferSize)
 void PannerNode::reset(ContextRenderLock &)
 {
     m_lastGain = -1.0;  // force to snap to initial gain
-    if (m_panner.get())
-        m_panner->reset();
+    RenderHandoff<Panner>::Use panner(m_panners->handoff);
+    if (panner)
+        panner->reset();
 }
 
 PanningModel PannerNode::panningModel() const
@@ -299,25 +342,25 @@ void PannerNode::setPanningModel(PanningModel model)
 
     ASSERT(m_sampleRate);
 
-    PanningModel curr = static_cast<PanningModel>(m_panningModel->valueUint32());
-    if (!m_panner.get() || model != curr)
-    {
-        m_panningModel->setUint32(static_cast<uint32_t>(model));
+    m_panningModel->setUint32(static_cast<uint32_t>(model), false);
 
-        switch (model)
-        {
-            case PanningModel::EQUALPOWER:
-                m_panner = std::unique_ptr<Panner>(new EqualPowerPanner(m_sampleRate));
-                break;
-            case PanningModel::HRTF:
-                //m_panner = std::unique_ptr<Panner>(new HRTFPanner(m_sampleRate));
-                m_panner.reset(nullptr);    // release the old one
-                // @TODO setting the panner is not thread safe.
-                // all of this should be part of the processing graph pre-render step.
-                break;
-            default:
-                throw std::invalid_argument("invalid panning model");
-        }
+    // The render thread keeps the previous panner until the new one is handed to it. An
+    // HRTF panner needs the context's renderer, and is made by prepare().
+    std::lock_guard<std::mutex> lock(m_panners->mutex);
+    const std::shared_ptr<Panner> & panner = m_panners->handoff.current();
+    if (panner && panner->panningModel() == model)
+        return;
+
+    switch (model)
+    {
+        case PanningModel::EQUALPOWER:
+            m_panners->handoff.publish(std::make_shared<EqualPowerPanner>(m_sampleRate));
+            break;
+        case PanningModel::HRTF:
+            m_panners->handoff.publish(nullptr);
+            break;
+        default:
+            throw std::invalid_argument("invalid panning model");
     }
 }
 
@@ -597,11 +640,13 @@ void PannerNode::setConeOuterGain(float angle)
 
 double PannerNode::tailTime(ContextRenderLock & r) const
 {
-    return m_panner ? m_panner->tailTime(r) : 0;
+    RenderHandoff<Panner>::Use panner(m_panners->handoff);
+    return panner ? panner->tailTime(r) : 0;
 }
 double PannerNode::latencyTime(ContextRenderLock & r) const
 {
-    return m_panner ? m_panner->latencyTime(r) : 0;
+    RenderHandoff<Panner>::Use panner(m_panners->handoff);
+    return panner ? panner->latencyTime(r) : 0;
 }
 
 }  // namespace lab
@@ -14,6 +14,9 @@
 #include <cmath>
 #include <exception>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 // The number of bands per octave.  Each octave will have this many entries in the wave tables.
 const unsigned kNumberOfOctaveBands = 3;
@@ -29,6 +32,47 @@ namespace lab
 
 using namespace VectorMath;
 
+namespace
+{
+    struct BasicWaveRegistry
+    {
+        std::mutex mutex;
+        std::map<std::tuple<float, int>, std::shared_ptr<PeriodicWave>> waves;
+    };
+
+    // leaked, so that waves may outlive static destruction
+    BasicWaveRegistry & basicWaveRegistry()
+    {
+        static BasicWaveRegistry * registry = new BasicWaveRegistry;
+        return *registry;
+    }
+}
+
+std::shared_ptr<PeriodicWave> PeriodicWave::acquire(float sampleRate, OscillatorType basicWaveform)
+{
+    if (sampleRate <= 0)
+        return nullptr;
+
+    switch (basicWaveform)
+    {
+        case OscillatorType::SINE:
+        case OscillatorType::SQUARE:
+        case OscillatorType::SAWTOOTH:
+        case OscillatorType::FALLING_SAWTOOTH:
+        case OscillatorType::TRIANGLE:
+            break;
+        default:
+            return nullptr;
+    }
+
+    BasicWaveRegistry & registry = basicWaveRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::shared_ptr<PeriodicWave> & wave = registry.waves[std::make_tuple(sampleRate, static_cast<int>(basicWaveform))];
+    if (!wave)
+        wave = std::make_shared<PeriodicWave>(sampleRate, basicWaveform);
+    return wave;
+}
+
 PeriodicWave::PeriodicWave(const float sampleRate, OscillatorType basicWaveform)
     : m_centsPerRange(CentsPerRange)
     , m_sampleRate(sampleRate)
@@ -84,7 +128,7 @@ unsigned PeriodicWave::periodicWaveSize() const
     return kMaxPeriodicWaveSize;
 }
 
-void PeriodicWave::waveDataForFundamentalFrequency(float fundamentalFrequency, float *& lowerWaveData, float *& higherWaveData, float & tableInterpolationFactor)
+void PeriodicWave::waveDataForFundamentalFrequency(float fundamentalFrequency, const float *& lowerWaveData, const float *& higherWaveData, float & tableInterpolationFactor) const
 {
     // Negative frequencies are allowed, in which case we alias to the positive frequency.
     fundamentalFrequency = std::abs(fundamentalFrequency);
@@ -177,8 +221,8 @@ void PeriodicWave::createBandLimitedTables(const float * realData, const float *
         realP[0] = 0;
         imagP[0] = 0;
 
-        // Create the band-limited table.
-        m_bandLimitedTables.push_back(std::unique_ptr<lab::AudioFloatArray>(new lab::AudioFloatArray(periodicWaveSize())));
+        // Create the band-limited table, and the frame that follows it.
+        m_bandLimitedTables.push_back(std::unique_ptr<lab::AudioFloatArray>(new lab::AudioFloatArray(periodicWaveSize() + 1)));
 
         // Apply an inverse FFT to generate the time-domain table data.
         float * data = m_bandLimitedTables[rangeIndex]->data();
@@ -196,6 +240,7 @@ void PeriodicWave::createBandLimitedTables(const float * realData, const float *
 
         // Apply normalization scale.
         vsmul(data, 1, &normalizationScale, data, 1, fftSize);
+        data[fftSize] = data[0];
     }
 }
 
@@ -254,6 +299,10 @@ void PeriodicWave::generateBasicWaveform(OscillatorType shape)
                 //      = (2/(n*pi))*(-1)^(n+1)
                 b = piFactor * ((n & 1) ? 1 : -1);
                 break;
+            case OscillatorType::FALLING_SAWTOOTH:
+                // The sawtooth, inverted.
+                b = piFactor * ((n & 1) ? -1 : 1);
+                break;
             case OscillatorType::TRIANGLE:
                 // Triangle-shaped waveform going from 0 at time 0 to 1 at time pi/2 and back to 0 at
                 // time pi.
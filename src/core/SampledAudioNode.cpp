@@ -14,9 +14,9 @@
 #include "LabSound/extended/VectorMath.h"
 
 #include "internal/Assertions.h"
+#include "internal/Resampler.h"
 
 #include "concurrentqueue/concurrentqueue.h"
-#include "libsamplerate/include/samplerate.h"
 
 using namespace lab;
 
@@ -29,24 +29,8 @@ namespace lab {
     * start/stop(when)
      */
 
-    struct SRC_Resampler
-    {
-        SRC_STATE* sampler = nullptr;
-        SRC_DATA data;
-
-        SRC_Resampler() = delete;
-        SRC_Resampler(SRC_STATE* s) : sampler(s) 
-        {
-            memset(&data, 0, sizeof(data));
-        }
-
-        ~SRC_Resampler()
-        {
-            if (sampler)
-                src_delete(sampler);
-        }
-    };
-
+    // a schedule resamples at most this many source channels
+    static const int MaxResampledChannels = 32;
 
     struct SampledAudioNode::Scheduled
     {
@@ -56,7 +40,8 @@ namespace lab {
         int32_t cursor;
         int loopCount;        // -1 means forever, 0 means play once, 1 means repeat once -2 is a sentinel value meaning clear the schedule
         std::shared_ptr<AudioBus> sourceBus;
-        std::vector<std::shared_ptr<SRC_Resampler>> resampler; // there is one resampler per source channel
+        uint32_t fraction = 0;  // the cursor's fraction of a frame, in units of 2^-32, when resampling
+        bool looped = false;    // a pass of the loop has played
     };
 
     struct SampledAudioNode::Internals
@@ -65,6 +50,7 @@ namespace lab {
         : greatest_cursor(-1)
         , ac(ac_.audioContextInterface())
         {
+            scheduled.reserve(16);
         }
         ~Internals() = default;
         moodycamel::ConcurrentQueue<Scheduled> incoming;
@@ -78,8 +64,14 @@ namespace lab {
         {"playbackRate", "RATE",  1.0, 0.0, 1024.},
         {"detune",       "DTUNE", 0.0, 0.0, 1200.},
         {"dopplerRate",  "DPLR",  1.0, 0.0, 1200.}, nullptr};
+    static char const * const s_qualities[] = {
+        "Linear", "Cubic", "Sinc16", "Sinc32", "Sinc64", nullptr};
     static AudioSettingDescriptor s_saSettings[] = {
-        {"sourceBus", "SBUS", SettingType::Bus}, nullptr};
+        {"sourceBus", "SBUS", SettingType::Bus},
+        {"quality",   "QUAL", SettingType::Enum, s_qualities}, nullptr};
+
+    static_assert(SampledAudioNode::RESAMPLE_SINC64 == static_cast<int>(Resampler::Sinc64),
+                  "the resampling qualities must match the resampler's");
     
     AudioNodeDescriptor * SampledAudioNode::desc()
     {
@@ -95,6 +87,13 @@ namespace lab {
         m_playbackRate = param("playbackRate");
         m_detune = param("detune");
         m_dopplerRate = param("dopplerRate");
+        m_quality = setting("quality");
+
+        // the resampler's tables are computed by the thread choosing the quality
+        m_quality->setValueChanged([this]() {
+            Resampler::prepare(static_cast<Resampler::Quality>(m_quality->valueUint32()));
+        });
+        setQuality(RESAMPLE_SINC16);
 
         m_sourceBus->setValueChanged([this]() {
             this->_internals->bus_setting_updated = true;
@@ -316,14 +315,15 @@ namespace lab {
         ASSERT(dstChannelCount == srcChannelCount);
 
         float* buffer = dstBus->channel(0)->mutableData();
+        const int quantum = static_cast<int>(frameSize);
         float rate = totalPitchRate(r);
-        if (fabsf(rate - 1.f) < 1e-3f)
+        if (fabsf(rate - 1.f) < 1e-3f && !schedule.fraction)
         {
             // no pitch modification
             int write_index = (int) destinationSampleOffset;
-            while (write_index < AudioNode::ProcessingSizeInFrames)
+            while (write_index < quantum)
             {
-                int count = AudioNode::ProcessingSizeInFrames - write_index;
+                int count = quantum - write_index;
                 int remainder = schedule.grain_end - schedule.cursor;
                 bool ending = remainder < count;
                 count = std::min(count, remainder);
@@ -342,6 +342,7 @@ namespace lab {
                 if (ending)
                 {
                     schedule.cursor = schedule.grain_start; // reset to start
+                    schedule.looped = true;
 
                     if (schedule.loopCount > 0)
                         schedule.loopCount--;
@@ -357,93 +358,65 @@ namespace lab {
                 }
             }
         }
-        else
+        else if (srcChannelCount <= MaxResampledChannels)
         {
-            while (schedule.resampler.size() < srcBus->numberOfChannels())
+            // pitch modification
+            if (schedule.grain_end <= schedule.grain_start)
             {
-                // samplers are expensive to allocate, so if there's one to recycle, use it
-                if (_resamplers.size())
-                {
-                    auto resampler = _resamplers.back();
-                    schedule.resampler.push_back(resampler);
-                    _resamplers.pop_back();
-                    src_reset(resampler->sampler);
-                    memset(&resampler->data, 0, sizeof(resampler->data));
-                }
-                else
-                {
-                    int err = 0;
-                    schedule.resampler.push_back(std::make_shared<SRC_Resampler>(src_new(SRC_LINEAR, 1, &err)));
-                }
+                schedule.loopCount = -3;    // nothing to play, so retire the schedule
+                return true;
             }
-            if (schedule.resampler.size() >= srcBus->numberOfChannels())
+
+            const Resampler::Quality quality = static_cast<Resampler::Quality>(m_quality->valueUint32());
+            const float* channels[MaxResampledChannels];
+            float* dests[MaxResampledChannels];
+            for (int i = 0; i < srcChannelCount; ++i)
+                channels[i] = srcBus->channel(i)->data();
+
+            int write_index = (int) destinationSampleOffset;
+            while (write_index < quantum)
             {
-                // pitch modification
-                int write_index = (int) destinationSampleOffset;
-                while (write_index < AudioNode::ProcessingSizeInFrames)
+                // the filters read across the seam of a loop, into the passes on either side of it
+                Resampler::Region region;
+                region.channels = channels;
+                region.channelCount = static_cast<int>(srcChannelCount);
+                region.start = schedule.grain_start;
+                region.end = schedule.grain_end;
+                region.wrapsBeforeStart = schedule.looped;
+                region.wrapsAfterEnd = schedule.loopCount != 0;
+
+                for (int i = 0; i < srcChannelCount; ++i)
+                    dests[i] = dstBus->channel(i)->mutableData() + write_index;
+
+                Resampler::Position position;
+                position.frame = schedule.cursor;
+                position.fraction = schedule.fraction;
+                write_index += Resampler::process(quality, region, position, rate, dests, quantum - write_index);
+                schedule.cursor = position.frame;
+                schedule.fraction = position.fraction;
+
+                if (schedule.cursor >= schedule.grain_end)
                 {
-                    int count = AudioNode::ProcessingSizeInFrames - write_index;
-                    int remainder = schedule.grain_end - schedule.cursor;
-                    bool ending = remainder < count;
+                    // the position's overshoot carries into the next pass, so that a loop keeps its period
+                    schedule.cursor = schedule.grain_start + (schedule.cursor - schedule.grain_end) % (schedule.grain_end - schedule.grain_start);
+                    schedule.looped = true;
 
-                    int src_increment = 0;
-                    int dst_increment = 0;
-                    for (int i = 0; i < srcChannelCount; ++i)
+                    if (schedule.loopCount > 0)
+                        schedule.loopCount--;
+                    else if (schedule.loopCount < 0)
                     {
-                        SRC_DATA* src_data = &schedule.resampler[i]->data;
-                        float* buffer = dstBus->channel(i)->mutableData();
-
-                        src_data->data_in = srcBus->channel(i)->data() + schedule.cursor;
-                        src_data->input_frames = remainder;
-                        std::array<float, AudioNode::ProcessingSizeInFrames> buff;
-                        src_data->data_out = buff.data();
-                        src_data->output_frames = AudioNode::ProcessingSizeInFrames;
-                        src_data->src_ratio = 1. / rate;
-                        src_data->end_of_input = ending ? 1 : 0;
-                        src_process(schedule.resampler[i]->sampler, src_data);
-                        VectorMath::vadd(buff.data(), 1, buffer + write_index, 1, buffer + write_index, 1, count);
-                        src_increment = static_cast<int>(src_data->input_frames_used);
-                        dst_increment = static_cast<int>(src_data->output_frames_gen);
+                        // infinite looping, nothing to do
                     }
-                    schedule.cursor += src_increment;
-                    write_index += dst_increment;
-
-                    ending |= (src_increment == 0) || (dst_increment == 0);
-
-                    if (ending)
+                    else
                     {
-                        if (write_index < AudioNode::ProcessingSizeInFrames) {
-                            // if the buffer didn't fully fill the buffer, at the end, zero out the remainder
-                            /// @TODO should lerp the end value to zero over a 10ms tail period.
-                            /// Going to assume the source data doesn't end with a non-zero value for now.
-                            for (int i = 0; i < srcChannelCount; ++i)
-                            {
-                                SRC_DATA * src_data = &schedule.resampler[i]->data;
-                                float* buffer = dstBus->channel(i)->mutableData();
-                                for (int j = write_index; j < AudioNode::ProcessingSizeInFrames; ++j)
-                                    buffer[j] = 0.f;
-                            }
-                        }
-
-                        schedule.cursor = schedule.grain_start; // reset to start
-
-                        if (schedule.loopCount > 0)
-                            schedule.loopCount--;
-                        else if (schedule.loopCount < 0)
-                        {
-                            // infinite looping, nothing to do
-                        }
-                        else
-                        {
-                            schedule.loopCount = -3;    // signal retirement of the schedule
-                            break;                      // and stop the write loop
-                        }
+                        schedule.loopCount = -3;    // signal retirement of the schedule
+                        break;                      // and stop the write loop
                     }
                 }
             }
         }
 
-        //r.context()->appendDebugBuffer(dstBus, 0, AudioNode::ProcessingSizeInFrames);
+        //r.context()->appendDebugBuffer(dstBus, 0, quantum);
         dstBus->clearSilentFlag();
         return true;
     }
@@ -518,10 +491,9 @@ namespace lab {
             dstBus = output(0)->bus(r);
         }
 
-        // compute the frame timing in samples and seconds
-        uint64_t quantumStartFrame = r.context()->currentSampleFrame();
-        uint64_t quantumEndFrame = quantumStartFrame + AudioNode::ProcessingSizeInFrames;
-        double quantumDuration = static_cast<double>(AudioNode::ProcessingSizeInFrames) / r.context()->sampleRate();
+        // compute the quantum timing in seconds
+        const int quantum = r.context()->renderQuantumSize();
+        double quantumDuration = static_cast<double>(quantum) / r.context()->sampleRate();
         double quantumStartTime = r.context()->currentTime();
         double quantumEndTime = quantumStartTime + quantumDuration;
 
@@ -532,7 +504,7 @@ namespace lab {
             if (s.when < quantumDuration)   // has s.when counted down to within this quantum?
             {
                 int32_t offset = (s.when < quantumStartTime) ? 0 : static_cast<int32_t>(s.when * r.context()->sampleRate());
-                renderSample(r, s, (size_t) offset, AudioNode::ProcessingSizeInFrames);
+                renderSample(r, s, (size_t) offset, quantum);
                 output(0)->bus(r)->clearSilentFlag();
                 if (s.cursor > _internals->greatest_cursor)
                     _internals->greatest_cursor = s.cursor;
@@ -548,12 +520,6 @@ namespace lab {
             Scheduled& s = _internals->scheduled.at(i);
             if (s.loopCount < -1)
             {
-                while (s.resampler.size())
-                {
-                    _resamplers.push_back(s.resampler.back()); // resamplers are expensive to construct, so cache them
-                    s.resampler.pop_back();
-                }
-
                 if (schedule_count - 1 > i)
                     _internals->scheduled.at(i) = _internals->scheduled.at(schedule_count - 1);
                 _internals->scheduled.pop_back();
@@ -565,6 +531,16 @@ namespace lab {
         }
     }
 
+    SampledAudioNode::ResamplingQuality SampledAudioNode::quality() const
+    {
+        return static_cast<ResamplingQuality>(m_quality->valueUint32());
+    }
+
+    void SampledAudioNode::setQuality(ResamplingQuality quality)
+    {
+        m_quality->setEnumeration(static_cast<int>(quality));
+    }
+
     int32_t SampledAudioNode::getCursor() const
     {
         return _internals->greatest_cursor;
@@ -253,7 +253,7 @@ AudioNodeDescriptor * StereoPannerNode::desc()
 StereoPannerNode::StereoPannerNode(AudioContext& ac)
     : AudioNode(ac, *desc())
 {
-    m_sampleAccuratePanValues.reset(new AudioFloatArray(AudioNode::ProcessingSizeInFrames));
+    m_sampleAccuratePanValues.reset(new AudioFloatArray(ac.renderQuantumSize()));
 
     addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
 
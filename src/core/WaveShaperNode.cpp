@@ -16,6 +16,7 @@
 namespace lab {
 struct OverSamplingArrays
 {
+    int m_renderQuantumSize;
     std::shared_ptr<AudioFloatArray> m_tempBuffer;
     std::shared_ptr<AudioFloatArray> m_tempBuffer2;
     std::shared_ptr<UpSampler> m_upSampler;
@@ -24,10 +25,10 @@ struct OverSamplingArrays
     std::shared_ptr<DownSampler> m_downSampler2;
 };
 
-static void* createOversamplingArrays()
+static void* createOversamplingArrays(int renderQuantumSize)
 {
     struct OverSamplingArrays * osa = new struct OverSamplingArrays;
-    int renderQuantumSize = 128;  // from https://www.w3.org/TR/webaudio/#render-quantum-size
+    osa->m_renderQuantumSize = renderQuantumSize;
     osa->m_tempBuffer = std::make_shared<AudioFloatArray>(renderQuantumSize * 2);
     osa->m_tempBuffer2 = std::make_shared<AudioFloatArray>(renderQuantumSize * 4);
     osa->m_upSampler = std::make_shared<UpSampler>(renderQuantumSize);
@@ -101,6 +102,12 @@ void WaveShaperNode::processCurve(const float* source, float* destination, int f
 void WaveShaperNode::processCurve2x(const float * source, float * destination, int framesToProcess)
 {
     OverSamplingArrays * osa = (OverSamplingArrays *) m_oversamplingArrays;
+    if (framesToProcess != osa->m_renderQuantumSize)
+    {
+        // the samplers process whole quanta
+        processCurve(source, destination, framesToProcess);
+        return;
+    }
     
     auto hold_buffer_pointer = osa->m_tempBuffer;
     auto hold_sampler = osa->m_upSampler;
@@ -117,6 +124,12 @@ void WaveShaperNode::processCurve2x(const float * source, float * destination, i
 void WaveShaperNode::processCurve4x(const float * source, float * destination, int framesToProcess)
 {
     OverSamplingArrays * osa = (OverSamplingArrays *) m_oversamplingArrays;
+    if (framesToProcess != osa->m_renderQuantumSize)
+    {
+        // the samplers process whole quanta
+        processCurve(source, destination, framesToProcess);
+        return;
+    }
 
     auto hold_buffer_pointer = osa->m_tempBuffer;
     auto hold_buffer_pointer2 = osa->m_tempBuffer2;
@@ -169,7 +182,7 @@ void WaveShaperNode::process(ContextRenderLock & r, int bufferSize)
         destinationBus = output(0)->bus(r);
     }
     if (m_oversample != OverSampleType::NONE && !m_oversamplingArrays)
-         m_oversamplingArrays = createOversamplingArrays();
+         m_oversamplingArrays = createOversamplingArrays(renderQuantumSize());
 
     for (int i = 0; i < srcChannelCount; ++i)
     {
@@ -42,9 +42,9 @@ namespace lab
         struct LerpTarget { float t, dvdt; };
         std:: deque<LerpTarget> _lerp;
 
-        ADSRNodeImpl() : AudioProcessor()
+        explicit ADSRNodeImpl(int renderQuantumSize) : AudioProcessor()
         {
-            envelope.reserve(AudioNode::ProcessingSizeInFrames * 4);
+            envelope.reserve(renderQuantumSize * 4);
         }
 
         virtual ~ADSRNodeImpl() {}
@@ -187,7 +187,7 @@ namespace lab
 
     ADSRNode::ADSRNode(AudioContext& ac) 
         : AudioNode(ac, *desc())
-        , adsr_impl(new ADSRNodeImpl)
+        , adsr_impl(new ADSRNodeImpl(ac.renderQuantumSize()))
     {
         addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
         
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/extended/AmbisonicDecoderNode.h"
+
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioContext.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+
+#include "LabSound/extended/AudioContextLock.h"
+
+#include "internal/Ambisonics.h"
+#include "internal/HRTFDatabase.h"
+#include "internal/JobQueue.h"
+
+#include <atomic>
+
+namespace lab
+{
+
+// Decoders are handed to and from the render thread through atomics, so that it neither
+// waits nor frees one.
+struct AmbisonicDecoderNode::Preparation
+{
+    ~Preparation()
+    {
+        delete pending.load();
+        delete retired.load();
+    }
+
+    std::atomic<AmbisonicBinauralDecoder *> pending {nullptr};  // prepared, and not yet picked up
+    std::atomic<AmbisonicBinauralDecoder *> retired {nullptr};  // replaced, and not yet released
+    std::atomic<uint64_t> requested {0};  // the most recent preparation asked for
+};
+
+AudioNodeDescriptor * AmbisonicDecoderNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr, 2};
+    return &d;
+}
+
+AmbisonicDecoderNode::AmbisonicDecoderNode(AudioContext & ac)
+: AudioNode(ac, *desc())
+, m_inputOrder(Ambisonics::MinOrder)
+, m_preparation(std::make_shared<Preparation>())
+{
+    addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
+
+    // The input has as many channels as the encoders connected to it, and they are
+    // summed channel by channel.
+    _self->m_channelCount = Ambisonics::channelCount(Ambisonics::MinOrder);
+    _self->m_channelCountMode = ChannelCountMode::Max;
+    _self->m_channelInterpretation = ChannelInterpretation::Discrete;
+
+    m_sources.reserve(Ambisonics::MaxChannelCount);
+
+    initialize();
+
+    // start on the decoder for the smallest order, if the database has already loaded
+    prepare(ac);
+}
+
+AmbisonicDecoderNode::~AmbisonicDecoderNode()
+{
+    uninitialize();
+}
+
+bool AmbisonicDecoderNode::prepare(AudioContext & ac)
+{
+    delete m_preparation->retired.exchange(nullptr);
+
+    // A decoder is prepared for the order of the input, once the database has loaded;
+    // until then, the decoder of another order, if any, decodes the channels they share.
+    const int order = m_inputOrder;
+    auto loader = ac.hrtfDatabaseLoader();
+    const HRTFDatabase * database = loader ? loader->database() : nullptr;
+    if (database && database->files_found_and_loaded() && (loader != m_requestedLoader || order != m_requestedOrder))
+        prepareDecoder(loader, order);
+
+    // the input's order, and the database, may change
+    return true;
+}
+
+void AmbisonicDecoderNode::prepareDecoder(std::shared_ptr<HRTFDatabaseLoader> loader, int order)
+{
+    m_requestedLoader = loader;
+    m_requestedOrder = order;
+
+    // The job holds the database's loader and the preparation, but not the node, which
+    // may be destroyed before the job runs.
+    std::shared_ptr<Preparation> preparation = m_preparation;
+    const uint64_t generation = ++preparation->requested;
+    const int quantum = renderQuantumSize();
+    JobQueue::shared().post([loader, preparation, generation, order, quantum]() {
+        // a newer request supersedes this one
+        if (generation != preparation->requested)
+            return;
+
+        // replaces, and releases, a decoder the render thread never picked up
+        auto decoder = new AmbisonicBinauralDecoder(*loader->database(), order, quantum);
+        delete preparation->pending.exchange(decoder);
+    });
+}
+
+void AmbisonicDecoderNode::process(ContextRenderLock & r, int bufferSize)
+{
+    // A prepared decoder is picked up once the one it replaces, if any, can be retired
+    // to be released by prepare(), off the render thread.
+    if (!m_preparation->retired.load())
+    {
+        if (AmbisonicBinauralDecoder * decoder = m_preparation->pending.exchange(nullptr))
+        {
+            m_preparation->retired = m_decoder.release();
+            m_decoder.reset(decoder);
+        }
+    }
+
+    AudioBus * destination = output(0)->bus(r);
+    AudioBus * source = input(0)->bus(r);
+    if (!isInitialized() || !input(0)->isConnected() || !source)
+    {
+        destination->zero();
+        return;
+    }
+
+    // prepare() starts on a decoder for the input's order
+    const int inputChannels = static_cast<int>(source->numberOfChannels());
+    if (const int order = Ambisonics::orderForChannelCount(inputChannels))
+        m_inputOrder.store(order, std::memory_order_relaxed);
+
+    if (!m_decoder)
+    {
+        destination->zero();
+        return;
+    }
+
+    // Silent channels are passed as null, and cost the convolver nothing once their
+    // silence has passed through it.
+    const int channels = m_decoder->channelCount();
+    m_sources.resize(channels);
+    for (int i = 0; i < channels; ++i)
+    {
+        const AudioChannel * channel = i < inputChannels ? source->channel(i) : nullptr;
+        m_sources[i] = channel && !channel->isSilent() ? channel->data() : nullptr;
+    }
+
+    float * dests[2] = {destination->channel(0)->mutableData(), destination->channel(1)->mutableData()};
+    m_decoder->process(m_sources.data(), dests, bufferSize);
+}
+
+void AmbisonicDecoderNode::reset(ContextRenderLock &)
+{
+    if (m_decoder)
+        m_decoder->reset();
+}
+
+double AmbisonicDecoderNode::tailTime(ContextRenderLock & r) const
+{
+    return m_decoder ? m_decoder->responseLength() / static_cast<double>(r.context()->sampleRate()) : 0;
+}
+
+}  // namespace lab
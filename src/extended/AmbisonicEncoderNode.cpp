@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/extended/AmbisonicEncoderNode.h"
+
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioSetting.h"
+
+#include "LabSound/extended/AudioContextLock.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include "internal/Ambisonics.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace lab
+{
+
+AudioNodeDescriptor * AmbisonicEncoderNode::desc()
+{
+    // the panner's params and settings, and the order
+    static std::vector<AudioSettingDescriptor> s_settings = []() {
+        std::vector<AudioSettingDescriptor> settings;
+        for (AudioSettingDescriptor const * i = PannerNode::desc()->settings; i->name; ++i)
+            settings.push_back(*i);
+        settings.push_back({"order", "ORDR", SettingType::Integer});
+        settings.push_back({nullptr, nullptr});
+        return settings;
+    }();
+    static AudioNodeDescriptor d {PannerNode::desc()->params, s_settings.data(), Ambisonics::channelCount(Ambisonics::MinOrder)};
+    return &d;
+}
+
+AmbisonicEncoderNode::AmbisonicEncoderNode(AudioContext & ac)
+: PannerNode(ac, *desc())
+{
+    m_order = setting("order");
+    m_order->setUint32(Ambisonics::MinOrder);
+
+    // The input is mixed down to mono.
+    _self->m_channelCount = 1;
+    _self->m_channelCountMode = ChannelCountMode::Explicit;
+    _self->m_channelInterpretation = ChannelInterpretation::Speakers;
+}
+
+int AmbisonicEncoderNode::order() const
+{
+    return static_cast<int>(m_order->valueUint32());
+}
+
+void AmbisonicEncoderNode::setOrder(int order)
+{
+    order = std::min(std::max(order, static_cast<int>(Ambisonics::MinOrder)), static_cast<int>(Ambisonics::MaxOrder));
+    m_order->setUint32(static_cast<uint32_t>(order));
+}
+
+void AmbisonicEncoderNode::process(ContextRenderLock & r, int bufferSize)
+{
+    const int order = std::min(std::max(this->order(), static_cast<int>(Ambisonics::MinOrder)), static_cast<int>(Ambisonics::MaxOrder));
+    const int channels = Ambisonics::channelCount(order);
+
+    AudioBus * destination = output(0)->bus(r);
+    if (static_cast<int>(destination->numberOfChannels()) != channels)
+    {
+        output(0)->setNumberOfChannels(r, channels);
+        destination = output(0)->bus(r);  // set number of channels invalidates the pointer
+    }
+
+    AudioBus * source = input(0)->bus(r);
+    if (!isInitialized() || !input(0)->isConnected() || !source || source->isSilent())
+    {
+        destination->zero();
+        return;
+    }
+
+    // The listener's azimuth is clockwise, and the encoding's counter-clockwise.
+    double azimuth;
+    double elevation;
+    getAzimuthElevation(r, &azimuth, &elevation);
+
+    float gains[Ambisonics::MaxChannelCount];
+    Ambisonics::encodingGains(order, -azimuth, elevation, gains);
+
+    const float totalGain = distanceConeGain(r);
+    for (int i = 0; i < channels; ++i)
+        gains[i] *= totalGain;
+
+    // Snap to the gains at the beginning, and whenever the order changes; otherwise ramp
+    // to them across the quantum.
+    if (m_gainCount != channels)
+    {
+        std::copy(gains, gains + channels, m_gains);
+        m_gainCount = channels;
+    }
+
+    const float * sourceP = source->channel(0)->data();
+    for (int i = 0; i < channels; ++i)
+    {
+        float start = m_gains[i];
+        const float step = (gains[i] - start) / bufferSize;
+        VectorMath::vrampmul(sourceP, 1, &start, &step, destination->channel(i)->mutableData(), 1, bufferSize);
+        m_gains[i] = gains[i];
+    }
+}
+
+void AmbisonicEncoderNode::reset(ContextRenderLock & r)
+{
+    m_gainCount = 0;  // force to snap to the initial gains
+    PannerNode::reset(r);
+}
+
+}  // namespace lab
@@ -8,6 +8,7 @@
 #include "LabSound/core/Mixing.h"
 
 #include "LabSound/extended/AudioFileReader.h"
+#include "LabSound/extended/Logging.h"
 
 #include "libnyquist/Decoders.h"
 
@@ -82,11 +83,11 @@ std::shared_ptr<AudioBus> MakeBusFromFile(const char * filePath, bool mixToMono)
         if (test) {
             fclose(test);
             nyquist_io.Load(audioData, std::string(filePath));
-            printf("Loaded %s\n", filePath);
+            LOG_TRACE("Loaded %s", filePath);
         }
         else {
             delete audioData;
-            printf("could not load %s\n", filePath);
+            LOG_ERROR("could not load %s", filePath);
             return {};
         }
     }
@@ -10,6 +10,7 @@
 #include "LabSound/core/WindowFunctions.h"
 
 #include "LabSound/extended/AudioContextLock.h"
+#include "LabSound/extended/Logging.h"
 #include "LabSound/extended/Util.h"
 
 #include "internal/Assertions.h"
@@ -62,6 +63,8 @@ GranulationNode::GranulationNode(AudioContext & ac)
     // How fast the grain should play, given as a multiplier. Useful for pitch-shifting effects.
     grainPlaybackFreq = param("PlaybackFrequency");
 
+    grain_sum_buffer.resize(4096);
+
     initialize();
 }
 
@@ -97,13 +100,12 @@ bool GranulationNode::RenderGranulation(ContextRenderLock & r, AudioBus * out_bu
 
     float * mono_destination = out_bus->channel(0)->mutableData();
 
-    // @fixme - this vector
-    std::vector<float> grain_sum_buffer(numberOfFrames, 0.f);
+    std::fill(grain_sum_buffer.begin(), grain_sum_buffer.begin() + numberOfFrames, 0.f);
 
     {
         for (int i = 0; i < grain_pool.size(); ++i)
         {
-            grain_pool[i].tick(grain_sum_buffer.data(), static_cast<int>(grain_sum_buffer.size()));
+            grain_pool[i].tick(grain_sum_buffer.data(), numberOfFrames);
         }
 
         for (int f = 0; f < numberOfFrames; ++f)
@@ -135,12 +137,12 @@ bool GranulationNode::setGrainSource(ContextRenderLock & r, std::shared_ptr<Audi
     // Granulation Settings Sanity Check
     /// @fixme these values should be per sample, not per quantum
     /// -or- they should be settings if they don't vary per sample
-    std::cout << "GranulationNode::WindowFunction    " << s_window_types[windowFunc->valueUint32()] << std::endl;
-    std::cout << "GranulationNode::numGrains         " << numGrains->value() << std::endl;
-    std::cout << "GranulationNode::grainDuration     " << grainDuration->value() << std::endl;
-    std::cout << "GranulationNode::grainPositionMin  " << grainPositionMin->value() << std::endl;
-    std::cout << "GranulationNode::grainPositionMax  " << grainPositionMax->value() << std::endl;
-    std::cout << "GranulationNode::grainPlaybackFreq " << grainPlaybackFreq->value() << std::endl;
+    LOG_TRACE("GranulationNode::WindowFunction    %s", s_window_types[windowFunc->valueUint32()]);
+    LOG_TRACE("GranulationNode::numGrains         %f", numGrains->value());
+    LOG_TRACE("GranulationNode::grainDuration     %f", grainDuration->value());
+    LOG_TRACE("GranulationNode::grainPositionMin  %f", grainPositionMin->value());
+    LOG_TRACE("GranulationNode::grainPositionMax  %f", grainPositionMax->value());
+    LOG_TRACE("GranulationNode::grainPlaybackFreq %f", grainPlaybackFreq->value());
 
     grainSourceBus->setBus(buffer.get());
     output(0)->setNumberOfChannels(r, buffer ? buffer->numberOfChannels() : 0);
@@ -175,7 +177,7 @@ bool GranulationNode::setGrainSource(ContextRenderLock & r, std::shared_ptr<Audi
         /// -or- they should be settings if they don't vary per sample
         const float random_pos_offset = rnd.random_float(grainPositionMin->value(), grainPositionMax->value());
         
-        printf("grain offset %f\n", random_pos_offset);
+        LOG_TRACE("grain offset %f", random_pos_offset);
         
         grain_pool.emplace_back(grain(sample_to_granulate, window_bus, r.context()->sampleRate(), random_pos_offset, grain_duration_seconds, grainPlaybackFreq->value()));
     }
@@ -273,6 +273,16 @@ void LabSoundRegistryInit(lab::NodeRegistry& reg)
             ADSRNode::static_name(), ADSRNode::desc(),
            [](AudioContext& ac)->AudioNode* { return new ADSRNode(ac); },
            [](AudioNode* n) { delete n; });
+
+        reg.Register(
+            AmbisonicDecoderNode::static_name(), AmbisonicDecoderNode::desc(),
+            [](AudioContext & ac) -> AudioNode * { return new AmbisonicDecoderNode(ac); },
+            [](AudioNode * n) { delete n; });
+
+        reg.Register(
+            AmbisonicEncoderNode::static_name(), AmbisonicEncoderNode::desc(),
+            [](AudioContext & ac) -> AudioNode * { return new AmbisonicEncoderNode(ac); },
+            [](AudioNode * n) { delete n; });
         
         reg.Register(
             ClipNode::static_name(), ClipNode::desc(),
@@ -294,6 +304,11 @@ void LabSoundRegistryInit(lab::NodeRegistry& reg)
             [](AudioContext& ac)->AudioNode* { return new GranulationNode(ac); },
             [](AudioNode* n) { delete n; });
         
+        reg.Register(
+            MultiTapDelayNode::static_name(), MultiTapDelayNode::desc(),
+            [](AudioContext & ac) -> AudioNode * { return new MultiTapDelayNode(ac); },
+            [](AudioNode * n) { delete n; });
+
         reg.Register(
             NoiseNode::static_name(), NoiseNode::desc(),
            [](AudioContext& ac)->AudioNode* { return new NoiseNode(ac); },
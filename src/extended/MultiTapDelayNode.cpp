@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/extended/MultiTapDelayNode.h"
+
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioContext.h"
+#include "LabSound/core/AudioProcessor.h"
+
+#include "LabSound/extended/AudioContextLock.h"
+
+#include "internal/AudioUtilities.h"
+#include "internal/MultiTapDelay.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace lab
+{
+
+static AudioParamDescriptor s_mtdParams[] = {
+    {"delayTime0", "DLY0", 0.0, 0.0, 1e6},
+    {"delayTime1", "DLY1", 0.0, 0.0, 1e6},
+    {"delayTime2", "DLY2", 0.0, 0.0, 1e6},
+    {"delayTime3", "DLY3", 0.0, 0.0, 1e6},
+    {"delayTime4", "DLY4", 0.0, 0.0, 1e6},
+    {"delayTime5", "DLY5", 0.0, 0.0, 1e6},
+    {"delayTime6", "DLY6", 0.0, 0.0, 1e6},
+    {"delayTime7", "DLY7", 0.0, 0.0, 1e6},
+    {"gain0",      "GAN0", 1.0, -1e6, 1e6},
+    {"gain1",      "GAN1", 1.0, -1e6, 1e6},
+    {"gain2",      "GAN2", 1.0, -1e6, 1e6},
+    {"gain3",      "GAN3", 1.0, -1e6, 1e6},
+    {"gain4",      "GAN4", 1.0, -1e6, 1e6},
+    {"gain5",      "GAN5", 1.0, -1e6, 1e6},
+    {"gain6",      "GAN6", 1.0, -1e6, 1e6},
+    {"gain7",      "GAN7", 1.0, -1e6, 1e6}, nullptr};
+
+static char const * const s_interpolations[] = {"Linear", "Cubic", "Allpass", nullptr};
+
+static AudioSettingDescriptor s_mtdSettings[] = {
+    {"taps",          "TAPS", SettingType::Integer},
+    {"interpolation", "INTP", SettingType::Enum, s_interpolations}, nullptr};
+
+AudioNodeDescriptor * MultiTapDelayNode::desc()
+{
+    static AudioNodeDescriptor d {s_mtdParams, s_mtdSettings, 1};
+    return &d;
+}
+
+const float SmoothingTimeConstant = 0.020f;  // 20ms, as DelayNode's
+const int kMaxChannels = 32;  // the most an AudioBus can have
+
+class MultiTapDelayNode::MultiTapDelayNodeInternal : public AudioProcessor
+{
+public:
+    MultiTapDelayNodeInternal(float sampleRate, int renderQuantumSize, double maxDelayTime)
+        : AudioProcessor()
+        , m_sampleRate(sampleRate)
+        , m_renderQuantumSize(renderQuantumSize)
+        , m_maxDelayTime(maxDelayTime)
+    {
+    }
+
+    virtual ~MultiTapDelayNodeInternal() {}
+
+    virtual void initialize() override
+    {
+        m_delay.setSmoothingRate(AudioUtilities::discreteTimeConstantForSampleRate(SmoothingTimeConstant, m_sampleRate));
+
+        // every line and tap the render thread could ask for, so that it only chooses how many are in use
+        m_delay.setSize(kMaxChannels, MaxTaps, m_maxDelayTime * m_sampleRate);
+        m_delay.setActive(0, 1);
+        m_sources.resize(kMaxChannels);
+        m_destinations.resize(kMaxChannels);
+        for (auto & delays : m_delays)
+            delays.resize(m_renderQuantumSize);
+        m_initialized = true;
+    }
+
+    virtual void uninitialize() override
+    {
+        m_delay.setSize(0, 0, 0);
+        m_initialized = false;
+    }
+
+    virtual void process(ContextRenderLock & r, const AudioBus * source, AudioBus * destination, int framesToProcess) override
+    {
+        if (!isInitialized())
+        {
+            destination->zero();
+            return;
+        }
+
+        const int channels = std::min(source->numberOfChannels(), destination->numberOfChannels());
+        const int taps = std::max(1, std::min(static_cast<int>(m_taps->valueUint32()), static_cast<int>(MaxTaps)));
+        const float sampleRate = r.context()->sampleRate();
+        if (m_delay.channels() != channels || m_delay.taps() != taps)
+        {
+            // the lines were allocated by initialize(), unless the sample rate wasn't known then
+            if (m_delay.maxDelayFrames() < m_maxDelayTime * sampleRate)
+                m_delay.setSize(kMaxChannels, MaxTaps, m_maxDelayTime * sampleRate);
+            m_delay.setActive(channels, taps);
+        }
+        for (int c = 0; c < channels; ++c)
+        {
+            m_sources[c] = source->channel(c)->data();
+            m_destinations[c] = destination->channel(c)->mutableData();
+        }
+
+        m_delay.setInterpolation(static_cast<MultiTapDelay::Interpolation>(std::min(m_interpolation->valueUint32(), 2u)));
+
+        MultiTapDelay::Tap parameters[MaxTaps];
+        for (int t = 0; t < taps; ++t)
+        {
+            parameters[t].gain = m_gains[t]->value();
+            if (m_delayTimes[t]->hasSampleAccurateValues())
+            {
+                std::vector<float> & delays = m_delays[t];
+                if (delays.size() < static_cast<size_t>(framesToProcess))
+                    delays.resize(framesToProcess);
+                m_delayTimes[t]->calculateSampleAccurateValues(r, delays.data(), framesToProcess);
+                for (int i = 0; i < framesToProcess; ++i)
+                    delays[i] *= sampleRate;
+                parameters[t].delays = delays.data();
+            }
+            else
+                parameters[t].delay = m_delayTimes[t]->value() * sampleRate;
+        }
+
+        m_delay.process(m_sources.data(), m_destinations.data(), framesToProcess, parameters);
+    }
+
+    virtual void reset() override { m_delay.reset(); }
+
+    virtual double tailTime(ContextRenderLock & r) const override { return m_maxDelayTime; }
+    virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
+
+    float m_sampleRate;
+    int m_renderQuantumSize;
+    double m_maxDelayTime;
+
+    MultiTapDelay m_delay;
+    std::vector<const float *> m_sources;
+    std::vector<float *> m_destinations;
+    std::vector<float> m_delays[MaxTaps];
+
+    std::shared_ptr<AudioParam> m_delayTimes[MaxTaps];
+    std::shared_ptr<AudioParam> m_gains[MaxTaps];
+    std::shared_ptr<AudioSetting> m_taps;
+    std::shared_ptr<AudioSetting> m_interpolation;
+};
+
+MultiTapDelayNode::MultiTapDelayNode(AudioContext & ac, double maxDelayTime)
+    : AudioBasicProcessorNode(ac, *desc())
+{
+    if (maxDelayTime < 0)
+        maxDelayTime = 0;
+
+    m_processor.reset(new MultiTapDelayNodeInternal(ac.sampleRate(), ac.renderQuantumSize(), maxDelayTime));
+    internalNode = static_cast<MultiTapDelayNodeInternal *>(m_processor.get());
+
+    for (int t = 0; t < MaxTaps; ++t)
+    {
+        internalNode->m_delayTimes[t] = param(s_mtdParams[t].name);
+        internalNode->m_gains[t] = param(s_mtdParams[MaxTaps + t].name);
+    }
+    internalNode->m_taps = setting("taps");
+    internalNode->m_taps->setUint32(1);
+    internalNode->m_interpolation = setting("interpolation");
+    internalNode->m_interpolation->setEnumeration(INTERPOLATE_LINEAR);
+
+    initialize();
+}
+
+MultiTapDelayNode::~MultiTapDelayNode()
+{
+    uninitialize();
+}
+
+int MultiTapDelayNode::tapCount() const
+{
+    return static_cast<int>(internalNode->m_taps->valueUint32());
+}
+
+void MultiTapDelayNode::setTapCount(int taps)
+{
+    internalNode->m_taps->setUint32(static_cast<uint32_t>(std::max(1, std::min(taps, static_cast<int>(MaxTaps)))));
+}
+
+MultiTapDelayNode::Interpolation MultiTapDelayNode::interpolation() const
+{
+    return static_cast<Interpolation>(internalNode->m_interpolation->valueUint32());
+}
+
+void MultiTapDelayNode::setInterpolation(Interpolation interpolation)
+{
+    internalNode->m_interpolation->setEnumeration(static_cast<int>(interpolation));
+}
+
+std::shared_ptr<AudioParam> MultiTapDelayNode::delayTime(int tap) const
+{
+    return tap >= 0 && tap < MaxTaps ? internalNode->m_delayTimes[tap] : nullptr;
+}
+
+std::shared_ptr<AudioParam> MultiTapDelayNode::gain(int tap) const
+{
+    return tap >= 0 && tap < MaxTaps ? internalNode->m_gains[tap] : nullptr;
+}
+
+double MultiTapDelayNode::maxDelayTime() const
+{
+    return internalNode->m_maxDelayTime;
+}
+
+}  // namespace lab
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/extended/OfflineRenderer.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioContext.h"
+#include "LabSound/core/AudioDevice.h"
+#include "LabSound/extended/Logging.h"
+
+#include "internal/Assertions.h"
+
+#include <algorithm>
+
+namespace lab
+{
+
+//-------------------------------------------
+//   OfflineRenderWavSink
+//-------------------------------------------
+
+namespace
+{
+    template <typename T>
+    void writeLE(std::ofstream & file, T value)
+    {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    const uint16_t kWaveFormatIEEEFloat = 3;
+    const uint32_t kWavHeaderBytes = 44;
+}
+
+OfflineRenderWavSink::OfflineRenderWavSink(const std::string & path)
+    : _path(path)
+{
+}
+
+OfflineRenderWavSink::~OfflineRenderWavSink()
+{
+    end();
+}
+
+bool OfflineRenderWavSink::begin(int channelCount, float sampleRate)
+{
+    _file.open(_path, std::ios::binary | std::ios::trunc);
+    if (!_file.is_open())
+    {
+        LOG_ERROR("OfflineRenderWavSink: failed to open %s for writing", _path.c_str());
+        return false;
+    }
+
+    _channelCount = channelCount;
+    _dataBytes = 0;
+
+    // the sizes are patched by end()
+    const uint32_t rate = static_cast<uint32_t>(sampleRate);
+    const uint16_t blockAlign = static_cast<uint16_t>(channelCount * sizeof(float));
+    _file.write("RIFF", 4);
+    writeLE<uint32_t>(_file, 0);
+    _file.write("WAVE", 4);
+    _file.write("fmt ", 4);
+    writeLE<uint32_t>(_file, 16);
+    writeLE<uint16_t>(_file, kWaveFormatIEEEFloat);
+    writeLE<uint16_t>(_file, static_cast<uint16_t>(channelCount));
+    writeLE<uint32_t>(_file, rate);
+    writeLE<uint32_t>(_file, rate * blockAlign);
+    writeLE<uint16_t>(_file, blockAlign);
+    writeLE<uint16_t>(_file, 32);
+    _file.write("data", 4);
+    writeLE<uint32_t>(_file, 0);
+    return _file.good();
+}
+
+bool OfflineRenderWavSink::write(const AudioBus & bus, int frames)
+{
+    if (!_file.is_open())
+        return false;
+
+    const int channels = std::min(_channelCount, bus.numberOfChannels());
+    _interleaved.assign(static_cast<size_t>(frames) * _channelCount, 0.f);
+    for (int c = 0; c < channels; ++c)
+    {
+        const float * src = bus.channel(c)->data();
+        for (int i = 0; i < frames; ++i)
+            _interleaved[i * _channelCount + c] = src[i];
+    }
+
+    const size_t bytes = _interleaved.size() * sizeof(float);
+    _file.write(reinterpret_cast<const char *>(_interleaved.data()), bytes);
+    _dataBytes += bytes;
+    return _file.good();
+}
+
+void OfflineRenderWavSink::end()
+{
+    if (!_file.is_open())
+        return;
+
+    // RIFF sizes are 32 bits; a longer render is written whole, but only
+    // readers that ignore the header's sizes will see all of it.
+    const uint64_t maxData = 0xffffffffull - (kWavHeaderBytes - 8);
+    if (_dataBytes > maxData)
+        LOG_ERROR("OfflineRenderWavSink: %s exceeds the 4GB WAV limit", _path.c_str());
+
+    const uint32_t dataBytes = static_cast<uint32_t>(std::min(_dataBytes, maxData));
+    _file.seekp(4);
+    writeLE<uint32_t>(_file, dataBytes + kWavHeaderBytes - 8);
+    _file.seekp(kWavHeaderBytes - 4);
+    writeLE<uint32_t>(_file, dataBytes);
+    _file.close();
+}
+
+//-------------------------------------------
+//   OfflineRenderRingBufferSink
+//-------------------------------------------
+
+bool OfflineRenderRingBufferSink::begin(int channelCount, float)
+{
+    _channelCount = channelCount;
+    _cancelled = false;
+    return true;
+}
+
+bool OfflineRenderRingBufferSink::write(const AudioBus & bus, int frames)
+{
+    const size_t count = static_cast<size_t>(frames) * _channelCount;
+    if (count > _ring.getSize())
+    {
+        LOG_ERROR("OfflineRenderRingBufferSink: the ring buffer is smaller than a render block");
+        return false;
+    }
+
+    const int channels = std::min(_channelCount, bus.numberOfChannels());
+    _interleaved.assign(count, 0.f);
+    for (int c = 0; c < channels; ++c)
+    {
+        const float * src = bus.channel(c)->data();
+        for (int i = 0; i < frames; ++i)
+            _interleaved[i * _channelCount + c] = src[i];
+    }
+
+    // the render runs faster than realtime, so wait for the reader rather than drop blocks
+    while (!_ring.write(_interleaved.data(), count))
+    {
+        if (_cancelled)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+//-------------------------------------------
+//   OfflineRenderer
+//-------------------------------------------
+
+OfflineRenderer::OfflineRenderer(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    for (int i = 0; i < threadCount; ++i)
+        _threads.emplace_back(&OfflineRenderer::workerThread, this);
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shouldRun = false;
+    }
+    _jobReady.notify_all();
+    for (auto & t : _threads)
+        t.join();
+}
+
+std::future<OfflineRenderStats> OfflineRenderer::render(std::shared_ptr<AudioContext> context,
+                                                        std::shared_ptr<OfflineRenderSink> sink,
+                                                        uint64_t framesToProcess)
+{
+    Job job;
+    job.context = std::move(context);
+    job.sink = std::move(sink);
+    job.frames = framesToProcess;
+    std::future<OfflineRenderStats> result = job.result.get_future();
+
+    bool isGood = job.context && job.sink && job.context->isOfflineContext() && job.context->destinationNode();
+    ASSERT(isGood);
+    if (!isGood)
+    {
+        LOG_ERROR("OfflineRenderer: a job needs an offline context with a destination node, and a sink");
+        job.result.set_value(OfflineRenderStats{});
+        return result;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _jobReady.notify_one();
+    return result;
+}
+
+void OfflineRenderer::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _jobsDone.wait(lock, [this]() { return _jobs.empty() && !_inFlight; });
+}
+
+OfflineRenderStats OfflineRenderer::totals() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    OfflineRenderStats totals = _totals;
+    double busy = _busySeconds;
+    if (_inFlight)
+        busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - _busySince).count();
+    totals.framesPerSecond = busy > 0 ? static_cast<double>(totals.frames) / busy : 0;
+    return totals;
+}
+
+void OfflineRenderer::workerThread()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobReady.wait(lock, [this]() { return !_jobs.empty() || !_shouldRun; });
+            if (_jobs.empty())
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+            if (!_inFlight++)
+                _busySince = std::chrono::steady_clock::now();
+        }
+
+        OfflineRenderStats stats;
+        auto start = std::chrono::steady_clock::now();
+        stats.frames = job.context->destinationNode()->offlineRender(*job.sink, job.frames);
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats.framesPerSecond = stats.seconds > 0 ? static_cast<double>(stats.frames) / stats.seconds : 0;
+
+        // release the graph before reporting, so a caller waiting on the job
+        // doesn't race the worker for the last reference to the context
+        job.context.reset();
+        job.sink.reset();
+        job.result.set_value(stats);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _totals.frames += stats.frames;
+            _totals.seconds += stats.seconds;
+            if (!--_inFlight)
+                _busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - _busySince).count();
+        }
+        _jobsDone.notify_all();
+    }
+}
+
+}  // namespace lab
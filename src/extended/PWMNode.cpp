@@ -45,8 +45,11 @@ public:
         if (!source->numberOfChannels() || !destination->numberOfChannels())
             return;
             
-        const float * carrierP = source->channelByType(Channel::Left)->data();
-        const float * modP = source->channelByType(Channel::Right)->data();
+        // a mono source has no modulator, and is passed through
+        const AudioChannel * carrier = source->channelByType(Channel::Left);
+        const AudioChannel * modulator = source->channelByType(Channel::Right);
+        const float * carrierP = carrier ? carrier->data() : nullptr;
+        const float * modP = modulator ? modulator->data() : nullptr;
 
         if (!modP && carrierP)
         {
@@ -1,5 +1,6 @@
 
 #include "LabSound/extended/Registry.h"
+#include "LabSound/extended/Logging.h"
 
 #include <cstdio>
 #include <memory>
@@ -45,7 +46,7 @@ NodeRegistry::~NodeRegistry()
 
 bool NodeRegistry::Register(char const* const name, AudioNodeDescriptor* desc, CreateNodeFn c, DeleteNodeFn d)
 {
-    printf("Registering %s\n", name);
+    LOG_TRACE("Registering %s", name);
     _detail->descriptors[name] = { name, desc, c, d };
     return true;
 }
@@ -11,8 +11,9 @@
 #include "LabSound/extended/SpectralMonitorNode.h"
 #include "LabSound/extended/Registry.h"
 
+#include "internal/FFTFrame.h"
+
 #include <cmath>
-#include <ooura/fftsg.h>
 
 namespace lab
 {
@@ -20,52 +21,19 @@ namespace lab
 using namespace lab;
 
 //////////////////////////////////////////////////////
-// Prviate FFT + SpectralMonitorNode Implementation //
+// Private SpectralMonitorNode Implementation       //
 //////////////////////////////////////////////////////
 
-// FFT class directly inspired by that in Cinder Audio 2.
-struct FFT
-{
-public:
-    FFT(int size)
-        : size(size)
-    {
-        oouraIp = (int *) calloc(2 + (int) sqrt(size / 2), sizeof(int));
-        oouraW = (float *) calloc(size / 2, sizeof(float));
-    }
-
-    ~FFT()
-    {
-        free(oouraIp);
-        free(oouraW);
-    }
-
-    // does an in place transform of waveform to real and imag.
-    // real values are on even, imag on odd
-    void forward(std::vector<float> & waveform)
-    {
-        ooura::rdft(static_cast<int>(size), 1, &waveform[0], oouraIp, oouraW);
-    }
-
-    int size;
-    int * oouraIp;
-    float * oouraW;
-};
-
 class SpectralMonitorNode::SpectralMonitorNodeInternal
 {
 public:
     SpectralMonitorNodeInternal(std::shared_ptr<AudioSetting> windowSize_)
         : windowSize(windowSize_)
-        , fft(nullptr)
     {
         setWindowSize(512);
     }
 
-    ~SpectralMonitorNodeInternal()
-    {
-        delete fft;
-    }
+    ~SpectralMonitorNodeInternal() = default;
 
     void setWindowSize(int s)
     {
@@ -79,8 +47,8 @@ public:
             buffer[i] = 0;
         }
 
-        delete fft;
-        fft = new FFT(s);
+        if (!fft || fft->fftSize() != s)
+            fft.reset(new FFTFrame(s));
     }
 
     float _db;
@@ -92,7 +60,7 @@ public:
 
     std::shared_ptr<AudioSetting> windowSize;
 
-    FFT * fft;
+    std::unique_ptr<FFTFrame> fft;
 };
 
 ////////////////////////////////
@@ -208,22 +176,29 @@ void SpectralMonitorNode::spectralMag(std::vector<float> & result)
         internalNode->setWindowSize(internalNode->windowSize->valueUint32());
     }
 
+    FFTFrame & fft = *internalNode->fft;
+    window.resize(fft.fftSize());
+
     // http://www.ni.com/white-paper/4844/en/
     ApplyWindowFunctionInplace(WindowFunction::blackman, window.data(), static_cast<int>(window.size()));
-    internalNode->fft->forward(window);
+    fft.computeForwardFFT(window.data());
 
     // similar to cinder audio2 Scope object, although Scope smooths spectral samples frame by frame
-    // remove nyquist component - the first imaginary component
-    window[1] = 0.0f;
+    // remove nyquist component - the first imaginary component on Accelerate
+    const float * realP = fft.realData();
+    float * imagP = fft.imagData();
+    imagP[0] = 0.0f;
 
     // compute normalized magnitude spectrum
     /// @TODO @tofix - break this into vector Cartesian -> polar and then vector lowpass. skip lowpass if smoothing factor is very small
     const float kMagScale = 1.0f;  /// detail->windowSize;
-    for (int i = 0; i < window.size(); i += 2)
+    const int bins = fft.fftSize() / 2;
+    window.resize(bins);
+    for (int i = 0; i < bins; ++i)
     {
-        float re = window[i];
-        float im = window[i + 1];
-        window[i / 2] = sqrt(re * re + im * im) * kMagScale;
+        float re = realP[i];
+        float im = imagP[i];
+        window[i] = sqrt(re * re + im * im) * kMagScale;
     }
 
     result.swap(window);
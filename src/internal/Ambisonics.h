@@ -0,0 +1,78 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef Ambisonics_h
+#define Ambisonics_h
+
+#include <memory>
+#include <vector>
+
+namespace lab
+{
+
+class HRTFDatabase;
+class PartitionedConvolver;
+
+// Ambisonic signals are in the AmbiX convention: channels in ACN order, with SN3D
+// normalization. Azimuth is in degrees counter-clockwise from the front, as for the
+// HRTF database, and elevation is in degrees up from the horizontal.
+namespace Ambisonics
+{
+    enum : int
+    {
+        MinOrder = 1,
+        MaxOrder = 3,
+        MaxChannelCount = (MaxOrder + 1) * (MaxOrder + 1)
+    };
+
+    inline int channelCount(int order) { return (order + 1) * (order + 1); }
+
+    // The highest order whose channels all fit in channelCount, or 0 if there are fewer
+    // than a first order signal has.
+    int orderForChannelCount(int channelCount);
+
+    // Writes the channelCount(order) spherical harmonic gains that encode a source in the
+    // direction given.
+    void encodingGains(int order, double azimuth, double elevation, float * gains);
+}
+
+// Decodes an ambisonic signal to the ears, through virtual speakers placed about the
+// listener, each of them rendered with the HRTF database.
+//
+// The speakers' decoding gains and their HRTFs are combined ahead of time into a
+// response for each ambisonic channel and ear, so that decoding costs a convolution per
+// channel and ear however many speakers there are, and however many sources were
+// encoded into the signal. The responses are summed in the frequency domain by a
+// PartitionedConvolver, so there is no latency, and a channel costs one forward
+// transform per block.
+//
+// The gains are found by mode matching: re-encoding the speakers' signals yields the
+// decoded signal. The database has no measurements below -45 degrees, so speakers lower
+// than that are rendered with the HRTFs at -45 degrees.
+class AmbisonicBinauralDecoder
+{
+public:
+    // Builds the responses, which is costly; the database must have loaded.
+    AmbisonicBinauralDecoder(const HRTFDatabase & database, int order, int blockSize);
+    ~AmbisonicBinauralDecoder();
+
+    int order() const { return m_order; }
+    int channelCount() const { return Ambisonics::channelCount(m_order); }
+    int responseLength() const { return m_responseLength; }
+
+    // Decodes exactly blockSize frames of channelCount() sources into the left and right
+    // dests. A null source is silent.
+    void process(const float * const * sources, float * const * dests, int framesToProcess);
+
+    // Clears the signal history.
+    void reset();
+
+private:
+    int m_order;
+    int m_responseLength = 0;
+    std::unique_ptr<PartitionedConvolver> m_convolver;
+};
+
+}  // namespace lab
+
+#endif  // Ambisonics_h
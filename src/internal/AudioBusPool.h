@@ -0,0 +1,53 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef AudioBusPool_h
+#define AudioBusPool_h
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lab
+{
+
+class AudioBus;
+
+// AudioBusPool keeps a stock of zeroed buses for each channel count, so that
+// a node changing its channel count on the render thread can swap buses
+// without allocating or freeing memory. The buses handed back in exchange are
+// recycled, or freed, by service(), which runs on the graph update thread.
+//
+// The render thread only ever try_locks the pool; if the update thread holds
+// it, or there is no stock for the requested channel count, exchange() fails
+// and the miss is remembered so that service() stocks that channel count.
+class AudioBusPool
+{
+public:
+    explicit AudioBusPool(int length);
+    ~AudioBusPool();
+
+    // Render thread. On success bus is replaced by a pooled bus with
+    // numberOfChannels channels, and the previous bus is retired.
+    bool exchange(std::unique_ptr<AudioBus> & bus, int numberOfChannels);
+
+    // Graph update thread. Recycles retired buses and restocks the pool.
+    void service();
+
+private:
+    struct Stock
+    {
+        std::vector<AudioBus *> buses;
+        int target = 0;
+        int misses = 0;
+    };
+
+    const int m_length;
+    std::mutex m_mutex;
+    std::vector<Stock> m_stock;       // indexed by channel count
+    std::vector<AudioBus *> m_retired; // never grows on the render thread
+};
+
+}  // namespace lab
+
+#endif  // AudioBusPool_h
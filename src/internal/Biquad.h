@@ -45,6 +45,9 @@ public:
     // (The zeroes will be the inverse of the poles)
     void setAllpassPole(const std::complex<double> & pole);
 
+    // The normalized coefficients, see below
+    void getCoefficients(double & b0, double & b1, double & b2, double & a1, double & a2) const;
+
     // Resets filter state
     void reset();
 
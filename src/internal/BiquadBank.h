@@ -0,0 +1,129 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef BiquadBank_h
+#define BiquadBank_h
+
+#include "LabSound/core/AudioNode.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace lab
+{
+
+// A cascade of biquad stages on each of a number of lanes, typically the
+// channels of a bus, all processed together. The lanes are blocked into SIMD
+// registers, so a frame of every lane in a block is filtered by one sequence of
+// instructions; the samples are interleaved into a scratch buffer once, run
+// through every stage, and deinterleaved, so a cascade of bands costs little
+// more than the arithmetic. Each stage is in transposed direct form II.
+//
+// Each lane of each stage has its own coefficients. New coefficients may take
+// effect at the first frame processed, or be reached at the last, each
+// coefficient ramping linearly from the old across the frames; the stable
+// region of the denominator coefficients is convex, so a ramp between two
+// stable filters is stable throughout. Ramping over short spans gives sample
+// accurate modulation without designing a filter every frame.
+//
+// The lanes run in single or double precision. Single precision is twice as
+// wide, and is accurate enough for most filters; double precision keeps the
+// poles of filters tuned low in the band, near the unit circle, where they
+// belong.
+class BiquadBank
+{
+public:
+    enum class Precision
+    {
+        Single,
+        Double
+    };
+
+    // The filter is
+    // y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2].
+    struct Coefficients
+    {
+        double b0 = 1;
+        double b1 = 0;
+        double b2 = 0;
+        double a1 = 0;
+        double a2 = 0;
+    };
+
+    // The coefficients of a filter of one of the node's types, as designed by
+    // Biquad. frequency is normalized to the Nyquist frequency; for the low and
+    // high pass filters, Q is the resonance in decibels.
+    static Coefficients design(FilterType type, double frequency, double Q, double dbGain);
+
+    // The response of a cascade of stages at a set of n frequencies,
+    // normalized to the Nyquist frequency. The phase response is in radians.
+    static void getFrequencyResponse(const Coefficients * stages, int stageCount, size_t n,
+                                     const float * frequency, float * magResponse, float * phaseResponse);
+
+    BiquadBank();
+    ~BiquadBank();
+
+    // Allocates for up to lanes lanes and stages stages, in either precision,
+    // processed framesToProcess frames at a time. The filters keep their state.
+    void reserve(int lanes, int stages, int framesToProcess);
+
+    // Sets the number of lanes and of stages; lanes and stages that are new
+    // pass their input through, and those that remain keep their state. Only
+    // allocates beyond what was reserved.
+    void setSize(int lanes, int stages);
+
+    int lanes() const { return m_lanes; }
+    int stages() const { return m_stages; }
+
+    // Changing the precision keeps the filters' state, and doesn't allocate.
+    void setPrecision(Precision);
+    Precision precision() const { return m_precision; }
+
+    // Sets the coefficients of a stage of a lane, or of every lane. They are
+    // used from the next call to process().
+    void setCoefficients(int stage, int lane, const Coefficients &);
+    void setCoefficients(int stage, const Coefficients &);
+    const Coefficients & coefficients(int stage, int lane) const { return m_targets[stage * m_laneCapacity + lane]; }
+
+    // Filters framesToProcess frames of a source for each lane into its
+    // destination; a source may be its destination. If ramp, coefficients set
+    // since the last call are reached at the last frame, otherwise they are
+    // used from the first. Only allocates if more frames are processed than
+    // were reserved.
+    void process(const float * const * sources, float * const * destinations, int framesToProcess, bool ramp);
+
+    // Clears the state of every filter.
+    void reset();
+
+    // The response of the cascade of a lane, see the static form.
+    void getFrequencyResponse(int lane, size_t n, const float * frequency, float * magResponse, float * phaseResponse) const;
+
+private:
+    template <class Lanes, typename T>
+    void processBlocks(std::vector<T> & bank, std::vector<T> & scratch,
+                       const float * const * sources, float * const * destinations, int framesToProcess, bool ramp);
+
+    int m_lanes = 0;
+    int m_stages = 0;
+    int m_laneCapacity = 0;
+    int m_stageCapacity = 0;
+    int m_frameCapacity = 0;
+    Precision m_precision = Precision::Single;
+
+    std::vector<Coefficients> m_targets;  // [stage][lane], as last set, for the reserved lanes
+    bool m_changed = false;
+
+    // For each block of lanes and stage, the coefficients, their steps across
+    // a ramp and the filter state, each a register's width of lanes; in the
+    // precision's type, in m_single or m_double. Both are sized for the
+    // reserved lanes and stages, so the precision can change without
+    // allocating, and the reserved stages set the stride between blocks.
+    std::vector<float> m_single;
+    std::vector<double> m_double;
+    std::vector<float> m_scratchSingle;
+    std::vector<double> m_scratchDouble;
+};
+
+}  // namespace lab
+
+#endif  // BiquadBank_h
@@ -5,20 +5,17 @@
 #ifndef DelayDSPKernel_h
 #define DelayDSPKernel_h
 
-#include "LabSound/core/AudioArray.h"
-
 #include "internal/AudioDSPKernel.h"
-#include "internal/DelayProcessor.h"
+#include "internal/MultiTapDelay.h"
 
 namespace lab
 {
 
-class DelayProcessor;
-
+// A single channel, single tap delay, approaching each delay it is given
+// smoothly.
 class DelayDSPKernel : public AudioDSPKernel
 {
 public:
-    explicit DelayDSPKernel(DelayProcessor *, float sampleRate);
     DelayDSPKernel(double maxDelayTime, float sampleRate);
     virtual ~DelayDSPKernel() {}
 
@@ -27,24 +24,15 @@ public:
 
     double maxDelayTime() const { return m_maxDelayTime; }
 
-    void setDelayFrames(double numberOfFrames) { m_desiredDelayFrames = numberOfFrames; }
+    void setDelayFrames(double numberOfFrames) { m_tap.delay = static_cast<float>(numberOfFrames); }
 
     virtual double tailTime(ContextRenderLock & r) const override;
     virtual double latencyTime(ContextRenderLock & r) const override;
 
 private:
-    AudioFloatArray m_buffer;
+    MultiTapDelay m_delay;
+    MultiTapDelay::Tap m_tap;
     double m_maxDelayTime;
-    int m_writeIndex;
-    double m_currentDelayTime;
-    double m_smoothingRate;
-    bool m_firstTime;
-    double m_desiredDelayFrames;
-
-    AudioFloatArray m_delayTimes;
-
-    DelayProcessor * delayProcessor() { return static_cast<DelayProcessor *>(processor()); }
-    size_t bufferLengthForDelay(double delayTime, double sampleRate) const;
 };
 
 }  // namespace lab
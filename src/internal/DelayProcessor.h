@@ -5,29 +5,51 @@
 #ifndef DelayProcessor_h
 #define DelayProcessor_h
 
+#include "LabSound/core/AudioParam.h"
+#include "LabSound/core/AudioProcessor.h"
 #include "LabSound/core/AudioSetting.h"
 
-#include "internal/AudioDSPKernelProcessor.h"
+#include "internal/MultiTapDelay.h"
+
+#include <vector>
 
 namespace lab
 {
 
-class AudioDSPKernel;
-
-class DelayProcessor : public AudioDSPKernelProcessor
+// Delays every channel by the delay time plus its modulation, through one
+// tap of a MultiTapDelay. A constant delay is approached smoothly; a
+// modulated one is followed sample accurately. The lines are allocated by
+// initialize() for as many channels as a bus can have, so the render thread
+// only has to choose how many of them are in use.
+class DelayProcessor : public AudioProcessor
 {
     std::shared_ptr<AudioSetting> m_delayTime;
+    std::shared_ptr<AudioParam> m_modulation;
     double m_maxDelayTime;
     float m_sampleRate;
+    int m_renderQuantumSize;
+
+    MultiTapDelay m_delay;
+    std::vector<const float *> m_sources;
+    std::vector<float *> m_destinations;
+    std::vector<float> m_delays;
 
 public:
-    DelayProcessor(float sampleRate, double maxDelayTime, std::shared_ptr<AudioSetting> delayTime);
+    DelayProcessor(float sampleRate, int renderQuantumSize, double maxDelayTime, std::shared_ptr<AudioSetting> delayTime, std::shared_ptr<AudioParam> modulation);
 
     virtual ~DelayProcessor();
 
-    virtual AudioDSPKernel * createKernel();
+    // AudioProcessor
+    virtual void initialize() override;
+    virtual void uninitialize() override;
+    virtual void process(ContextRenderLock &, const AudioBus * source, AudioBus * destination, int framesToProcess) override;
+    virtual void reset() override;
+
+    virtual double tailTime(ContextRenderLock & r) const override { return m_maxDelayTime; }
+    virtual double latencyTime(ContextRenderLock & r) const override { return 0; }
 
     std::shared_ptr<AudioSetting> delayTime() const { return m_delayTime; }
+    std::shared_ptr<AudioParam> modulation() const { return m_modulation; }
 
     double maxDelayTime() { return m_maxDelayTime; }
 };
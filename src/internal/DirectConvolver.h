@@ -40,7 +40,8 @@ class DirectConvolver final {
     //WTF_MAKE_FAST_ALLOCATED;
     //WTF_MAKE_NONCOPYABLE(DirectConvolver);
 public:
-    explicit DirectConvolver(size_t inputBlockSize);
+    // maxKernelSize may exceed the block size, for blocks shorter than the kernel.
+    explicit DirectConvolver(size_t inputBlockSize, size_t maxKernelSize = 0);
 
     void process(AudioFloatArray* convolutionKernel, const float* sourceP, float* destP, size_t framesToProcess);
 
@@ -48,6 +49,7 @@ public:
 
 private:
     size_t m_inputBlockSize;
+    size_t m_historySize; // frames kept from earlier blocks
 
     AudioFloatArray m_buffer;
 };
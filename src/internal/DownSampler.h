@@ -54,6 +54,7 @@ private:
     enum { DefaultKernelSize = 256 };
 
     size_t m_inputBlockSize;
+    size_t m_historySize; // of m_inputBuffer, at least half the kernel
 
     // Computes ideal band-limited half-band filter coefficients.
     // In other words, filter out all frequencies higher than 0.25 * Nyquist.
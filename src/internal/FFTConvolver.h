@@ -27,6 +27,9 @@ public:
     // Processing in-place is allowed...
     void process(FFTFrame * fftKernel, const float * sourceP, float * destP, int framesToProcess);
 
+    // As above, with the kernel's spectrum held elsewhere, in FFTFrame's layout
+    void process(const float * kernelReal, const float * kernelImag, const float * sourceP, float * destP, int framesToProcess);
+
     void reset();
 
     int fftSize() const { return m_frame.fftSize(); }
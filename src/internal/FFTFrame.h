@@ -23,8 +23,7 @@
 #endif 
 
 #if defined(USE_KISS_FFT)
-#include <kissfft/kiss_fft.hpp>
-#include <kissfft/kiss_fftr.hpp>
+#include "internal/FFTPlan.h"
 #endif
 
 namespace lab
@@ -46,6 +45,7 @@ public:
     void computeForwardFFT(const float * data);
     void computeInverseFFT(float * data);
     void multiply(const FFTFrame & frame);  // multiplies ourself with frame : effectively operator*=()
+    void multiply(const float * realP2, const float * imagP2);  // likewise, by binCount() bins held elsewhere
 
     float * realData() const;
     float * imagData() const;
@@ -64,6 +64,22 @@ public:
     int fftSize() const { return m_FFTSize; }
     int log2FFTSize() const { return m_log2FFTSize; }
 
+    // The number of complex bins in realData() and imagData(). Bin 0 is combined
+    // component-wise by multiply(); on Accelerate, imagData()[0] holds the Nyquist bin.
+#if USE_ACCELERATE_FFT
+    int binCount() const { return m_FFTSize / 2; }
+#else
+    int binCount() const { return m_FFTSize / 2 + 1; }
+#endif
+
+    // multiply() scales its product by this, compensating for the scaling of the forward
+    // transform; code that multiplies spectra itself must do the same.
+#if USE_ACCELERATE_FFT
+    static float productScale() { return 0.5f; }
+#else
+    static float productScale() { return 1.f; }
+#endif
+
 #if USE_ACCELERATE_FFT
     static void cleanup();
 #endif
@@ -93,16 +109,12 @@ private:
 #endif
 
 #if defined(USE_KISS_FFT)
-    kiss_fftr_cfg mFFT;
-    kiss_fftr_cfg mIFFT;
-
-    kiss_fft_cpx * m_cpxInputData;
-    kiss_fft_cpx * m_cpxOutputData;
-
-    std::vector<kiss_fft_cpx> mOutputBuffer;
+    // shared by every frame of this size; see FFTPlan
+    std::shared_ptr<const FFTPlan> m_plan;
 
     AudioFloatArray m_realData;
     AudioFloatArray m_imagData;
+    AudioFloatArray m_work;
 #endif
 
 };
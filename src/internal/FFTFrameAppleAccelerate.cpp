@@ -10,6 +10,8 @@
 #include "internal/FFTFrame.h"
 #include "LabSound/extended/VectorMath.h"
 
+#include <mutex>
+
 namespace lab
 {
 
@@ -88,13 +90,13 @@ void FFTFrame::cleanup()
 
 void FFTFrame::multiply(const FFTFrame & frame)
 {
-    FFTFrame & frame1 = *this;
-    const FFTFrame & frame2 = frame;
+    multiply(frame.realData(), frame.imagData());
+}
 
-    float * realP1 = frame1.realData();
-    float * imagP1 = frame1.imagData();
-    const float * realP2 = frame2.realData();
-    const float * imagP2 = frame2.imagData();
+void FFTFrame::multiply(const float * realP2, const float * imagP2)
+{
+    float * realP1 = realData();
+    float * imagP1 = imagData();
 
     int halfSize = m_FFTSize / 2;
     float real0 = realP1[0];
@@ -133,6 +135,10 @@ void FFTFrame::computeInverseFFT(float * data)
 
 FFTSetup FFTFrame::fftSetupForSize(int fftSize)
 {
+    // frames may be made on any thread, such as those that load HRTF databases
+    static std::mutex setupMutex;
+    std::lock_guard<std::mutex> lock(setupMutex);
+
     if (!fftSetups)
     {
         fftSetups = (FFTSetup *) malloc(sizeof(FFTSetup) * kMaxFFTPow2Size);
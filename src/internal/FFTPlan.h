@@ -0,0 +1,71 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef FFTPlan_h
+#define FFTPlan_h
+
+#include <memory>
+
+namespace lab
+{
+
+// The real FFT implementations that FFTFrame may use where the platform's own,
+// Accelerate, is not.
+enum class FFTBackend
+{
+    Kiss,      // KissFFT's complex transform of half the size
+    Ooura,     // Ooura's split-radix rdft
+    Stockham,  // radix-4 Stockham autosort on split complex data, four SIMD lanes wide
+};
+
+// A real FFT of one power of two size, by one backend. forward() takes size samples
+// to size / 2 + 1 bins, in separate arrays of real and imaginary parts, and inverse()
+// takes the bins back; neither scales, so inverse(forward(x)) is size * x.
+//
+// A plan holds nothing but constant tables, so there is one per size and backend,
+// made on first use and kept for the life of the process, and shared by every frame
+// of that size. The caller provides workSize() floats of scratch to each transform,
+// so a plan may be used by any number of threads at once.
+class FFTPlan
+{
+public:
+    virtual ~FFTPlan() = default;
+
+    static std::shared_ptr<const FFTPlan> get(int size, FFTBackend backend);
+    static std::shared_ptr<const FFTPlan> get(int size) { return get(size, defaultBackend()); }
+
+    // The backend of frames created from now on; Stockham unless set otherwise.
+    static FFTBackend defaultBackend();
+    static void setDefaultBackend(FFTBackend backend);
+
+    static const char * backendName(FFTBackend backend);
+
+    int size() const { return m_size; }
+    int workSize() const { return m_workSize; }
+    FFTBackend backend() const { return m_backend; }
+
+    virtual void forward(const float * input, float * real, float * imag, float * work) const = 0;
+    virtual void inverse(const float * real, const float * imag, float * output, float * work) const = 0;
+
+protected:
+    FFTPlan(int size, int workSize, FFTBackend backend)
+        : m_size(size)
+        , m_workSize(workSize)
+        , m_backend(backend)
+    {
+    }
+
+private:
+    int m_size;
+    int m_workSize;
+    FFTBackend m_backend;
+};
+
+// Defined by each backend
+std::unique_ptr<FFTPlan> createKissPlan(int size);
+std::unique_ptr<FFTPlan> createOouraPlan(int size);
+std::unique_ptr<FFTPlan> createStockhamPlan(int size);
+
+}  // namespace lab
+
+#endif  // FFTPlan_h
@@ -7,10 +7,13 @@
 
 #include "LabSound/extended/Util.h"
 #include "internal/FFTFrame.h"
+#include "internal/MappedFile.h"
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <thread>
+#include <string>
 #include <vector>
 
 namespace lab
@@ -28,7 +31,7 @@ struct HRTFDatabaseInfo
     int minElevation = -45;
     int maxElevation = 90;
     int rawElevationAngleSpacing = 15;
-    bool files_found_and_loaded = false;
+    std::atomic<bool> files_found_and_loaded {false};
  
     // Number of elevations loaded from resource
     int numberOfRawElevations = 10;  // -45 -> +90 (each 15 degrees)
@@ -48,7 +51,7 @@ struct HRTFDatabaseInfo
     }
 
     // Returns the index for the correct HRTFElevation given the elevation angle.
-    int indexFromElevationAngle(double elevationAngle)
+    int indexFromElevationAngle(double elevationAngle) const
     {
         elevationAngle = Max((double) minElevation, elevationAngle);
         elevationAngle = Min((double) maxElevation, elevationAngle);
@@ -71,25 +74,47 @@ public:
 
     HRTFKernel(std::unique_ptr<FFTFrame> fftFrame, float frameDelay, float sampleRate)
         : m_fftFrame(std::move(fftFrame))
+        , m_real(m_fftFrame->realData())
+        , m_imag(m_fftFrame->imagData())
+        , m_fftSize(m_fftFrame->fftSize())
         , m_frameDelay(frameDelay)
         , m_sampleRate(sampleRate)
     {
         //m_fftFrame->print();
     }
 
+    // Refers to a spectrum in FFTFrame's layout held elsewhere, such as in a mapped
+    // HRTF pack, which must outlive the kernel.
+    HRTFKernel(const float * real, const float * imag, int fftSize, float frameDelay, float sampleRate)
+        : m_real(real)
+        , m_imag(imag)
+        , m_fftSize(fftSize)
+        , m_frameDelay(frameDelay)
+        , m_sampleRate(sampleRate)
+    {
+    }
+
+    // Null if the spectrum is held elsewhere
     FFTFrame * fftFrame() { return m_fftFrame.get(); }
 
-    int fftSize() const { return m_fftFrame->fftSize(); }
+    // The spectrum, of FFTFrame::binCount() bins
+    const float * realData() const { return m_real; }
+    const float * imagData() const { return m_imag; }
+
+    int fftSize() const { return m_fftSize; }
     float frameDelay() const { return m_frameDelay; }
 
     // Converts back into impulse-response form.
-    std::unique_ptr<AudioChannel> createImpulseResponse();
+    std::unique_ptr<AudioChannel> createImpulseResponse() const;
 
     float sampleRate() const { return m_sampleRate; }
 
 private:
     // Note: this is destructive on the passed in AudioChannel.
     std::unique_ptr<FFTFrame> m_fftFrame;
+    const float * m_real = nullptr;
+    const float * m_imag = nullptr;
+    int m_fftSize;
     float m_frameDelay;
     float m_sampleRate;
 };
@@ -110,6 +135,9 @@ public:
     // Valid values for elevation are -45 -> +90 in 15 degree increments.
     static std::unique_ptr<HRTFElevation> createForSubject(HRTFDatabaseInfo * info, int elevation);
 
+    // Wraps kernels made elsewhere, such as those of a mapped HRTF pack.
+    static std::unique_ptr<HRTFElevation> createWithKernels(std::unique_ptr<HRTFKernelList> kernelListL, std::unique_ptr<HRTFKernelList> kernelListR, int elevation);
+
     // Given two HRTFElevations, and an interpolation factor x: 0 -> 1, returns an interpolated HRTFElevation.
     static std::unique_ptr<HRTFElevation> createByInterpolatingSlices(HRTFDatabaseInfo * info, HRTFElevation * hrtfElevation1, HRTFElevation * hrtfElevation2, float x);
 
@@ -122,7 +150,7 @@ public:
 
     // Returns the left and right kernels for the given azimuth index.
     // The interpolated delays based on azimuthBlend: 0 -> 1 are returned in frameDelayL and frameDelayR.
-    void getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, HRTFKernel *& kernelL, HRTFKernel *& kernelR, double & frameDelayL, double & frameDelayR);
+    void getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, const HRTFKernel *& kernelL, const HRTFKernel *& kernelR, double & frameDelayL, double & frameDelayR) const;
 
     // Spacing, in degrees, between every azimuth loaded from resource.
     static const unsigned AzimuthSpacing;
@@ -167,85 +195,89 @@ class HRTFDatabase
     NO_MOVE(HRTFDatabase);
 
 public:
-    HRTFDatabase(float sampleRate, const std::string & searchPath);
+    // Loads the database for sampleRate from searchPath. The pack written by writePack()
+    // for this sample rate is mapped and used in place if it is there, unless usePack is
+    // false; otherwise the kernels are computed from the IRCAM files, an elevation at a
+    // time on each core.
+    HRTFDatabase(float sampleRate, const std::string & searchPath, bool usePack = true);
+
+    // The path of the pack for sampleRate in searchPath
+    static std::string packPath(const std::string & searchPath, float sampleRate);
+
+    // Writes the kernels, their delays, and the interpolated azimuths and elevations to a
+    // pack that later loads at the same sample rate can map. Returns false on failure.
+    bool writePack(const std::string & path) const;
+
+    bool isPacked() const { return m_pack != nullptr; }
 
     // getKernelsFromAzimuthElevation() returns a left and right ear kernel, and an interpolated left and right frame delay for the given azimuth and elevation.
     // azimuthBlend must be in the range 0 -> 1.
     // Valid values for azimuthIndex are 0 -> HRTFElevation::NumberOfTotalAzimuths - 1 (corresponding to angles of 0 -> 360).
     // Valid values for elevationAngle are MinElevation -> MaxElevation.
-    void getKernelsFromAzimuthElevation(double azimuthBlend, unsigned azimuthIndex, double elevationAngle, HRTFKernel *& kernelL, HRTFKernel *& kernelR, double & frameDelayL, double & frameDelayR);
+    void getKernelsFromAzimuthElevation(double azimuthBlend, unsigned azimuthIndex, double elevationAngle, const HRTFKernel *& kernelL, const HRTFKernel *& kernelR, double & frameDelayL, double & frameDelayR) const;
 
     // Returns the number of different azimuth angles.
     static unsigned numberOfAzimuths() { return HRTFElevation::NumberOfTotalAzimuths; }
     int numberOfElevations() const { return (int) m_elevations.size(); }
-    bool files_found_and_loaded() { return info->files_found_and_loaded; }
+    bool files_found_and_loaded() const { return info->files_found_and_loaded; }
 
 private:
+    bool loadPack(const std::string & path);
+    void loadFiles();
+
+    // the kernels of a packed database refer into the mapping
+    std::unique_ptr<MappedFile> m_pack;
+
     std::vector<std::unique_ptr<HRTFElevation>> m_elevations;
 
     std::unique_ptr<HRTFDatabaseInfo> info;
 };
 
-// HRTFDatabaseLoader will asynchronously load the default HRTFDatabase in a new thread.
-
+// HRTFDatabaseLoader is a handle to an HRTFDatabase that loads in the background.
+//
+// Loaders are kept in a registry keyed by the database's search path, sample rate,
+// and FFT size, for as long as anything holds them, so every context at the same
+// sample rate that asks for the same database shares one loader, and one copy of
+// the kernels. Once loaded, a database is never modified. isLoaded() and database()
+// never block, so the render thread polls them rather than wait.
 class HRTFDatabaseLoader
 {
+    NO_MOVE(HRTFDatabaseLoader);
 
 public:
-    // Both constructor and destructor must be called from the main thread.
-    // It's expected that the singletons will be accessed instead.
-    // @CBB the guts of the loader should be a private singleton, so that the loader can be constructed without a factory
-    explicit HRTFDatabaseLoader(float sampleRate, const std::string & searchPath);
-
-    // Lazily creates the singleton HRTFDatabaseLoader (if not already created) and starts loading asynchronously (when created the first time).
-    // Returns the singleton HRTFDatabaseLoader.
-    // Must be called from the main thread.
-    static HRTFDatabaseLoader* MakeHRTFLoaderSingleton(float sampleRate, const std::string & searchPath);
+    // Returns the loader of the database in searchPath for sampleRate, which starts to
+    // load on a background job if no one holds it already. A loader that has finished
+    // without finding the files is replaced, so that a request may be retried.
+    static std::shared_ptr<HRTFDatabaseLoader> acquire(float sampleRate, const std::string & searchPath);
 
-    // Returns the singleton HRTFDatabaseLoader.
-    static HRTFDatabaseLoader* loader() { return s_loader; }
-
-    // Both constructor and destructor must be called from the main thread.
     ~HRTFDatabaseLoader();
 
-    // Returns true once the default database has been completely loaded.
-    bool isLoaded() const;
+    // Returns true once loading has finished, whether or not the files were found.
+    bool isLoaded() const { return m_loaded.load(std::memory_order_acquire); }
 
-    // waitForLoaderThreadCompletion() may be called more than once and is thread-safe.
-    void waitForLoaderThreadCompletion();
+    // Blocks until loading has finished. Must not be called on the render thread.
+    void waitUntilLoaded() const;
 
-    HRTFDatabase * database() { return m_hrtfDatabase.get(); }
+    // The database, or null until isLoaded().
+    const HRTFDatabase * database() const { return isLoaded() ? m_hrtfDatabase.get() : nullptr; }
 
     float databaseSampleRate() const { return m_databaseSampleRate; }
-
-    // Called in asynchronous loading thread.
-    void load();
-
-    // defaultHRTFDatabase() gives access to the loaded database.
-    // This can be called from any thread, but it is the callers responsibilty to call this while the context (and thus HRTFDatabaseLoader)
-    // is still alive.  Otherwise this will return 0.
-    static HRTFDatabase * defaultHRTFDatabase();
-
-        // If it hasn't already been loaded, creates a new thread and initiates asynchronous loading of the default database.
-    // This must be called from the main thread.
-    void loadAsynchronously();
+    const std::string & searchPath() const { return m_searchPath; }
 
 private:
-    static void databaseLoaderEntry(HRTFDatabaseLoader * threadData);
+    HRTFDatabaseLoader(float sampleRate, const std::string & searchPath, int fftSize);
 
+    void load();
 
-    static HRTFDatabaseLoader* s_loader;  // convenience pointer, owned elsewhere
     std::unique_ptr<HRTFDatabase> m_hrtfDatabase;
+    std::atomic<bool> m_loaded {false};
 
-    // Holding a m_threadLock is required when accessing m_databaseLoaderThread.
-    std::mutex m_threadLock;
-    std::thread m_databaseLoaderThread;
-    std::condition_variable m_loadingCondition;
-    bool m_loading;
+    mutable std::mutex m_loadingMutex;
+    mutable std::condition_variable m_loadingCondition;
 
     float m_databaseSampleRate;
-
-    std::string searchPath;
+    int m_fftSize;
+    std::string m_searchPath;
 };
 
 }  // namespace lab
@@ -6,17 +6,22 @@
 #define HRTFPanner_h
 
 #include "internal/DelayDSPKernel.h"
-#include "internal/FFTConvolver.h"
+#include "internal/HRTFRenderer.h"
 #include "internal/Panner.h"
 
 namespace lab
 {
 
+// Positions a sound with the HRTF database: the input is delayed by the inter-aural
+// time differences here, and convolved with the ears' responses, together with the
+// other HRTF panners of the context, by an HRTFRenderer.
 class HRTFPanner : public Panner
 {
 
 public:
-    HRTFPanner(float sampleRate);
+    // The panner holds the renderer, and so its database. It is made, and destroyed, off
+    // the render thread, as it adds its source to the renderer and removes it.
+    HRTFPanner(float sampleRate, std::shared_ptr<HRTFRenderer> renderer);
     virtual ~HRTFPanner();
 
     // Panner
@@ -29,6 +34,12 @@ public:
 
     virtual void reset() override;
 
+    // The input that the output is summed into, if it is the output's only connection;
+    // the renderer mixes the panners feeding the same input.
+    void setMixTarget(const void * target) { m_source.mixTarget = target; }
+
+    const HRTFRenderer * renderer() const { return m_renderer.get(); }
+
     uint32_t fftSize() const { return fftSizeForSampleRate(m_sampleRate); }
     static uint32_t fftSizeForSampleRate(float sampleRate);
     static uint32_t fftSizeForSampleLength(int sampleLength);
@@ -41,51 +52,14 @@ private:
     // and azimuthBlend which is an interpolation value from 0 -> 1.
     int calculateDesiredAzimuthIndexAndBlend(double azimuth, double & azimuthBlend);
 
-    // We maintain two sets of convolvers for smooth cross-faded interpolations when
-    // then azimuth and elevation are dynamically changing.
-    // When the azimuth and elevation are not changing, we simply process with one of the two sets.
-    // Initially we use CrossfadeSelection1 corresponding to m_convolverL1 and m_convolverR1.
-    // Whenever the azimuth or elevation changes, a crossfade is initiated to transition
-    // to the new position. So if we're currently processing with CrossfadeSelection1, then
-    // we transition to CrossfadeSelection2 (and vice versa).
-    // If we're in the middle of a transition, then we wait until it is complete before
-    // initiating a new transition.
-
-    // Selects either the convolver set (m_convolverL1, m_convolverR1) or (m_convolverL2, m_convolverR2).
-    enum CrossfadeSelection
-    {
-        CrossfadeSelection1,
-        CrossfadeSelection2
-    };
-
-    CrossfadeSelection m_crossfadeSelection;
-
-    // azimuth/elevation for CrossfadeSelection1.
-    int m_azimuthIndex1;
-    double m_elevation1;
+    std::shared_ptr<HRTFRenderer> m_renderer;
 
-    // azimuth/elevation for CrossfadeSelection2.
-    int m_azimuthIndex2;
-    double m_elevation2;
-
-    // A crossfade value 0 <= m_crossfadeX <= 1.
-    float m_crossfadeX;
-
-    // Per-sample-frame crossfade value increment.
-    float m_crossfadeIncr;
-
-    FFTConvolver m_convolverL1;
-    FFTConvolver m_convolverR1;
-    FFTConvolver m_convolverL2;
-    FFTConvolver m_convolverR2;
+    // The convolution state, and the positions cross-faded between when the azimuth and
+    // elevation change; see HRTFRenderer::Source. The renderer has it until it is removed.
+    HRTFRenderer::Source & m_source;
 
     DelayDSPKernel m_delayLineL;
     DelayDSPKernel m_delayLineR;
-
-    AudioFloatArray m_tempL1;
-    AudioFloatArray m_tempR1;
-    AudioFloatArray m_tempL2;
-    AudioFloatArray m_tempR2;
 };
 
 }  // namespace lab
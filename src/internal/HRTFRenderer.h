@@ -0,0 +1,235 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef HRTFRenderer_h
+#define HRTFRenderer_h
+
+#include "LabSound/core/AudioArray.h"
+#include "LabSound/extended/Util.h"
+
+#include "internal/FFTFrame.h"
+#include "internal/RenderHandoff.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lab
+{
+
+class ContextRenderLock;
+class HRTFDatabase;
+class HRTFDatabaseLoader;
+
+// Renders the convolutions of every HRTF panner in a context together, a block
+// at a time.
+//
+// Each panner is an HRTFRenderer::Source. The panner delays its input by the
+// inter-aural delays into the source's block, and reads its output from the
+// block before, as FFTConvolver does, so a block's convolution is not needed
+// until the quantum after the one that completes it. The blocks of all sources
+// are aligned to the context's frames, so they complete together, and the
+// context calls processBlocks() at the end of each quantum to convolve them:
+//
+//   - each source's block is transformed once per ear, even while it cross-fades
+//     between two positions and is convolved with the kernels of both;
+//   - the spectral products of all sources are computed in one pass, ordered by
+//     kernel, so that each kernel is read once for every source that uses it;
+//   - sources that feed the same input, and aren't cross-fading, are mixed: their
+//     spectra are summed for each kernel they share, the products are summed,
+//     and the mix costs one inverse transform per ear however many sources it
+//     has. One of the sources carries the mix in its output, and the others are
+//     silent, so the input receives the same sum.
+//
+// Sources change position, and join or leave a mix, at block boundaries; a
+// source leaving a mix is heard through it until the end of the block, and a
+// mixed source that moves leaves its mix a block before it fades. With
+// render quanta longer than a block, a source's output is needed within the
+// quantum that completes its block, so each source is convolved alone, as soon
+// as its block completes.
+//
+// Sources are added and removed off the render thread, which renders them from a
+// roster handed to it whole, without locks; see RenderHandoff.
+class HRTFRenderer
+{
+    NO_MOVE(HRTFRenderer);
+
+    struct Scratch;
+
+public:
+    struct Mix;
+
+    // The convolution state of one panner, which the renderer makes, and the panner
+    // holds for as long as it exists.
+    struct Source
+    {
+        explicit Source(const HRTFRenderer & renderer);
+        ~Source();
+
+        // The current block of input, for each ear, in the first half of a transform.
+        AudioFloatArray input[2];
+
+        // The output of the previous block, for each ear, if it isn't mixed.
+        AudioFloatArray output[2];
+
+        // The convolution tails of each position's kernels, for each ear.
+        AudioFloatArray overlap[2][2];
+
+        AudioFloatArray spectrumReal[2];
+        AudioFloatArray spectrumImag[2];
+        AudioFloatArray productReal[2][2];
+        AudioFloatArray productImag[2][2];
+
+        // The frames of the current block written, and the frame expected next.
+        int blockIndex = 0;
+        uint64_t nextFrame = UINT64_MAX;
+
+        // The two positions cross-faded between, as azimuth index and elevation; the
+        // cross-fade is at crossfadeX when the block starts, where 0 is position 0,
+        // and moves by crossfadeIncr each frame. Positions change at block boundaries.
+        int azimuthIndex[2] = {-1, -1};
+        double elevation[2] = {0, 0};
+        int selection = 0;
+        float crossfadeX = 0;
+        float crossfadeIncr = 0;
+
+        // The position the panner asked for most recently.
+        int desiredAzimuthIndex = 0;
+        double desiredElevation = 0;
+        double azimuthBlend = 0;
+
+        // The input the panner's output is summed into, if it feeds only that one.
+        const void * mixTarget = nullptr;
+
+        // The mix of the previous block's output, if any, and whether that output is
+        // in it, rather than in this source's output.
+        Mix * mix = nullptr;
+        bool isMixed = false;
+
+        // The working space to convolve the source's block alone.
+        std::unique_ptr<Scratch> scratch;
+    };
+
+    // The sum of the outputs of the sources feeding one input.
+    struct Mix
+    {
+        explicit Mix(const HRTFRenderer & renderer);
+
+        // Returns true for exactly one caller per quantum.
+        bool claim(uint64_t frame);
+
+        const void * target = nullptr;
+        AudioFloatArray real[2];
+        AudioFloatArray imag[2];
+        AudioFloatArray overlap[2];
+        AudioFloatArray output[2];
+        int members = 0;
+        int sources = 0;
+        std::atomic<uint64_t> claimedFrame {UINT64_MAX};
+    };
+
+    HRTFRenderer(float sampleRate, int renderQuantumSize, std::shared_ptr<HRTFDatabaseLoader> databaseLoader);
+    ~HRTFRenderer();
+
+    const HRTFDatabaseLoader * databaseLoader() const { return m_databaseLoader.get(); }
+
+    // Null until the database has loaded, or if its files weren't found.
+    const HRTFDatabase * database() const;
+
+    float sampleRate() const { return m_sampleRate; }
+    int fftSize() const { return m_fftSize; }
+    int blockSize() const { return m_fftSize / 2; }
+    int binCount() const { return m_binCount; }
+
+    // Off the render thread. A source added is rendered until it is removed, and then
+    // freed by a later call, once the render thread can no longer have it.
+    Source * addSource();
+    void removeSource(Source * source);
+
+    // Off the render thread. Frees the sources, and rosters, that were retired.
+    void collect();
+
+    // Called by a source's panner at the start of its first quantum, and of any that
+    // doesn't follow the last one it rendered: the source starts afresh, aligned to
+    // the context's blocks.
+    void restart(Source & source, uint64_t frame) const;
+
+    // Called by a source's panner when its block is complete and must be convolved
+    // before the quantum ends. Sources convolved so, on different render threads,
+    // share nothing.
+    void processSource(Source & source);
+
+    // Called by the context at the end of each render quantum; convolves the blocks
+    // that the quantum completed.
+    void processBlocks(ContextRenderLock & r);
+
+private:
+    struct Product
+    {
+        const float * kernelReal;
+        const float * kernelImag;
+        const float * spectrumReal;
+        const float * spectrumImag;
+        float * real;
+        float * imag;
+        bool accumulate;
+    };
+
+    // The working space of a pass; a source has one to convolve its block alone.
+    struct Scratch
+    {
+        Scratch(int fftSize, int binCount, size_t sources);
+
+        FFTFrame frame;
+        AudioFloatArray time[2];
+        AudioFloatArray sumReal;
+        AudioFloatArray sumImag;
+        std::vector<Product> products;
+    };
+
+    // What processBlocks() renders, with room for every source's block. A new roster
+    // is made whenever a source is added or removed, and holds the sources it names,
+    // so that a source removed lives until the roster without it is in use.
+    struct Roster
+    {
+        Roster(const HRTFRenderer & renderer, size_t sources);
+
+        std::vector<std::shared_ptr<Source>> sources;
+        std::vector<Mix *> mixes;
+        std::vector<Source *> blockSources;
+        Scratch scratch;
+    };
+
+    void publishRoster();
+
+    void render(Scratch & scratch, Mix * const * mixes, int mixCount, Source * const * sources, int count, bool mixing);
+    void prepare(const HRTFDatabase & database, Source & source, Mix * const * mixes, int mixCount, bool mixing);
+    void addProducts(Scratch & scratch, const HRTFDatabase & database, Source & source);
+    void multiplyProducts(Scratch & scratch);
+    void finish(Scratch & scratch, Source & source);
+    void finish(Scratch & scratch, Mix & mix);
+    Mix * findMix(Mix * const * mixes, int mixCount, const void * target);
+
+    std::shared_ptr<HRTFDatabaseLoader> m_databaseLoader;
+    float m_sampleRate;
+    int m_fftSize;
+    int m_binCount;
+    float m_crossfadeFrames;
+
+    // false when a quantum is longer than a block, so that blocks are convolved as they
+    // complete, and never mixed
+    bool m_deferred;
+
+    // guards the sources and mixes, and the rosters' publication, off the render thread,
+    // which never takes it
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<Source>> m_sources;
+    std::vector<std::unique_ptr<Mix>> m_mixes;
+    RenderHandoff<Roster> m_rosters;
+};
+
+}  // namespace lab
+
+#endif  // HRTFRenderer_h
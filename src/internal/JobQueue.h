@@ -0,0 +1,46 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef JobQueue_h
+#define JobQueue_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lab
+{
+
+// A process-wide queue of jobs, run in the order they are posted by a few worker
+// threads. It is for work that must neither run on the render thread nor stall the
+// thread that asks for it, such as preparing an impulse response. A job must not
+// refer to anything that it does not keep alive itself; jobs still queued when the
+// process exits are discarded.
+class JobQueue
+{
+public:
+    static JobQueue & shared();
+
+    void post(std::function<void()> job);
+
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    explicit JobQueue(int threadCount);
+    ~JobQueue();
+
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_shouldStop = false;
+    std::vector<std::thread> m_threads;
+};
+
+}  // namespace lab
+
+#endif  // JobQueue_h
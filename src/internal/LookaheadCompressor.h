@@ -0,0 +1,79 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef LookaheadCompressor_h
+#define LookaheadCompressor_h
+
+#include <memory>
+#include <vector>
+
+namespace lab
+{
+
+class AudioBus;
+
+// A feed forward peak compressor, whose channels share one detector, so that
+// compressing one does not move the image between them. The peak of every
+// channel is detected in decibels, put through a static curve with a soft
+// knee, and the reduction it asks for is smoothed with separate attack and
+// release times. The gain is applied to the channels delayed by the
+// lookahead, so that it is already down when a transient arrives.
+//
+// A span of frames is processed in passes, each but the smoothing vectorised
+// across frames: the detection takes the peak of every channel in one pass,
+// and the conversions between decibels and gains are polynomial
+// approximations of log2 and exp2, accurate to well under a thousandth of a
+// decibel.
+class LookaheadCompressor
+{
+public:
+    enum
+    {
+        MaxLookaheadFrames = 4096,
+    };
+
+    struct Parameters
+    {
+        float threshold = -24;  // dB
+        float knee = 0;         // dB, the width of the soft knee, centered on the threshold
+        float ratio = 12;       // dB of input over the threshold, for each dB of output
+        float attack = 0.003f;  // seconds for the reduction to move by 1 - 1/e of a change
+        float release = 0.25f;  // seconds, likewise
+        float lookahead = 0;    // seconds
+        float makeup = 0;       // dB
+    };
+
+    LookaheadCompressor();
+    ~LookaheadCompressor();
+
+    // Compresses framesToProcess frames of each channel of the source into the
+    // destination's, which may be the source's; they are linked across as many
+    // channels as both buses have.
+    void process(const Parameters &, float sampleRate, const AudioBus * source, AudioBus * destination, int framesToProcess);
+
+    void reset();
+
+    // The reduction of the last frame, in dB; zero or less.
+    float reduction() const { return m_envelope; }
+
+    int latencyFrames() const { return m_lookaheadFrames; }
+
+private:
+    void setLookahead(int frames, int numberOfChannels);
+
+    float m_envelope = 0;  // the smoothed reduction, in dB
+
+    int m_lookaheadFrames = 0;
+    int m_writeIndex = 0;
+    std::vector<std::unique_ptr<float[]>> m_delayLines;  // for each channel, when there is a lookahead
+
+    std::vector<const float *> m_sources;
+    std::vector<float *> m_destinations;
+
+    std::unique_ptr<float[]> m_reductions;  // a span's, in dB
+    std::unique_ptr<float[]> m_gains;       // and their gains
+};
+
+}  // namespace lab
+
+#endif  // LookaheadCompressor_h
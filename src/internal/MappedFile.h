@@ -0,0 +1,46 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include "LabSound/core/Macros.h"
+#include "LabSound/extended/Util.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace lab
+{
+
+// A file mapped read-only into memory, for data that is used in place rather than
+// parsed, such as a packed HRTF database. The mapping is page aligned, and lasts
+// as long as the MappedFile.
+class MappedFile
+{
+    NO_MOVE(MappedFile);
+
+public:
+    // Returns null if the file can't be opened or is empty.
+    static std::unique_ptr<MappedFile> open(const std::string & path);
+    ~MappedFile();
+
+    const uint8_t * data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t * m_data = nullptr;
+    size_t m_size = 0;
+#if defined(LABSOUND_PLATFORM_WINDOWS)
+    void * m_file = nullptr;
+    void * m_mapping = nullptr;
+#endif
+};
+
+}  // namespace lab
+
+#endif  // MappedFile_h
@@ -0,0 +1,127 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef MultiTapDelay_h
+#define MultiTapDelay_h
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace lab
+{
+
+// A delay line for each of a number of channels, read by a number of taps,
+// each with its own delay and gain; the taps are summed into the output. A
+// chorus, a flanger or a tape echo needs only one line, however many voices
+// it has.
+//
+// A tap's delay is either constant, and approached smoothly when it is
+// changed, or given for every frame, and followed exactly. Reads at a
+// constant delay are contiguous, and are vectorised across the frames; at a
+// varying delay the read positions are found for a span of frames at once,
+// and shared by the channels.
+//
+// The interpolation between frames is linear, cubic (Catmull-Rom), or a first
+// order allpass, which has a flat magnitude response, but which is only
+// accurate for delays that change slowly.
+class MultiTapDelay
+{
+public:
+    enum class Interpolation
+    {
+        Linear,
+        Cubic,
+        Allpass
+    };
+
+    struct Tap
+    {
+        float delay = 0;                 // frames
+        const float * delays = nullptr;  // frames, for each frame processed, instead of delay
+        float gain = 1;
+    };
+
+    MultiTapDelay();
+    ~MultiTapDelay();
+
+    // Sets the most channels and taps, and the longest delay, all of them in
+    // use, and clears the lines. Allocates. The lines are zeroed by calloc, so
+    // the memory of channels that are never used is never touched.
+    void setSize(int channels, int taps, double maxDelayFrames);
+
+    // Uses the first channels lines and taps taps of those set by setSize,
+    // and clears them. Doesn't allocate, so it can follow a change in the
+    // channel count on the render thread.
+    void setActive(int channels, int taps);
+
+    int channels() const { return m_channels; }
+    int taps() const { return m_taps; }
+    int channelCapacity() const { return m_channelCapacity; }
+    int tapCapacity() const { return m_tapCapacity; }
+    double maxDelayFrames() const { return m_maxDelayFrames; }
+
+    void setInterpolation(Interpolation interpolation) { m_interpolation = interpolation; }
+    Interpolation interpolation() const { return m_interpolation; }
+
+    // The fraction of the way from a tap's delay to a new constant delay
+    // covered each frame; 1 jumps to it.
+    void setSmoothingRate(double rate) { m_smoothingRate = rate; }
+
+    // Writes framesToProcess frames of each source channel into its line, and
+    // sums the taps read from it into its destination, which may be the
+    // source. taps has an entry for each tap. Delays are clamped to the
+    // longest, and to the shortest the interpolation allows: none for linear,
+    // half a frame for allpass, and a frame for cubic.
+    void process(const float * const * sources, float * const * destinations, int framesToProcess, const Tap * taps);
+
+    // Clears the lines; each tap jumps to the next constant delay it is given.
+    void reset();
+
+private:
+    void processSpan(const float * const * sources, float * const * destinations, int offset, int frames, const Tap * taps);
+    void readConstant(int tap, double delay, float gain, float * const * destinations, int offset, int frames);
+    void readVarying(int tap, const float * delays, float gain, float * const * destinations, int offset, int frames);
+
+    float * line(int channel) { return m_lines.get() + static_cast<size_t>(channel) * (m_length + Guard); }
+
+    struct FreeLines
+    {
+        void operator()(float * lines) const { std::free(lines); }
+    };
+
+    enum
+    {
+        SpanFrames = 128,  // frames written to the lines before the taps read them
+        Guard = 3,         // frames past the end of each line, mirroring its start
+    };
+
+    int m_channels = 0;
+    int m_taps = 0;
+    int m_channelCapacity = 0;
+    int m_tapCapacity = 0;
+    double m_maxDelayFrames = 0;
+    Interpolation m_interpolation = Interpolation::Linear;
+    double m_smoothingRate = 1;
+
+    // each line is m_length frames, a power of two, followed by its guard
+    std::unique_ptr<float[], FreeLines> m_lines;
+    int m_length = 0;
+    int m_writeIndex = 0;
+
+    std::vector<double> m_currentDelays;  // for each tap, where it is moving from
+    std::vector<char> m_jump;             // for each tap, if its next delay is not approached
+    std::vector<float> m_allpassStates;   // [tap][channel], the last output
+
+    // for a span read at varying delays, the delays, then for each frame the
+    // index of the first of the four frames read, and the fraction of the way
+    // from the second to the third
+    std::vector<float> m_delays;
+    std::vector<int> m_indices;
+    std::vector<float> m_fractions;
+};
+
+}  // namespace lab
+
+#endif  // MultiTapDelay_h
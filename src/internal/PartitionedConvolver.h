@@ -0,0 +1,132 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef PartitionedConvolver_h
+#define PartitionedConvolver_h
+
+#include "LabSound/core/AudioArray.h"
+
+#include "internal/FFTFrame.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lab
+{
+
+// Convolves signals with impulse responses of any length, a block at a time,
+// with no latency.
+//
+// The response is divided into segments of uniformly sized partitions, and each
+// segment is convolved by overlap-save, with a frequency-domain delay line of
+// the input spectra, so that every partition costs one complex multiply-add of
+// its spectrum rather than a transform. The first segment's partitions are the
+// size of a block, so its output is ready in the same call as its input. Each
+// later segment's partitions are eight times larger, up to maxPartitionSize, and
+// begin exactly where the larger transform's extra latency is hidden by the
+// segments before it; the long tail of a reverb is therefore convolved with a
+// few large transforms, while the head keeps the latency at zero.
+//
+// A convolver has a number of inputs and outputs, and each output is the sum of
+// some of the inputs, each convolved with one of the responses, as given by a
+// routing matrix; a true stereo reverb has two inputs, two outputs, and four
+// responses. The products are summed in the frequency domain, so each input
+// costs one forward transform per partition however many outputs it reaches,
+// and each output costs one inverse transform. Inputs that are given the same
+// signal share its transforms, and silent inputs cost nothing once their
+// silence fills the delay lines.
+//
+// The large transforms come due once per partition, so they make the render
+// time of a quantum uneven. With backgroundTail, the segments of partitions of
+// BackgroundPartitionSize frames and more are convolved on a background thread
+// shared by all convolvers, which has half a partition to deliver each one, and
+// the render thread keeps only the head.
+//
+// Partitioning and transforming the responses is the costly part of creating a
+// convolver, so it is done apart from it, by prepareResponses(), which may be
+// called from any thread. Prepared responses are immutable, and are cached by
+// a hash of their samples and of the partition layout for as long as any
+// convolver holds them, so that convolvers of the same response share one copy.
+class PartitionedConvolver
+{
+public:
+    enum : int
+    {
+        DefaultMaxPartitionSize = 8192,
+        BackgroundPartitionSize = 4096
+    };
+
+    struct Responses;
+
+    // Returns the responses, each responseLength frames long and scaled by gain,
+    // partitioned for convolvers of blockSize frames. The responses are copied into
+    // their spectra, or found in the cache. blockSize and maxPartitionSize must be
+    // powers of two.
+    static std::shared_ptr<const Responses> prepareResponses(const float * const * responses, int responseCount,
+                                                             int responseLength, float gain, int blockSize,
+                                                             bool backgroundTail = false,
+                                                             int maxPartitionSize = DefaultMaxPartitionSize);
+
+    // As above, cached under key rather than under a hash of the responses. Responses
+    // derived from others, by resampling for instance, may be cached under the key of
+    // the originals, so that they need only be derived if findResponses() fails.
+    static std::shared_ptr<const Responses> prepareResponses(uint64_t key, const float * const * responses,
+                                                             int responseCount, int responseLength, float gain,
+                                                             int blockSize, bool backgroundTail = false,
+                                                             int maxPartitionSize = DefaultMaxPartitionSize);
+
+    // Hashes the responses' samples and the partition layout; salt distinguishes the
+    // ways in which responses may be derived from the same samples.
+    static uint64_t responseKey(const float * const * responses, int responseCount, int responseLength,
+                                uint64_t salt, int blockSize, bool backgroundTail = false,
+                                int maxPartitionSize = DefaultMaxPartitionSize);
+
+    // Returns the responses cached under key, if a convolver still holds them.
+    static std::shared_ptr<const Responses> findResponses(uint64_t key);
+
+    // routing has an entry for each output and input, routing[output * inputCount + input],
+    // which is the index of the response that convolves the input for the output, or -1
+    // if the input does not reach the output.
+    PartitionedConvolver(std::shared_ptr<const Responses> responses,
+                         int inputCount, int outputCount, const int * routing);
+    ~PartitionedConvolver();
+
+    // Processes exactly blockSize() frames of each input into each output. A null source
+    // is silent. Processing in-place is allowed.
+    void process(const float * const * sources, float * const * dests, int framesToProcess);
+
+    // Clears the signal history, leaving the impulse responses in place. Must not be
+    // called concurrently with process().
+    void reset();
+
+    int blockSize() const { return m_blockSize; }
+    int inputCount() const { return m_inputCount; }
+    int outputCount() const { return m_outputCount; }
+    int responseLength() const { return m_responseLength; }
+
+private:
+    struct Segment;
+    class BackgroundThread;
+
+    std::shared_ptr<const Responses> m_responses;
+    int m_blockSize;
+    int m_inputCount;
+    int m_outputCount;
+    int m_responseLength;
+    std::vector<std::unique_ptr<Segment>> m_segments;
+
+    // For each input, the earlier input it has shared its signal with, or Silent, and
+    // for how many blocks in a row
+    enum : int
+    {
+        Unshared = -1,
+        Silent = -2
+    };
+    std::vector<int> m_sharedWith;
+    std::vector<int> m_sharedBlocks;
+};
+
+}  // namespace lab
+
+#endif  // PartitionedConvolver_h
@@ -0,0 +1,44 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef RenderAllocationTracer_h
+#define RenderAllocationTracer_h
+
+namespace lab
+{
+
+// When LabSound is built with LABSOUND_TRACE_RENDER_ALLOCATIONS, every heap
+// allocation made while a RenderAllocationScope is active on the calling
+// thread is reported to stderr, along with the innermost scope's name and the
+// call site. pull_graph opens a scope for the render quantum, and each node
+// opens one named after itself while it processes.
+//
+// In other builds a scope compiles away to nothing.
+#if defined(LABSOUND_TRACE_RENDER_ALLOCATIONS)
+
+class RenderAllocationScope
+{
+public:
+    explicit RenderAllocationScope(const char * name);
+    ~RenderAllocationScope();
+
+    RenderAllocationScope(const RenderAllocationScope &) = delete;
+    RenderAllocationScope & operator=(const RenderAllocationScope &) = delete;
+
+private:
+    const char * m_previous;
+};
+
+#else
+
+class RenderAllocationScope
+{
+public:
+    explicit RenderAllocationScope(const char *) {}
+};
+
+#endif
+
+}  // namespace lab
+
+#endif  // RenderAllocationTracer_h
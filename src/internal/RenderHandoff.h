@@ -0,0 +1,84 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef RenderHandoff_h
+#define RenderHandoff_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace lab
+{
+
+// RenderHandoff hands objects made off the render thread to it, without locks,
+// and without the render thread ever freeing one.
+//
+// The owner publishes an object, and the render thread uses the current one for
+// the scope of a Use. A published object replaces the previous one, which is
+// retired, and freed by a later publish() or collect() once a Use has ended
+// since: the render thread can't have it any longer, as Uses begun after the
+// replacement see the new object. The owner's calls must not overlap, and only
+// one Use may be alive at a time, on whichever thread renders the owner.
+template <typename T>
+class RenderHandoff
+{
+public:
+    class Use
+    {
+    public:
+        explicit Use(RenderHandoff & handoff)
+            : m_handoff(handoff)
+            , m_object(handoff.m_object.load())
+        {
+        }
+        ~Use() { m_handoff.m_uses.fetch_add(1); }
+
+        T * get() const { return m_object; }
+        T * operator->() const { return m_object; }
+        explicit operator bool() const { return m_object != nullptr; }
+
+    private:
+        RenderHandoff & m_handoff;
+        T * m_object;
+    };
+
+    // Owner. Replaces the current object, which is retired.
+    void publish(std::shared_ptr<T> object)
+    {
+        std::shared_ptr<T> previous = std::move(m_current);
+        m_current = std::move(object);
+        m_object.store(m_current.get());
+        if (previous)
+            m_retired.emplace_back(std::move(previous), m_uses.load());
+        collect();
+    }
+
+    // Owner. Frees the retired objects that no Use can still have.
+    void collect()
+    {
+        const uint64_t uses = m_uses.load();
+        m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+                                       [uses](const Retired & retired) { return uses > retired.second; }),
+                        m_retired.end());
+    }
+
+    // Owner. The object most recently published.
+    const std::shared_ptr<T> & current() const { return m_current; }
+
+private:
+    // an object, and the count of Uses ended when it was retired
+    using Retired = std::pair<std::shared_ptr<T>, uint64_t>;
+
+    std::shared_ptr<T> m_current;
+    std::vector<Retired> m_retired;
+    std::atomic<T *> m_object {nullptr};
+    std::atomic<uint64_t> m_uses {0};
+};
+
+}  // namespace lab
+
+#endif  // RenderHandoff_h
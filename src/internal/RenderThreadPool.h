@@ -0,0 +1,103 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef RenderThreadPool_h
+#define RenderThreadPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lab
+{
+
+// A task in a render task graph. A task may run once all of the tasks it
+// depends on have completed; when it completes, each of its dependents has
+// one fewer dependency outstanding.
+struct RenderTask
+{
+    int dependencies = 0;
+    std::vector<int> dependents;
+};
+
+// RenderThreadPool runs a graph of RenderTasks once per render quantum on a set
+// of worker threads, with the calling thread participating as worker zero.
+// Each worker owns a deque of ready tasks; a worker pushes and pops at the
+// bottom of its own deque, and idle workers steal from the top of the others.
+// Neither running a quantum nor stealing takes a lock or allocates, except that
+// idle workers sleep on a condition variable between quanta.
+class RenderThreadPool
+{
+public:
+    typedef void (*TaskFunction)(void * user, int task);
+
+    // threadCount threads are started in addition to the calling thread.
+    // Threads are pinned to successive cores where the platform allows.
+    explicit RenderThreadPool(int threadCount);
+    ~RenderThreadPool();
+
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+
+    // Must be called before run() whenever the number of tasks changes, and
+    // never concurrently with run().
+    void reserve(int taskCount);
+
+    // Runs every task in tasks, calling fn(user, i) for task i, and returns
+    // once all of them have completed. tasks must be acyclic.
+    void run(const std::vector<RenderTask> & tasks, TaskFunction fn, void * user);
+
+private:
+    // A fixed capacity Chase-Lev deque. The capacity is at least the number of
+    // tasks, so a push can never overflow, since each task is pushed once per run.
+    class TaskDeque
+    {
+    public:
+        void reserve(int capacity);
+        void push(int task);
+        int pop();
+        int steal();
+
+    private:
+        // The owner writes the bottom and thieves the top, so each is padded onto a
+        // cache line of its own. Padding is used rather than alignas, which operator
+        // new doesn't honour before C++17, and deques are allocated on the heap.
+        static const int kCacheLine = 64;
+
+        std::unique_ptr<std::atomic<int>[]> m_tasks;
+        int64_t m_mask = 0;
+        char m_pad0[kCacheLine];
+        std::atomic<int64_t> m_top{0};
+        char m_pad1[kCacheLine - sizeof(std::atomic<int64_t>)];
+        std::atomic<int64_t> m_bottom{0};
+        char m_pad2[kCacheLine - sizeof(std::atomic<int64_t>)];
+    };
+
+    void workerThread(int index);
+    void work(int index);
+    void complete(int index, int task);
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<TaskDeque>> m_deques;
+    std::unique_ptr<std::atomic<int>[]> m_pending;
+    int m_capacity = 0;
+
+    // the quantum in progress
+    const std::vector<RenderTask> * m_tasks = nullptr;
+    TaskFunction m_fn = nullptr;
+    void * m_user = nullptr;
+    std::atomic<int> m_remaining{0};
+    std::atomic<int> m_working{0};
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<bool> m_shouldRun{true};
+};
+
+}  // namespace lab
+
+#endif  // RenderThreadPool_h
@@ -0,0 +1,76 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef Resampler_h
+#define Resampler_h
+
+#include <cstdint>
+
+namespace lab
+{
+
+// Plays a sound held in memory at any rate, accumulating the result into the
+// destination. Each output frame is interpolated from the source frames about a
+// read position, which advances by the rate each frame, and which keeps a 32 bit
+// fraction so that it does not drift however long the sound.
+//
+// The sinc qualities are polyphase filters: a windowed sinc is tabulated at a
+// number of phases between two source frames, and the coefficients of a position
+// are interpolated between its two nearest phases. When the rate is above one
+// the filter's cutoff is lowered with it, so that the sound does not alias; the
+// cutoffs are tabulated every half octave of rate, and the next lower one is
+// used. A table takes a while to compute, so prepare() must be called for a
+// quality before it is rendered; the tables are shared by every resampler.
+//
+// All the channels of the source are interpolated together, sharing the
+// coefficients of each frame.
+class Resampler
+{
+public:
+    enum Quality
+    {
+        Linear = 0,  // two frames; costs least, and both attenuates and aliases the highs
+        Cubic,       // four frames, a Catmull-Rom spline
+        Sinc16,      // sixteen frames
+        Sinc32,
+        Sinc64,
+        _QualityCount
+    };
+
+    // A position in the source, in frames
+    struct Position
+    {
+        int32_t frame = 0;
+        uint32_t fraction = 0;  // in units of 2^-32 frames
+    };
+
+    // The region of the source that plays. Frames outside it read as silence,
+    // or, on the sides it wraps, as the frames at the other end of it, so that
+    // the filters run smoothly across the seams of a loop.
+    struct Region
+    {
+        const float * const * channels = nullptr;
+        int channelCount = 0;
+        int32_t start = 0;
+        int32_t end = 0;
+        bool wrapsBeforeStart = false;  // a pass of the loop precedes this one
+        bool wrapsAfterEnd = false;     // a pass of the loop follows this one
+    };
+
+    // Computes the tables of a quality, if they have not been already. Call it
+    // before rendering with the quality, from a thread other than the render
+    // thread; it may be called from any number of threads.
+    static void prepare(Quality quality);
+
+    // Adds up to framesToProcess frames of the region, read from the position
+    // at rate source frames per frame, to dests, and advances the position. It
+    // stops when the position reaches the end of the region; returns the number
+    // of frames written. If the quality's tables have not been prepared, Cubic
+    // is used.
+    static int process(Quality quality, const Region & source, Position & position, double rate,
+                       float * const * dests, int framesToProcess);
+};
+
+}  // namespace lab
+
+#endif  // Resampler_h
@@ -55,6 +55,7 @@ private:
     enum { DefaultKernelSize = 128 };
 
     size_t m_inputBlockSize;
+    size_t m_historySize; // of m_inputBuffer, at least half the kernel
 
     // Computes ideal band-limited filter coefficients to sample in between each source sample-frame.
     // This filter will be used to compute the odd sample-frames of the output.
@@ -0,0 +1,61 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef VectorMathKernels_h
+#define VectorMathKernels_h
+
+#include "LabSound/extended/VectorMath.h"
+
+// Runtime dispatch for VectorMath. Each instruction set provides a table of
+// kernels operating on contiguous vectors; the public VectorMath functions
+// forward unit stride calls to the table for the selected SimdLevel. A null
+// entry means the baseline implementation in VectorMath.cpp is used.
+
+#if !defined(__APPLE__) && (defined(__x86_64__) || defined(_M_X64))
+#define LABSOUND_VECTORMATH_X86_DISPATCH 1
+#endif
+
+namespace lab
+{
+
+namespace VectorMath
+{
+    struct Kernels
+    {
+        void (*vsma)(const float * sourceP, float scale, float * destP, int framesToProcess);
+        void (*vsmul)(const float * sourceP, float scale, float * destP, int framesToProcess);
+        void (*vadd)(const float * source1P, const float * source2P, float * destP, int framesToProcess);
+        void (*vmul)(const float * source1P, const float * source2P, float * destP, int framesToProcess);
+        void (*vma)(const float * source1P, const float * source2P, const float * source3P, float * destP, int framesToProcess);
+        void (*zvmul)(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                      float * realDestP, float * imagDestP, int framesToProcess);
+        void (*zvmuladd)(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                         float * realAccP, float * imagAccP, int framesToProcess);
+        float (*vsvesq)(const float * sourceP, int framesToProcess);
+        float (*vmaxmgv)(const float * sourceP, int framesToProcess);
+        void (*vclip)(const float * sourceP, float lowThreshold, float highThreshold, float * destP, int framesToProcess);
+        void (*vramp)(float start, float step, float * destP, int framesToProcess);
+        void (*vrampmul)(const float * sourceP, float start, float step, float * destP, int framesToProcess);
+        void (*vrampmuladd)(const float * sourceP, float start, float step, float * destP, int framesToProcess);
+        void (*vintlvclip)(const float * const * sourceChannels, int channelCount, float lowThreshold, float highThreshold,
+                           float * destP, int framesToProcess);
+        void (*vdeintlvclip)(const float * sourceP, int channelCount, float lowThreshold, float highThreshold,
+                             float * const * destChannels, int framesToProcess);
+    };
+
+    // The kernels for the level in use
+    const Kernels & activeKernels();
+
+    // Each returns nullptr if the build does not include the instruction set.
+    // The AVX2 and AVX-512 tables live in translation units compiled for those
+    // instruction sets; they must only be called once the CPU is known to
+    // support them.
+    const Kernels * scalarKernels();
+    const Kernels * avx2Kernels();
+    const Kernels * avx512Kernels();
+
+}  // namespace VectorMath
+
+}  // namespace lab
+
+#endif  // VectorMathKernels_h
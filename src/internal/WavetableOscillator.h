@@ -0,0 +1,46 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#ifndef WavetableOscillator_h
+#define WavetableOscillator_h
+
+namespace lab
+{
+
+class PeriodicWave;
+
+// Plays a PeriodicWave. The wave's tables for the frequency being played are
+// read with linear interpolation between frames, and cross-faded between the
+// two neighbouring bands, so that no partial above Nyquist is heard.
+//
+// The read positions follow the frequency serially; the table reads and the
+// cross-fade are vectorised. The tables are chosen once for each span of
+// SpanFrames frames, from the frequency at its start, which is too short for
+// the change of band to be heard in a sweep.
+class WavetableOscillator
+{
+public:
+    WavetableOscillator();
+    ~WavetableOscillator();
+
+    // Writes framesToProcess frames of the wave, at unit amplitude, at the
+    // frequencies in Hz given for each frame. The wave may change between
+    // calls; the phase carries over.
+    void render(const PeriodicWave & wave, const float * frequencies, float * destination, int framesToProcess);
+
+    // The phase, in cycles, in [0, 1).
+    double phase() const { return m_phase; }
+    void setPhase(double phase) { m_phase = phase; }
+
+private:
+    enum
+    {
+        SpanFrames = 16
+    };
+
+    double m_phase = 0;
+};
+
+}  // namespace lab
+
+#endif  // WavetableOscillator_h
@@ -0,0 +1,285 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/Ambisonics.h"
+#include "internal/Assertions.h"
+#include "internal/HRTFDatabase.h"
+#include "internal/PartitionedConvolver.h"
+
+#include "LabSound/core/AudioArray.h"
+#include "LabSound/core/AudioChannel.h"
+#include "LabSound/core/Macros.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lab
+{
+
+namespace
+{
+    // The elevations of the IRCAM database, in degrees
+    const double MinDatabaseElevation = -45;
+    const double MaxDatabaseElevation = 90;
+    const double DatabaseElevationSpacing = 15;
+
+    struct Direction
+    {
+        double azimuth;
+        double elevation;
+    };
+
+    // The spherical harmonics in ACN order with SN3D normalization, of the unit vector x
+    // to the front, y to the left, and z up.
+    void sphericalHarmonics(int order, double x, double y, double z, double * gains)
+    {
+        gains[0] = 1;
+        if (order < 1)
+            return;
+
+        gains[1] = y;
+        gains[2] = z;
+        gains[3] = x;
+        if (order < 2)
+            return;
+
+        const double sqrt3 = std::sqrt(3.0);
+        gains[4] = sqrt3 * x * y;
+        gains[5] = sqrt3 * y * z;
+        gains[6] = 0.5 * (3 * z * z - 1);
+        gains[7] = sqrt3 * x * z;
+        gains[8] = 0.5 * sqrt3 * (x * x - y * y);
+        if (order < 3)
+            return;
+
+        const double sqrt5_8 = std::sqrt(5.0 / 8.0);
+        const double sqrt3_8 = std::sqrt(3.0 / 8.0);
+        const double sqrt15 = std::sqrt(15.0);
+        gains[9] = sqrt5_8 * y * (3 * x * x - y * y);
+        gains[10] = sqrt15 * x * y * z;
+        gains[11] = sqrt3_8 * y * (5 * z * z - 1);
+        gains[12] = 0.5 * z * (5 * z * z - 3);
+        gains[13] = sqrt3_8 * x * (5 * z * z - 1);
+        gains[14] = 0.5 * sqrt15 * z * (x * x - y * y);
+        gains[15] = sqrt5_8 * x * (x * x - 3 * y * y);
+    }
+
+    void sphericalHarmonics(int order, const Direction & direction, double * gains)
+    {
+        const double azimuth = direction.azimuth * static_cast<double>(LAB_PI) / 180.0;
+        const double elevation = direction.elevation * static_cast<double>(LAB_PI) / 180.0;
+        const double horizontal = std::cos(elevation);
+        sphericalHarmonics(order, horizontal * std::cos(azimuth), horizontal * std::sin(azimuth), std::sin(elevation), gains);
+    }
+
+    // count directions spread evenly over the sphere on a golden angle spiral, in pairs
+    // mirrored left to right so that the decoding is symmetric, and moved to the nearest
+    // azimuths and elevations the database has; those below its lowest elevation keep theirs.
+    std::vector<Direction> virtualSpeakers(int count)
+    {
+        const double goldenAngle = 180.0 * (3.0 - std::sqrt(5.0));
+        const int azimuths = static_cast<int>(HRTFDatabase::numberOfAzimuths());
+        const double azimuthSpacing = 360.0 / azimuths;
+        const int pairs = count / 2;
+
+        std::vector<Direction> speakers;
+        speakers.reserve(2 * pairs);
+        for (int i = 0; i < pairs; ++i)
+        {
+            double elevation = 180.0 * std::asin(1.0 - (2.0 * i + 1.0) / pairs) / static_cast<double>(LAB_PI);
+            if (elevation >= MinDatabaseElevation)
+            {
+                elevation = DatabaseElevationSpacing * std::round(elevation / DatabaseElevationSpacing);
+                elevation = std::min(std::max(elevation, MinDatabaseElevation), MaxDatabaseElevation);
+            }
+
+            const int azimuthIndex = static_cast<int>(std::lround(std::fmod(i * goldenAngle, 360.0) / azimuthSpacing)) % azimuths;
+            speakers.push_back({azimuthIndex * azimuthSpacing, elevation});
+            speakers.push_back({((azimuths - azimuthIndex) % azimuths) * azimuthSpacing, elevation});
+        }
+        return speakers;
+    }
+
+    // Inverts the n by n matrix a, in place, by Gauss-Jordan elimination. Returns false if
+    // it is singular.
+    bool invert(std::vector<double> & a, int n)
+    {
+        std::vector<double> inverse(n * n, 0.0);
+        for (int i = 0; i < n; ++i)
+            inverse[i * n + i] = 1;
+
+        for (int column = 0; column < n; ++column)
+        {
+            int pivot = column;
+            for (int row = column + 1; row < n; ++row)
+            {
+                if (std::fabs(a[row * n + column]) > std::fabs(a[pivot * n + column]))
+                    pivot = row;
+            }
+            if (std::fabs(a[pivot * n + column]) < 1e-12)
+                return false;
+
+            for (int i = 0; i < n; ++i)
+            {
+                std::swap(a[column * n + i], a[pivot * n + i]);
+                std::swap(inverse[column * n + i], inverse[pivot * n + i]);
+            }
+
+            const double scale = 1.0 / a[column * n + column];
+            for (int i = 0; i < n; ++i)
+            {
+                a[column * n + i] *= scale;
+                inverse[column * n + i] *= scale;
+            }
+
+            for (int row = 0; row < n; ++row)
+            {
+                const double factor = a[row * n + column];
+                if (row == column || !factor)
+                    continue;
+                for (int i = 0; i < n; ++i)
+                {
+                    a[row * n + i] -= factor * a[column * n + i];
+                    inverse[row * n + i] -= factor * inverse[column * n + i];
+                }
+            }
+        }
+
+        a.swap(inverse);
+        return true;
+    }
+}
+
+int Ambisonics::orderForChannelCount(int channelCount)
+{
+    int order = 0;
+    while (order < MaxOrder && Ambisonics::channelCount(order + 1) <= channelCount)
+        ++order;
+    return order;
+}
+
+void Ambisonics::encodingGains(int order, double azimuth, double elevation, float * gains)
+{
+    double harmonics[MaxChannelCount];
+    sphericalHarmonics(order, Direction {azimuth, elevation}, harmonics);
+    for (int i = 0; i < channelCount(order); ++i)
+        gains[i] = static_cast<float>(harmonics[i]);
+}
+
+AmbisonicBinauralDecoder::AmbisonicBinauralDecoder(const HRTFDatabase & database, int order, int blockSize)
+    : m_order(std::min(std::max(order, static_cast<int>(Ambisonics::MinOrder)), static_cast<int>(Ambisonics::MaxOrder)))
+{
+    const int channels = channelCount();
+
+    // Twice as many speakers as channels keep the matching well conditioned.
+    const std::vector<Direction> speakers = virtualSpeakers(2 * channels);
+    const int speakerCount = static_cast<int>(speakers.size());
+
+    // Y holds the harmonics of each speaker, Y[speaker * channels + channel]. The decoding
+    // gains, D = Y (Y' Y)^-1, re-encode to the identity.
+    std::vector<double> harmonics(speakerCount * channels);
+    for (int s = 0; s < speakerCount; ++s)
+        sphericalHarmonics(m_order, speakers[s], &harmonics[s * channels]);
+
+    std::vector<double> gram(channels * channels, 0.0);
+    for (int i = 0; i < channels; ++i)
+    {
+        for (int j = 0; j < channels; ++j)
+        {
+            double sum = 0;
+            for (int s = 0; s < speakerCount; ++s)
+                sum += harmonics[s * channels + i] * harmonics[s * channels + j];
+            gram[i * channels + j] = sum;
+        }
+    }
+
+    bool isInvertible = invert(gram, channels);
+    ASSERT(isInvertible);
+    if (!isInvertible)
+        return;
+
+    std::vector<double> decoding(speakerCount * channels, 0.0);
+    for (int s = 0; s < speakerCount; ++s)
+    {
+        for (int i = 0; i < channels; ++i)
+        {
+            double sum = 0;
+            for (int j = 0; j < channels; ++j)
+                sum += harmonics[s * channels + j] * gram[j * channels + i];
+            decoding[s * channels + i] = sum;
+        }
+    }
+
+    // Each speaker's response, with its leading delay restored, is summed into the
+    // response of every channel and ear by its decoding gain. The responses are no longer
+    // than half a transform, plus the delay.
+    std::vector<AudioFloatArray> responses(2 * channels);
+    for (int s = 0; s < speakerCount; ++s)
+    {
+        const int azimuthIndex = static_cast<int>(std::lround(speakers[s].azimuth * HRTFDatabase::numberOfAzimuths() / 360.0));
+        const HRTFKernel * kernels[2];
+        double frameDelayL;
+        double frameDelayR;
+        database.getKernelsFromAzimuthElevation(0, azimuthIndex, std::max(speakers[s].elevation, MinDatabaseElevation),
+                                                kernels[0], kernels[1], frameDelayL, frameDelayR);
+
+        bool areKernelsGood = kernels[0] && kernels[1];
+        ASSERT(areKernelsGood);
+        if (!areKernelsGood)
+            return;
+
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            std::unique_ptr<AudioChannel> response = kernels[ear]->createImpulseResponse();
+            const int length = std::min(static_cast<int>(response->length()),
+                                        kernels[ear]->fftSize() / 2 + static_cast<int>(std::ceil(kernels[ear]->frameDelay())));
+            m_responseLength = std::max(m_responseLength, length);
+
+            for (int i = 0; i < channels; ++i)
+            {
+                AudioFloatArray & sum = responses[ear * channels + i];
+                if (!sum.size())
+                    sum.allocate(response->length());
+
+                const float gain = static_cast<float>(decoding[s * channels + i]);
+                VectorMath::vsma(response->data(), 1, &gain, sum.data(), 1, length);
+            }
+        }
+    }
+
+    // The left ear's output sums each channel through its responses, and the right's
+    // through its own.
+    std::vector<const float *> responseData(2 * channels);
+    std::vector<int> routing(2 * channels);
+    for (int i = 0; i < 2 * channels; ++i)
+    {
+        responseData[i] = responses[i].data();
+        routing[i] = i;
+    }
+
+    auto prepared = PartitionedConvolver::prepareResponses(responseData.data(), 2 * channels, m_responseLength, 1.f, blockSize);
+    m_convolver.reset(new PartitionedConvolver(prepared, channels, 2, routing.data()));
+}
+
+AmbisonicBinauralDecoder::~AmbisonicBinauralDecoder() = default;
+
+void AmbisonicBinauralDecoder::process(const float * const * sources, float * const * dests, int framesToProcess)
+{
+    if (!m_convolver)
+    {
+        for (int ear = 0; ear < 2; ++ear)
+            std::fill(dests[ear], dests[ear] + framesToProcess, 0.f);
+        return;
+    }
+
+    m_convolver->process(sources, dests, framesToProcess);
+}
+
+void AmbisonicBinauralDecoder::reset()
+{
+    if (m_convolver)
+        m_convolver->reset();
+}
+
+}  // namespace lab
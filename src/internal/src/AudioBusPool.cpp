@@ -0,0 +1,101 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/AudioBusPool.h"
+#include "LabSound/core/AudioBus.h"
+
+#include <algorithm>
+
+namespace lab
+{
+
+namespace
+{
+    // AudioBus supports at most this many channels
+    const int kMaxChannels = 32;
+
+    // Mono and stereo are what nearly every node settles on, so they are
+    // stocked up front. Other channel counts are stocked once requested.
+    const int kDefaultStock = 2;
+    const int kMaxStock = 8;
+    const int kRetiredCapacity = 64;
+}
+
+AudioBusPool::AudioBusPool(int length)
+    : m_length(length)
+    , m_stock(kMaxChannels + 1)
+{
+    m_stock[1].target = kDefaultStock;
+    m_stock[2].target = kDefaultStock;
+    service();
+}
+
+AudioBusPool::~AudioBusPool()
+{
+    for (auto & stock : m_stock)
+        for (AudioBus * bus : stock.buses)
+            delete bus;
+
+    for (AudioBus * bus : m_retired)
+        delete bus;
+}
+
+bool AudioBusPool::exchange(std::unique_ptr<AudioBus> & bus, int numberOfChannels)
+{
+    if (numberOfChannels < 1 || numberOfChannels > kMaxChannels)
+        return false;
+
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return false;
+
+    Stock & stock = m_stock[numberOfChannels];
+    if (stock.buses.empty() || (bus && m_retired.size() == m_retired.capacity()))
+    {
+        ++stock.misses;
+        return false;
+    }
+
+    if (bus)
+        m_retired.push_back(bus.release());
+
+    bus.reset(stock.buses.back());
+    stock.buses.pop_back();
+    return true;
+}
+
+void AudioBusPool::service()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (AudioBus * bus : m_retired)
+    {
+        int channels = bus->numberOfChannels();
+        if (channels >= 1 && channels <= kMaxChannels && bus->length() == m_length &&
+            static_cast<int>(m_stock[channels].buses.size()) < kMaxStock)
+        {
+            bus->zero();
+            m_stock[channels].buses.push_back(bus);
+        }
+        else
+            delete bus;
+    }
+    m_retired.clear();
+    m_retired.reserve(kRetiredCapacity);
+
+    for (int channels = 1; channels <= kMaxChannels; ++channels)
+    {
+        Stock & stock = m_stock[channels];
+        if (stock.misses)
+        {
+            stock.target = std::min(kMaxStock, std::max(stock.target, 1) + stock.misses);
+            stock.misses = 0;
+        }
+
+        stock.buses.reserve(kMaxStock);
+        while (static_cast<int>(stock.buses.size()) < stock.target)
+            stock.buses.push_back(new AudioBus(channels, m_length));
+    }
+}
+
+}  // namespace lab
@@ -169,6 +169,15 @@ void Biquad::setNormalizedCoefficients(double b0, double b1, double b2, double a
     m_a2 = a2 * a0Inverse;
 }
 
+void Biquad::getCoefficients(double & b0, double & b1, double & b2, double & a1, double & a2) const
+{
+    b0 = m_b0;
+    b1 = m_b1;
+    b2 = m_b2;
+    a1 = m_a1;
+    a2 = m_a2;
+}
+
 void Biquad::setLowShelfParams(double frequency, double dbGain)
 {
     // Clip frequencies to between 0 and 1, inclusive.
@@ -0,0 +1,550 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/BiquadBank.h"
+#include "internal/Biquad.h"
+
+#include "LabSound/core/Macros.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+namespace lab
+{
+
+namespace
+{
+    // The fields of a stage of a block, each a block's width of lanes
+    enum Field : int
+    {
+        B0 = 0, B1, B2, A1, A2,                // coefficients
+        StepB0, StepB1, StepB2, StepA1, StepA2,  // their steps across a ramp
+        S1, S2,                                // state
+        FieldCount
+    };
+
+    // A SIMD register of lanes, and the arithmetic the filters need
+
+    template <typename T>
+    struct Scalar
+    {
+        using Type = T;
+        static const int Width = 1;
+        T v;
+
+        static Scalar load(const T * p) { return {*p}; }
+        void store(T * p) const { *p = v; }
+        friend Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+        friend Scalar operator-(Scalar a, Scalar b) { return {a.v - b.v}; }
+        friend Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+        friend Scalar operator/(Scalar a, Scalar b) { return {a.v / b.v}; }
+    };
+
+#ifdef __SSE2__
+    struct SingleLanes
+    {
+        using Type = float;
+        static const int Width = 4;
+        __m128 v;
+
+        static SingleLanes load(const float * p) { return {_mm_loadu_ps(p)}; }
+        void store(float * p) const { _mm_storeu_ps(p, v); }
+        friend SingleLanes operator+(SingleLanes a, SingleLanes b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend SingleLanes operator-(SingleLanes a, SingleLanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend SingleLanes operator*(SingleLanes a, SingleLanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+        friend SingleLanes operator/(SingleLanes a, SingleLanes b) { return {_mm_div_ps(a.v, b.v)}; }
+    };
+
+    struct DoubleLanes
+    {
+        using Type = double;
+        static const int Width = 2;
+        __m128d v;
+
+        static DoubleLanes load(const double * p) { return {_mm_loadu_pd(p)}; }
+        void store(double * p) const { _mm_storeu_pd(p, v); }
+        friend DoubleLanes operator+(DoubleLanes a, DoubleLanes b) { return {_mm_add_pd(a.v, b.v)}; }
+        friend DoubleLanes operator-(DoubleLanes a, DoubleLanes b) { return {_mm_sub_pd(a.v, b.v)}; }
+        friend DoubleLanes operator*(DoubleLanes a, DoubleLanes b) { return {_mm_mul_pd(a.v, b.v)}; }
+        friend DoubleLanes operator/(DoubleLanes a, DoubleLanes b) { return {_mm_div_pd(a.v, b.v)}; }
+    };
+#elif defined(ARM_NEON_INTRINSICS)
+    struct SingleLanes
+    {
+        using Type = float;
+        static const int Width = 4;
+        float32x4_t v;
+
+        static SingleLanes load(const float * p) { return {vld1q_f32(p)}; }
+        void store(float * p) const { vst1q_f32(p, v); }
+        friend SingleLanes operator+(SingleLanes a, SingleLanes b) { return {vaddq_f32(a.v, b.v)}; }
+        friend SingleLanes operator-(SingleLanes a, SingleLanes b) { return {vsubq_f32(a.v, b.v)}; }
+        friend SingleLanes operator*(SingleLanes a, SingleLanes b) { return {vmulq_f32(a.v, b.v)}; }
+        friend SingleLanes operator/(SingleLanes a, SingleLanes b)
+        {
+            float32x4_t r = vrecpeq_f32(b.v);
+            r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+            r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+            return {vmulq_f32(a.v, r)};
+        }
+    };
+
+    using DoubleLanes = Scalar<double>;
+#else
+    using SingleLanes = Scalar<float>;
+    using DoubleLanes = Scalar<double>;
+#endif
+
+    // A block is two registers of lanes, whose recursions are independent, so
+    // that they overlap in the pipeline
+    template <typename T> struct LanesOf;
+    template <> struct LanesOf<float> { using Type = SingleLanes; static const int Block = 2 * SingleLanes::Width; };
+    template <> struct LanesOf<double> { using Type = DoubleLanes; static const int Block = 2 * DoubleLanes::Width; };
+
+    // A stage of a register of lanes
+    template <class Lanes, bool Ramp>
+    struct Section
+    {
+        using T = typename Lanes::Type;
+        Lanes b0, b1, b2, a1, a2, s1, s2;
+        Lanes db0, db1, db2, da1, da2;
+
+        Section(const T * stage, int block)
+        {
+            b0 = Lanes::load(stage + B0 * block);
+            b1 = Lanes::load(stage + B1 * block);
+            b2 = Lanes::load(stage + B2 * block);
+            a1 = Lanes::load(stage + A1 * block);
+            a2 = Lanes::load(stage + A2 * block);
+            s1 = Lanes::load(stage + S1 * block);
+            s2 = Lanes::load(stage + S2 * block);
+            if (Ramp)
+            {
+                db0 = Lanes::load(stage + StepB0 * block);
+                db1 = Lanes::load(stage + StepB1 * block);
+                db2 = Lanes::load(stage + StepB2 * block);
+                da1 = Lanes::load(stage + StepA1 * block);
+                da2 = Lanes::load(stage + StepA2 * block);
+            }
+        }
+
+        void store(T * stage, int block) const
+        {
+            s1.store(stage + S1 * block);
+            s2.store(stage + S2 * block);
+        }
+
+        Lanes process(Lanes x)
+        {
+            if (Ramp)
+            {
+                b0 = b0 + db0;
+                b1 = b1 + db1;
+                b2 = b2 + db2;
+                a1 = a1 + da1;
+                a2 = a2 + da2;
+            }
+
+            const Lanes y = b0 * x + s1;
+            s1 = (b1 * x + s2) - a1 * y;
+            s2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    // Runs one stage of a block over frames interleaved a block's width to a
+    // frame, in place.
+    template <class Lanes, bool Ramp>
+    void runStage(typename Lanes::Type * stage, typename Lanes::Type * frames, int framesToProcess)
+    {
+        const int W = Lanes::Width;
+        const int Block = 2 * W;
+
+        Section<Lanes, Ramp> low(stage, Block);
+        Section<Lanes, Ramp> high(stage + W, Block);
+        for (int i = 0; i < framesToProcess; ++i)
+        {
+            typename Lanes::Type * frame = frames + i * Block;
+            const Lanes x0 = Lanes::load(frame);
+            const Lanes x1 = Lanes::load(frame + W);
+            low.process(x0).store(frame);
+            high.process(x1).store(frame + W);
+        }
+        low.store(stage, Block);
+        high.store(stage + W, Block);
+    }
+
+    // The index of a field of a lane of a stage, in a bank of blocks
+    inline size_t fieldIndex(int block, int stages, int stage, int field, int lane)
+    {
+        return ((static_cast<size_t>(lane / block) * stages + stage) * FieldCount + field) * block + lane % block;
+    }
+
+    inline size_t fieldCount(int block, int lanes, int stages)
+    {
+        return static_cast<size_t>((lanes + block - 1) / block) * stages * FieldCount * block;
+    }
+
+    // Copies every field of the first lanes and stages of a bank to another,
+    // which may differ in precision, block and stride; neither is resized
+    template <typename From, typename To>
+    void copyBank(const std::vector<From> & from, int fromStride, std::vector<To> & to, int stride, int lanes, int stages)
+    {
+        const int fromBlock = LanesOf<From>::Block;
+        const int block = LanesOf<To>::Block;
+
+        for (int stage = 0; stage < stages; ++stage)
+            for (int lane = 0; lane < lanes; ++lane)
+                for (int field = 0; field < FieldCount; ++field)
+                    to[fieldIndex(block, stride, stage, field, lane)] =
+                        static_cast<To>(from[fieldIndex(fromBlock, fromStride, stage, field, lane)]);
+    }
+
+    // Clears a lane of a stage, with its coefficients passing the input through
+    template <typename T>
+    void passThrough(std::vector<T> & bank, int stride, int stage, int lane)
+    {
+        const int block = LanesOf<T>::Block;
+        for (int field = 0; field < FieldCount; ++field)
+            bank[fieldIndex(block, stride, stage, field, lane)] = T(0);
+        bank[fieldIndex(block, stride, stage, B0, lane)] = T(1);
+    }
+}
+
+BiquadBank::Coefficients BiquadBank::design(FilterType type, double frequency, double Q, double dbGain)
+{
+    Biquad biquad;
+
+    // clang-format off
+    switch (type)
+    {
+        case FilterType::LOWPASS:   biquad.setLowpassParams(frequency, Q);           break;
+        case FilterType::HIGHPASS:  biquad.setHighpassParams(frequency, Q);          break;
+        case FilterType::BANDPASS:  biquad.setBandpassParams(frequency, Q);          break;
+        case FilterType::LOWSHELF:  biquad.setLowShelfParams(frequency, dbGain);     break;
+        case FilterType::HIGHSHELF: biquad.setHighShelfParams(frequency, dbGain);    break;
+        case FilterType::PEAKING:   biquad.setPeakingParams(frequency, Q, dbGain);   break;
+        case FilterType::NOTCH:     biquad.setNotchParams(frequency, Q);             break;
+        case FilterType::ALLPASS:   biquad.setAllpassParams(frequency, Q);           break;
+        default: break;
+    }
+    // clang-format on
+
+    Coefficients c;
+    biquad.getCoefficients(c.b0, c.b1, c.b2, c.a1, c.a2);
+    return c;
+}
+
+void BiquadBank::getFrequencyResponse(const Coefficients * stages, int stageCount, size_t n,
+                                      const float * frequency, float * magResponse, float * phaseResponse)
+{
+    // The response of a stage is
+    //
+    // H(z) = (b0 + b1*z^(-1) + b2*z^(-2))/(1 + a1*z^(-1) + a2*z^(-2))
+    //
+    // at z = exp(j*pi*frequency). The response of the cascade is the product
+    // of the stages', accumulated a register of frequencies at a time; the
+    // sines and cosines of each frequency are shared by every stage.
+    using Lanes = DoubleLanes;
+    const int W = Lanes::Width;
+    const int Chunk = 64;
+
+    double cos1[Chunk], sin1[Chunk], cos2[Chunk], sin2[Chunk];
+    double re[Chunk], im[Chunk];
+
+    for (size_t start = 0; start < n; start += Chunk)
+    {
+        const int count = static_cast<int>(std::min<size_t>(Chunk, n - start));
+        const int padded = (count + W - 1) / W * W;
+        for (int k = 0; k < padded; ++k)
+        {
+            const double omega = k < count ? static_cast<double>(LAB_PI) * frequency[start + k] : 0;
+            cos1[k] = std::cos(omega);
+            sin1[k] = std::sin(omega);
+            cos2[k] = 2 * cos1[k] * cos1[k] - 1;
+            sin2[k] = 2 * sin1[k] * cos1[k];
+            re[k] = 1;
+            im[k] = 0;
+        }
+
+        double ones[W];
+        std::fill(ones, ones + W, 1.0);
+        const Lanes one = Lanes::load(ones);
+        for (int s = 0; s < stageCount; ++s)
+        {
+            const Coefficients & c = stages[s];
+            double coefficient[5][W];
+            for (int w = 0; w < W; ++w)
+            {
+                coefficient[0][w] = c.b0;
+                coefficient[1][w] = c.b1;
+                coefficient[2][w] = c.b2;
+                coefficient[3][w] = c.a1;
+                coefficient[4][w] = c.a2;
+            }
+            const Lanes b0 = Lanes::load(coefficient[0]);
+            const Lanes b1 = Lanes::load(coefficient[1]);
+            const Lanes b2 = Lanes::load(coefficient[2]);
+            const Lanes a1 = Lanes::load(coefficient[3]);
+            const Lanes a2 = Lanes::load(coefficient[4]);
+
+            for (int k = 0; k < padded; k += W)
+            {
+                const Lanes c1 = Lanes::load(cos1 + k), s1 = Lanes::load(sin1 + k);
+                const Lanes c2 = Lanes::load(cos2 + k), s2 = Lanes::load(sin2 + k);
+
+                // z^(-1) = cos - j sin
+                const Lanes nr = b0 + b1 * c1 + b2 * c2;
+                const Lanes ni = b1 * s1 + b2 * s2;  // negated
+                const Lanes dr = one + a1 * c1 + a2 * c2;
+                const Lanes di = a1 * s1 + a2 * s2;  // negated
+
+                // (nr - j ni) / (dr - j di) = (nr - j ni)(dr + j di) / |d|^2
+                const Lanes scale = one / (dr * dr + di * di);
+                const Lanes hr = (nr * dr + ni * di) * scale;
+                const Lanes hi = (nr * di - ni * dr) * scale;
+
+                const Lanes r = Lanes::load(re + k), i = Lanes::load(im + k);
+                (r * hr - i * hi).store(re + k);
+                (r * hi + i * hr).store(im + k);
+            }
+        }
+
+        for (int k = 0; k < count; ++k)
+        {
+            magResponse[start + k] = static_cast<float>(std::sqrt(re[k] * re[k] + im[k] * im[k]));
+            phaseResponse[start + k] = static_cast<float>(std::atan2(im[k], re[k]));
+        }
+    }
+}
+
+BiquadBank::BiquadBank() {}
+BiquadBank::~BiquadBank() {}
+
+void BiquadBank::reserve(int lanes, int stages, int framesToProcess)
+{
+    lanes = std::max(lanes, m_laneCapacity);
+    stages = std::max(stages, m_stageCapacity);
+    framesToProcess = std::max(framesToProcess, m_frameCapacity);
+
+    if (lanes != m_laneCapacity || stages != m_stageCapacity)
+    {
+        std::vector<Coefficients> targets(static_cast<size_t>(lanes) * stages);
+        for (int stage = 0; stage < m_stages; ++stage)
+            for (int lane = 0; lane < m_lanes; ++lane)
+                targets[stage * lanes + lane] = m_targets[stage * m_laneCapacity + lane];
+        m_targets.swap(targets);
+
+        std::vector<float> single(fieldCount(LanesOf<float>::Block, lanes, stages));
+        std::vector<double> dbl(fieldCount(LanesOf<double>::Block, lanes, stages));
+        if (m_precision == Precision::Single)
+            copyBank(m_single, m_stageCapacity, single, stages, m_lanes, m_stages);
+        else
+            copyBank(m_double, m_stageCapacity, dbl, stages, m_lanes, m_stages);
+        m_single.swap(single);
+        m_double.swap(dbl);
+
+        m_laneCapacity = lanes;
+        m_stageCapacity = stages;
+    }
+
+    if (framesToProcess != m_frameCapacity)
+    {
+        m_scratchSingle.resize(static_cast<size_t>(framesToProcess) * LanesOf<float>::Block);
+        m_scratchDouble.resize(static_cast<size_t>(framesToProcess) * LanesOf<double>::Block);
+        m_frameCapacity = framesToProcess;
+    }
+}
+
+void BiquadBank::setSize(int lanes, int stages)
+{
+    lanes = std::max(0, lanes);
+    stages = std::max(0, stages);
+    if (lanes == m_lanes && stages == m_stages)
+        return;
+
+    if (lanes > m_laneCapacity || stages > m_stageCapacity)
+        reserve(lanes, stages, m_frameCapacity);
+
+    // the lanes and stages that are new pass their input through
+    for (int stage = 0; stage < stages; ++stage)
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            if (stage < m_stages && lane < m_lanes)
+                continue;
+
+            m_targets[stage * m_laneCapacity + lane] = Coefficients();
+            if (m_precision == Precision::Single)
+                passThrough(m_single, m_stageCapacity, stage, lane);
+            else
+                passThrough(m_double, m_stageCapacity, stage, lane);
+        }
+
+    m_lanes = lanes;
+    m_stages = stages;
+    m_changed = true;
+}
+
+void BiquadBank::setPrecision(Precision precision)
+{
+    if (precision == m_precision)
+        return;
+
+    if (precision == Precision::Single)
+        copyBank(m_double, m_stageCapacity, m_single, m_stageCapacity, m_lanes, m_stages);
+    else
+        copyBank(m_single, m_stageCapacity, m_double, m_stageCapacity, m_lanes, m_stages);
+    m_precision = precision;
+}
+
+void BiquadBank::setCoefficients(int stage, int lane, const Coefficients & c)
+{
+    if (stage < 0 || stage >= m_stages || lane < 0 || lane >= m_lanes)
+        return;
+    m_targets[stage * m_laneCapacity + lane] = c;
+    m_changed = true;
+}
+
+void BiquadBank::setCoefficients(int stage, const Coefficients & c)
+{
+    if (stage < 0 || stage >= m_stages)
+        return;
+    std::fill(m_targets.begin() + stage * m_laneCapacity, m_targets.begin() + stage * m_laneCapacity + m_lanes, c);
+    m_changed = true;
+}
+
+void BiquadBank::reset()
+{
+    if (m_precision == Precision::Single)
+    {
+        for (int stage = 0; stage < m_stages; ++stage)
+            for (int lane = 0; lane < m_lanes; ++lane)
+            {
+                m_single[fieldIndex(LanesOf<float>::Block, m_stageCapacity, stage, S1, lane)] = 0;
+                m_single[fieldIndex(LanesOf<float>::Block, m_stageCapacity, stage, S2, lane)] = 0;
+            }
+    }
+    else
+    {
+        for (int stage = 0; stage < m_stages; ++stage)
+            for (int lane = 0; lane < m_lanes; ++lane)
+            {
+                m_double[fieldIndex(LanesOf<double>::Block, m_stageCapacity, stage, S1, lane)] = 0;
+                m_double[fieldIndex(LanesOf<double>::Block, m_stageCapacity, stage, S2, lane)] = 0;
+            }
+    }
+}
+
+void BiquadBank::process(const float * const * sources, float * const * destinations, int framesToProcess, bool ramp)
+{
+    if (m_lanes < 1 || framesToProcess < 1)
+        return;
+
+    if (m_precision == Precision::Single)
+        processBlocks<SingleLanes>(m_single, m_scratchSingle, sources, destinations, framesToProcess, ramp);
+    else
+        processBlocks<DoubleLanes>(m_double, m_scratchDouble, sources, destinations, framesToProcess, ramp);
+}
+
+template <class Lanes, typename T>
+void BiquadBank::processBlocks(std::vector<T> & bank, std::vector<T> & scratch,
+                               const float * const * sources, float * const * destinations, int framesToProcess, bool ramp)
+{
+    const int Block = LanesOf<T>::Block;
+
+    // Coefficients that changed either step toward their targets across the
+    // frames, or replace the old ones
+    ramp = ramp && m_changed;
+    if (m_changed)
+    {
+        const T framesInverse = T(1) / framesToProcess;
+        for (int stage = 0; stage < m_stages; ++stage)
+            for (int lane = 0; lane < m_lanes; ++lane)
+            {
+                const Coefficients & c = m_targets[stage * m_laneCapacity + lane];
+                const T target[5] = {T(c.b0), T(c.b1), T(c.b2), T(c.a1), T(c.a2)};
+                for (int field = B0; field <= A2; ++field)
+                {
+                    T & coefficient = bank[fieldIndex(Block, m_stageCapacity, stage, field, lane)];
+                    T & step = bank[fieldIndex(Block, m_stageCapacity, stage, field + StepB0, lane)];
+                    if (ramp)
+                        step = (target[field] - coefficient) * framesInverse;
+                    else
+                        coefficient = target[field];
+                }
+            }
+    }
+
+    if (scratch.size() < static_cast<size_t>(framesToProcess) * Block)
+        scratch.resize(static_cast<size_t>(framesToProcess) * Block);
+    T * frames = scratch.data();
+
+    for (int first = 0; first < m_lanes; first += Block)
+    {
+        const int lanes = std::min(Block, m_lanes - first);
+
+        for (int lane = 0; lane < Block; ++lane)
+        {
+            if (lane < lanes)
+            {
+                const float * source = sources[first + lane];
+                for (int i = 0; i < framesToProcess; ++i)
+                    frames[i * Block + lane] = static_cast<T>(source[i]);
+            }
+            else
+            {
+                for (int i = 0; i < framesToProcess; ++i)
+                    frames[i * Block + lane] = 0;
+            }
+        }
+
+        for (int stage = 0; stage < m_stages; ++stage)
+        {
+            T * fields = &bank[fieldIndex(Block, m_stageCapacity, stage, 0, first)];
+            if (ramp)
+                runStage<Lanes, true>(fields, frames, framesToProcess);
+            else
+                runStage<Lanes, false>(fields, frames, framesToProcess);
+        }
+
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            float * destination = destinations[first + lane];
+            for (int i = 0; i < framesToProcess; ++i)
+                destination[i] = static_cast<float>(frames[i * Block + lane]);
+        }
+    }
+
+    // A ramp ends exactly on its targets
+    if (ramp)
+    {
+        for (int stage = 0; stage < m_stages; ++stage)
+            for (int lane = 0; lane < m_lanes; ++lane)
+            {
+                const Coefficients & c = m_targets[stage * m_laneCapacity + lane];
+                const T target[5] = {T(c.b0), T(c.b1), T(c.b2), T(c.a1), T(c.a2)};
+                for (int field = B0; field <= A2; ++field)
+                    bank[fieldIndex(Block, m_stageCapacity, stage, field, lane)] = target[field];
+            }
+    }
+    m_changed = false;
+}
+
+void BiquadBank::getFrequencyResponse(int lane, size_t n, const float * frequency, float * magResponse, float * phaseResponse) const
+{
+    if (lane < 0 || lane >= m_lanes)
+        return;
+
+    std::vector<Coefficients> stages(m_stages);
+    for (int stage = 0; stage < m_stages; ++stage)
+        stages[stage] = m_targets[stage * m_laneCapacity + lane];
+    getFrequencyResponse(stages.data(), m_stages, n, frequency, magResponse, phaseResponse);
+}
+
+}  // namespace lab
@@ -3,20 +3,29 @@
 // Copyright (C) 2015+, The LabSound Authors. All rights reserved.
 
 #include "internal/DelayProcessor.h"
-#include "internal/AudioDSPKernelProcessor.h"
-#include "internal/DelayDSPKernel.h"
+#include "internal/AudioUtilities.h"
+
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioContext.h"
+#include "LabSound/extended/AudioContextLock.h"
+
+#include <algorithm>
 
 using namespace std;
 
 namespace lab
 {
 
+const float SmoothingTimeConstant = 0.020f;  // 20ms
+const int kMaxChannels = 32;  // the most an AudioBus can have
 
-DelayProcessor::DelayProcessor(float sampleRate, double maxDelayTime, std::shared_ptr<AudioSetting> t)
-    : AudioDSPKernelProcessor()
+DelayProcessor::DelayProcessor(float sampleRate, int renderQuantumSize, double maxDelayTime, std::shared_ptr<AudioSetting> t, std::shared_ptr<AudioParam> modulation)
+    : AudioProcessor()
+    , m_delayTime(t)
+    , m_modulation(modulation)
     , m_maxDelayTime(maxDelayTime)
     , m_sampleRate(sampleRate)
-    , m_delayTime(t)
+    , m_renderQuantumSize(renderQuantumSize)
 {
 }
 
@@ -26,9 +35,74 @@ DelayProcessor::~DelayProcessor()
         uninitialize();
 }
 
-AudioDSPKernel * DelayProcessor::createKernel()
+void DelayProcessor::initialize()
+{
+    m_delay.setSmoothingRate(AudioUtilities::discreteTimeConstantForSampleRate(SmoothingTimeConstant, m_sampleRate));
+    m_delay.setSize(kMaxChannels, 1, m_maxDelayTime * m_sampleRate);
+    m_delay.setActive(0, 1);
+    m_sources.resize(kMaxChannels);
+    m_destinations.resize(kMaxChannels);
+    m_delays.resize(m_renderQuantumSize);
+    m_initialized = true;
+}
+
+void DelayProcessor::uninitialize()
+{
+    m_delay.setSize(0, 0, 0);
+    m_initialized = false;
+}
+
+void DelayProcessor::process(ContextRenderLock & r, const AudioBus * source, AudioBus * destination, int framesToProcess)
+{
+    if (!source || !destination)
+        return;
+
+    if (!isInitialized())
+    {
+        destination->zero();
+        return;
+    }
+
+    const int channels = std::min(source->numberOfChannels(), destination->numberOfChannels());
+    const float sampleRate = r.context()->sampleRate();
+    if (m_delay.channels() != channels)
+    {
+        // the lines were allocated by initialize(), unless the sample rate wasn't known then
+        if (m_delay.maxDelayFrames() < m_maxDelayTime * sampleRate)
+            m_delay.setSize(kMaxChannels, 1, m_maxDelayTime * sampleRate);
+        m_delay.setActive(channels, 1);
+    }
+    for (int c = 0; c < channels; ++c)
+    {
+        m_sources[c] = source->channel(c)->data();
+        m_destinations[c] = destination->channel(c)->mutableData();
+    }
+
+    // The engine clamps the delay to the range it can read
+    const float delayTime = m_delayTime->valueFloat();
+
+    MultiTapDelay::Tap tap;
+    if (m_modulation && m_modulation->hasSampleAccurateValues())
+    {
+        if (m_delays.size() < static_cast<size_t>(framesToProcess))
+            m_delays.resize(framesToProcess);
+        m_modulation->calculateSampleAccurateValues(r, m_delays.data(), framesToProcess);
+        for (int i = 0; i < framesToProcess; ++i)
+            m_delays[i] = (delayTime + m_delays[i]) * sampleRate;
+        tap.delays = m_delays.data();
+    }
+    else
+    {
+        const float modulation = m_modulation ? m_modulation->value() : 0.f;
+        tap.delay = (delayTime + modulation) * sampleRate;
+    }
+
+    m_delay.process(m_sources.data(), m_destinations.data(), framesToProcess, &tap);
+}
+
+void DelayProcessor::reset()
 {
-    return new DelayDSPKernel(this, m_sampleRate);
+    m_delay.reset();
 }
 
 }  // namespace lab
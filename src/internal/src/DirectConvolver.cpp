@@ -39,11 +39,15 @@
 #include "LabSound/extended/VectorMath.h"
 #include "LabSound/core/Macros.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace lab {
     
-DirectConvolver::DirectConvolver(size_t inputBlockSize)
+DirectConvolver::DirectConvolver(size_t inputBlockSize, size_t maxKernelSize)
     : m_inputBlockSize(inputBlockSize)
-    , m_buffer((int)(inputBlockSize * 2))
+    , m_historySize(std::max(inputBlockSize, maxKernelSize))
+    , m_buffer((int)(m_historySize + inputBlockSize))
 {
 }
 
@@ -53,10 +57,10 @@ void DirectConvolver::process(AudioFloatArray* convolutionKernel, const float* s
     if (framesToProcess != m_inputBlockSize)
         return;
 
-    // Only support kernelSize <= m_inputBlockSize
+    // Only support kernelSize <= m_historySize
     size_t kernelSize = convolutionKernel->size();
-    ASSERT(kernelSize <= m_inputBlockSize);
-    if (kernelSize > m_inputBlockSize)
+    ASSERT(kernelSize <= m_historySize);
+    if (kernelSize > m_historySize)
         return;
 
     float* kernelP = convolutionKernel->data();
@@ -67,9 +71,9 @@ void DirectConvolver::process(AudioFloatArray* convolutionKernel, const float* s
     if (!isCopyGood)
         return;
 
-    float* inputP = m_buffer.data() + m_inputBlockSize;
+    float* inputP = m_buffer.data() + m_historySize;
 
-    // Copy samples to 2nd half of input buffer.
+    // Copy samples after the history.
     memcpy(inputP, sourceP, sizeof(float) * framesToProcess);
 
 #if defined(LABSOUND_PLATFORM_OSX) //#if USE(ACCELERATE)
@@ -346,8 +350,8 @@ void DirectConvolver::process(AudioFloatArray* convolutionKernel, const float* s
     }
 #endif // USE(ACCELERATE)
 
-    // Copy 2nd half of input buffer to 1st half.
-    memcpy(m_buffer.data(), inputP, sizeof(float) * framesToProcess);
+    // Keep the latest m_historySize frames as the history.
+    memmove(m_buffer.data(), m_buffer.data() + framesToProcess, sizeof(float) * m_historySize);
 }
 
 void DirectConvolver::reset()
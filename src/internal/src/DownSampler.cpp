@@ -30,15 +30,19 @@
 #include "DownSampler.h"
 #include "LabSound/core/Macros.h"
 #include "internal/Assertions.h"
+
+#include <algorithm>
+#include <cstring>
 //#include <wtf/MathExtras.h>
 
 namespace lab {
 
 DownSampler::DownSampler(size_t inputBlockSize)
     : m_inputBlockSize(inputBlockSize)
-    , m_convolver(inputBlockSize / 2) // runs at 1/2 source sample-rate
+    , m_historySize(std::max<size_t>(inputBlockSize, DefaultKernelSize / 2))
+    , m_convolver(inputBlockSize / 2, DefaultKernelSize / 2) // runs at 1/2 source sample-rate
     , m_tempBuffer((int) inputBlockSize / 2)
-    , m_inputBuffer((int) inputBlockSize * 2)
+    , m_inputBuffer((int) (m_historySize + inputBlockSize))
 {
     initializeKernel();
 }
@@ -98,13 +102,13 @@ void DownSampler::process(const float* sourceP, float* destP, size_t sourceFrame
 
     size_t halfSize = DefaultKernelSize / 2;
 
-    // Copy source samples to 2nd half of input buffer.
-    bool isInputBufferGood = m_inputBuffer.size() == sourceFramesToProcess * 2 && halfSize <= sourceFramesToProcess;
+    // Copy source samples after the history in the input buffer.
+    bool isInputBufferGood = m_inputBuffer.size() == m_historySize + sourceFramesToProcess && halfSize <= m_historySize;
     ASSERT(isInputBufferGood);
     if (!isInputBufferGood)
         return;
 
-    float* inputP = m_inputBuffer.data() + sourceFramesToProcess;
+    float* inputP = m_inputBuffer.data() + m_historySize;
     memcpy(inputP, sourceP, sizeof(float) * sourceFramesToProcess);
 
     // Copy the odd sample-frames from sourceP, delayed by one sample-frame (destination sample-rate)
@@ -125,8 +129,8 @@ void DownSampler::process(const float* sourceP, float* destP, size_t sourceFrame
     for (unsigned i = 0; i < destFramesToProcess; ++i)
         destP[i] += (float) (0.5 * *((inputP - halfSize) + i * 2));
 
-    // Copy 2nd half of input buffer to 1st half.
-    memcpy(m_inputBuffer.data(), inputP, sizeof(float) * sourceFramesToProcess);
+    // Keep the latest m_historySize frames as the history.
+    memmove(m_inputBuffer.data(), m_inputBuffer.data() + sourceFramesToProcess, sizeof(float) * m_historySize);
 }
 
 void DownSampler::reset()
@@ -258,7 +258,9 @@ void DynamicsCompressorKernel::process(ContextRenderLock & r,
 
     setPreDelayTime(preDelayTime, r.context()->sampleRate());
 
-    const int nDivisionFrames = 32;
+    // the desired gain is recalculated every division; render quanta shorter
+    // than a division are processed as a single division.
+    const int nDivisionFrames = std::min(32, framesToProcess);
 
     const int nDivisions = framesToProcess / nDivisionFrames;
 
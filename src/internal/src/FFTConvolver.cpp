@@ -21,6 +21,11 @@ FFTConvolver::FFTConvolver(int fftSize)
 }
 
 void FFTConvolver::process(FFTFrame * fftKernel, const float * sourceP, float * destP, int framesToProcess)
+{
+    process(fftKernel->realData(), fftKernel->imagData(), sourceP, destP, framesToProcess);
+}
+
+void FFTConvolver::process(const float * kernelReal, const float * kernelImag, const float * sourceP, float * destP, int framesToProcess)
 {
     int halfSize = fftSize() / 2;
 
@@ -71,7 +76,7 @@ void FFTConvolver::process(FFTFrame * fftKernel, const float * sourceP, float *
 
             // The input buffer is now filled (get frequency-domain version)
             m_frame.computeForwardFFT(m_inputBuffer.data());
-            m_frame.multiply(*fftKernel);
+            m_frame.multiply(kernelReal, kernelImag);
             m_frame.computeInverseFFT(m_outputBuffer.data());
 
             // Overlap-add 1st half from previous time
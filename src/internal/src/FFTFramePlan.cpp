@@ -0,0 +1,101 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/core/Macros.h"
+#include "internal/Assertions.h"
+
+#if defined(USE_KISS_FFT)
+
+#include "internal/FFTFrame.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include <cmath>
+#include <cstring>
+
+// To use this implementation, add USE_KISS_FFT=1 to the list of preprocessor defines.
+// The transforms are done by the shared FFTPlan of the frame's size, of the default
+// backend at the time the frame is made.
+namespace lab
+{
+
+// Normal constructor: allocates for a given fftSize.
+FFTFrame::FFTFrame(int fftSize)
+    : m_FFTSize(fftSize), m_log2FFTSize(static_cast<int>(log2((double) fftSize)))
+    , m_plan(FFTPlan::get(fftSize)), m_realData(fftSize / 2 + 1), m_imagData(fftSize / 2 + 1)
+    , m_work(m_plan->workSize())
+{
+    // We only allow power of two.
+    ASSERT((1 << m_log2FFTSize) == m_FFTSize);
+}
+
+// Creates a blank/empty frame (interpolate() must later be called).
+FFTFrame::FFTFrame() : m_FFTSize(0), m_log2FFTSize(0)
+{
+}
+
+// Copy constructor.
+FFTFrame::FFTFrame(const FFTFrame & frame) 
+    : m_FFTSize(frame.m_FFTSize), m_log2FFTSize(frame.m_log2FFTSize)
+    , m_plan(frame.m_plan), m_realData(frame.m_FFTSize / 2 + 1), m_imagData(frame.m_FFTSize / 2 + 1)
+{
+    if (m_plan)
+        m_work.allocate(m_plan->workSize());
+
+    // Copy/setup frame data.
+    unsigned nbytes = sizeof(float) * binCount();
+
+    memcpy(realData(), frame.realData(), nbytes);
+    memcpy(imagData(), frame.imagData(), nbytes);
+}
+
+FFTFrame::~FFTFrame()
+{
+}
+
+void FFTFrame::multiply(const FFTFrame & frame)
+{
+    multiply(frame.realData(), frame.imagData());
+}
+
+void FFTFrame::multiply(const float * realP2, const float * imagP2)
+{
+    float * realP1 = realData();
+    float * imagP1 = imagData();
+
+    float real0 = realP1[0];
+    float imag0 = imagP1[0];
+    VectorMath::zvmul(realP1, imagP1, realP2, imagP2, realP1, imagP1, binCount());
+
+    // Multiply the DC component
+    realP1[0] = real0 * realP2[0];
+    imagP1[0] = imag0 * imagP2[0];
+}
+
+void FFTFrame::computeForwardFFT(const float * data)
+{
+    m_plan->forward(data, m_realData.data(), m_imagData.data(), m_work.data());
+}
+
+void FFTFrame::computeInverseFFT(float * data)
+{
+    m_plan->inverse(m_realData.data(), m_imagData.data(), data, m_work.data());
+
+    // Scale so that a forward then inverse FFT yields exactly the original data.
+    //  x == IFFT(FFT(x))
+    const float scale = 1.0f / m_FFTSize;
+    VectorMath::vsmul(data, 1, &scale, data, 1, m_FFTSize);
+}
+
+float * FFTFrame::realData() const
+{
+    return const_cast<float *>(m_realData.data());
+}
+
+float * FFTFrame::imagData() const
+{
+    return const_cast<float *>(m_imagData.data());
+}
+
+}  // namespace lab
+
+#endif  // USE KISS FFT
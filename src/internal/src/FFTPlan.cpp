@@ -0,0 +1,211 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/core/Macros.h"
+#include "internal/Assertions.h"
+
+#if defined(USE_KISS_FFT)
+
+#include "internal/FFTPlan.h"
+
+#include <kissfft/kiss_fft.hpp>
+#include <ooura/fftsg.h>
+
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace lab
+{
+
+static std::atomic<int> s_defaultBackend(static_cast<int>(FFTBackend::Stockham));
+
+std::shared_ptr<const FFTPlan> FFTPlan::get(int size, FFTBackend backend)
+{
+    ASSERT(size >= 2 && (size & (size - 1)) == 0);
+
+    // leaked, so that plans outlive any static frames
+    static std::mutex * mutex = new std::mutex;
+    static auto * plans = new std::map<std::pair<int, int>, std::shared_ptr<const FFTPlan>>;
+
+    std::lock_guard<std::mutex> lock(*mutex);
+    std::shared_ptr<const FFTPlan> & plan = (*plans)[std::make_pair(size, static_cast<int>(backend))];
+    if (!plan)
+    {
+        switch (backend)
+        {
+            case FFTBackend::Kiss: plan = createKissPlan(size); break;
+            case FFTBackend::Ooura: plan = createOouraPlan(size); break;
+            case FFTBackend::Stockham: plan = createStockhamPlan(size); break;
+        }
+    }
+    return plan;
+}
+
+FFTBackend FFTPlan::defaultBackend()
+{
+    return static_cast<FFTBackend>(s_defaultBackend.load(std::memory_order_relaxed));
+}
+
+void FFTPlan::setDefaultBackend(FFTBackend backend)
+{
+    s_defaultBackend.store(static_cast<int>(backend), std::memory_order_relaxed);
+}
+
+const char * FFTPlan::backendName(FFTBackend backend)
+{
+    switch (backend)
+    {
+        case FFTBackend::Kiss: return "KissFFT";
+        case FFTBackend::Ooura: return "Ooura";
+        case FFTBackend::Stockham: return "Stockham";
+    }
+    return "";
+}
+
+// KissFFT's complex transform of the even samples as real parts and the odd ones as
+// imaginary, untangled as kiss_fftr does. kiss_fftr keeps scratch in its configuration,
+// but the complex transform does not when it is out of place, so this can be shared.
+class KissPlan final : public FFTPlan
+{
+public:
+    explicit KissPlan(int size)
+        : FFTPlan(size, size, FFTBackend::Kiss)
+        , m_half(size / 2)
+        , m_forward(kiss_fft_alloc(size / 2, 0, nullptr, nullptr))
+        , m_inverse(kiss_fft_alloc(size / 2, 1, nullptr, nullptr))
+        , m_twiddles(size / 2)
+    {
+        const double pi = 3.14159265358979323846;
+        for (int k = 0; k < m_half; ++k)
+        {
+            double theta = 2.0 * pi * k / size;
+            m_twiddles[k].r = static_cast<float>(std::cos(theta));
+            m_twiddles[k].i = static_cast<float>(-std::sin(theta));
+        }
+    }
+
+    ~KissPlan()
+    {
+        KISS_FFT_FREE(m_forward);
+        KISS_FFT_FREE(m_inverse);
+    }
+
+    void forward(const float * input, float * real, float * imag, float * work) const override
+    {
+        kiss_fft_cpx * z = reinterpret_cast<kiss_fft_cpx *>(work);
+        kiss_fft(m_forward, reinterpret_cast<const kiss_fft_cpx *>(input), z);
+
+        const int half = m_half;
+        real[0] = z[0].r + z[0].i;
+        imag[0] = 0.f;
+        real[half] = z[0].r - z[0].i;
+        imag[half] = 0.f;
+        for (int k = 1; k < half; ++k)
+        {
+            float a = z[k].r, b = z[k].i, c = z[half - k].r, d = z[half - k].i;
+            float orr = 0.5f * (b + d), oi = 0.5f * (c - a);
+            float wr = m_twiddles[k].r, wi = m_twiddles[k].i;
+            real[k] = 0.5f * (a + c) + wr * orr - wi * oi;
+            imag[k] = 0.5f * (b - d) + wr * oi + wi * orr;
+        }
+    }
+
+    void inverse(const float * real, const float * imag, float * output, float * work) const override
+    {
+        kiss_fft_cpx * z = reinterpret_cast<kiss_fft_cpx *>(work);
+
+        const int half = m_half;
+        z[0].r = real[0] + real[half];
+        z[0].i = real[0] - real[half];
+        for (int k = 1; k < half; ++k)
+        {
+            float a = real[k], b = imag[k], c = real[half - k], d = imag[half - k];
+            float dr = a - c, di = b + d;
+            float wr = m_twiddles[k].r, wi = m_twiddles[k].i;
+            z[k].r = a + c - (wr * di - wi * dr);
+            z[k].i = b - d + (wr * dr + wi * di);
+        }
+
+        kiss_fft(m_inverse, z, reinterpret_cast<kiss_fft_cpx *>(output));
+    }
+
+private:
+    int m_half;
+    kiss_fft_cfg m_forward;
+    kiss_fft_cfg m_inverse;
+    std::vector<kiss_fft_cpx> m_twiddles;
+};
+
+// Ooura's rdft works in place on a packed spectrum: the real parts of DC and Nyquist
+// first, then each bin's real part and its imaginary part negated. Its tables are
+// made on the first call, and only read by later ones.
+class OouraPlan final : public FFTPlan
+{
+public:
+    explicit OouraPlan(int size)
+        : FFTPlan(size, size, FFTBackend::Ooura)
+        , m_ip(2 + static_cast<int>(std::sqrt(size / 2)))
+        , m_w(size / 2)
+    {
+        std::vector<float> dummy(size);
+        ooura::rdft(size, 1, dummy.data(), m_ip.data(), m_w.data());
+    }
+
+    void forward(const float * input, float * real, float * imag, float * work) const override
+    {
+        const int n = size();
+        std::copy(input, input + n, work);
+        ooura::rdft(n, 1, work, const_cast<int *>(m_ip.data()), const_cast<float *>(m_w.data()));
+
+        const int half = n / 2;
+        real[0] = work[0];
+        imag[0] = 0.f;
+        real[half] = work[1];
+        imag[half] = 0.f;
+        for (int k = 1; k < half; ++k)
+        {
+            real[k] = work[2 * k];
+            imag[k] = -work[2 * k + 1];
+        }
+    }
+
+    void inverse(const float * real, const float * imag, float * output, float * work) const override
+    {
+        const int n = size();
+        const int half = n / 2;
+        output[0] = real[0];
+        output[1] = real[half];
+        for (int k = 1; k < half; ++k)
+        {
+            output[2 * k] = real[k];
+            output[2 * k + 1] = -imag[k];
+        }
+
+        // rdft's inverse is half of the unscaled transform
+        ooura::rdft(n, -1, output, const_cast<int *>(m_ip.data()), const_cast<float *>(m_w.data()));
+        for (int i = 0; i < n; ++i)
+            output[i] *= 2.f;
+    }
+
+private:
+    std::vector<int> m_ip;
+    std::vector<float> m_w;
+};
+
+std::unique_ptr<FFTPlan> createKissPlan(int size)
+{
+    return std::unique_ptr<FFTPlan>(new KissPlan(size));
+}
+
+std::unique_ptr<FFTPlan> createOouraPlan(int size)
+{
+    return std::unique_ptr<FFTPlan>(new OouraPlan(size));
+}
+
+}  // namespace lab
+
+#endif  // USE_KISS_FFT
@@ -0,0 +1,475 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/core/Macros.h"
+#include "internal/Assertions.h"
+
+#if defined(USE_KISS_FFT)
+
+#include "internal/FFTPlan.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define FFT_SIMD 1
+#elif defined(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#define FFT_SIMD 1
+#else
+#define FFT_SIMD 0
+#endif
+
+// A real FFT in the manner of PFFFT: the input is packed into a complex sequence of
+// half the size, transformed by radix-4 Stockham autosort passes on separate arrays
+// of real and imaginary parts, and the two halves of the spectrum are then untangled.
+// Every pass reads and writes contiguous runs of four, so each butterfly works on four
+// transforms, or four points of one, at once, with no bit reversal.
+
+namespace lab
+{
+
+namespace
+{
+
+#if FFT_SIMD
+
+#ifdef __SSE2__
+    typedef __m128 v4;
+
+    inline v4 load(const float * p) { return _mm_loadu_ps(p); }
+    inline void store(float * p, v4 a) { _mm_storeu_ps(p, a); }
+    inline v4 splat(float x) { return _mm_set1_ps(x); }
+    inline v4 add(v4 a, v4 b) { return _mm_add_ps(a, b); }
+    inline v4 sub(v4 a, v4 b) { return _mm_sub_ps(a, b); }
+    inline v4 mul(v4 a, v4 b) { return _mm_mul_ps(a, b); }
+    inline v4 reverse(v4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3)); }
+    inline void transpose(v4 & a, v4 & b, v4 & c, v4 & d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+
+    // p[0..7] holds four interleaved complex values
+    inline void deinterleave(const float * p, v4 & re, v4 & im)
+    {
+        v4 lo = load(p);
+        v4 hi = load(p + 4);
+        re = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        im = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+
+    inline void interleave(float * p, v4 re, v4 im)
+    {
+        store(p, _mm_unpacklo_ps(re, im));
+        store(p + 4, _mm_unpackhi_ps(re, im));
+    }
+#else
+    typedef float32x4_t v4;
+
+    inline v4 load(const float * p) { return vld1q_f32(p); }
+    inline void store(float * p, v4 a) { vst1q_f32(p, a); }
+    inline v4 splat(float x) { return vdupq_n_f32(x); }
+    inline v4 add(v4 a, v4 b) { return vaddq_f32(a, b); }
+    inline v4 sub(v4 a, v4 b) { return vsubq_f32(a, b); }
+    inline v4 mul(v4 a, v4 b) { return vmulq_f32(a, b); }
+
+    inline v4 reverse(v4 a)
+    {
+        v4 r = vrev64q_f32(a);
+        return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+    }
+
+    inline void transpose(v4 & a, v4 & b, v4 & c, v4 & d)
+    {
+        float32x4x2_t ab = vtrnq_f32(a, b);
+        float32x4x2_t cd = vtrnq_f32(c, d);
+        a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+
+    inline void deinterleave(const float * p, v4 & re, v4 & im)
+    {
+        float32x4x2_t x = vld2q_f32(p);
+        re = x.val[0];
+        im = x.val[1];
+    }
+
+    inline void interleave(float * p, v4 re, v4 im)
+    {
+        float32x4x2_t x = {{re, im}};
+        vst2q_f32(p, x);
+    }
+#endif
+
+    // (ar + i ai) * (br + i bi)
+    inline void cmul(v4 ar, v4 ai, v4 br, v4 bi, v4 & r, v4 & i)
+    {
+        r = sub(mul(ar, br), mul(ai, bi));
+        i = add(mul(ar, bi), mul(ai, br));
+    }
+
+#endif  // FFT_SIMD
+
+    inline void cmul(float ar, float ai, float br, float bi, float & r, float & i)
+    {
+        r = ar * br - ai * bi;
+        i = ar * bi + ai * br;
+    }
+
+}  // namespace
+
+class StockhamPlan final : public FFTPlan
+{
+public:
+    explicit StockhamPlan(int size)
+        : FFTPlan(size, size * 2, FFTBackend::Stockham)
+        , m_half(size / 2)
+    {
+        const double pi = 3.14159265358979323846;
+
+        // A radix-4 pass on sub-transforms of n points, s of them interleaved, takes
+        // the twiddles w^p, w^2p and w^3p, w = e^(-2 pi i / n), for p < n / 4. An odd
+        // power of two leaves a final radix-2 pass, which needs none.
+        int n = m_half;
+        int s = 1;
+        while (n >= 4)
+        {
+            const int m = n / 4;
+            m_passes.push_back({n, s, static_cast<int>(m_twiddles.size())});
+            m_twiddles.resize(m_twiddles.size() + 6 * m);
+            float * w = m_twiddles.data() + m_passes.back().twiddles;
+            for (int p = 0; p < m; ++p)
+            {
+                for (int k = 1; k <= 3; ++k)
+                {
+                    double theta = 2.0 * pi * k * p / n;
+                    w[(2 * k - 2) * m + p] = static_cast<float>(std::cos(theta));
+                    w[(2 * k - 1) * m + p] = static_cast<float>(-std::sin(theta));
+                }
+            }
+            n /= 4;
+            s *= 4;
+        }
+        if (n == 2)
+            m_passes.push_back({2, s, -1});
+
+        // e^(-2 pi i k / size), to untangle the spectrum of the packed sequence
+        m_untangleReal.resize(m_half);
+        m_untangleImag.resize(m_half);
+        for (int k = 0; k < m_half; ++k)
+        {
+            double theta = 2.0 * pi * k / size;
+            m_untangleReal[k] = static_cast<float>(std::cos(theta));
+            m_untangleImag[k] = static_cast<float>(-std::sin(theta));
+        }
+    }
+
+    void forward(const float * input, float * real, float * imag, float * work) const override
+    {
+        const int half = m_half;
+        float * zr = work;
+        float * zi = work + half;
+
+        // the even samples are the real parts, and the odd ones the imaginary
+        int k = 0;
+#if FFT_SIMD
+        for (; k + 4 <= half; k += 4)
+        {
+            v4 re, im;
+            deinterleave(input + 2 * k, re, im);
+            store(zr + k, re);
+            store(zi + k, im);
+        }
+#endif
+        for (; k < half; ++k)
+        {
+            zr[k] = input[2 * k];
+            zi[k] = input[2 * k + 1];
+        }
+
+        transform(zr, zi, work + half * 2, work + half * 3);
+
+        // With Z the transform of the packed sequence, and Z' its conjugate reflected,
+        // Z'[k] = conj(Z[half - k]), the spectrum is
+        //   X[k] = (Z[k] + Z'[k]) / 2 - i w^k (Z[k] - Z'[k]) / 2
+        real[0] = zr[0] + zi[0];
+        imag[0] = 0.f;
+        real[half] = zr[0] - zi[0];
+        imag[half] = 0.f;
+
+        k = 1;
+#if FFT_SIMD
+        const v4 one_half = splat(0.5f);
+        for (; k + 4 <= half; k += 4)
+        {
+            v4 a = load(zr + k);
+            v4 b = load(zi + k);
+            v4 c = reverse(load(zr + half - k - 3));
+            v4 d = reverse(load(zi + half - k - 3));
+            v4 er = mul(add(a, c), one_half);
+            v4 ei = mul(sub(b, d), one_half);
+            v4 orr = mul(add(b, d), one_half);
+            v4 oi = mul(sub(c, a), one_half);
+            v4 tr, ti;
+            cmul(load(m_untangleReal.data() + k), load(m_untangleImag.data() + k), orr, oi, tr, ti);
+            store(real + k, add(er, tr));
+            store(imag + k, add(ei, ti));
+        }
+#endif
+        for (; k < half; ++k)
+        {
+            float a = zr[k], b = zi[k], c = zr[half - k], d = zi[half - k];
+            float tr, ti;
+            cmul(m_untangleReal[k], m_untangleImag[k], 0.5f * (b + d), 0.5f * (c - a), tr, ti);
+            real[k] = 0.5f * (a + c) + tr;
+            imag[k] = 0.5f * (b - d) + ti;
+        }
+    }
+
+    void inverse(const float * real, const float * imag, float * output, float * work) const override
+    {
+        const int half = m_half;
+
+        // Tangles the spectrum back into that of the packed sequence, doubled:
+        //   Z[k] = (X[k] + X'[k]) + i conj(w^k) (X[k] - X'[k]),  X'[k] = conj(X[half - k])
+        // The inverse transform is the forward one with the real and imaginary parts
+        // exchanged, on the way in and on the way out.
+        float * zr = work + half;
+        float * zi = work;
+        zr[0] = real[0] + real[half];
+        zi[0] = real[0] - real[half];
+
+        int k = 1;
+#if FFT_SIMD
+        for (; k + 4 <= half; k += 4)
+        {
+            v4 a = load(real + k);
+            v4 b = load(imag + k);
+            v4 c = reverse(load(real + half - k - 3));
+            v4 d = reverse(load(imag + half - k - 3));
+            v4 dr = sub(a, c);
+            v4 di = add(b, d);
+            v4 wr = load(m_untangleReal.data() + k);
+            v4 wi = load(m_untangleImag.data() + k);
+            v4 orr = add(mul(wr, dr), mul(wi, di));
+            v4 oi = sub(mul(wr, di), mul(wi, dr));
+            store(zr + k, sub(add(a, c), oi));
+            store(zi + k, add(sub(b, d), orr));
+        }
+#endif
+        for (; k < half; ++k)
+        {
+            float a = real[k], b = imag[k], c = real[half - k], d = imag[half - k];
+            float dr = a - c, di = b + d;
+            float wr = m_untangleReal[k], wi = m_untangleImag[k];
+            float orr = wr * dr + wi * di;
+            float oi = wr * di - wi * dr;
+            zr[k] = a + c - oi;
+            zi[k] = b - d + orr;
+        }
+
+        // zi and zr are in exchanged places
+        transform(zi, zr, work + half * 2, work + half * 3);
+
+        k = 0;
+#if FFT_SIMD
+        for (; k + 4 <= half; k += 4)
+            interleave(output + 2 * k, load(zr + k), load(zi + k));
+#endif
+        for (; k < half; ++k)
+        {
+            output[2 * k] = zr[k];
+            output[2 * k + 1] = zi[k];
+        }
+    }
+
+private:
+    struct Pass
+    {
+        int n;          // points per sub-transform
+        int s;          // sub-transforms, interleaved
+        int twiddles;   // offset in m_twiddles, or -1 for radix-2
+    };
+
+    // The complex forward transform of (re, im) in place, using (re2, im2) as scratch
+    void transform(float * re, float * im, float * re2, float * im2) const
+    {
+        float * xr = re;
+        float * xi = im;
+        float * yr = re2;
+        float * yi = im2;
+        for (const Pass & pass : m_passes)
+        {
+            if (pass.twiddles < 0)
+                radix2(pass, xr, xi, yr, yi);
+            else
+                radix4(pass, xr, xi, yr, yi);
+            std::swap(xr, yr);
+            std::swap(xi, yi);
+        }
+
+        if (xr != re)
+        {
+            std::copy(xr, xr + m_half, re);
+            std::copy(xi, xi + m_half, im);
+        }
+    }
+
+    void radix2(const Pass & pass, const float * xr, const float * xi, float * yr, float * yi) const
+    {
+        const int s = pass.s;
+        int q = 0;
+#if FFT_SIMD
+        for (; q + 4 <= s; q += 4)
+        {
+            v4 ar = load(xr + q), ai = load(xi + q);
+            v4 br = load(xr + q + s), bi = load(xi + q + s);
+            store(yr + q, add(ar, br));
+            store(yi + q, add(ai, bi));
+            store(yr + q + s, sub(ar, br));
+            store(yi + q + s, sub(ai, bi));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            float ar = xr[q], ai = xi[q], br = xr[q + s], bi = xi[q + s];
+            yr[q] = ar + br;
+            yi[q] = ai + bi;
+            yr[q + s] = ar - br;
+            yi[q + s] = ai - bi;
+        }
+    }
+
+    // y[q + s (4p + k)] = w^kp sum_j x[q + s (p + j m)] (-i)^jk, for each of the s transforms
+    void radix4(const Pass & pass, const float * xr, const float * xi, float * yr, float * yi) const
+    {
+        const int n = pass.n;
+        const int s = pass.s;
+        const int m = n / 4;
+        const float * w = m_twiddles.data() + pass.twiddles;
+        const float * w1r = w;
+        const float * w1i = w + m;
+        const float * w2r = w + 2 * m;
+        const float * w2i = w + 3 * m;
+        const float * w3r = w + 4 * m;
+        const float * w3i = w + 5 * m;
+
+#if FFT_SIMD
+        if (s == 1 && m >= 4)
+        {
+            // the first pass: four values of p at once, transposed on the way out
+            for (int p = 0; p < m; p += 4)
+            {
+                v4 ar = load(xr + p), ai = load(xi + p);
+                v4 br = load(xr + p + m), bi = load(xi + p + m);
+                v4 cr = load(xr + p + 2 * m), ci = load(xi + p + 2 * m);
+                v4 dr = load(xr + p + 3 * m), di = load(xi + p + 3 * m);
+
+                v4 apcr = add(ar, cr), apci = add(ai, ci);
+                v4 amcr = sub(ar, cr), amci = sub(ai, ci);
+                v4 bpdr = add(br, dr), bpdi = add(bi, di);
+                v4 bmdr = sub(br, dr), bmdi = sub(bi, di);
+
+                // -i (b - d)
+                v4 y0r = add(apcr, bpdr), y0i = add(apci, bpdi);
+                v4 y1r, y1i, y2r, y2i, y3r, y3i;
+                cmul(add(amcr, bmdi), sub(amci, bmdr), load(w1r + p), load(w1i + p), y1r, y1i);
+                cmul(sub(apcr, bpdr), sub(apci, bpdi), load(w2r + p), load(w2i + p), y2r, y2i);
+                cmul(sub(amcr, bmdi), add(amci, bmdr), load(w3r + p), load(w3i + p), y3r, y3i);
+
+                transpose(y0r, y1r, y2r, y3r);
+                transpose(y0i, y1i, y2i, y3i);
+                store(yr + 4 * p, y0r);
+                store(yr + 4 * p + 4, y1r);
+                store(yr + 4 * p + 8, y2r);
+                store(yr + 4 * p + 12, y3r);
+                store(yi + 4 * p, y0i);
+                store(yi + 4 * p + 4, y1i);
+                store(yi + 4 * p + 8, y2i);
+                store(yi + 4 * p + 12, y3i);
+            }
+            return;
+        }
+
+        if (s >= 4)
+        {
+            // the later passes: four of the interleaved transforms at once
+            for (int p = 0; p < m; ++p)
+            {
+                const v4 wr1 = splat(w1r[p]), wi1 = splat(w1i[p]);
+                const v4 wr2 = splat(w2r[p]), wi2 = splat(w2i[p]);
+                const v4 wr3 = splat(w3r[p]), wi3 = splat(w3i[p]);
+                const float * ar_ = xr + s * p;
+                const float * ai_ = xi + s * p;
+                float * yr_ = yr + s * 4 * p;
+                float * yi_ = yi + s * 4 * p;
+                for (int q = 0; q < s; q += 4)
+                {
+                    v4 ar = load(ar_ + q), ai = load(ai_ + q);
+                    v4 br = load(ar_ + q + s * m), bi = load(ai_ + q + s * m);
+                    v4 cr = load(ar_ + q + 2 * s * m), ci = load(ai_ + q + 2 * s * m);
+                    v4 dr = load(ar_ + q + 3 * s * m), di = load(ai_ + q + 3 * s * m);
+
+                    v4 apcr = add(ar, cr), apci = add(ai, ci);
+                    v4 amcr = sub(ar, cr), amci = sub(ai, ci);
+                    v4 bpdr = add(br, dr), bpdi = add(bi, di);
+                    v4 bmdr = sub(br, dr), bmdi = sub(bi, di);
+
+                    v4 tr, ti;
+                    store(yr_ + q, add(apcr, bpdr));
+                    store(yi_ + q, add(apci, bpdi));
+                    cmul(add(amcr, bmdi), sub(amci, bmdr), wr1, wi1, tr, ti);
+                    store(yr_ + q + s, tr);
+                    store(yi_ + q + s, ti);
+                    cmul(sub(apcr, bpdr), sub(apci, bpdi), wr2, wi2, tr, ti);
+                    store(yr_ + q + 2 * s, tr);
+                    store(yi_ + q + 2 * s, ti);
+                    cmul(sub(amcr, bmdi), add(amci, bmdr), wr3, wi3, tr, ti);
+                    store(yr_ + q + 3 * s, tr);
+                    store(yi_ + q + 3 * s, ti);
+                }
+            }
+            return;
+        }
+#endif
+
+        for (int p = 0; p < m; ++p)
+        {
+            for (int q = 0; q < s; ++q)
+            {
+                float ar = xr[q + s * p], ai = xi[q + s * p];
+                float br = xr[q + s * (p + m)], bi = xi[q + s * (p + m)];
+                float cr = xr[q + s * (p + 2 * m)], ci = xi[q + s * (p + 2 * m)];
+                float dr = xr[q + s * (p + 3 * m)], di = xi[q + s * (p + 3 * m)];
+
+                float apcr = ar + cr, apci = ai + ci;
+                float amcr = ar - cr, amci = ai - ci;
+                float bpdr = br + dr, bpdi = bi + di;
+                float bmdr = br - dr, bmdi = bi - di;
+
+                int o = q + s * 4 * p;
+                yr[o] = apcr + bpdr;
+                yi[o] = apci + bpdi;
+                cmul(amcr + bmdi, amci - bmdr, w1r[p], w1i[p], yr[o + s], yi[o + s]);
+                cmul(apcr - bpdr, apci - bpdi, w2r[p], w2i[p], yr[o + 2 * s], yi[o + 2 * s]);
+                cmul(amcr - bmdi, amci + bmdr, w3r[p], w3i[p], yr[o + 3 * s], yi[o + 3 * s]);
+            }
+        }
+    }
+
+    int m_half;
+    std::vector<Pass> m_passes;
+    std::vector<float> m_twiddles;
+    std::vector<float> m_untangleReal;
+    std::vector<float> m_untangleImag;
+};
+
+std::unique_ptr<FFTPlan> createStockhamPlan(int size)
+{
+    return std::unique_ptr<FFTPlan>(new StockhamPlan(size));
+}
+
+}  // namespace lab
+
+#endif  // USE_KISS_FFT
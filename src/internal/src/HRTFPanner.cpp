@@ -10,16 +10,21 @@
 #include "internal/Assertions.h"
 #include "internal/HRTFDatabase.h"
 #include "internal/Biquad.h"
-#include "internal/FFTConvolver.h"
 #include "internal/FFTFrame.h"
+#include "internal/JobQueue.h"
+
+#include "LabSound/extended/Logging.h"
+#include "LabSound/extended/VectorMath.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <math.h>
 #include <string>
-
-#include <algorithm>
+#include <thread>
+#include <tuple>
 
 using namespace std;
 
@@ -34,22 +39,87 @@ namespace lab
 
 
 
-HRTFDatabase::HRTFDatabase(float sampleRate, const std::string & searchPath)
+// A packed database is a header, the elevation angles, the kernels' frame delays,
+// and their spectra, all in the native byte order and FFTFrame's layout, so that it
+// can be mapped and used in place. The delays and spectra are in elevation, then
+// azimuth, then ear order, left before right; each spectrum is its real parts and
+// then its imaginary parts, each padded to a multiple of four floats so that every
+// array is aligned for SIMD.
+namespace
+{
+    const char HRTFPackMagic[8] = {'L', 'S', 'H', 'R', 'T', 'F', 'P', 'K'};
+    const uint32_t HRTFPackVersion = 1;
+    const uint32_t HRTFPackByteOrder = 0x01020304;
+
+    struct HRTFPackHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        float sampleRate;
+        uint32_t fftSize;
+        uint32_t binCount;
+        uint32_t binStride;  // floats from each real or imaginary array to the next
+        uint32_t elevationCount;
+        uint32_t azimuthCount;
+        uint32_t reserved[2];
+        uint64_t anglesOffset;   // int32_t per elevation
+        uint64_t delaysOffset;   // float per kernel
+        uint64_t spectraOffset;  // 2 * binStride floats per kernel
+        uint64_t fileSize;
+    };
+
+    uint64_t alignPackOffset(uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+}
+
+HRTFDatabase::HRTFDatabase(float sampleRate, const std::string & searchPath, bool usePack)
 {
     info.reset(new HRTFDatabaseInfo("Composite", searchPath, sampleRate));
 
+    if (usePack && loadPack(packPath(searchPath, sampleRate)))
+        return;
+
+    loadFiles();
+}
+
+std::string HRTFDatabase::packPath(const std::string & searchPath, float sampleRate)
+{
+    return searchPath + "/IRC_Composite_" + std::to_string(static_cast<int>(sampleRate)) + ".hrtfpack";
+}
+
+void HRTFDatabase::loadFiles()
+{
+    m_elevations.clear();
     m_elevations.resize(info->numTotalElevations);
 
-    int elevationIndex = 0;
+    // Each elevation is independent of the others until they are interpolated, so they
+    // are loaded by as many threads as there are cores.
+    std::vector<int> elevations;
     for (int elevation = info->minElevation; elevation <= info->maxElevation; elevation += info->rawElevationAngleSpacing)
+        elevations.push_back(elevation);
+
+    std::atomic<int> next(0);
+    auto loadElevations = [&]() {
+        for (int i = next++; i < static_cast<int>(elevations.size()); i = next++)
+            m_elevations[i * info->interpolationFactor] = HRTFElevation::createForSubject(info.get(), elevations[i]);
+    };
+
+    int threadCount = static_cast<int>(std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), elevations.size()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; ++i)
+        threads.emplace_back(loadElevations);
+    loadElevations();
+    for (std::thread & thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < elevations.size(); ++i)
     {
-        std::unique_ptr<HRTFElevation> hrtfElevation = HRTFElevation::createForSubject(info.get(), elevation);
-
         // @tofix - removed ASSERT(hrtfElevation.get());
-        if (!hrtfElevation.get()) return;
-
-        m_elevations[elevationIndex] = std::move(hrtfElevation);
-        elevationIndex += info->interpolationFactor;
+        if (!m_elevations[i * info->interpolationFactor])
+        {
+            info->files_found_and_loaded = false;
+            return;
+        }
     }
 
     // Go back and interpolate elevations
@@ -75,13 +145,143 @@ HRTFDatabase::HRTFDatabase(float sampleRate, const std::string & searchPath)
     }
 }
 
+bool HRTFDatabase::loadPack(const std::string & path)
+{
+    std::unique_ptr<MappedFile> pack = MappedFile::open(path);
+    if (!pack || pack->size() < sizeof(HRTFPackHeader))
+        return false;
+
+    const HRTFPackHeader & header = *reinterpret_cast<const HRTFPackHeader *>(pack->data());
+
+    // The pack must have been written for this sample rate, and by a build with the
+    // same FFT layout.
+    const int fftSize = HRTFPanner::fftSizeForSampleRate(info->sampleRate);
+    const uint32_t kernelCount = header.elevationCount * header.azimuthCount * 2;
+    bool isHeaderGood = !memcmp(header.magic, HRTFPackMagic, sizeof(HRTFPackMagic))
+        && header.version == HRTFPackVersion
+        && header.byteOrder == HRTFPackByteOrder
+        && header.sampleRate == info->sampleRate
+        && header.fftSize == static_cast<uint32_t>(fftSize)
+        && header.binCount == static_cast<uint32_t>(FFTFrame(fftSize).binCount())
+        && header.binStride >= header.binCount && header.binStride % 4 == 0
+        && header.elevationCount == static_cast<uint32_t>(info->numTotalElevations)
+        && header.azimuthCount == HRTFElevation::NumberOfTotalAzimuths
+        && header.fileSize == pack->size()
+        && header.anglesOffset + sizeof(int32_t) * header.elevationCount <= header.fileSize
+        && header.delaysOffset + sizeof(float) * kernelCount <= header.fileSize
+        && header.spectraOffset % 16 == 0
+        && header.spectraOffset + sizeof(float) * 2 * header.binStride * uint64_t(kernelCount) <= header.fileSize;
+    if (!isHeaderGood)
+    {
+        LOG_ERROR("HRTF pack %s does not match this build or sample rate, loading the files instead", path.c_str());
+        return false;
+    }
+
+    const int32_t * angles = reinterpret_cast<const int32_t *>(pack->data() + header.anglesOffset);
+    const float * delays = reinterpret_cast<const float *>(pack->data() + header.delaysOffset);
+    const float * spectra = reinterpret_cast<const float *>(pack->data() + header.spectraOffset);
+
+    m_elevations.clear();
+    m_elevations.resize(header.elevationCount);
+    for (uint32_t e = 0; e < header.elevationCount; ++e)
+    {
+        std::unique_ptr<HRTFKernelList> kernelListL(new HRTFKernelList(header.azimuthCount));
+        std::unique_ptr<HRTFKernelList> kernelListR(new HRTFKernelList(header.azimuthCount));
+        for (uint32_t a = 0; a < header.azimuthCount; ++a)
+        {
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                size_t kernel = (size_t(e) * header.azimuthCount + a) * 2 + ear;
+                const float * real = spectra + kernel * 2 * header.binStride;
+                const float * imag = real + header.binStride;
+                HRTFKernelList & list = ear ? *kernelListR : *kernelListL;
+                list[a] = std::make_shared<HRTFKernel>(real, imag, fftSize, delays[kernel], info->sampleRate);
+            }
+        }
+        m_elevations[e] = HRTFElevation::createWithKernels(std::move(kernelListL), std::move(kernelListR), angles[e]);
+    }
+
+    m_pack = std::move(pack);
+    info->files_found_and_loaded = true;
+    return true;
+}
+
+bool HRTFDatabase::writePack(const std::string & path) const
+{
+    if (!info->files_found_and_loaded || m_elevations.empty())
+        return false;
+
+    const HRTFKernel * first = m_elevations[0]->kernelListL()->at(0).get();
+    const int fftSize = first->fftSize();
+    const uint32_t binCount = static_cast<uint32_t>(FFTFrame(fftSize).binCount());
+
+    HRTFPackHeader header = {};
+    memcpy(header.magic, HRTFPackMagic, sizeof(HRTFPackMagic));
+    header.version = HRTFPackVersion;
+    header.byteOrder = HRTFPackByteOrder;
+    header.sampleRate = info->sampleRate;
+    header.fftSize = fftSize;
+    header.binCount = binCount;
+    header.binStride = (binCount + 3) & ~3u;
+    header.elevationCount = static_cast<uint32_t>(m_elevations.size());
+    header.azimuthCount = HRTFElevation::NumberOfTotalAzimuths;
+
+    const uint64_t kernelCount = uint64_t(header.elevationCount) * header.azimuthCount * 2;
+    header.anglesOffset = alignPackOffset(sizeof(HRTFPackHeader));
+    header.delaysOffset = alignPackOffset(header.anglesOffset + sizeof(int32_t) * header.elevationCount);
+    header.spectraOffset = alignPackOffset(header.delaysOffset + sizeof(float) * kernelCount);
+    header.fileSize = header.spectraOffset + sizeof(float) * 2 * header.binStride * kernelCount;
+
+    std::vector<uint8_t> bytes(header.fileSize, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    int32_t * angles = reinterpret_cast<int32_t *>(bytes.data() + header.anglesOffset);
+    float * delays = reinterpret_cast<float *>(bytes.data() + header.delaysOffset);
+    float * spectra = reinterpret_cast<float *>(bytes.data() + header.spectraOffset);
+
+    for (uint32_t e = 0; e < header.elevationCount; ++e)
+    {
+        HRTFElevation * elevation = m_elevations[e].get();
+        if (!elevation)
+            return false;
+
+        angles[e] = static_cast<int32_t>(elevation->elevationAngle());
+        for (uint32_t a = 0; a < header.azimuthCount; ++a)
+        {
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                const HRTFKernel * kernel = (ear ? elevation->kernelListR() : elevation->kernelListL())->at(a).get();
+                if (!kernel || kernel->fftSize() != fftSize)
+                    return false;
+
+                size_t index = (size_t(e) * header.azimuthCount + a) * 2 + ear;
+                delays[index] = kernel->frameDelay();
+                float * real = spectra + index * 2 * header.binStride;
+                memcpy(real, kernel->realData(), sizeof(float) * binCount);
+                memcpy(real + header.binStride, kernel->imagData(), sizeof(float) * binCount);
+            }
+        }
+    }
+
+    FILE * file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        LOG_ERROR("could not write the HRTF pack %s", path.c_str());
+        return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = fclose(file) == 0 && written;
+    if (!written)
+        LOG_ERROR("could not write the HRTF pack %s", path.c_str());
+    return written;
+}
+
 void HRTFDatabase::getKernelsFromAzimuthElevation(double azimuthBlend,
                                                   unsigned azimuthIndex,
                                                   double elevationAngle,
-                                                  HRTFKernel *& kernelL,
-                                                  HRTFKernel *& kernelR,
+                                                  const HRTFKernel *& kernelL,
+                                                  const HRTFKernel *& kernelR,
                                                   double & frameDelayL,
-                                                  double & frameDelayR)
+                                                  double & frameDelayR) const
 {
 
     size_t elevationIndex = info->indexFromElevationAngle(elevationAngle);
@@ -114,106 +314,90 @@ void HRTFDatabase::getKernelsFromAzimuthElevation(double azimuthBlend,
 
 
 
-// Singleton
-HRTFDatabaseLoader* HRTFDatabaseLoader::s_loader;
-
-HRTFDatabaseLoader* HRTFDatabaseLoader::MakeHRTFLoaderSingleton(float sampleRate, const std::string & searchPath)
+namespace
 {
-    //if (!s_loader)
-    //{
-    //    s_loader = new HRTFDatabaseLoader(sampleRate, searchPath);
-    //    s_loader->loadAsynchronously();
-    //}
-    if (!s_loader)
+    struct HRTFLoaderKey
     {
-        s_loader = new HRTFDatabaseLoader(sampleRate, searchPath);
-        // s_loader->loadAsynchronously();
-    }
-    if (s_loader && (!s_loader->database() || !s_loader->database()->files_found_and_loaded()))
-    {
-        s_loader = new HRTFDatabaseLoader(sampleRate, searchPath);
-    }
-    // if (s_loader && s_loader->database() && (s_loader->searchPath != searchPath ) )
-    //{
-    //     s_loader = new HRTFDatabaseLoader(sampleRate, searchPath);
-    // }
+        std::string searchPath;
+        float sampleRate;
+        int fftSize;
 
-    return s_loader;
-}
-
-HRTFDatabaseLoader::HRTFDatabaseLoader(float sampleRate, const std::string & searchPath)
-    : m_loading(false)
-    , m_databaseSampleRate(sampleRate)
-    , searchPath(searchPath)
-{
-    s_loader = this;
-}
-
-HRTFDatabaseLoader::~HRTFDatabaseLoader()
-{
-    waitForLoaderThreadCompletion();
-
-    if (m_databaseLoaderThread.joinable()) m_databaseLoaderThread.join();
-
-    m_hrtfDatabase.reset();
-
-    ASSERT(this == s_loader);
-
-    //s_loader = nullptr; //.reset(db) creates new loader before calling this destructor
-}
-
-// Asynchronously load the database in this thread.
-void HRTFDatabaseLoader::databaseLoaderEntry(HRTFDatabaseLoader * threadData)
-{
-    std::lock_guard<std::mutex> locker(threadData->m_threadLock);
-    HRTFDatabaseLoader * loader = reinterpret_cast<HRTFDatabaseLoader *>(threadData);
-    ASSERT(loader);
-
-    threadData->m_loading = true;
-    loader->load();
-    threadData->m_loadingCondition.notify_one();
-}
+        bool operator<(const HRTFLoaderKey & other) const
+        {
+            return std::tie(searchPath, sampleRate, fftSize) < std::tie(other.searchPath, other.sampleRate, other.fftSize);
+        }
+    };
 
-void HRTFDatabaseLoader::load()
-{
-    m_hrtfDatabase.reset(new HRTFDatabase(m_databaseSampleRate, searchPath));
+    struct HRTFLoaderRegistry
+    {
+        std::mutex mutex;
+        std::map<HRTFLoaderKey, std::weak_ptr<HRTFDatabaseLoader>> loaders;
+    };
 
-    if (!m_hrtfDatabase.get())
+    // leaked, so that loaders may outlive static destruction
+    HRTFLoaderRegistry & hrtfLoaderRegistry()
     {
-        LOG_ERROR("HRTF database not loaded");
+        static HRTFLoaderRegistry * registry = new HRTFLoaderRegistry;
+        return *registry;
     }
 }
 
-void HRTFDatabaseLoader::loadAsynchronously()
+std::shared_ptr<HRTFDatabaseLoader> HRTFDatabaseLoader::acquire(float sampleRate, const std::string & searchPath)
 {
-    std::lock_guard<std::mutex> lock(m_threadLock);
+    const int fftSize = HRTFPanner::fftSizeForSampleRate(sampleRate);
 
-    if (!m_hrtfDatabase.get() && !m_loading)
+    std::shared_ptr<HRTFDatabaseLoader> loader;
     {
-        m_databaseLoaderThread = std::thread(databaseLoaderEntry, this);
+        HRTFLoaderRegistry & registry = hrtfLoaderRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::weak_ptr<HRTFDatabaseLoader> & entry = registry.loaders[HRTFLoaderKey {searchPath, sampleRate, fftSize}];
+        loader = entry.lock();
+        if (loader && !(loader->isLoaded() && !loader->database()->files_found_and_loaded()))
+            return loader;
+
+        loader.reset(new HRTFDatabaseLoader(sampleRate, searchPath, fftSize));
+        entry = loader;
     }
+
+    // the job holds the loader until it has loaded
+    JobQueue::shared().post([loader]() { loader->load(); });
+    return loader;
 }
 
-bool HRTFDatabaseLoader::isLoaded() const
+HRTFDatabaseLoader::HRTFDatabaseLoader(float sampleRate, const std::string & searchPath, int fftSize)
+    : m_databaseSampleRate(sampleRate)
+    , m_fftSize(fftSize)
+    , m_searchPath(searchPath)
 {
-    return (m_hrtfDatabase.get() != nullptr);
 }
 
-void HRTFDatabaseLoader::waitForLoaderThreadCompletion()
+HRTFDatabaseLoader::~HRTFDatabaseLoader()
 {
-    std::unique_lock<std::mutex> locker(m_threadLock);
-    while (!m_hrtfDatabase.get())
-    {
-        m_loadingCondition.wait(locker);
-    }
+    // forget this loader, unless it has been replaced already
+    HRTFLoaderRegistry & registry = hrtfLoaderRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto entry = registry.loaders.find(HRTFLoaderKey {m_searchPath, m_databaseSampleRate, m_fftSize});
+    if (entry != registry.loaders.end() && entry->second.expired())
+        registry.loaders.erase(entry);
 }
 
-HRTFDatabase * HRTFDatabaseLoader::defaultHRTFDatabase()
+void HRTFDatabaseLoader::load()
 {
-    if (!s_loader) return nullptr;
-    return s_loader->database();
+    std::unique_ptr<HRTFDatabase> database(new HRTFDatabase(m_databaseSampleRate, m_searchPath));
+    if (!database->files_found_and_loaded())
+        LOG_ERROR("HRTF database not loaded from %s", m_searchPath.c_str());
+
+    std::lock_guard<std::mutex> lock(m_loadingMutex);
+    m_hrtfDatabase = std::move(database);
+    m_loaded.store(true, std::memory_order_release);
+    m_loadingCondition.notify_all();
 }
 
+void HRTFDatabaseLoader::waitUntilLoaded() const
+{
+    std::unique_lock<std::mutex> lock(m_loadingMutex);
+    m_loadingCondition.wait(lock, [this]() { return isLoaded(); });
+}
 
 // The range of elevations for the IRCAM impulse responses varies depending on azimuth, but the minimum elevation appears to always be -45.
 static int maxElevations[] = {
@@ -394,6 +578,11 @@ std::unique_ptr<HRTFElevation> HRTFElevation::createForSubject(HRTFDatabaseInfo
     return std::unique_ptr<HRTFElevation>(new HRTFElevation(info, std::move(kernelListL), std::move(kernelListR), elevation));
 }
 
+std::unique_ptr<HRTFElevation> HRTFElevation::createWithKernels(std::unique_ptr<HRTFKernelList> kernelListL, std::unique_ptr<HRTFKernelList> kernelListR, int elevation)
+{
+    return std::unique_ptr<HRTFElevation>(new HRTFElevation(nullptr, std::move(kernelListL), std::move(kernelListR), elevation));
+}
+
 std::unique_ptr<HRTFElevation> HRTFElevation::createByInterpolatingSlices(HRTFDatabaseInfo * info, HRTFElevation * hrtfElevation1, HRTFElevation * hrtfElevation2, float x)
 {
     ASSERT(hrtfElevation1 && hrtfElevation2);
@@ -423,7 +612,7 @@ std::unique_ptr<HRTFElevation> HRTFElevation::createByInterpolatingSlices(HRTFDa
     return std::unique_ptr<HRTFElevation>(new HRTFElevation(info, std::move(kernelListL), std::move(kernelListR), (int) angle));
 }
 
-void HRTFElevation::getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, HRTFKernel *& kernelL, HRTFKernel *& kernelR, double & frameDelayL, double & frameDelayR)
+void HRTFElevation::getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, const HRTFKernel *& kernelL, const HRTFKernel *& kernelR, double & frameDelayL, double & frameDelayR) const
 {
     bool checkAzimuthBlend = azimuthBlend >= 0.0 && azimuthBlend < 1.0;
     ASSERT(checkAzimuthBlend);
@@ -489,7 +678,8 @@ inline float ExtractAverageGroupDelay(AudioChannel * channel, int analysisFFTSiz
 }
 
 HRTFKernel::HRTFKernel(AudioChannel * channel, int fftSize, float sampleRate)
-    : m_frameDelay(0)
+    : m_fftSize(fftSize)
+    , m_frameDelay(0)
     , m_sampleRate(sampleRate)
 {
     ASSERT(channel);
@@ -518,12 +708,17 @@ HRTFKernel::HRTFKernel(AudioChannel * channel, int fftSize, float sampleRate)
 
     m_fftFrame = std::unique_ptr<FFTFrame>(new FFTFrame(fftSize));
     m_fftFrame->doPaddedFFT(impulseResponse, truncatedResponseLength);
+    m_real = m_fftFrame->realData();
+    m_imag = m_fftFrame->imagData();
 }
 
-std::unique_ptr<AudioChannel> HRTFKernel::createImpulseResponse()
+std::unique_ptr<AudioChannel> HRTFKernel::createImpulseResponse() const
 {
     std::unique_ptr<AudioChannel> channel(new AudioChannel(fftSize()));
-    FFTFrame fftFrame(*m_fftFrame);
+    FFTFrame fftFrame(fftSize());
+    const size_t binBytes = sizeof(float) * fftFrame.binCount();
+    memcpy(fftFrame.realData(), m_real, binBytes);
+    memcpy(fftFrame.imagData(), m_imag, binBytes);
 
     // Add leading delay back in.
     fftFrame.addConstantGroupDelay(m_frameDelay);
@@ -539,6 +734,11 @@ std::unique_ptr<HRTFKernel> MakeInterpolatedKernel(HRTFKernel * kernel1, HRTFKer
     if (!kernel1 || !kernel2)
         return 0;
 
+    // packed kernels are interpolated already
+    ASSERT(kernel1->fftFrame() && kernel2->fftFrame());
+    if (!kernel1->fftFrame() || !kernel2->fftFrame())
+        return 0;
+
     ASSERT(x >= 0.0 && x < 1.0);
     x = std::min(1.0f, std::max(0.0f, x));
 
@@ -564,30 +764,18 @@ const double MaxDelayTimeSeconds = 0.002;
 const int UninitializedAzimuth = -1;
 const uint32_t RenderingQuantum = AudioNode::ProcessingSizeInFrames;
 
-HRTFPanner::HRTFPanner(float sampleRate)
+HRTFPanner::HRTFPanner(float sampleRate, std::shared_ptr<HRTFRenderer> renderer)
     : Panner(sampleRate, PanningModel::HRTF)
-    , m_crossfadeSelection(CrossfadeSelection1)
-    , m_azimuthIndex1(UninitializedAzimuth)
-    , m_elevation1(0)
-    , m_azimuthIndex2(UninitializedAzimuth)
-    , m_elevation2(0)
-    , m_crossfadeX(0)
-    , m_crossfadeIncr(0)
-    , m_convolverL1(fftSizeForSampleRate(sampleRate))
-    , m_convolverR1(fftSizeForSampleRate(sampleRate))
-    , m_convolverL2(fftSizeForSampleRate(sampleRate))
-    , m_convolverR2(fftSizeForSampleRate(sampleRate))
+    , m_renderer(std::move(renderer))
+    , m_source(*m_renderer->addSource())
     , m_delayLineL(MaxDelayTimeSeconds, sampleRate)
     , m_delayLineR(MaxDelayTimeSeconds, sampleRate)
-    , m_tempL1(RenderingQuantum)
-    , m_tempR1(RenderingQuantum)
-    , m_tempL2(RenderingQuantum)
-    , m_tempR2(RenderingQuantum)
 {
 }
 
 HRTFPanner::~HRTFPanner()
 {
+    m_renderer->removeSource(&m_source);
 }
 
 uint32_t HRTFPanner::fftSizeForSampleRate(float sampleRate)
@@ -619,10 +807,8 @@ uint32_t HRTFPanner::fftSizeForSampleLength(int sampleLength)
 
 void HRTFPanner::reset()
 {
-    m_convolverL1.reset();
-    m_convolverR1.reset();
-    m_convolverL2.reset();
-    m_convolverR2.reset();
+    // the renderer starts the source afresh when it next pans
+    m_source.nextFrame = UINT64_MAX;
     m_delayLineL.reset();
     m_delayLineR.reset();
 }
@@ -634,10 +820,7 @@ int HRTFPanner::calculateDesiredAzimuthIndexAndBlend(double azimuth, double & az
     if (azimuth < 0)
         azimuth += 360.0;
 
-    HRTFDatabase * database = HRTFDatabaseLoader::defaultHRTFDatabase();
-    ASSERT(database);
-
-    int numberOfAzimuths = database->numberOfAzimuths();
+    int numberOfAzimuths = HRTFDatabase::numberOfAzimuths();
     const double angleBetweenAzimuths = 360.0 / numberOfAzimuths;
 
     // Calculate the azimuth index and the blend (0 -> 1) for interpolation.
@@ -672,10 +855,8 @@ void HRTFPanner::pan(ContextRenderLock & r,
         return;
     }
 
-    // This code only runs as long as the context is alive and after database has been loaded.
-    HRTFDatabase * database = HRTFDatabaseLoader::defaultHRTFDatabase();
-    ASSERT(database);
-
+    // Silent until the database has loaded; the render thread never waits for it.
+    const HRTFDatabase * database = m_renderer->database();
     if (!database)
     {
         outputBus.zero();
@@ -708,69 +889,62 @@ void HRTFPanner::pan(ContextRenderLock & r,
     double azimuthBlend;
     int desiredAzimuthIndex = calculateDesiredAzimuthIndexAndBlend(azimuth, azimuthBlend);
 
-    // Initially snap azimuth and elevation values to first values encountered.
-    if (m_azimuthIndex1 == UninitializedAzimuth)
-    {
-        m_azimuthIndex1 = desiredAzimuthIndex;
-        m_elevation1 = elevation;
-    }
-
-    if (m_azimuthIndex2 == UninitializedAzimuth)
-    {
-        m_azimuthIndex2 = desiredAzimuthIndex;
-        m_elevation2 = elevation;
-    }
-
-    // Cross-fade / transition over a period of around 45 milliseconds.
-    // This is an empirical value tuned to be a reasonable trade-off between
-    // smoothness and speed.
-    const double fadeFrames = r.context()->sampleRate() <= 48000 ? 2048 : 4096;
+    HRTFRenderer::Source & source = m_source;
+    source.desiredAzimuthIndex = desiredAzimuthIndex;
+    source.desiredElevation = elevation;
+    source.azimuthBlend = azimuthBlend;
 
-    // Check for azimuth and elevation changes, initiating a cross-fade if needed.
-    if (!m_crossfadeX && m_crossfadeSelection == CrossfadeSelection1)
+    // Initially snap azimuth and elevation values to first values encountered.
+    if (source.azimuthIndex[0] == UninitializedAzimuth)
     {
-        if (desiredAzimuthIndex != m_azimuthIndex1 || elevation != m_elevation1)
+        for (int position = 0; position < 2; ++position)
         {
-            // Cross-fade from 1 -> 2
-            m_crossfadeIncr = static_cast<float>(1 / fadeFrames);
-            m_azimuthIndex2 = desiredAzimuthIndex;
-            m_elevation2 = elevation;
+            source.azimuthIndex[position] = desiredAzimuthIndex;
+            source.elevation[position] = elevation;
         }
     }
 
-    if (m_crossfadeX == 1 && m_crossfadeSelection == CrossfadeSelection2)
+    // Blocks are aligned to the context's frames; a panner that skipped a quantum starts afresh.
+    // The low bit of the sample frame selects the sampling info's epoch, and isn't part of it.
+    const uint64_t frame = r.context()->currentSampleFrame() & ~uint64_t(1);
+    if (frame != source.nextFrame)
     {
-        if (desiredAzimuthIndex != m_azimuthIndex2 || elevation != m_elevation2)
-        {
-            // Cross-fade from 2 -> 1
-            m_crossfadeIncr = static_cast<float>(-1 / fadeFrames);
-            m_azimuthIndex1 = desiredAzimuthIndex;
-            m_elevation1 = elevation;
-        }
+        m_renderer->restart(source, frame);
+        m_delayLineL.reset();
+        m_delayLineR.reset();
     }
+    source.nextFrame = frame + framesToProcess;
 
-    // This algorithm currently requires that we process in power-of-two size chunks at least RenderingQuantum.
-    ASSERT(uint64_t(1) << static_cast<int>(log2(framesToProcess)) == framesToProcess);
-    ASSERT(framesToProcess >= RenderingQuantum);
+    // A block the renderer didn't convolve, if the context changed renderers.
+    const int blockSize = m_renderer->blockSize();
+    if (source.blockIndex == blockSize)
+        m_renderer->processSource(source);
 
-    const int framesPerSegment = RenderingQuantum;
-    const int numberOfSegments = framesToProcess / framesPerSegment;
+    // One of the panners in a mix carries it, and the others are silent.
+    HRTFRenderer::Mix * mix = source.mix;
+    const bool carriesMix = mix && mix->claim(frame);
+    const bool isSilent = source.isMixed && !carriesMix;
 
-    for (int segment = 0; segment < numberOfSegments; ++segment)
+    // The blocks are processed in segments of at most RenderingQuantum frames, so that the
+    // inter-aural delays change as often as they did when quanta were that size.
+    for (int offset = 0; offset < framesToProcess;)
     {
-        // Get the HRTFKernels and interpolated delays.
-        HRTFKernel * kernelL1;
-        HRTFKernel * kernelR1;
-        HRTFKernel * kernelL2;
-        HRTFKernel * kernelR2;
+        const int framesPerSegment = std::min(std::min(framesToProcess - offset, static_cast<int>(RenderingQuantum)),
+                                              blockSize - source.blockIndex);
+
+        // Get the interpolated delays of both positions.
+        const HRTFKernel * kernelL1;
+        const HRTFKernel * kernelR1;
+        const HRTFKernel * kernelL2;
+        const HRTFKernel * kernelR2;
 
         double frameDelayL1;
         double frameDelayR1;
         double frameDelayL2;
         double frameDelayR2;
 
-        database->getKernelsFromAzimuthElevation(azimuthBlend, m_azimuthIndex1, m_elevation1, kernelL1, kernelR1, frameDelayL1, frameDelayR1);
-        database->getKernelsFromAzimuthElevation(azimuthBlend, m_azimuthIndex2, m_elevation2, kernelL2, kernelR2, frameDelayL2, frameDelayR2);
+        database->getKernelsFromAzimuthElevation(azimuthBlend, source.azimuthIndex[0], source.elevation[0], kernelL1, kernelR1, frameDelayL1, frameDelayR1);
+        database->getKernelsFromAzimuthElevation(azimuthBlend, source.azimuthIndex[1], source.elevation[1], kernelL2, kernelR2, frameDelayL2, frameDelayR2);
 
         bool areKernelsGood = kernelL1 && kernelR1 && kernelL2 && kernelR2;
         ASSERT(areKernelsGood);
@@ -785,76 +959,52 @@ void HRTFPanner::pan(ContextRenderLock & r,
         ASSERT(frameDelayL2 / r.context()->sampleRate() < MaxDelayTimeSeconds && frameDelayR2 / r.context()->sampleRate() < MaxDelayTimeSeconds);
 
         // Crossfade inter-aural delays based on transitions.
-        double frameDelayL = (1 - m_crossfadeX) * frameDelayL1 + m_crossfadeX * frameDelayL2;
-        double frameDelayR = (1 - m_crossfadeX) * frameDelayR1 + m_crossfadeX * frameDelayR2;
+        const double x = std::min(1.0, std::max(0.0, static_cast<double>(source.crossfadeX + source.blockIndex * source.crossfadeIncr)));
+        double frameDelayL = (1 - x) * frameDelayL1 + x * frameDelayL2;
+        double frameDelayR = (1 - x) * frameDelayR1 + x * frameDelayR2;
 
-        // Calculate the source and destination pointers for the current segment.
-        uint32_t offset = segment * framesPerSegment;
-        const float * segmentSourceL = sourceL + offset;
-        const float * segmentSourceR = sourceR + offset;
-        float * segmentDestinationL = destinationL + offset;
-        float * segmentDestinationR = destinationR + offset;
-
-        // First run through delay lines for inter-aural time difference.
+        // Run through the delay lines for inter-aural time difference, into the renderer's block.
         m_delayLineL.setDelayFrames(frameDelayL);
         m_delayLineR.setDelayFrames(frameDelayR);
-        m_delayLineL.process(r, segmentSourceL, segmentDestinationL, framesPerSegment);
-        m_delayLineR.process(r, segmentSourceR, segmentDestinationR, framesPerSegment);
-
-        bool needsCrossfading = m_crossfadeIncr;
+        m_delayLineL.process(r, sourceL + offset, source.input[0].data() + source.blockIndex, framesPerSegment);
+        m_delayLineR.process(r, sourceR + offset, source.input[1].data() + source.blockIndex, framesPerSegment);
 
-        // Have the convolvers render directly to the final destination if we're not cross-fading.
-        float * convolutionDestinationL1 = needsCrossfading ? m_tempL1.data() : segmentDestinationL;
-        float * convolutionDestinationR1 = needsCrossfading ? m_tempR1.data() : segmentDestinationR;
-        float * convolutionDestinationL2 = needsCrossfading ? m_tempL2.data() : segmentDestinationL;
-        float * convolutionDestinationR2 = needsCrossfading ? m_tempR2.data() : segmentDestinationR;
-
-        // Now do the convolutions.
-        // Note that we avoid doing convolutions on both sets of convolvers if we're not currently cross-fading.
-        if (m_crossfadeSelection == CrossfadeSelection1 || needsCrossfading)
-        {
-            m_convolverL1.process(kernelL1->fftFrame(), segmentDestinationL, convolutionDestinationL1, framesPerSegment);
-            m_convolverR1.process(kernelR1->fftFrame(), segmentDestinationR, convolutionDestinationR1, framesPerSegment);
-        }
-
-        if (m_crossfadeSelection == CrossfadeSelection2 || needsCrossfading)
+        // The output is the previous block's convolution.
+        if (!isSilent)
         {
-            m_convolverL2.process(kernelL2->fftFrame(), segmentDestinationL, convolutionDestinationL2, framesPerSegment);
-            m_convolverR2.process(kernelR2->fftFrame(), segmentDestinationR, convolutionDestinationR2, framesPerSegment);
-        }
-
-        if (needsCrossfading)
-        {
-            // Apply linear cross-fade.
-            float x = m_crossfadeX;
-            float incr = m_crossfadeIncr;
-
-            for (uint32_t i = 0; i < framesPerSegment; ++i)
+            float * segmentDestinationL = destinationL + offset;
+            float * segmentDestinationR = destinationR + offset;
+            if (source.isMixed)
             {
-                segmentDestinationL[i] = (1 - x) * convolutionDestinationL1[i] + x * convolutionDestinationL2[i];
-                segmentDestinationR[i] = (1 - x) * convolutionDestinationR1[i] + x * convolutionDestinationR2[i];
-                x += incr;
+                memset(segmentDestinationL, 0, sizeof(float) * framesPerSegment);
+                memset(segmentDestinationR, 0, sizeof(float) * framesPerSegment);
             }
-
-            // Update cross-fade value from local.
-            m_crossfadeX = x;
-
-            if (m_crossfadeIncr > 0 && fabs(m_crossfadeX - 1) < m_crossfadeIncr)
+            else
             {
-                // We've fully made the crossfade transition from 1 -> 2.
-                m_crossfadeSelection = CrossfadeSelection2;
-                m_crossfadeX = 1;
-                m_crossfadeIncr = 0;
+                memcpy(segmentDestinationL, source.output[0].data() + source.blockIndex, sizeof(float) * framesPerSegment);
+                memcpy(segmentDestinationR, source.output[1].data() + source.blockIndex, sizeof(float) * framesPerSegment);
             }
-            else if (m_crossfadeIncr < 0 && fabs(m_crossfadeX) < -m_crossfadeIncr)
+
+            if (carriesMix)
             {
-                // We've fully made the crossfade transition from 2 -> 1.
-                m_crossfadeSelection = CrossfadeSelection1;
-                m_crossfadeX = 0;
-                m_crossfadeIncr = 0;
+                const float * mixL = mix->output[0].data() + source.blockIndex;
+                const float * mixR = mix->output[1].data() + source.blockIndex;
+                VectorMath::vadd(segmentDestinationL, 1, mixL, 1, segmentDestinationL, 1, framesPerSegment);
+                VectorMath::vadd(segmentDestinationR, 1, mixR, 1, segmentDestinationR, 1, framesPerSegment);
             }
         }
+
+        source.blockIndex += framesPerSegment;
+        offset += framesPerSegment;
+
+        // Quanta longer than a block need the block's convolution before they end; otherwise
+        // the renderer convolves it with the others at the end of the quantum.
+        if (source.blockIndex == blockSize && offset < framesToProcess)
+            m_renderer->processSource(source);
     }
+
+    if (isSilent)
+        outputBus.zero();
 }
 
 double HRTFPanner::tailTime(ContextRenderLock & r) const
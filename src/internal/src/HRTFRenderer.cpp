@@ -0,0 +1,526 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/HRTFRenderer.h"
+#include "internal/Assertions.h"
+#include "internal/HRTFDatabase.h"
+#include "internal/HRTFPanner.h"
+
+#include "LabSound/extended/AudioContextLock.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace lab
+{
+
+using namespace VectorMath;
+
+namespace
+{
+    // Multiplies spectra in FFTFrame's layout, into or onto the product; bin 0 is
+    // combined component-wise, as FFTFrame::multiply() does.
+    void multiplySpectra(const float * real1, const float * imag1, const float * real2, const float * imag2,
+                         float * real, float * imag, int binCount, bool accumulate)
+    {
+        float real0 = accumulate ? real[0] : 0.f;
+        float imag0 = accumulate ? imag[0] : 0.f;
+        real0 += real1[0] * real2[0];
+        imag0 += imag1[0] * imag2[0];
+
+        if (accumulate)
+            zvmuladd(real1, imag1, real2, imag2, real, imag, binCount);
+        else
+            zvmul(real1, imag1, real2, imag2, real, imag, binCount);
+
+        real[0] = real0;
+        imag[0] = imag0;
+    }
+}
+
+HRTFRenderer::Source::Source(const HRTFRenderer & renderer)
+{
+    const int blockSize = renderer.blockSize();
+    const int binCount = renderer.binCount();
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        input[ear].allocate(renderer.fftSize());
+        output[ear].allocate(blockSize);
+        spectrumReal[ear].allocate(binCount);
+        spectrumImag[ear].allocate(binCount);
+        for (int position = 0; position < 2; ++position)
+        {
+            overlap[position][ear].allocate(blockSize);
+            productReal[position][ear].allocate(binCount);
+            productImag[position][ear].allocate(binCount);
+        }
+    }
+
+    // alone, a source has at most a product for each position and ear
+    scratch.reset(new Scratch(renderer.fftSize(), binCount, 1));
+}
+
+HRTFRenderer::Source::~Source() = default;
+
+HRTFRenderer::Mix::Mix(const HRTFRenderer & renderer)
+{
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        real[ear].allocate(renderer.binCount());
+        imag[ear].allocate(renderer.binCount());
+        overlap[ear].allocate(renderer.blockSize());
+        output[ear].allocate(renderer.blockSize());
+    }
+}
+
+bool HRTFRenderer::Mix::claim(uint64_t frame)
+{
+    uint64_t claimed = claimedFrame.load(std::memory_order_relaxed);
+    return claimed != frame && claimedFrame.compare_exchange_strong(claimed, frame, std::memory_order_relaxed);
+}
+
+HRTFRenderer::Scratch::Scratch(int fftSize, int binCount, size_t sources)
+    : frame(fftSize)
+{
+    time[0].allocate(fftSize);
+    time[1].allocate(fftSize);
+    sumReal.allocate(binCount);
+    sumImag.allocate(binCount);
+    products.reserve(sources * 4);
+}
+
+HRTFRenderer::Roster::Roster(const HRTFRenderer & renderer, size_t sources)
+    : scratch(renderer.fftSize(), renderer.binCount(), sources)
+{
+    this->sources.reserve(sources);
+    blockSources.reserve(sources);
+}
+
+HRTFRenderer::HRTFRenderer(float sampleRate, int renderQuantumSize, std::shared_ptr<HRTFDatabaseLoader> databaseLoader)
+    : m_databaseLoader(std::move(databaseLoader))
+    , m_sampleRate(sampleRate)
+    , m_fftSize(HRTFPanner::fftSizeForSampleRate(sampleRate))
+    , m_binCount(FFTFrame(m_fftSize).binCount())
+    , m_crossfadeFrames(sampleRate <= 48000 ? 2048.f : 4096.f)
+    , m_deferred(renderQuantumSize <= m_fftSize / 2)
+{
+}
+
+HRTFRenderer::~HRTFRenderer()
+{
+    ASSERT(m_sources.empty());
+}
+
+const HRTFDatabase * HRTFRenderer::database() const
+{
+    const HRTFDatabase * database = m_databaseLoader ? m_databaseLoader->database() : nullptr;
+    return database && database->files_found_and_loaded() ? database : nullptr;
+}
+
+HRTFRenderer::Source * HRTFRenderer::addSource()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sources.push_back(std::make_shared<Source>(*this));
+
+    // A mix is found for each source a block; those of the block before keep their
+    // targets until the block ends, so there may be as many again.
+    while (m_mixes.size() < m_sources.size() * 2)
+        m_mixes.emplace_back(new Mix(*this));
+
+    publishRoster();
+    return m_sources.back().get();
+}
+
+void HRTFRenderer::removeSource(Source * source)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sources.erase(std::remove_if(m_sources.begin(), m_sources.end(),
+                                   [source](const std::shared_ptr<Source> & s) { return s.get() == source; }),
+                    m_sources.end());
+    publishRoster();
+}
+
+void HRTFRenderer::collect()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rosters.collect();
+}
+
+void HRTFRenderer::publishRoster()
+{
+    std::shared_ptr<Roster> roster = std::make_shared<Roster>(*this, m_sources.size());
+    roster->sources = m_sources;
+    for (auto & mix : m_mixes)
+        roster->mixes.push_back(mix.get());
+    m_rosters.publish(std::move(roster));
+}
+
+void HRTFRenderer::restart(Source & source, uint64_t frame) const
+{
+    source.blockIndex = static_cast<int>(frame % static_cast<uint64_t>(blockSize()));
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        source.input[ear].zero();
+        source.output[ear].zero();
+        source.overlap[0][ear].zero();
+        source.overlap[1][ear].zero();
+    }
+    source.mix = nullptr;
+    source.isMixed = false;
+}
+
+void HRTFRenderer::processSource(Source & source)
+{
+    Source * sources[] = {&source};
+    render(*source.scratch, nullptr, 0, sources, 1, false);
+}
+
+void HRTFRenderer::processBlocks(ContextRenderLock &)
+{
+    RenderHandoff<Roster>::Use roster(m_rosters);
+    if (!roster)
+        return;
+
+    // the roster has room for every source
+    std::vector<Source *> & blockSources = roster->blockSources;
+    blockSources.clear();
+    for (auto & source : roster->sources)
+    {
+        if (source->blockIndex == blockSize())
+            blockSources.push_back(source.get());
+    }
+
+    if (!blockSources.empty())
+        render(roster->scratch, roster->mixes.data(), static_cast<int>(roster->mixes.size()),
+               blockSources.data(), static_cast<int>(blockSources.size()), m_deferred);
+}
+
+void HRTFRenderer::render(Scratch & scratch, Mix * const * mixes, int mixCount, Source * const * sources, int count, bool mixing)
+{
+    const HRTFDatabase * database = this->database();
+    if (!database)
+    {
+        for (int i = 0; i < count; ++i)
+            sources[i]->blockIndex = 0;
+        return;
+    }
+
+    // a mix's output gathers the tails of the sources that join it
+    if (mixing)
+    {
+        for (int i = 0; i < mixCount; ++i)
+        {
+            Mix * mix = mixes[i];
+            mix->members = 0;
+            mix->sources = 0;
+            mix->output[0].zero();
+            mix->output[1].zero();
+        }
+    }
+
+    const int binCount = this->binCount();
+    for (int i = 0; i < count; ++i)
+    {
+        Source & source = *sources[i];
+        prepare(*database, source, mixes, mixCount, mixing);
+
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            scratch.frame.computeForwardFFT(source.input[ear].data());
+            memcpy(source.spectrumReal[ear].data(), scratch.frame.realData(), sizeof(float) * binCount);
+            memcpy(source.spectrumImag[ear].data(), scratch.frame.imagData(), sizeof(float) * binCount);
+        }
+    }
+
+    if (mixing)
+    {
+        for (int i = 0; i < mixCount; ++i)
+        {
+            Mix * mix = mixes[i];
+            if (!mix->members)
+                continue;
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                mix->real[ear].zero();
+                mix->imag[ear].zero();
+            }
+        }
+    }
+
+    scratch.products.clear();
+    for (int i = 0; i < count; ++i)
+        addProducts(scratch, *database, *sources[i]);
+    multiplyProducts(scratch);
+
+    for (int i = 0; i < count; ++i)
+        finish(scratch, *sources[i]);
+
+    if (mixing)
+    {
+        for (int i = 0; i < mixCount; ++i)
+            finish(scratch, *mixes[i]);
+    }
+}
+
+void HRTFRenderer::prepare(const HRTFDatabase & database, Source & source, Mix * const * mixes, int mixCount, bool mixing)
+{
+    // finish the cross-fade of the block that ended
+    if (source.crossfadeIncr)
+    {
+        source.crossfadeX += source.crossfadeIncr * blockSize();
+        if (source.crossfadeIncr > 0 && source.crossfadeX > 1 - source.crossfadeIncr)
+        {
+            source.selection = 1;
+            source.crossfadeX = 1;
+            source.crossfadeIncr = 0;
+        }
+        else if (source.crossfadeIncr < 0 && source.crossfadeX < -source.crossfadeIncr)
+        {
+            source.selection = 0;
+            source.crossfadeX = 0;
+            source.crossfadeIncr = 0;
+        }
+    }
+
+    // Begin a cross-fade to the panner's position, if it has moved. A mixed source's
+    // tails are in its mix, where they can't be faded, so it leaves the mix a block
+    // before it fades, and its own tails are faded.
+    const int current = source.selection;
+    const bool wasMixed = source.isMixed;
+    const bool moved = !source.crossfadeIncr &&
+        (source.desiredAzimuthIndex != source.azimuthIndex[current] || source.desiredElevation != source.elevation[current]);
+    if (moved && !wasMixed)
+    {
+        const int next = 1 - current;
+        source.azimuthIndex[next] = source.desiredAzimuthIndex;
+        source.elevation[next] = source.desiredElevation;
+        source.crossfadeIncr = (next ? 1.f : -1.f) / m_crossfadeFrames;
+        source.overlap[next][0].zero();
+        source.overlap[next][1].zero();
+    }
+
+    // a source that isn't cross-fading joins the mix of the input it feeds; the
+    // tails of its last block alone are heard through the mix
+    source.mix = mixing && source.mixTarget ? findMix(mixes, mixCount, source.mixTarget) : nullptr;
+    source.isMixed = source.mix && !source.crossfadeIncr && !moved;
+    if (source.mix)
+        ++source.mix->sources;
+
+    if (source.isMixed)
+    {
+        ++source.mix->members;
+        if (!wasMixed)
+        {
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                float * output = source.mix->output[ear].data();
+                vadd(output, 1, source.overlap[current][ear].data(), 1, output, 1, blockSize());
+            }
+        }
+    }
+    else if (wasMixed)
+    {
+        // the tails of its last block are in the mix it left
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            source.overlap[0][ear].zero();
+            source.overlap[1][ear].zero();
+        }
+    }
+}
+
+void HRTFRenderer::addProducts(Scratch & scratch, const HRTFDatabase & database, Source & source)
+{
+    for (int position = 0; position < 2; ++position)
+    {
+        if (position != source.selection && !source.crossfadeIncr)
+            continue;
+
+        const HRTFKernel * kernels[2];
+        double frameDelayL;
+        double frameDelayR;
+        database.getKernelsFromAzimuthElevation(source.azimuthBlend, source.azimuthIndex[position], source.elevation[position],
+                                                kernels[0], kernels[1], frameDelayL, frameDelayR);
+
+        bool areKernelsGood = kernels[0] && kernels[1];
+        ASSERT(areKernelsGood);
+
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            if (!areKernelsGood)
+            {
+                source.productReal[position][ear].zero();
+                source.productImag[position][ear].zero();
+                continue;
+            }
+
+            Product product;
+            product.kernelReal = kernels[ear]->realData();
+            product.kernelImag = kernels[ear]->imagData();
+            product.spectrumReal = source.spectrumReal[ear].data();
+            product.spectrumImag = source.spectrumImag[ear].data();
+            product.accumulate = source.isMixed;
+            product.real = source.isMixed ? source.mix->real[ear].data() : source.productReal[position][ear].data();
+            product.imag = source.isMixed ? source.mix->imag[ear].data() : source.productImag[position][ear].data();
+            scratch.products.push_back(product);
+        }
+    }
+}
+
+void HRTFRenderer::multiplyProducts(Scratch & scratch)
+{
+    std::vector<Product> & products = scratch.products;
+
+    // Ordered by kernel, each kernel is read once for all the sources at its position.
+    // Sources at the same position in the same mix are adjacent, and are summed before
+    // they are multiplied.
+    std::sort(products.begin(), products.end(), [](const Product & a, const Product & b) {
+        return std::tie(a.kernelReal, a.real) < std::tie(b.kernelReal, b.real);
+    });
+
+    const int binCount = this->binCount();
+    const size_t count = products.size();
+    for (size_t i = 0; i < count;)
+    {
+        const Product & product = products[i];
+        size_t end = i + 1;
+        while (end < count && products[end].kernelReal == product.kernelReal && products[end].real == product.real)
+            ++end;
+
+        const float * spectrumReal = product.spectrumReal;
+        const float * spectrumImag = product.spectrumImag;
+        if (end - i > 1)
+        {
+            memcpy(scratch.sumReal.data(), spectrumReal, sizeof(float) * binCount);
+            memcpy(scratch.sumImag.data(), spectrumImag, sizeof(float) * binCount);
+            for (size_t j = i + 1; j < end; ++j)
+            {
+                vadd(scratch.sumReal.data(), 1, products[j].spectrumReal, 1, scratch.sumReal.data(), 1, binCount);
+                vadd(scratch.sumImag.data(), 1, products[j].spectrumImag, 1, scratch.sumImag.data(), 1, binCount);
+            }
+            spectrumReal = scratch.sumReal.data();
+            spectrumImag = scratch.sumImag.data();
+        }
+
+        multiplySpectra(spectrumReal, spectrumImag, product.kernelReal, product.kernelImag,
+                        product.real, product.imag, binCount, product.accumulate);
+        i = end;
+    }
+}
+
+void HRTFRenderer::finish(Scratch & scratch, Source & source)
+{
+    source.blockIndex = 0;
+    if (source.isMixed)
+        return;
+
+    const int blockSize = this->blockSize();
+    const int binCount = this->binCount();
+    const float scale = FFTFrame::productScale();
+    const bool isCrossfading = source.crossfadeIncr != 0;
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        for (int position = 0; position < 2; ++position)
+        {
+            if (position != source.selection && !isCrossfading)
+                continue;
+
+            float * time = scratch.time[position].data();
+            memcpy(scratch.frame.realData(), source.productReal[position][ear].data(), sizeof(float) * binCount);
+            memcpy(scratch.frame.imagData(), source.productImag[position][ear].data(), sizeof(float) * binCount);
+            scratch.frame.computeInverseFFT(time);
+            if (scale != 1.f)
+                vsmul(time, 1, &scale, time, 1, m_fftSize);
+
+            // overlap-add the tail of the block before
+            float * overlap = source.overlap[position][ear].data();
+            vadd(time, 1, overlap, 1, time, 1, blockSize);
+            memcpy(overlap, time + blockSize, sizeof(float) * blockSize);
+        }
+
+        float * output = source.output[ear].data();
+        if (!isCrossfading)
+        {
+            memcpy(output, scratch.time[source.selection].data(), sizeof(float) * blockSize);
+            continue;
+        }
+
+        // Apply linear cross-fade.
+        const float * time1 = scratch.time[0].data();
+        const float * time2 = scratch.time[1].data();
+        float x = source.crossfadeX;
+        const float incr = source.crossfadeIncr;
+        for (int i = 0; i < blockSize; ++i)
+        {
+            const float clampedX = std::min(1.f, std::max(0.f, x));
+            output[i] = (1 - clampedX) * time1[i] + clampedX * time2[i];
+            x += incr;
+        }
+    }
+}
+
+void HRTFRenderer::finish(Scratch & scratch, Mix & mix)
+{
+    if (!mix.target)
+        return;
+
+    if (!mix.sources)
+    {
+        // nothing feeds the input any longer, so nothing would carry the mix
+        mix.target = nullptr;
+        mix.overlap[0].zero();
+        mix.overlap[1].zero();
+        return;
+    }
+
+    const int blockSize = this->blockSize();
+    const int binCount = this->binCount();
+    const float scale = FFTFrame::productScale();
+    float * time = scratch.time[0].data();
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        float * output = mix.output[ear].data();
+        float * overlap = mix.overlap[ear].data();
+        vadd(output, 1, overlap, 1, output, 1, blockSize);
+
+        if (!mix.members)
+        {
+            mix.overlap[ear].zero();
+            continue;
+        }
+
+        memcpy(scratch.frame.realData(), mix.real[ear].data(), sizeof(float) * binCount);
+        memcpy(scratch.frame.imagData(), mix.imag[ear].data(), sizeof(float) * binCount);
+        scratch.frame.computeInverseFFT(time);
+        if (scale != 1.f)
+            vsmul(time, 1, &scale, time, 1, m_fftSize);
+
+        vadd(output, 1, time, 1, output, 1, blockSize);
+        memcpy(overlap, time + blockSize, sizeof(float) * blockSize);
+    }
+}
+
+HRTFRenderer::Mix * HRTFRenderer::findMix(Mix * const * mixes, int mixCount, const void * target)
+{
+    // there are mixes enough for every source; see addSource()
+    Mix * unused = nullptr;
+    for (int i = 0; i < mixCount; ++i)
+    {
+        Mix * mix = mixes[i];
+        if (mix->target == target)
+            return mix;
+        if (!mix->target && !unused)
+            unused = mix;
+    }
+
+    ASSERT(unused);
+    if (unused)
+        unused->target = target;
+    return unused;
+}
+
+}  // namespace lab
@@ -0,0 +1,68 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/JobQueue.h"
+#include "internal/DenormalDisabler.h"
+
+#include <algorithm>
+
+namespace lab
+{
+
+JobQueue & JobQueue::shared()
+{
+    // one core is left to the render thread, and a few workers are enough to keep
+    // preparation off the threads that ask for it
+    static JobQueue queue(std::max(1, std::min(4, static_cast<int>(std::thread::hardware_concurrency()) - 1)));
+    return queue;
+}
+
+JobQueue::JobQueue(int threadCount)
+{
+    for (int i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&JobQueue::run, this);
+}
+
+JobQueue::~JobQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shouldStop = true;
+        m_jobs.clear();
+    }
+    m_wake.notify_all();
+    for (auto & thread : m_threads)
+        thread.join();
+}
+
+void JobQueue::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void JobQueue::run()
+{
+    DenormalDisabler denormalDisabler;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this] { return m_shouldStop || !m_jobs.empty(); });
+        if (m_shouldStop)
+            return;
+
+        std::function<void()> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+
+        lock.unlock();
+        job();
+        job = nullptr;  // releases what the job holds outside of the lock
+        lock.lock();
+    }
+}
+
+}  // namespace lab
@@ -0,0 +1,326 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/LookaheadCompressor.h"
+
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+namespace lab
+{
+
+namespace
+{
+    enum : int
+    {
+        SpanFrames = 256,        // frames processed by each pass
+        DelayLineFrames = 8192,  // a power of two, at least MaxLookaheadFrames + SpanFrames
+    };
+
+    const float DecibelsPerOctave = 6.02059991f;  // 20 log10(2)
+    const float OctavesPerDecibel = 0.166096405f;  // log2(10) / 20
+    const float SilentLevel = 1e-10f;             // -200 dB
+
+    // log2(1 + u) = u * p(u) for u in [0, 1), and 2^f = q(f) for f in [0, 1),
+    // interpolated at Chebyshev nodes; log2 is within 1.2e-6, and 2^f within
+    // a relative 1.1e-7.
+    const float Log2Coefficients[7] = {1.44269298f, -0.721144092f, 0.477496364f, -0.338377198f, 0.213943212f, -0.0946268097f, 0.02001665f};
+    const float Exp2Coefficients[6] = {0.999999898f, 0.69315449f, 0.240141818f, 0.0558603371f, 0.00894959042f, 0.00189375406f};
+
+    inline float log2Scalar(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        const float exponent = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(bits));
+
+        const float u = mantissa - 1;
+        float p = Log2Coefficients[6];
+        for (int i = 5; i >= 0; --i)
+            p = p * u + Log2Coefficients[i];
+        return exponent + u * p;
+    }
+
+    inline float exp2Scalar(float x)
+    {
+        x = std::max(-126.f, std::min(126.f, x));
+        const float whole = std::floor(x);
+        const float f = x - whole;
+        float q = Exp2Coefficients[5];
+        for (int i = 4; i >= 0; --i)
+            q = q * f + Exp2Coefficients[i];
+
+        const uint32_t bits = static_cast<uint32_t>(static_cast<int>(whole) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(bits));
+        return q * scale;
+    }
+
+    // The reduction the static curve asks of a level, in dB, where slope is
+    // 1 / ratio - 1. The knee is quadratic, and meets the lines on either side
+    // of it with their slopes.
+    inline float reductionScalar(float levelDb, float threshold, float halfKnee, float kneeScale, float slope)
+    {
+        const float over = levelDb - threshold;
+        const float inKnee = std::max(0.f, std::min(2 * halfKnee, over + halfKnee));
+        return slope * (inKnee * inKnee * kneeScale + std::max(0.f, over - halfKnee));
+    }
+
+    // For each frame, the largest magnitude of the channels, and the reduction
+    // the static curve asks of it
+    void detect(const float * const * sources, int numberOfChannels, int first, int frames,
+                float threshold, float halfKnee, float kneeScale, float slope, float * reductions)
+    {
+        int i = 0;
+
+#if defined(__SSE2__)
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 silent = _mm_set1_ps(SilentLevel);
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 vThreshold = _mm_set1_ps(threshold);
+        const __m128 vHalfKnee = _mm_set1_ps(halfKnee);
+        const __m128 vKnee = _mm_set1_ps(2 * halfKnee);
+        const __m128 vKneeScale = _mm_set1_ps(kneeScale);
+        const __m128 vSlope = _mm_set1_ps(slope);
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            __m128 peak = silent;
+            for (int j = 0; j < numberOfChannels; ++j)
+                peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(sources[j] + first + i), signMask));
+
+            // log2 of the peak, from its exponent and a polynomial of its mantissa
+            const __m128i bits = _mm_castps_si128(peak);
+            const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+            const __m128 u = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                                                      _mm_set1_epi32(0x3f800000))), one);
+            __m128 p = _mm_set1_ps(Log2Coefficients[6]);
+            for (int k = 5; k >= 0; --k)
+                p = _mm_add_ps(_mm_mul_ps(p, u), _mm_set1_ps(Log2Coefficients[k]));
+            const __m128 levelDb = _mm_mul_ps(_mm_add_ps(exponent, _mm_mul_ps(u, p)), _mm_set1_ps(DecibelsPerOctave));
+
+            const __m128 over = _mm_sub_ps(levelDb, vThreshold);
+            const __m128 inKnee = _mm_max_ps(zero, _mm_min_ps(vKnee, _mm_add_ps(over, vHalfKnee)));
+            const __m128 above = _mm_max_ps(zero, _mm_sub_ps(over, vHalfKnee));
+            _mm_storeu_ps(reductions + i, _mm_mul_ps(vSlope, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(inKnee, inKnee), vKneeScale), above)));
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        const float32x4_t silent = vdupq_n_f32(SilentLevel);
+        const float32x4_t one = vdupq_n_f32(1.f);
+        const float32x4_t zero = vdupq_n_f32(0.f);
+        const float32x4_t vThreshold = vdupq_n_f32(threshold);
+        const float32x4_t vHalfKnee = vdupq_n_f32(halfKnee);
+        const float32x4_t vKnee = vdupq_n_f32(2 * halfKnee);
+        const float32x4_t vKneeScale = vdupq_n_f32(kneeScale);
+        const float32x4_t vSlope = vdupq_n_f32(slope);
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            float32x4_t peak = silent;
+            for (int j = 0; j < numberOfChannels; ++j)
+                peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(sources[j] + first + i)));
+
+            const uint32x4_t bits = vreinterpretq_u32_f32(peak);
+            const float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+            const float32x4_t u = vsubq_f32(vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)),
+                                                                            vdupq_n_u32(0x3f800000))), one);
+            float32x4_t p = vdupq_n_f32(Log2Coefficients[6]);
+            for (int k = 5; k >= 0; --k)
+                p = vmlaq_f32(vdupq_n_f32(Log2Coefficients[k]), p, u);
+            const float32x4_t levelDb = vmulq_n_f32(vmlaq_f32(exponent, u, p), DecibelsPerOctave);
+
+            const float32x4_t over = vsubq_f32(levelDb, vThreshold);
+            const float32x4_t inKnee = vmaxq_f32(zero, vminq_f32(vKnee, vaddq_f32(over, vHalfKnee)));
+            const float32x4_t above = vmaxq_f32(zero, vsubq_f32(over, vHalfKnee));
+            vst1q_f32(reductions + i, vmulq_f32(vSlope, vmlaq_f32(above, vmulq_f32(inKnee, inKnee), vKneeScale)));
+        }
+#endif
+
+        for (; i < frames; ++i)
+        {
+            float peak = SilentLevel;
+            for (int j = 0; j < numberOfChannels; ++j)
+                peak = std::max(peak, std::fabs(sources[j][first + i]));
+            reductions[i] = reductionScalar(DecibelsPerOctave * log2Scalar(peak), threshold, halfKnee, kneeScale, slope);
+        }
+    }
+
+    // gains = 2^((reductions + makeup) * OctavesPerDecibel)
+    void toGains(const float * reductions, float makeup, float * gains, int frames)
+    {
+        int i = 0;
+
+#if defined(__SSE2__)
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 vMakeup = _mm_set1_ps(makeup);
+        const __m128 vOctaves = _mm_set1_ps(OctavesPerDecibel);
+        for (; i + 4 <= frames; i += 4)
+        {
+            __m128 x = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(reductions + i), vMakeup), vOctaves);
+            x = _mm_max_ps(_mm_set1_ps(-126.f), _mm_min_ps(_mm_set1_ps(126.f), x));
+
+            // floor, as truncation rounds the negatives up
+            __m128 whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+            whole = _mm_sub_ps(whole, _mm_and_ps(_mm_cmpgt_ps(whole, x), one));
+            const __m128 f = _mm_sub_ps(x, whole);
+
+            __m128 q = _mm_set1_ps(Exp2Coefficients[5]);
+            for (int k = 4; k >= 0; --k)
+                q = _mm_add_ps(_mm_mul_ps(q, f), _mm_set1_ps(Exp2Coefficients[k]));
+
+            const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(whole), _mm_set1_epi32(127)), 23));
+            _mm_storeu_ps(gains + i, _mm_mul_ps(q, scale));
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        for (; i + 4 <= frames; i += 4)
+        {
+            float32x4_t x = vmulq_n_f32(vaddq_f32(vld1q_f32(reductions + i), vdupq_n_f32(makeup)), OctavesPerDecibel);
+            x = vmaxq_f32(vdupq_n_f32(-126.f), vminq_f32(vdupq_n_f32(126.f), x));
+
+            float32x4_t whole = vcvtq_f32_s32(vcvtq_s32_f32(x));
+            whole = vsubq_f32(whole, vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(whole, x), vreinterpretq_u32_f32(vdupq_n_f32(1.f)))));
+            const float32x4_t f = vsubq_f32(x, whole);
+
+            float32x4_t q = vdupq_n_f32(Exp2Coefficients[5]);
+            for (int k = 4; k >= 0; --k)
+                q = vmlaq_f32(vdupq_n_f32(Exp2Coefficients[k]), q, f);
+
+            const float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(whole), vdupq_n_s32(127)), 23));
+            vst1q_f32(gains + i, vmulq_f32(q, scale));
+        }
+#endif
+
+        for (; i < frames; ++i)
+            gains[i] = exp2Scalar((reductions[i] + makeup) * OctavesPerDecibel);
+    }
+}
+
+LookaheadCompressor::LookaheadCompressor()
+    : m_reductions(new float[SpanFrames])
+    , m_gains(new float[SpanFrames])
+{
+}
+
+LookaheadCompressor::~LookaheadCompressor() {}
+
+void LookaheadCompressor::reset()
+{
+    m_envelope = 0;
+    for (auto & delayLine : m_delayLines)
+        std::fill(delayLine.get(), delayLine.get() + DelayLineFrames, 0.f);
+}
+
+void LookaheadCompressor::setLookahead(int frames, int numberOfChannels)
+{
+    frames = std::max(0, std::min(frames, static_cast<int>(MaxLookaheadFrames)));
+
+    // The delay lines are only kept up while there is a lookahead, so they
+    // are cleared when it changes
+    bool clear = frames != m_lookaheadFrames;
+    if (frames && static_cast<int>(m_delayLines.size()) < numberOfChannels)
+    {
+        while (static_cast<int>(m_delayLines.size()) < numberOfChannels)
+            m_delayLines.emplace_back(new float[DelayLineFrames]);
+        clear = true;
+    }
+
+    if (clear)
+    {
+        for (auto & delayLine : m_delayLines)
+            std::fill(delayLine.get(), delayLine.get() + DelayLineFrames, 0.f);
+    }
+    m_lookaheadFrames = frames;
+}
+
+void LookaheadCompressor::process(const Parameters & parameters, float sampleRate, const AudioBus * source, AudioBus * destination, int framesToProcess)
+{
+    const int numberOfChannels = std::min(source->numberOfChannels(), destination->numberOfChannels());
+    if (numberOfChannels < 1 || framesToProcess < 1)
+        return;
+
+    m_sources.resize(numberOfChannels);
+    m_destinations.resize(numberOfChannels);
+    for (int c = 0; c < numberOfChannels; ++c)
+    {
+        m_sources[c] = source->channel(c)->data();
+        m_destinations[c] = destination->channel(c)->mutableData();
+    }
+    const float * const * sources = m_sources.data();
+    float * const * destinations = m_destinations.data();
+
+    setLookahead(static_cast<int>(parameters.lookahead * sampleRate), numberOfChannels);
+
+    const float threshold = parameters.threshold;
+    const float halfKnee = 0.5f * std::max(parameters.knee, 1e-3f);
+    const float kneeScale = 0.25f / halfKnee;  // 1 / (2 knee)
+    const float slope = 1 / std::max(1.f, parameters.ratio) - 1;
+
+    const float attack = std::exp(-1 / (std::max(parameters.attack, 1e-6f) * sampleRate));
+    const float release = std::exp(-1 / (std::max(parameters.release, 1e-6f) * sampleRate));
+
+    float * reductions = m_reductions.get();
+    float * gains = m_gains.get();
+
+    for (int first = 0; first < framesToProcess; first += SpanFrames)
+    {
+        const int frames = std::min(static_cast<int>(SpanFrames), framesToProcess - first);
+
+        detect(sources, numberOfChannels, first, frames, threshold, halfKnee, kneeScale, slope, reductions);
+
+        // Smooth the reduction, attacking as it deepens and releasing as it recedes
+        float envelope = m_envelope;
+        for (int i = 0; i < frames; ++i)
+        {
+            const float target = reductions[i];
+            const float coefficient = target < envelope ? attack : release;
+            envelope = target + coefficient * (envelope - target);
+            reductions[i] = envelope;
+        }
+        m_envelope = envelope;
+
+        toGains(reductions, parameters.makeup, gains, frames);
+
+        for (int c = 0; c < numberOfChannels; ++c)
+        {
+            const float * input = sources[c] + first;
+            float * output = destinations[c] + first;
+
+            if (!m_lookaheadFrames)
+            {
+                VectorMath::vmul(input, 1, gains, 1, output, 1, frames);
+                continue;
+            }
+
+            // Write the span into the delay line, then read it back the lookahead earlier
+            float * delayLine = m_delayLines[c].get();
+            const int writeIndex = m_writeIndex;
+            const int written = std::min(frames, DelayLineFrames - writeIndex);
+            std::memcpy(delayLine + writeIndex, input, sizeof(float) * written);
+            std::memcpy(delayLine, input + written, sizeof(float) * (frames - written));
+
+            const int readIndex = (writeIndex - m_lookaheadFrames) & (DelayLineFrames - 1);
+            const int read = std::min(frames, DelayLineFrames - readIndex);
+            VectorMath::vmul(delayLine + readIndex, 1, gains, 1, output, 1, read);
+            VectorMath::vmul(delayLine, 1, gains + read, 1, output + read, 1, frames - read);
+        }
+
+        if (m_lookaheadFrames)
+            m_writeIndex = (m_writeIndex + frames) & (DelayLineFrames - 1);
+    }
+}
+
+}  // namespace lab
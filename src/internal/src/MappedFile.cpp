@@ -0,0 +1,100 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "LabSound/core/Macros.h"
+
+#include "internal/MappedFile.h"
+
+#if defined(LABSOUND_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lab
+{
+
+#if defined(LABSOUND_PLATFORM_WINDOWS)
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string & path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    const void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->m_data = static_cast<const uint8_t *>(data);
+    mapped->m_size = static_cast<size_t>(size.QuadPart);
+    mapped->m_file = file;
+    mapped->m_mapping = mapping;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string & path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // the mapping keeps the file open
+    void * data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->m_data = static_cast<const uint8_t *>(data);
+    mapped->m_size = static_cast<size_t>(info.st_size);
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+}
+
+#endif
+
+}  // namespace lab
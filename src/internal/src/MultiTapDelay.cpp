@@ -0,0 +1,284 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/MultiTapDelay.h"
+
+#include "LabSound/extended/VectorMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lab
+{
+
+namespace
+{
+    // A constant delay is considered reached within this many frames of it
+    const double SettledFrames = 1e-4;
+
+    double minimumDelay(MultiTapDelay::Interpolation interpolation)
+    {
+        switch (interpolation)
+        {
+            case MultiTapDelay::Interpolation::Cubic: return 1;
+            case MultiTapDelay::Interpolation::Allpass: return 0.5;
+            default: return 0;
+        }
+    }
+
+    // The Catmull-Rom weights of four frames, interpolating between the
+    // second and the third at t
+    inline void cubicWeights(float t, float gain, float * weights)
+    {
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        weights[0] = gain * 0.5f * (-t + 2 * t2 - t3);
+        weights[1] = gain * 0.5f * (2 - 5 * t2 + 3 * t3);
+        weights[2] = gain * 0.5f * (t + 4 * t2 - 3 * t3);
+        weights[3] = gain * 0.5f * (t3 - t2);
+    }
+}
+
+MultiTapDelay::MultiTapDelay() {}
+
+MultiTapDelay::~MultiTapDelay() {}
+
+void MultiTapDelay::setSize(int channels, int taps, double maxDelayFrames)
+{
+    m_channelCapacity = std::max(0, channels);
+    m_tapCapacity = std::max(0, taps);
+    m_maxDelayFrames = std::max(0.0, maxDelayFrames);
+
+    // The span written before the taps read must not reach the oldest frame
+    // the longest delay reads
+    const int needed = static_cast<int>(std::ceil(m_maxDelayFrames)) + SpanFrames + Guard + 2;
+    m_length = 1;
+    while (m_length < needed)
+        m_length *= 2;
+
+    const size_t lineFrames = static_cast<size_t>(m_channelCapacity) * (m_length + Guard);
+    m_lines.reset(lineFrames ? static_cast<float *>(std::calloc(lineFrames, sizeof(float))) : nullptr);
+    if (!m_lines)
+        m_channelCapacity = 0;
+    m_writeIndex = 0;
+
+    m_currentDelays.assign(m_tapCapacity, 0.0);
+    m_jump.assign(m_tapCapacity, 1);
+    m_allpassStates.assign(static_cast<size_t>(m_tapCapacity) * m_channelCapacity, 0.f);
+
+    m_delays.resize(SpanFrames);
+    m_indices.resize(SpanFrames);
+    m_fractions.resize(SpanFrames);
+
+    // the lines are already clear
+    m_channels = m_channelCapacity;
+    m_taps = m_tapCapacity;
+}
+
+void MultiTapDelay::setActive(int channels, int taps)
+{
+    m_channels = std::max(0, std::min(channels, m_channelCapacity));
+    m_taps = std::max(0, std::min(taps, m_tapCapacity));
+    reset();
+}
+
+void MultiTapDelay::reset()
+{
+    // only the lines in use are cleared, so unused ones stay untouched
+    if (m_channels)
+        std::memset(m_lines.get(), 0, sizeof(float) * static_cast<size_t>(m_channels) * (m_length + Guard));
+    m_writeIndex = 0;
+    std::fill(m_jump.begin(), m_jump.end(), 1);
+    std::fill(m_allpassStates.begin(), m_allpassStates.end(), 0.f);
+}
+
+void MultiTapDelay::process(const float * const * sources, float * const * destinations, int framesToProcess, const Tap * taps)
+{
+    if (!m_channels)
+        return;
+
+    for (int offset = 0; offset < framesToProcess; offset += SpanFrames)
+        processSpan(sources, destinations, offset, std::min(static_cast<int>(SpanFrames), framesToProcess - offset), taps);
+}
+
+void MultiTapDelay::processSpan(const float * const * sources, float * const * destinations, int offset, int frames, const Tap * taps)
+{
+    const int writeIndex = m_writeIndex;
+    const int written = std::min(frames, m_length - writeIndex);
+    for (int c = 0; c < m_channels; ++c)
+    {
+        float * x = line(c);
+        std::memcpy(x + writeIndex, sources[c] + offset, sizeof(float) * written);
+        std::memcpy(x, sources[c] + offset + written, sizeof(float) * (frames - written));
+        std::memcpy(x + m_length, x, sizeof(float) * Guard);
+    }
+
+    // a destination may be its source, which is now in the line
+    for (int c = 0; c < m_channels; ++c)
+        std::memset(destinations[c] + offset, 0, sizeof(float) * frames);
+
+    const double minDelay = minimumDelay(m_interpolation);
+    for (int t = 0; t < m_taps; ++t)
+    {
+        const Tap & tap = taps[t];
+        if (tap.delays)
+        {
+            readVarying(t, tap.delays + offset, tap.gain, destinations, offset, frames);
+            continue;
+        }
+
+        const double target = std::max(minDelay, std::min(m_maxDelayFrames, static_cast<double>(tap.delay)));
+        double current = m_currentDelays[t];
+        if (m_jump[t] || m_smoothingRate >= 1 || std::fabs(target - current) < SettledFrames)
+        {
+            m_jump[t] = 0;
+            m_currentDelays[t] = target;
+            readConstant(t, target, tap.gain, destinations, offset, frames);
+            continue;
+        }
+
+        // Approach the new delay
+        float * delays = m_delays.data();
+        for (int i = 0; i < frames; ++i)
+        {
+            current += (target - current) * m_smoothingRate;
+            delays[i] = static_cast<float>(current);
+        }
+        readVarying(t, delays, tap.gain, destinations, offset, frames);
+        m_currentDelays[t] = std::fabs(target - current) < SettledFrames ? target : current;
+    }
+
+    m_writeIndex = (writeIndex + frames) & (m_length - 1);
+}
+
+// The frame written i frames into the span is at m_writeIndex + i in the line.
+// A delay of k whole frames and a fraction f reads between the frames at
+// m_writeIndex + i - k - 1 and m_writeIndex + i - k, a fraction 1 - f of the
+// way from the first; the four frames read around them start one earlier.
+
+void MultiTapDelay::readConstant(int tap, double delay, float gain, float * const * destinations, int offset, int frames)
+{
+    const int mask = m_length - 1;
+
+    if (m_interpolation == Interpolation::Allpass)
+    {
+        // centering the fractional delay on a frame keeps the pole well inside the unit circle
+        const int k = static_cast<int>(delay - 0.5);
+        const float fraction = static_cast<float>(delay - k);
+        const float a = (1 - fraction) / (1 + fraction);
+        const int first = (m_writeIndex - k - 2) & mask;
+
+        for (int c = 0; c < m_channels; ++c)
+        {
+            const float * x = line(c);
+            float * out = destinations[c] + offset;
+            float y = m_allpassStates[tap * m_channels + c];
+            for (int i = 0; i < frames; ++i)
+            {
+                const int index = (first + i) & mask;
+                y = a * (x[index + 2] - y) + x[index + 1];
+                out[i] += gain * y;
+            }
+            m_allpassStates[tap * m_channels + c] = y;
+        }
+        return;
+    }
+
+    const int k = static_cast<int>(delay);
+    const float t = 1 - static_cast<float>(delay - k);
+
+    float weights[4];
+    if (m_interpolation == Interpolation::Cubic)
+        cubicWeights(t, gain, weights);
+    else
+    {
+        weights[0] = 0;
+        weights[1] = gain * (1 - t);
+        weights[2] = gain * t;
+        weights[3] = 0;
+    }
+
+    // The reads are contiguous up to the end of the line, and the guard
+    // covers the frames read past it
+    const int first = (m_writeIndex - k - 2) & mask;
+    const int before = std::min(frames, m_length - first);
+
+    for (int c = 0; c < m_channels; ++c)
+    {
+        const float * x = line(c);
+        float * out = destinations[c] + offset;
+        for (int j = 0; j < 4; ++j)
+        {
+            if (weights[j] == 0)
+                continue;
+            VectorMath::vsma(x + first + j, 1, &weights[j], out, 1, before);
+            if (before < frames)
+                VectorMath::vsma(x + j, 1, &weights[j], out + before, 1, frames - before);
+        }
+    }
+}
+
+void MultiTapDelay::readVarying(int tap, const float * delays, float gain, float * const * destinations, int offset, int frames)
+{
+    const int mask = m_length - 1;
+    const float minDelay = static_cast<float>(minimumDelay(m_interpolation));
+    const float maxDelay = static_cast<float>(m_maxDelayFrames);
+    const bool allpass = m_interpolation == Interpolation::Allpass;
+    const float centering = allpass ? 0.5f : 0.f;
+
+    // Find the read positions once for every channel
+    int * indices = m_indices.data();
+    float * fractions = m_fractions.data();
+    for (int i = 0; i < frames; ++i)
+    {
+        const float delay = std::max(minDelay, std::min(maxDelay, delays[i]));
+        const int k = static_cast<int>(delay - centering);
+        const float fraction = delay - k;
+        indices[i] = (m_writeIndex + i - k - 2) & mask;
+        fractions[i] = allpass ? (1 - fraction) / (1 + fraction) : 1 - fraction;
+    }
+    m_currentDelays[tap] = std::max(minDelay, std::min(maxDelay, delays[frames - 1]));
+
+    for (int c = 0; c < m_channels; ++c)
+    {
+        const float * x = line(c);
+        float * out = destinations[c] + offset;
+
+        switch (m_interpolation)
+        {
+            case Interpolation::Linear:
+                for (int i = 0; i < frames; ++i)
+                {
+                    const float * p = x + indices[i];
+                    out[i] += gain * (p[1] + fractions[i] * (p[2] - p[1]));
+                }
+                break;
+
+            case Interpolation::Cubic:
+                for (int i = 0; i < frames; ++i)
+                {
+                    const float * p = x + indices[i];
+                    float weights[4];
+                    cubicWeights(fractions[i], gain, weights);
+                    out[i] += weights[0] * p[0] + weights[1] * p[1] + weights[2] * p[2] + weights[3] * p[3];
+                }
+                break;
+
+            case Interpolation::Allpass:
+            {
+                float y = m_allpassStates[tap * m_channels + c];
+                for (int i = 0; i < frames; ++i)
+                {
+                    const float * p = x + indices[i];
+                    y = fractions[i] * (p[2] - y) + p[1];
+                    out[i] += gain * y;
+                }
+                m_allpassStates[tap * m_channels + c] = y;
+                break;
+            }
+        }
+    }
+}
+
+}  // namespace lab
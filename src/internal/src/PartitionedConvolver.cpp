@@ -0,0 +1,770 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/PartitionedConvolver.h"
+#include "internal/Assertions.h"
+#include "internal/DenormalDisabler.h"
+#include "LabSound/extended/VectorMath.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace lab
+{
+
+using namespace VectorMath;
+
+// The responses, divided into segments of uniformly sized partitions, and
+// transformed; see prepareResponses().
+struct PartitionedConvolver::Responses
+{
+    // A run of partitions of one size. The spectra are scaled to suit
+    // the accumulation of products in Segment::convolve().
+    struct Partitions
+    {
+        int offset;
+        int partitionSize;
+        int partitionCount;
+        bool background;
+        int bins;
+        AudioFloatArray real;
+        AudioFloatArray imag;
+
+        const float * spectrumReal(int response, int p) const { return real.data() + (response * partitionCount + p) * bins; }
+        const float * spectrumImag(int response, int p) const { return imag.data() + (response * partitionCount + p) * bins; }
+    };
+
+    explicit Responses(uint64_t key)
+        : key(key)
+    {
+    }
+
+    ~Responses();
+
+    void prepare(const float * const * responses, int count, int length, float gain,
+                 int blockSize, bool backgroundTail, int maxPartitionSize);
+
+    uint64_t key;
+    int responseCount = 0;
+    int responseLength = 0;
+    int blockSize = 0;
+    std::vector<std::unique_ptr<Partitions>> segments;
+    std::once_flag prepared;
+    std::atomic<bool> ready {false};
+};
+
+namespace
+{
+    // Prepared responses, by key, for as long as a convolver holds them. The cache
+    // is never destroyed, as responses may be released while the process exits.
+    struct ResponseCache
+    {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::weak_ptr<PartitionedConvolver::Responses>> entries;
+    };
+
+    ResponseCache & responseCache()
+    {
+        static ResponseCache * cache = new ResponseCache;
+        return *cache;
+    }
+
+    // FNV-1a over 32 bit words, with a final avalanche
+    struct Hash
+    {
+        uint64_t value = 14695981039346656037ull;
+
+        void add(uint32_t word)
+        {
+            value ^= word;
+            value *= 1099511628211ull;
+        }
+
+        void add(const float * data, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                uint32_t word;
+                memcpy(&word, data + i, sizeof(word));
+                add(word);
+            }
+        }
+
+        uint64_t finish() const
+        {
+            uint64_t x = value;
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdull;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ull;
+            x ^= x >> 33;
+            return x;
+        }
+    };
+}
+
+PartitionedConvolver::Responses::~Responses()
+{
+    // Another set may have been prepared under the key since this one was last held
+    ResponseCache & cache = responseCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto entry = cache.entries.find(key);
+    if (entry != cache.entries.end() && entry->second.expired())
+        cache.entries.erase(entry);
+}
+
+void PartitionedConvolver::Responses::prepare(const float * const * responses, int count, int length, float gain,
+                                              int blockSize_, bool backgroundTail, int maxPartitionSize)
+{
+    responseCount = count;
+    responseLength = length;
+    blockSize = blockSize_;
+    maxPartitionSize = std::max(maxPartitionSize, blockSize);
+
+    // A segment of partitions of size P produces its output P - blockSize frames
+    // after its input arrives, so it may begin no earlier than that in the impulse
+    // response. The first segment begins at 0 with P = blockSize; each segment of
+    // size P is followed by one of size 8P, and holds just enough partitions, 7, to
+    // reach the offset where the larger segment's latency is hidden. The largest size
+    // repeats until the response is covered. Growing by 8 rather than 4 trades a few
+    // more multiply-adds in the head for one fewer level of transforms, which measured
+    // faster for responses from 0.1 to 10 seconds.
+    //
+    // A segment in the background begins a further P / 2 frames later, which is the
+    // time the background thread has to deliver each partition of output; the segment
+    // before it holds as many more partitions as that takes.
+    int offset = 0;
+    int partitionSize = blockSize;
+    bool background = false;
+    while (offset < length)
+    {
+        int nextPartitionSize = std::min(partitionSize * 8, maxPartitionSize);
+        int remaining = (length - offset + partitionSize - 1) / partitionSize;
+        int partitionCount = remaining;
+        bool nextInBackground = backgroundTail && nextPartitionSize >= BackgroundPartitionSize;
+        if (nextPartitionSize > partitionSize)
+        {
+            int nextOffset = nextPartitionSize - blockSize + (nextInBackground ? nextPartitionSize / 2 : 0);
+            partitionCount = std::min(remaining, (nextOffset - offset + partitionSize - 1) / partitionSize);
+        }
+
+        std::unique_ptr<Partitions> partitions(new Partitions);
+        partitions->offset = offset;
+        partitions->partitionSize = partitionSize;
+        partitions->partitionCount = partitionCount;
+        partitions->background = background;
+
+        // Transform each partition, zero padded to the transform size. multiply() would
+        // scale each product to suit the inverse transform; scaling the responses once
+        // instead lets the products be accumulated directly.
+        FFTFrame frame(partitionSize * 2);
+        const int bins = frame.binCount();
+        partitions->bins = bins;
+        partitions->real.allocate(count * partitionCount * bins);
+        partitions->imag.allocate(count * partitionCount * bins);
+
+        const float scale = gain * FFTFrame::productScale();
+        AudioFloatArray padded(partitionSize * 2);
+        for (int r = 0; r < count; ++r)
+        {
+            for (int p = 0; p < partitionCount; ++p)
+            {
+                padded.zero();
+                int start = offset + p * partitionSize;
+                int frames = std::min(partitionSize, length - start);
+                if (frames > 0)
+                    memcpy(padded.data(), responses[r] + start, sizeof(float) * frames);
+
+                frame.computeForwardFFT(padded.data());
+                vsmul(frame.realData(), 1, &scale, partitions->real.data() + (r * partitionCount + p) * bins, 1, bins);
+                vsmul(frame.imagData(), 1, &scale, partitions->imag.data() + (r * partitionCount + p) * bins, 1, bins);
+            }
+        }
+
+        segments.emplace_back(std::move(partitions));
+        offset += partitionCount * partitionSize;
+        partitionSize = nextPartitionSize;
+        background = nextInBackground;
+    }
+}
+
+uint64_t PartitionedConvolver::responseKey(const float * const * responses, int responseCount, int responseLength,
+                                           uint64_t salt, int blockSize, bool backgroundTail, int maxPartitionSize)
+{
+    Hash hash;
+    hash.add(static_cast<uint32_t>(salt));
+    hash.add(static_cast<uint32_t>(salt >> 32));
+    hash.add(static_cast<uint32_t>(responseCount));
+    hash.add(static_cast<uint32_t>(responseLength));
+    hash.add(static_cast<uint32_t>(blockSize));
+    hash.add(static_cast<uint32_t>(backgroundTail));
+    hash.add(static_cast<uint32_t>(maxPartitionSize));
+    for (int r = 0; r < responseCount; ++r)
+        hash.add(responses[r], responseLength);
+    return hash.finish();
+}
+
+std::shared_ptr<const PartitionedConvolver::Responses> PartitionedConvolver::findResponses(uint64_t key)
+{
+    ResponseCache & cache = responseCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto entry = cache.entries.find(key);
+    if (entry == cache.entries.end())
+        return nullptr;
+
+    // responses still being prepared are returned once they are ready
+    std::shared_ptr<Responses> responses = entry->second.lock();
+    if (!responses || !responses->ready.load(std::memory_order_acquire))
+        return nullptr;
+    return responses;
+}
+
+std::shared_ptr<const PartitionedConvolver::Responses>
+PartitionedConvolver::prepareResponses(const float * const * responses, int responseCount, int responseLength,
+                                       float gain, int blockSize, bool backgroundTail, int maxPartitionSize)
+{
+    uint32_t gainBits;
+    memcpy(&gainBits, &gain, sizeof(gainBits));
+    uint64_t key = responseKey(responses, responseCount, responseLength, gainBits, blockSize, backgroundTail, maxPartitionSize);
+    return prepareResponses(key, responses, responseCount, responseLength, gain, blockSize, backgroundTail, maxPartitionSize);
+}
+
+std::shared_ptr<const PartitionedConvolver::Responses>
+PartitionedConvolver::prepareResponses(uint64_t key, const float * const * responses, int responseCount,
+                                       int responseLength, float gain, int blockSize, bool backgroundTail,
+                                       int maxPartitionSize)
+{
+    ASSERT(blockSize > 0 && !(blockSize & (blockSize - 1)));
+    ASSERT(maxPartitionSize > 0 && !(maxPartitionSize & (maxPartitionSize - 1)));
+
+    std::shared_ptr<Responses> prepared;
+    {
+        ResponseCache & cache = responseCache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        std::weak_ptr<Responses> & entry = cache.entries[key];
+        prepared = entry.lock();
+        if (!prepared)
+        {
+            prepared = std::make_shared<Responses>(key);
+            entry = prepared;
+        }
+    }
+
+    // the first to ask prepares the responses, outside of the cache's lock; any
+    // others asking meanwhile wait for it
+    std::call_once(prepared->prepared, [&]() {
+        prepared->prepare(responses, responseCount, responseLength, gain, blockSize, backgroundTail, maxPartitionSize);
+        prepared->ready.store(true, std::memory_order_release);
+    });
+    return prepared;
+}
+
+// A run of partitions of one size, convolved by uniformly partitioned overlap-save.
+// The segment sees the same input as every other segment; its partitions
+// cover the impulse responses from offset to offset + partitionCount * partitionSize.
+//
+// A segment in the foreground convolves on the render thread, as soon as a
+// partition of input has arrived. A segment in the background hands each
+// partition of input to the BackgroundThread through a ring of two slots, and
+// the thread hands the partition of output back through another; the render
+// thread only waits for, or convolves, a partition itself if the output is due
+// before the thread has delivered it.
+struct PartitionedConvolver::Segment
+{
+    struct Route
+    {
+        int input;
+        int response;
+    };
+
+    Segment(const Responses::Partitions & spectra, int inputCount, const std::vector<std::vector<Route>> & routes)
+        : partitionSize(spectra.partitionSize)
+        , partitionCount(spectra.partitionCount)
+        , offset(spectra.offset)
+        , background(spectra.background)
+        , inputCount(inputCount)
+        , outputCount(static_cast<int>(routes.size()))
+        , bins(spectra.bins)
+        , routes(routes)
+        , spectra(spectra)
+        , frame(partitionSize * 2)
+        , windows(inputCount * partitionSize * 2)
+        , inputReal(inputCount * partitionCount * bins)
+        , inputImag(inputCount * partitionCount * bins)
+        , silentPartitions(inputCount)
+        , transformed(outputCount * partitionSize * 2)
+        , shares(inputCount * 2)
+    {
+        ASSERT(frame.binCount() == bins);
+        if (background)
+        {
+            inputSlots.allocate(inputCount * partitionSize * 2);
+            outputSlots.allocate(outputCount * partitionSize * 2);
+        }
+
+        reset();
+    }
+
+    float * window(int input) { return windows.data() + input * partitionSize * 2; }
+    float * delayLineReal(int input, int slot) { return inputReal.data() + (input * partitionCount + slot) * bins; }
+    float * delayLineImag(int input, int slot) { return inputImag.data() + (input * partitionCount + slot) * bins; }
+    float * output(int o) { return transformed.data() + o * partitionSize * 2; }
+    float * inputSlot(int input, int job) { return inputSlots.data() + (input * 2 + (job & 1)) * partitionSize; }
+    float * outputSlot(int o, int job) { return outputSlots.data() + (o * 2 + (job & 1)) * partitionSize; }
+
+    void reset()
+    {
+        // keeps the background thread out while the state is cleared
+        while (busy.exchange(true, std::memory_order_acquire))
+            std::this_thread::yield();
+
+        windows.zero();
+        transformed.zero();
+        inputReal.zero();
+        inputImag.zero();
+        inputSlots.zero();
+        outputSlots.zero();
+        inputFill = 0;
+        newest = 0;
+        framesRead = 0;
+        submitted.store(0, std::memory_order_relaxed);
+        completed.store(0, std::memory_order_relaxed);
+
+        // the delay lines hold nothing but silence
+        std::fill(silentPartitions.begin(), silentPartitions.end(), partitionCount);
+
+        // transformed holds nothing yet; reading from its second half yields the
+        // silence that precedes the first partition of output
+        readIndex = partitionSize;
+
+        busy.store(false, std::memory_order_release);
+    }
+
+    // Convolves the partition of input in the second half of each window, and
+    // leaves the next partition of each output in the second half of transformed.
+    // An input whose share is another input's index takes that input's spectrum
+    // instead of transforming its own; one whose share is Silent is silent.
+    void convolve(const int * inputShares)
+    {
+        // each window holds the previous partition of input followed by the new one
+        newest = newest ? newest - 1 : partitionCount - 1;
+        for (int i = 0; i < inputCount; ++i)
+        {
+            float * real = delayLineReal(i, newest);
+            float * imag = delayLineImag(i, newest);
+            int share = inputShares[i];
+            if (share == Silent)
+            {
+                memset(real, 0, sizeof(float) * bins);
+                memset(imag, 0, sizeof(float) * bins);
+                silentPartitions[i] = std::min(silentPartitions[i] + 1, partitionCount);
+            }
+            else
+            {
+                if (share >= 0)
+                {
+                    memcpy(real, delayLineReal(share, newest), sizeof(float) * bins);
+                    memcpy(imag, delayLineImag(share, newest), sizeof(float) * bins);
+                }
+                else
+                {
+                    frame.computeForwardFFT(window(i));
+                    memcpy(real, frame.realData(), sizeof(float) * bins);
+                    memcpy(imag, frame.imagData(), sizeof(float) * bins);
+                }
+                silentPartitions[i] = 0;
+            }
+            memmove(window(i), window(i) + partitionSize, sizeof(float) * partitionSize);
+        }
+
+        // Sum the product of each partition's spectrum with the spectrum of the input
+        // it is aligned with; the delay line is ordered from newest to oldest, and
+        // wraps around the end of its storage.
+        float * accReal = frame.realData();
+        float * accImag = frame.imagData();
+        for (int o = 0; o < outputCount; ++o)
+        {
+            memset(accReal, 0, sizeof(float) * bins);
+            memset(accImag, 0, sizeof(float) * bins);
+            float dc = 0.f;
+            float packed = 0.f;
+            bool audible = false;
+            for (const Route & route : routes[o])
+            {
+                // an input whose delay line holds only silence contributes nothing
+                if (silentPartitions[route.input] >= partitionCount)
+                    continue;
+
+                audible = true;
+                for (int p = 0; p < partitionCount; ++p)
+                {
+                    int slot = newest + p;
+                    if (slot >= partitionCount)
+                        slot -= partitionCount;
+
+                    const float * xReal = delayLineReal(route.input, slot);
+                    const float * xImag = delayLineImag(route.input, slot);
+                    const float * hReal = spectra.spectrumReal(route.response, p);
+                    const float * hImag = spectra.spectrumImag(route.response, p);
+
+                    // bin 0 holds real values, the imaginary part being either zero or the
+                    // packed Nyquist bin, so it is multiplied component-wise
+                    dc += xReal[0] * hReal[0];
+                    packed += xImag[0] * hImag[0];
+                    zvmuladd(xReal + 1, xImag + 1, hReal + 1, hImag + 1, accReal + 1, accImag + 1, bins - 1);
+                }
+            }
+
+            if (!audible)
+            {
+                memset(output(o) + partitionSize, 0, sizeof(float) * partitionSize);
+                continue;
+            }
+
+            accReal[0] = dc;
+            accImag[0] = packed;
+
+            // The first half of the inverse transform is aliased by the circular
+            // convolution; the second half is the next partition of output.
+            frame.computeInverseFFT(output(o));
+        }
+    }
+
+    // Appends a block of each input. Returns true if a partition was handed to the
+    // background thread.
+    bool write(const float * const * sources, const int * sharedWith, const int * sharedBlocks, int framesToProcess)
+    {
+        int job = background ? submitted.load(std::memory_order_relaxed) : 0;
+        for (int i = 0; i < inputCount; ++i)
+        {
+            float * destP = (background ? inputSlot(i, job) : window(i) + partitionSize) + inputFill;
+            if (sources[i])
+                memcpy(destP, sources[i], sizeof(float) * framesToProcess);
+            else
+                memset(destP, 0, sizeof(float) * framesToProcess);
+        }
+
+        inputFill += framesToProcess;
+        if (inputFill < partitionSize)
+            return false;
+
+        inputFill = 0;
+
+        // An input may share another's spectrum, or be silent, only if it has been
+        // for the whole window, the previous partition and this one.
+        int * inputShares = shares.data() + (job & 1) * inputCount;
+        for (int i = 0; i < inputCount; ++i)
+            inputShares[i] = sharedBlocks[i] * framesToProcess >= partitionSize * 2 ? sharedWith[i] : Unshared;
+
+        if (!background)
+        {
+            convolve(inputShares);
+            readIndex = partitionSize;
+            return false;
+        }
+
+        submitted.store(job + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Convolves the oldest partition of input that has been handed over, unless
+    // there is none, or another thread is already convolving one.
+    bool runPendingJob()
+    {
+        if (busy.exchange(true, std::memory_order_acquire))
+            return false;
+
+        int job = completed.load(std::memory_order_relaxed);
+        bool pending = job < submitted.load(std::memory_order_acquire);
+        if (pending)
+        {
+            for (int i = 0; i < inputCount; ++i)
+                memcpy(window(i) + partitionSize, inputSlot(i, job), sizeof(float) * partitionSize);
+
+            convolve(shares.data() + (job & 1) * inputCount);
+
+            for (int o = 0; o < outputCount; ++o)
+                memcpy(outputSlot(o, job), output(o) + partitionSize, sizeof(float) * partitionSize);
+
+            completed.store(job + 1, std::memory_order_release);
+        }
+
+        busy.store(false, std::memory_order_release);
+        return pending;
+    }
+
+    bool hasPendingJob() const
+    {
+        return completed.load(std::memory_order_relaxed) < submitted.load(std::memory_order_relaxed);
+    }
+
+    // Sums the next block of each output into dests
+    void read(float * const * dests, int framesToProcess)
+    {
+        if (!background)
+        {
+            ASSERT(readIndex + framesToProcess <= partitionSize * 2);
+            for (int o = 0; o < outputCount; ++o)
+                vadd(output(o) + readIndex, 1, dests[o], 1, dests[o], 1, framesToProcess);
+            readIndex += framesToProcess;
+            return;
+        }
+
+        // The output of partition k of the input is heard from offset + k * partitionSize.
+        // Blocks never straddle partitions, as offsets and sizes are multiples of a block.
+        // framesRead is 64 bit, as 32 bits of frames are only 12 hours at 48kHz
+        int64_t position = framesRead - offset;
+        framesRead += framesToProcess;
+        if (position < 0)
+            return;
+
+        int job = static_cast<int>(position / partitionSize);
+        while (completed.load(std::memory_order_acquire) <= job)
+        {
+            // the deadline has arrived; take the work back from the background thread
+            if (!runPendingJob())
+                std::this_thread::yield();
+        }
+
+        for (int o = 0; o < outputCount; ++o)
+        {
+            const float * sourceP = outputSlot(o, job) + (position - job * partitionSize);
+            vadd(sourceP, 1, dests[o], 1, dests[o], 1, framesToProcess);
+        }
+    }
+
+    int partitionSize;
+    int partitionCount;
+    int offset;
+    bool background;
+    int inputCount;
+    int outputCount;
+    int bins;
+
+    // for each output, the inputs that reach it, and the responses that convolve them
+    std::vector<std::vector<Route>> routes;
+
+    // the responses' partitions, transformed
+    const Responses::Partitions & spectra;
+
+    FFTFrame frame;
+
+    // for each input, the previous and current partitions of input
+    AudioFloatArray windows;
+    int inputFill;
+
+    // for each input, the frequency-domain delay line, one spectrum per partition;
+    // newest is the slot of the most recent spectrum, and each older one follows it.
+    // silentPartitions counts the most recent spectra that are silent.
+    AudioFloatArray inputReal;
+    AudioFloatArray inputImag;
+    int newest;
+    std::vector<int> silentPartitions;
+
+    // for each output, the most recent inverse transform
+    AudioFloatArray transformed;
+    int readIndex;
+
+    // how each input is to be transformed, for each of the two partitions that may be
+    // in flight; see convolve()
+    std::vector<int> shares;
+
+    // In the background, partition k of the input and of the output occupy slot
+    // k & 1. The render thread writes the input slots and advances submitted;
+    // whichever thread holds busy convolves, and advances completed.
+    AudioFloatArray inputSlots;
+    AudioFloatArray outputSlots;
+    std::atomic<int> submitted {0};
+    std::atomic<int> completed {0};
+    std::atomic<bool> busy {false};
+    int64_t framesRead;
+};
+
+// A single thread, shared by every convolver, that convolves the background
+// segments. The render threads never block on it; wake() only signals the
+// thread if its lock is free, and the thread checks for work before it sleeps,
+// so a signal is only missed if a convolver is being created or destroyed at
+// that moment, in which case the partition is picked up at its deadline.
+class PartitionedConvolver::BackgroundThread
+{
+public:
+    static BackgroundThread & shared()
+    {
+        static BackgroundThread thread;
+        return thread;
+    }
+
+    void add(Segment * segment)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_segments.push_back(segment);
+    }
+
+    // Once this returns, the thread is not using the segment
+    void remove(Segment * segment)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_segments.erase(std::remove(m_segments.begin(), m_segments.end(), segment), m_segments.end());
+    }
+
+    void wake()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+        if (lock.owns_lock())
+            m_wake.notify_one();
+    }
+
+private:
+    BackgroundThread()
+        : m_thread(&BackgroundThread::run, this)
+    {
+    }
+
+    ~BackgroundThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shouldStop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    bool hasPendingJob() const
+    {
+        for (const Segment * segment : m_segments)
+        {
+            if (segment->hasPendingJob())
+                return true;
+        }
+        return false;
+    }
+
+    void run()
+    {
+        DenormalDisabler denormalDisabler;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait(lock, [this] { return m_shouldStop || hasPendingJob(); });
+            if (m_shouldStop)
+                return;
+
+            for (Segment * segment : m_segments)
+            {
+                while (segment->runPendingJob())
+                {
+                }
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<Segment *> m_segments;
+    bool m_shouldStop = false;
+    std::thread m_thread;
+};
+
+PartitionedConvolver::PartitionedConvolver(std::shared_ptr<const Responses> responses,
+                                           int inputCount, int outputCount, const int * routing)
+    : m_responses(std::move(responses))
+    , m_blockSize(m_responses->blockSize)
+    , m_inputCount(inputCount)
+    , m_outputCount(outputCount)
+    , m_responseLength(m_responses->responseLength)
+    , m_sharedWith(inputCount)
+    , m_sharedBlocks(inputCount)
+{
+    std::vector<std::vector<Segment::Route>> routes(outputCount);
+    for (int o = 0; o < outputCount; ++o)
+    {
+        for (int i = 0; i < inputCount; ++i)
+        {
+            int response = routing[o * inputCount + i];
+            ASSERT(response < m_responses->responseCount);
+            if (response >= 0 && response < m_responses->responseCount)
+                routes[o].push_back({i, response});
+        }
+    }
+
+    for (auto & partitions : m_responses->segments)
+        m_segments.emplace_back(new Segment(*partitions, inputCount, routes));
+
+    reset();
+
+    for (auto & segment : m_segments)
+    {
+        if (segment->background)
+            BackgroundThread::shared().add(segment.get());
+    }
+}
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+    for (auto & segment : m_segments)
+    {
+        if (segment->background)
+            BackgroundThread::shared().remove(segment.get());
+    }
+}
+
+void PartitionedConvolver::process(const float * const * sources, float * const * dests, int framesToProcess)
+{
+    ASSERT(framesToProcess == m_blockSize);
+    if (framesToProcess != m_blockSize)
+        return;
+
+    // note which inputs carry the same signal as an earlier one, or none
+    const int sharedLimit = 1 << 20;
+    for (int i = 0; i < m_inputCount; ++i)
+    {
+        int shared = sources[i] ? Unshared : Silent;
+        for (int j = 0; j < i && shared == Unshared; ++j)
+        {
+            if (sources[j] == sources[i])
+                shared = j;
+        }
+
+        if (shared != m_sharedWith[i])
+        {
+            m_sharedWith[i] = shared;
+            m_sharedBlocks[i] = 1;
+        }
+        else if (m_sharedBlocks[i] < sharedLimit)
+            ++m_sharedBlocks[i];
+    }
+
+    // every segment takes the input before any output is written, as they may alias
+    bool submitted = false;
+    for (auto & segment : m_segments)
+        submitted |= segment->write(sources, m_sharedWith.data(), m_sharedBlocks.data(), framesToProcess);
+
+    if (submitted)
+        BackgroundThread::shared().wake();
+
+    for (int o = 0; o < m_outputCount; ++o)
+        memset(dests[o], 0, sizeof(float) * framesToProcess);
+
+    for (auto & segment : m_segments)
+        segment->read(dests, framesToProcess);
+}
+
+void PartitionedConvolver::reset()
+{
+    for (auto & segment : m_segments)
+        segment->reset();
+
+    // the history is silent
+    std::fill(m_sharedWith.begin(), m_sharedWith.end(), static_cast<int>(Silent));
+    std::fill(m_sharedBlocks.begin(), m_sharedBlocks.end(), 1 << 20);
+}
+
+}  // namespace lab
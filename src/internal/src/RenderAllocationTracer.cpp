@@ -0,0 +1,143 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/RenderAllocationTracer.h"
+
+#if defined(LABSOUND_TRACE_RENDER_ALLOCATIONS)
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+
+extern "C" void * __libc_malloc(size_t);
+extern "C" void * __libc_calloc(size_t, size_t);
+extern "C" void * __libc_realloc(void *, size_t);
+extern "C" void __libc_free(void *);
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LABSOUND_CALL_SITE _ReturnAddress()
+#else
+#define LABSOUND_CALL_SITE __builtin_return_address(0)
+#endif
+
+#if defined(__GLIBC__)
+// the allocator must not be reentered to set up the tracer's own thread locals
+#define LABSOUND_TRACER_TLS __attribute__((tls_model("initial-exec")))
+#else
+#define LABSOUND_TRACER_TLS
+#endif
+
+namespace
+{
+    thread_local const char * t_renderScope LABSOUND_TRACER_TLS = nullptr;
+    thread_local bool t_reporting LABSOUND_TRACER_TLS = false;
+
+    void reportRenderAllocation(const char * what, size_t size, void * callSite)
+    {
+        if (!t_renderScope || t_reporting)
+            return;
+
+        // reporting may itself allocate
+        t_reporting = true;
+        if (size)
+            fprintf(stderr, "LabSound: %s of %zu bytes on the render thread in %s, called from %p\n",
+                    what, size, t_renderScope, callSite);
+        else
+            fprintf(stderr, "LabSound: %s on the render thread in %s, called from %p\n",
+                    what, t_renderScope, callSite);
+#if defined(__GLIBC__)
+        void * frames[16];
+        int count = backtrace(frames, 16);
+        backtrace_symbols_fd(frames + 1, count - 1, STDERR_FILENO);
+#endif
+        t_reporting = false;
+    }
+}
+
+namespace lab
+{
+
+RenderAllocationScope::RenderAllocationScope(const char * name)
+    : m_previous(t_renderScope)
+{
+    t_renderScope = name;
+}
+
+RenderAllocationScope::~RenderAllocationScope()
+{
+    t_renderScope = m_previous;
+}
+
+}  // namespace lab
+
+#if defined(__GLIBC__)
+
+// glibc supports replacing the malloc family outright, which also catches
+// operator new, since libstdc++ implements it with malloc, and C libraries
+// such as libsamplerate.
+
+extern "C" void * malloc(size_t size)
+{
+    reportRenderAllocation("malloc", size, LABSOUND_CALL_SITE);
+    return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t count, size_t size)
+{
+    reportRenderAllocation("calloc", count * size, LABSOUND_CALL_SITE);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size)
+{
+    reportRenderAllocation("realloc", size, LABSOUND_CALL_SITE);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void * ptr)
+{
+    if (ptr)
+        reportRenderAllocation("free", 0, LABSOUND_CALL_SITE);
+    __libc_free(ptr);
+}
+
+#else
+
+// elsewhere the C allocator can't be portably replaced, so only allocations
+// made through operator new are reported
+
+void * operator new(size_t size)
+{
+    reportRenderAllocation("operator new", size, LABSOUND_CALL_SITE);
+    if (void * p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void * operator new[](size_t size)
+{
+    reportRenderAllocation("operator new[]", size, LABSOUND_CALL_SITE);
+    if (void * p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+#endif  // LABSOUND_TRACE_RENDER_ALLOCATIONS
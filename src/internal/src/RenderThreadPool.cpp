@@ -0,0 +1,251 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/RenderThreadPool.h"
+#include "internal/Assertions.h"
+#include "internal/DenormalDisabler.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lab
+{
+
+namespace
+{
+    // how many times an idle worker polls for work before yielding the core,
+    // and for the next quantum before sleeping
+    const int kSpinCount = 64;
+    const int kIdleSpinCount = 4096;
+
+    void pinThread(std::thread & t, int core)
+    {
+#if defined(__linux__)
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        if (cores <= 1)
+            return;
+
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(core % cores, &cpuset);
+        pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &cpuset);
+#else
+        (void) t;
+        (void) core;
+#endif
+    }
+}
+
+void RenderThreadPool::TaskDeque::reserve(int capacity)
+{
+    int64_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    if (size <= m_mask)
+        return;
+
+    m_tasks.reset(new std::atomic<int>[size]);
+    m_mask = size - 1;
+    m_top = 0;
+    m_bottom = 0;
+}
+
+void RenderThreadPool::TaskDeque::push(int task)
+{
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    m_tasks[b & m_mask].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+int RenderThreadPool::TaskDeque::pop()
+{
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    int task = m_tasks[b & m_mask].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // the last task; race any thieves for it
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            task = -1;
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+int RenderThreadPool::TaskDeque::steal()
+{
+    int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return -1;
+
+    int task = m_tasks[t & m_mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return -1;
+    return task;
+}
+
+RenderThreadPool::RenderThreadPool(int threadCount)
+{
+    if (threadCount < 0)
+        threadCount = 0;
+
+    for (int i = 0; i <= threadCount; ++i)
+        m_deques.emplace_back(new TaskDeque());
+
+    // worker zero is the thread calling run(), the rest are started here
+    for (int i = 1; i <= threadCount; ++i)
+    {
+        m_threads.emplace_back(&RenderThreadPool::workerThread, this, i);
+        pinThread(m_threads.back(), i);
+    }
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_shouldRun = false;
+    }
+    m_wake.notify_all();
+
+    for (auto & t : m_threads)
+        t.join();
+}
+
+void RenderThreadPool::reserve(int taskCount)
+{
+    if (taskCount <= m_capacity)
+        return;
+
+    for (auto & d : m_deques)
+        d->reserve(taskCount);
+
+    m_pending.reset(new std::atomic<int>[taskCount]);
+    m_capacity = taskCount;
+}
+
+void RenderThreadPool::run(const std::vector<RenderTask> & tasks, TaskFunction fn, void * user)
+{
+    const int taskCount = static_cast<int>(tasks.size());
+    ASSERT(taskCount <= m_capacity);
+    if (!taskCount)
+        return;
+
+    m_tasks = &tasks;
+    m_fn = fn;
+    m_user = user;
+
+    for (int i = 0; i < taskCount; ++i)
+    {
+        m_pending[i].store(tasks[i].dependencies, std::memory_order_relaxed);
+        if (!tasks[i].dependencies)
+            m_deques[0]->push(i);
+    }
+
+    m_remaining.store(taskCount, std::memory_order_release);
+
+    if (!m_threads.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_generation.fetch_add(1, std::memory_order_release);
+        }
+        m_wake.notify_all();
+    }
+
+    work(0);
+
+    // don't return while a worker might still be looking at this quantum's tasks
+    while (m_working.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+
+    m_tasks = nullptr;
+}
+
+void RenderThreadPool::workerThread(int index)
+{
+    DenormalDisabler denormalDisabler;
+
+    uint64_t seen = 0;
+    while (true)
+    {
+        int spins = 0;
+        while (m_generation.load(std::memory_order_acquire) == seen && m_shouldRun)
+        {
+            if (++spins < kIdleSpinCount)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait(lock, [&]() { return m_generation.load() != seen || !m_shouldRun; });
+        }
+
+        if (!m_shouldRun)
+            return;
+
+        seen = m_generation.load(std::memory_order_acquire);
+
+        m_working.fetch_add(1, std::memory_order_acq_rel);
+        work(index);
+        m_working.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void RenderThreadPool::work(int index)
+{
+    const int dequeCount = static_cast<int>(m_deques.size());
+    int spins = 0;
+
+    while (m_remaining.load(std::memory_order_acquire) > 0)
+    {
+        int task = m_deques[index]->pop();
+        for (int i = 1; task < 0 && i < dequeCount; ++i)
+            task = m_deques[(index + i) % dequeCount]->steal();
+
+        if (task < 0)
+        {
+            // everything runnable is in progress elsewhere
+            if (++spins > kSpinCount)
+            {
+                std::this_thread::yield();
+                spins = 0;
+            }
+            continue;
+        }
+
+        m_fn(m_user, task);
+        complete(index, task);
+        spins = 0;
+    }
+}
+
+void RenderThreadPool::complete(int index, int task)
+{
+    for (int d : (*m_tasks)[task].dependents)
+    {
+        if (m_pending[d].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            m_deques[index]->push(d);
+    }
+
+    m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+}  // namespace lab
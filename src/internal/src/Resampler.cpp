@@ -0,0 +1,334 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/Resampler.h"
+
+#include "LabSound/core/Macros.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define RESAMPLER_SIMD 1
+#elif defined(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#define RESAMPLER_SIMD 1
+#else
+#define RESAMPLER_SIMD 0
+#endif
+
+namespace lab
+{
+
+namespace
+{
+    enum : int
+    {
+        PhaseBits = 7,
+        Phases = 1 << PhaseBits,
+
+        // Cutoffs for rates up to 2^7, every half octave; the node limits the rate to 100
+        Bands = 15,
+    };
+
+    const int SincQualityCount = Resampler::_QualityCount - Resampler::Sinc16;
+
+    // A windowed sinc, tabulated at Phases + 1 fractions of a frame, from 0 to 1
+    // inclusive, for each band. Tap j of a row weighs the source frame
+    // j - (taps / 2 - 1) from the position's.
+    struct Filter
+    {
+        int taps = 0;
+        std::vector<float> coefficients;  // [band][phase][tap]
+
+        const float * row(int band, int phase) const { return &coefficients[(band * (Phases + 1) + phase) * taps]; }
+    };
+
+    // The taps, the cutoff relative to the source's Nyquist frequency when the
+    // rate is one or less, and the Kaiser window's beta of each sinc quality.
+    // The cutoff is at the middle of the transition band, which narrows as the
+    // taps increase, so that the stop band begins near the Nyquist frequency.
+    const struct
+    {
+        int taps;
+        double cutoff;
+        double beta;
+    } s_sincDesigns[SincQualityCount] = {
+        {16, 0.80, 6.0},
+        {32, 0.85, 8.0},
+        {64, 0.90, 10.0},
+    };
+
+    std::mutex s_filterMutex;
+    std::unique_ptr<Filter> s_filterStorage[SincQualityCount];
+    std::atomic<const Filter *> s_filters[SincQualityCount] = {};
+
+    // The modified Bessel function of the first kind, of order zero
+    double besselI0(double x)
+    {
+        double sum = 1;
+        double term = 1;
+        for (int k = 1; k < 50; ++k)
+        {
+            const double factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+    std::unique_ptr<Filter> designFilter(int taps, double cutoff, double beta)
+    {
+        std::unique_ptr<Filter> filter(new Filter);
+        filter->taps = taps;
+        filter->coefficients.resize(Bands * (Phases + 1) * taps);
+
+        const double pi = static_cast<double>(LAB_PI);
+        const double halfWidth = taps / 2;
+        const double windowScale = 1.0 / besselI0(beta);
+
+        for (int band = 0; band < Bands; ++band)
+        {
+            const double bandCutoff = cutoff * std::pow(2.0, -0.5 * band);
+            for (int phase = 0; phase <= Phases; ++phase)
+            {
+                float * row = &filter->coefficients[(band * (Phases + 1) + phase) * taps];
+                const double fraction = static_cast<double>(phase) / Phases;
+
+                double sum = 0;
+                for (int j = 0; j < taps; ++j)
+                {
+                    const double t = (j - (taps / 2 - 1)) - fraction;
+                    const double x = t / halfWidth;
+                    const double window = std::fabs(x) < 1 ? besselI0(beta * std::sqrt(1 - x * x)) * windowScale : 0;
+                    const double sinc = t == 0 ? 1 : std::sin(pi * bandCutoff * t) / (pi * bandCutoff * t);
+                    const double h = bandCutoff * sinc * window;
+                    row[j] = static_cast<float>(h);
+                    sum += h;
+                }
+
+                // unity gain at DC, whatever the phase
+                for (int j = 0; j < taps; ++j)
+                    row[j] = static_cast<float>(row[j] / sum);
+            }
+        }
+
+        return filter;
+    }
+
+    // The band whose cutoff is at or below the one the rate needs
+    int bandForRate(double rate)
+    {
+        if (rate <= 1)
+            return 0;
+        return std::min(static_cast<int>(std::ceil(2.0 * std::log2(rate) - 1e-9)), static_cast<int>(Bands) - 1);
+    }
+
+    // coefficients = row0 + t * (row1 - row0); taps is a multiple of four
+    inline void interpolateRows(const float * row0, const float * row1, float t, float * coefficients, int taps)
+    {
+#if RESAMPLER_SIMD
+#ifdef __SSE2__
+        const __m128 vt = _mm_set1_ps(t);
+        for (int j = 0; j < taps; j += 4)
+        {
+            const __m128 a = _mm_loadu_ps(row0 + j);
+            const __m128 b = _mm_loadu_ps(row1 + j);
+            _mm_storeu_ps(coefficients + j, _mm_add_ps(a, _mm_mul_ps(vt, _mm_sub_ps(b, a))));
+        }
+#else
+        const float32x4_t vt = vdupq_n_f32(t);
+        for (int j = 0; j < taps; j += 4)
+        {
+            const float32x4_t a = vld1q_f32(row0 + j);
+            const float32x4_t b = vld1q_f32(row1 + j);
+            vst1q_f32(coefficients + j, vmlaq_f32(a, vt, vsubq_f32(b, a)));
+        }
+#endif
+#else
+        for (int j = 0; j < taps; ++j)
+            coefficients[j] = row0[j] + t * (row1[j] - row0[j]);
+#endif
+    }
+
+    // The sum of the products of taps frames and coefficients; taps is a multiple of four
+    inline float dot(const float * frames, const float * coefficients, int taps)
+    {
+#if RESAMPLER_SIMD
+#ifdef __SSE2__
+        __m128 sum = _mm_mul_ps(_mm_loadu_ps(frames), _mm_loadu_ps(coefficients));
+        for (int j = 4; j < taps; j += 4)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(frames + j), _mm_loadu_ps(coefficients + j)));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+#else
+        float32x4_t sum = vmulq_f32(vld1q_f32(frames), vld1q_f32(coefficients));
+        for (int j = 4; j < taps; j += 4)
+            sum = vmlaq_f32(sum, vld1q_f32(frames + j), vld1q_f32(coefficients + j));
+        float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+        return vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+#else
+        float sum = 0;
+        for (int j = 0; j < taps; ++j)
+            sum += frames[j] * coefficients[j];
+        return sum;
+#endif
+    }
+
+    // Copies the taps frames from first into window, as the region reads them
+    // where they fall outside it.
+    void gather(const Resampler::Region & source, const float * channel, int32_t first, int taps, float * window)
+    {
+        const int32_t length = source.end - source.start;
+        for (int j = 0; j < taps; ++j)
+        {
+            int32_t frame = first + j;
+            if (frame < source.start)
+            {
+                if (!source.wrapsBeforeStart)
+                {
+                    window[j] = 0;
+                    continue;
+                }
+                frame = source.end - (source.start - frame - 1) % length - 1;
+            }
+            else if (frame >= source.end)
+            {
+                if (!source.wrapsAfterEnd)
+                {
+                    window[j] = 0;
+                    continue;
+                }
+                frame = source.start + (frame - source.end) % length;
+            }
+            window[j] = channel[frame];
+        }
+    }
+    // Linear interpolation with two taps, Catmull-Rom with four, and the filter
+    // with more.
+    template <int Taps>
+    int resample(const Filter * filter, const Resampler::Region & source, Resampler::Position & position, double rate,
+                 float * const * dests, int framesToProcess)
+    {
+        const int before = Taps / 2 - 1;  // the frames read before the position's
+        const int after = Taps / 2;       // and after it
+        const int band = filter ? bandForRate(rate) : 0;
+
+        const int64_t step = static_cast<int64_t>(std::llround(rate * 4294967296.0));
+        const int64_t end = static_cast<int64_t>(source.end) << 32;
+        int64_t p = (static_cast<int64_t>(position.frame) << 32) | position.fraction;
+
+        float coefficients[Taps];
+        float window[Taps];
+
+        int written = 0;
+        for (; written < framesToProcess && p < end; ++written, p += step)
+        {
+            const int32_t frame = static_cast<int32_t>(p >> 32);
+            const uint32_t fraction = static_cast<uint32_t>(p);
+
+            if (Taps == 2)
+            {
+                const float t = static_cast<float>(fraction) * (1.f / 4294967296.f);
+                coefficients[0] = 1.f - t;
+                coefficients[1] = t;
+            }
+            else if (Taps == 4)
+            {
+                const float t = static_cast<float>(fraction) * (1.f / 4294967296.f);
+                const float t2 = t * t;
+                const float t3 = t2 * t;
+                coefficients[0] = 0.5f * (-t3 + 2.f * t2 - t);
+                coefficients[1] = 0.5f * (3.f * t3 - 5.f * t2 + 2.f);
+                coefficients[2] = 0.5f * (-3.f * t3 + 4.f * t2 + t);
+                coefficients[3] = 0.5f * (t3 - t2);
+            }
+            else
+            {
+                const uint32_t phase = fraction >> (32 - PhaseBits);
+                const float t = static_cast<float>(fraction & ((1u << (32 - PhaseBits)) - 1)) * (1.f / (1u << (32 - PhaseBits)));
+                interpolateRows(filter->row(band, phase), filter->row(band, phase + 1), t, coefficients, Taps);
+            }
+
+            const int32_t first = frame - before;
+            const bool isInside = first >= source.start && frame + after < source.end;
+            for (int c = 0; c < source.channelCount; ++c)
+            {
+                const float * frames = source.channels[c] + first;
+                if (!isInside)
+                {
+                    gather(source, source.channels[c], first, Taps, window);
+                    frames = window;
+                }
+
+                float value;
+                if (Taps == 2)
+                    value = frames[0] * coefficients[0] + frames[1] * coefficients[1];
+                else
+                    value = dot(frames, coefficients, Taps);
+                dests[c][written] += value;
+            }
+        }
+
+        position.frame = static_cast<int32_t>(p >> 32);
+        position.fraction = static_cast<uint32_t>(p);
+        return written;
+    }
+}
+
+void Resampler::prepare(Quality quality)
+{
+    if (quality < Sinc16 || quality >= _QualityCount)
+        return;
+
+    const int index = quality - Sinc16;
+    if (s_filters[index].load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> lock(s_filterMutex);
+    if (s_filterStorage[index])
+        return;
+
+    s_filterStorage[index] = designFilter(s_sincDesigns[index].taps, s_sincDesigns[index].cutoff, s_sincDesigns[index].beta);
+    s_filters[index].store(s_filterStorage[index].get(), std::memory_order_release);
+}
+
+int Resampler::process(Quality quality, const Region & source, Position & position, double rate,
+                       float * const * dests, int framesToProcess)
+{
+    if (source.end <= source.start)
+        return 0;
+
+    const Filter * filter = nullptr;
+    if (quality >= Sinc16 && quality < _QualityCount)
+    {
+        filter = s_filters[quality - Sinc16].load(std::memory_order_acquire);
+        if (!filter)
+            quality = Cubic;
+    }
+
+    if (filter)
+    {
+        switch (filter->taps)
+        {
+            case 16: return resample<16>(filter, source, position, rate, dests, framesToProcess);
+            case 32: return resample<32>(filter, source, position, rate, dests, framesToProcess);
+            default: return resample<64>(filter, source, position, rate, dests, framesToProcess);
+        }
+    }
+
+    if (quality == Cubic)
+        return resample<4>(nullptr, source, position, rate, dests, framesToProcess);
+    return resample<2>(nullptr, source, position, rate, dests, framesToProcess);
+}
+
+}  // namespace lab
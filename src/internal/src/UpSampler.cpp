@@ -32,6 +32,9 @@
 
 #include "UpSampler.h"
 #include "internal/Assertions.h"
+
+#include <algorithm>
+#include <cstring>
 #include "LabSound/core/Macros.h"
 //#include <wtf/MathExtras.h>
 
@@ -39,10 +42,11 @@ namespace lab {
 
 UpSampler::UpSampler(size_t inputBlockSize)
     : m_inputBlockSize(inputBlockSize)
+    , m_historySize(std::max<size_t>(inputBlockSize, DefaultKernelSize / 2))
     , m_kernel(DefaultKernelSize)
-    , m_convolver(inputBlockSize)
+    , m_convolver(inputBlockSize, DefaultKernelSize)
     , m_tempBuffer(inputBlockSize)
-    , m_inputBuffer(inputBlockSize * 2)
+    , m_inputBuffer(m_historySize + inputBlockSize)
 {
     initializeKernel();
 }
@@ -93,13 +97,13 @@ void UpSampler::process(const float* sourceP, float* destP, size_t sourceFramesT
 
     size_t halfSize = m_kernel.size() / 2;
 
-    // Copy source samples to 2nd half of input buffer.
-    bool isInputBufferGood = m_inputBuffer.size() == sourceFramesToProcess * 2 && halfSize <= sourceFramesToProcess;
+    // Copy source samples after the history in the input buffer.
+    bool isInputBufferGood = m_inputBuffer.size() == m_historySize + sourceFramesToProcess && halfSize <= m_historySize;
     ASSERT(isInputBufferGood);
     if (!isInputBufferGood)
         return;
 
-    float* inputP = m_inputBuffer.data() + sourceFramesToProcess;
+    float* inputP = m_inputBuffer.data() + m_historySize;
     memcpy(inputP, sourceP, sizeof(float) * sourceFramesToProcess);
 
     // Copy even sample-frames 0,2,4,6... (delayed by the linear phase delay) directly into destP.
@@ -110,11 +114,11 @@ void UpSampler::process(const float* sourceP, float* destP, size_t sourceFramesT
     float* oddSamplesP = m_tempBuffer.data();
     m_convolver.process(&m_kernel, sourceP, oddSamplesP, sourceFramesToProcess);
 
-    for (unsigned i = 0; i < sourceFramesToProcess - 1; ++i)
+    for (unsigned i = 0; i < sourceFramesToProcess; ++i)
         destP[i * 2 + 1] = oddSamplesP[i];
 
-    // Copy 2nd half of input buffer to 1st half.
-    memcpy(m_inputBuffer.data(), inputP, sizeof(float) * sourceFramesToProcess);
+    // Keep the latest m_historySize frames as the history.
+    memmove(m_inputBuffer.data(), m_inputBuffer.data() + sourceFramesToProcess, sizeof(float) * m_historySize);
 }
 
 void UpSampler::reset()
@@ -6,6 +6,7 @@
 #include "internal/Assertions.h"
 
 #include "LabSound/extended/VectorMath.h"
+#include "internal/VectorMathKernels.h"
 
 #if defined(LABSOUND_PLATFORM_OSX)
 #include <Accelerate/Accelerate.h>
@@ -79,6 +80,20 @@ namespace VectorMath
 #endif
     }
 
+    void zvmuladd(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P, float * realAccP, float * imagAccP, int framesToProcess)
+    {
+        DSPSplitComplex sc1;
+        DSPSplitComplex sc2;
+        DSPSplitComplex acc;
+        sc1.realp = const_cast<float *>(real1P);
+        sc1.imagp = const_cast<float *>(imag1P);
+        sc2.realp = const_cast<float *>(real2P);
+        sc2.imagp = const_cast<float *>(imag2P);
+        acc.realp = realAccP;
+        acc.imagp = imagAccP;
+        vDSP_zvma(&sc1, 1, &sc2, 1, &acc, 1, &acc, 1, framesToProcess);
+    }
+
     void vsma(const float * sourceP, int sourceStride, const float * scale, float * destP, int destStride, int framesToProcess)
     {
         vDSP_vsma(sourceP, sourceStride, scale, destP, destStride, destP, destStride, framesToProcess);
@@ -98,10 +113,27 @@ namespace VectorMath
     {
         vDSP_vclip(const_cast<float *>(sourceP), sourceStride, const_cast<float *>(lowThresholdP), const_cast<float *>(highThresholdP), destP, destStride, framesToProcess);
     }
+
+    void vfill(const float * valueP, float * destP, int destStride, int framesToProcess)
+    {
+        vDSP_vfill(valueP, destP, destStride, framesToProcess);
+    }
+
+    void vramp(const float * startP, const float * stepP, float * destP, int destStride, int framesToProcess)
+    {
+        vDSP_vramp(startP, stepP, destP, destStride, framesToProcess);
+    }
 #else
 
     void vsma(const float * sourceP, int sourceStride, const float * scale, float * destP, int destStride, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vsma && sourceStride == 1 && destStride == 1)
+        {
+            kernels.vsma(sourceP, *scale, destP, framesToProcess);
+            return;
+        }
+
         int n = framesToProcess;
 
 #ifdef __SSE2__
@@ -180,6 +212,13 @@ namespace VectorMath
 
     void vsmul(const float * sourceP, int sourceStride, const float * scale, float * destP, int destStride, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vsmul && sourceStride == 1 && destStride == 1)
+        {
+            kernels.vsmul(sourceP, *scale, destP, framesToProcess);
+            return;
+        }
+
         int n = framesToProcess;
 
 #ifdef __SSE2__
@@ -272,6 +311,13 @@ namespace VectorMath
 
     void vadd(const float * source1P, int sourceStride1, const float * source2P, int sourceStride2, float * destP, int destStride, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vadd && sourceStride1 == 1 && sourceStride2 == 1 && destStride == 1)
+        {
+            kernels.vadd(source1P, source2P, destP, framesToProcess);
+            return;
+        }
+
         int n = framesToProcess;
 
 #ifdef __SSE2__
@@ -401,6 +447,13 @@ namespace VectorMath
 
     void vmul(const float * source1P, int sourceStride1, const float * source2P, int sourceStride2, float * destP, int destStride, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vmul && sourceStride1 == 1 && sourceStride2 == 1 && destStride == 1)
+        {
+            kernels.vmul(source1P, source2P, destP, framesToProcess);
+            return;
+        }
+
 
         int n = framesToProcess;
 
@@ -481,6 +534,13 @@ namespace VectorMath
 
     void zvmul(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P, float * realDestP, float * imagDestP, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.zvmul)
+        {
+            kernels.zvmul(real1P, imag1P, real2P, imag2P, realDestP, imagDestP, framesToProcess);
+            return;
+        }
+
         int i = 0;
 #ifdef __SSE2__
         // Only use the SSE optimization in the very common case that all addresses are 16-byte aligned.
@@ -539,8 +599,65 @@ namespace VectorMath
         }
     }
 
+    void zvmuladd(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P, float * realAccP, float * imagAccP, int framesToProcess)
+    {
+        const Kernels & kernels = activeKernels();
+        if (kernels.zvmuladd)
+        {
+            kernels.zvmuladd(real1P, imag1P, real2P, imag2P, realAccP, imagAccP, framesToProcess);
+            return;
+        }
+
+        int i = 0;
+#ifdef __SSE2__
+        int endSize = framesToProcess - framesToProcess % 4;
+        while (i < endSize)
+        {
+            __m128 real1 = _mm_loadu_ps(real1P + i);
+            __m128 real2 = _mm_loadu_ps(real2P + i);
+            __m128 imag1 = _mm_loadu_ps(imag1P + i);
+            __m128 imag2 = _mm_loadu_ps(imag2P + i);
+            __m128 real = _mm_sub_ps(_mm_mul_ps(real1, real2), _mm_mul_ps(imag1, imag2));
+            __m128 imag = _mm_add_ps(_mm_mul_ps(real1, imag2), _mm_mul_ps(imag1, real2));
+            _mm_storeu_ps(realAccP + i, _mm_add_ps(_mm_loadu_ps(realAccP + i), real));
+            _mm_storeu_ps(imagAccP + i, _mm_add_ps(_mm_loadu_ps(imagAccP + i), imag));
+            i += 4;
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        int endSize = framesToProcess - framesToProcess % 4;
+        while (i < endSize)
+        {
+            float32x4_t real1 = vld1q_f32(real1P + i);
+            float32x4_t real2 = vld1q_f32(real2P + i);
+            float32x4_t imag1 = vld1q_f32(imag1P + i);
+            float32x4_t imag2 = vld1q_f32(imag2P + i);
+
+            float32x4_t realAcc = vmlsq_f32(vmlaq_f32(vld1q_f32(realAccP + i), real1, real2), imag1, imag2);
+            float32x4_t imagAcc = vmlaq_f32(vmlaq_f32(vld1q_f32(imagAccP + i), real1, imag2), imag1, real2);
+
+            vst1q_f32(realAccP + i, realAcc);
+            vst1q_f32(imagAccP + i, imagAcc);
+
+            i += 4;
+        }
+#endif
+        for (; i < framesToProcess; ++i)
+        {
+            realAccP[i] += real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+            imagAccP[i] += real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+        }
+    }
+
     void vsvesq(const float * sourceP, int sourceStride, float * sumP, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vsvesq && sourceStride == 1)
+        {
+            ASSERT(sumP);
+            *sumP = kernels.vsvesq(sourceP, framesToProcess);
+            return;
+        }
+
         int n = framesToProcess;
         float sum = 0;
 
@@ -612,6 +729,14 @@ namespace VectorMath
 
     void vmaxmgv(const float * sourceP, int sourceStride, float * maxP, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vmaxmgv && sourceStride == 1)
+        {
+            ASSERT(maxP);
+            *maxP = kernels.vmaxmgv(sourceP, framesToProcess);
+            return;
+        }
+
         int n = framesToProcess;
         float max = 0;
 
@@ -687,12 +812,35 @@ namespace VectorMath
 
     void vclip(const float * sourceP, int sourceStride, const float * lowThresholdP, const float * highThresholdP, float * destP, int destStride, int framesToProcess)
     {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vclip && sourceStride == 1 && destStride == 1)
+        {
+            kernels.vclip(sourceP, *lowThresholdP, *highThresholdP, destP, framesToProcess);
+            return;
+        }
+
         int n = framesToProcess;
         float lowThreshold = *lowThresholdP;
         float highThreshold = *highThresholdP;
 
-        // FIXME: Optimize for SSE2.
-#if defined(ARM_NEON_INTRINSICS)
+#ifdef __SSE2__
+        if ((sourceStride == 1) && (destStride == 1))
+        {
+            int tailFrames = n % 4;
+            const float * endP = destP + n - tailFrames;
+
+            __m128 low = _mm_set1_ps(lowThreshold);
+            __m128 high = _mm_set1_ps(highThreshold);
+            while (destP < endP)
+            {
+                __m128 source = _mm_loadu_ps(sourceP);
+                _mm_storeu_ps(destP, _mm_max_ps(_mm_min_ps(source, high), low));
+                sourceP += 4;
+                destP += 4;
+            }
+            n = tailFrames;
+        }
+#elif defined(ARM_NEON_INTRINSICS)
         if ((sourceStride == 1) && (destStride == 1))
         {
             int tailFrames = n % 4;
@@ -718,6 +866,72 @@ namespace VectorMath
         }
     }
 
+    void vfill(const float * valueP, float * destP, int destStride, int framesToProcess)
+    {
+        int n = framesToProcess;
+        float value = *valueP;
+
+        if (destStride == 1)
+        {
+            std::fill(destP, destP + n, value);
+            return;
+        }
+
+        while (n--)
+        {
+            *destP = value;
+            destP += destStride;
+        }
+    }
+
+    void vramp(const float * startP, const float * stepP, float * destP, int destStride, int framesToProcess)
+    {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vramp && destStride == 1)
+        {
+            kernels.vramp(*startP, *stepP, destP, framesToProcess);
+            return;
+        }
+
+        int n = framesToProcess;
+        float start = *startP;
+        float step = *stepP;
+        int i = 0;
+
+#ifdef __SSE2__
+        if (destStride == 1)
+        {
+            __m128 mStart = _mm_set1_ps(start);
+            __m128 mStep = _mm_set1_ps(step);
+            __m128 mIndex = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+            const __m128 mFour = _mm_set1_ps(4.f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                _mm_storeu_ps(destP + i, _mm_add_ps(mStart, _mm_mul_ps(mIndex, mStep)));
+                mIndex = _mm_add_ps(mIndex, mFour);
+            }
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        if (destStride == 1)
+        {
+            float32x4_t mStart = vdupq_n_f32(start);
+            float32x4_t mStep = vdupq_n_f32(step);
+            const float indices[4] = {0.f, 1.f, 2.f, 3.f};
+            float32x4_t mIndex = vld1q_f32(indices);
+            const float32x4_t mFour = vdupq_n_f32(4.f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                vst1q_f32(destP + i, vmlaq_f32(mStart, mIndex, mStep));
+                mIndex = vaddq_f32(mIndex, mFour);
+            }
+        }
+#endif
+        for (; i < n; ++i)
+            destP[i * destStride] = start + static_cast<float>(i) * step;
+    }
+
 #endif  // OS(DARWIN)
 
     void vintlve(const float * realSrcP, const float * imagSrcP, float * destP, int framesToProcess)
@@ -754,29 +968,26 @@ namespace VectorMath
 
     void vdeintlve(const float * sourceP, float * realDestP, float * imagDestP, int framesToProcess)
     {
+        // framesToProcess counts the interleaved values; there are half as many pairs
+        int pairs = framesToProcess / 2;
         int i = 0;
 #if defined(ARM_NEON_INTRINSICS)
-        int j = 0;
-        int endSize = framesToProcess - framesToProcess % 4;
+        int endSize = pairs - pairs % 4;
 
         while (i < endSize)
         {
-            float32x4_t source1 = vld1q_f32(sourceP);
-            float32x4_t source2 = vld1q_f32(sourceP + 4);
+            float32x4_t source1 = vld1q_f32(sourceP + 2 * i);
+            float32x4_t source2 = vld1q_f32(sourceP + 2 * i + 4);
 
             float32x4x2_t source = vuzpq_f32(source1, source2);
 
-            vst1q_f32(realDestP + j, source.val[0]);
-            vst1q_f32(imagDestP + j, source.val[1]);
+            vst1q_f32(realDestP + i, source.val[0]);
+            vst1q_f32(imagDestP + i, source.val[1]);
 
-            sourceP += 8;
-
-            i += 8;
-            j += 4;
+            i += 4;
         }
 #endif
-        int lenTail = framesToProcess / 2;
-        for (; i < lenTail; ++i)
+        for (; i < pairs; ++i)
         {
             int baseIndex = 2 * i;
             realDestP[i] = sourceP[baseIndex];
@@ -784,6 +995,219 @@ namespace VectorMath
         }
     }
 
+    void vrampmul(const float * sourceP, int sourceStride, float * startP, const float * stepP, float * destP, int destStride, int framesToProcess)
+    {
+        int n = framesToProcess;
+        float start = *startP;
+        float step = *stepP;
+        *startP = start + static_cast<float>(n) * step;
+
+        const Kernels & kernels = activeKernels();
+        if (kernels.vrampmul && sourceStride == 1 && destStride == 1)
+        {
+            kernels.vrampmul(sourceP, start, step, destP, n);
+            return;
+        }
+
+        int i = 0;
+#ifdef __SSE2__
+        if ((sourceStride == 1) && (destStride == 1))
+        {
+            __m128 mStart = _mm_set1_ps(start);
+            __m128 mStep = _mm_set1_ps(step);
+            __m128 mIndex = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+            const __m128 mFour = _mm_set1_ps(4.f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 gain = _mm_add_ps(mStart, _mm_mul_ps(mIndex, mStep));
+                _mm_storeu_ps(destP + i, _mm_mul_ps(_mm_loadu_ps(sourceP + i), gain));
+                mIndex = _mm_add_ps(mIndex, mFour);
+            }
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        if ((sourceStride == 1) && (destStride == 1))
+        {
+            float32x4_t mStart = vdupq_n_f32(start);
+            float32x4_t mStep = vdupq_n_f32(step);
+            const float indices[4] = {0.f, 1.f, 2.f, 3.f};
+            float32x4_t mIndex = vld1q_f32(indices);
+            const float32x4_t mFour = vdupq_n_f32(4.f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t gain = vmlaq_f32(mStart, mIndex, mStep);
+                vst1q_f32(destP + i, vmulq_f32(vld1q_f32(sourceP + i), gain));
+                mIndex = vaddq_f32(mIndex, mFour);
+            }
+        }
+#endif
+        for (; i < n; ++i)
+            destP[i * destStride] = sourceP[i * sourceStride] * (start + static_cast<float>(i) * step);
+    }
+
+    void vrampmuladd(const float * sourceP, int sourceStride, float * startP, const float * stepP, float * destP, int destStride, int framesToProcess)
+    {
+        int n = framesToProcess;
+        float start = *startP;
+        float step = *stepP;
+        *startP = start + static_cast<float>(n) * step;
+
+        const Kernels & kernels = activeKernels();
+        if (kernels.vrampmuladd && sourceStride == 1 && destStride == 1)
+        {
+            kernels.vrampmuladd(sourceP, start, step, destP, n);
+            return;
+        }
+
+        int i = 0;
+#ifdef __SSE2__
+        if ((sourceStride == 1) && (destStride == 1))
+        {
+            __m128 mStart = _mm_set1_ps(start);
+            __m128 mStep = _mm_set1_ps(step);
+            __m128 mIndex = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+            const __m128 mFour = _mm_set1_ps(4.f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 gain = _mm_add_ps(mStart, _mm_mul_ps(mIndex, mStep));
+                __m128 sum = _mm_add_ps(_mm_loadu_ps(destP + i), _mm_mul_ps(_mm_loadu_ps(sourceP + i), gain));
+                _mm_storeu_ps(destP + i, sum);
+                mIndex = _mm_add_ps(mIndex, mFour);
+            }
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        if ((sourceStride == 1) && (destStride == 1))
+        {
+            float32x4_t mStart = vdupq_n_f32(start);
+            float32x4_t mStep = vdupq_n_f32(step);
+            const float indices[4] = {0.f, 1.f, 2.f, 3.f};
+            float32x4_t mIndex = vld1q_f32(indices);
+            const float32x4_t mFour = vdupq_n_f32(4.f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t gain = vmlaq_f32(mStart, mIndex, mStep);
+                vst1q_f32(destP + i, vmlaq_f32(vld1q_f32(destP + i), vld1q_f32(sourceP + i), gain));
+                mIndex = vaddq_f32(mIndex, mFour);
+            }
+        }
+#endif
+        for (; i < n; ++i)
+            destP[i * destStride] += sourceP[i * sourceStride] * (start + static_cast<float>(i) * step);
+    }
+
+    void vma(const float * source1P, int sourceStride1, const float * source2P, int sourceStride2,
+             const float * source3P, int sourceStride3, float * destP, int destStride, int framesToProcess)
+    {
+        int n = framesToProcess;
+        bool contiguous = sourceStride1 == 1 && sourceStride2 == 1 && sourceStride3 == 1 && destStride == 1;
+
+        const Kernels & kernels = activeKernels();
+        if (kernels.vma && contiguous)
+        {
+            kernels.vma(source1P, source2P, source3P, destP, n);
+            return;
+        }
+
+        int i = 0;
+#ifdef __SSE2__
+        if (contiguous)
+        {
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 product = _mm_mul_ps(_mm_loadu_ps(source1P + i), _mm_loadu_ps(source2P + i));
+                _mm_storeu_ps(destP + i, _mm_add_ps(product, _mm_loadu_ps(source3P + i)));
+            }
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        if (contiguous)
+        {
+            for (; i + 4 <= n; i += 4)
+                vst1q_f32(destP + i, vmlaq_f32(vld1q_f32(source3P + i), vld1q_f32(source1P + i), vld1q_f32(source2P + i)));
+        }
+#endif
+        for (; i < n; ++i)
+            destP[i * destStride] = source1P[i * sourceStride1] * source2P[i * sourceStride2] + source3P[i * sourceStride3];
+    }
+
+    void vintlvclip(const float * const * sourceChannels, int channelCount, const float * lowThresholdP, const float * highThresholdP,
+                    float * destP, int framesToProcess)
+    {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vintlvclip)
+        {
+            kernels.vintlvclip(sourceChannels, channelCount, *lowThresholdP, *highThresholdP, destP, framesToProcess);
+            return;
+        }
+
+#ifdef __SSE2__
+        if (channelCount == 2)
+        {
+            const float * leftP = sourceChannels[0];
+            const float * rightP = sourceChannels[1];
+            __m128 low = _mm_set1_ps(*lowThresholdP);
+            __m128 high = _mm_set1_ps(*highThresholdP);
+            int i = 0;
+            for (; i + 4 <= framesToProcess; i += 4)
+            {
+                __m128 left = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(leftP + i), high), low);
+                __m128 right = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(rightP + i), high), low);
+                _mm_storeu_ps(destP + 2 * i, _mm_unpacklo_ps(left, right));
+                _mm_storeu_ps(destP + 2 * i + 4, _mm_unpackhi_ps(left, right));
+            }
+            for (; i < framesToProcess; ++i)
+            {
+                destP[2 * i] = std::max(std::min(leftP[i], *highThresholdP), *lowThresholdP);
+                destP[2 * i + 1] = std::max(std::min(rightP[i], *highThresholdP), *lowThresholdP);
+            }
+            return;
+        }
+#endif
+        for (int c = 0; c < channelCount; ++c)
+            vclip(sourceChannels[c], 1, lowThresholdP, highThresholdP, destP + c, channelCount, framesToProcess);
+    }
+
+    void vdeintlvclip(const float * sourceP, int channelCount, const float * lowThresholdP, const float * highThresholdP,
+                      float * const * destChannels, int framesToProcess)
+    {
+        const Kernels & kernels = activeKernels();
+        if (kernels.vdeintlvclip)
+        {
+            kernels.vdeintlvclip(sourceP, channelCount, *lowThresholdP, *highThresholdP, destChannels, framesToProcess);
+            return;
+        }
+
+#ifdef __SSE2__
+        if (channelCount == 2)
+        {
+            float * leftP = destChannels[0];
+            float * rightP = destChannels[1];
+            __m128 low = _mm_set1_ps(*lowThresholdP);
+            __m128 high = _mm_set1_ps(*highThresholdP);
+            int i = 0;
+            for (; i + 4 <= framesToProcess; i += 4)
+            {
+                __m128 a = _mm_loadu_ps(sourceP + 2 * i);
+                __m128 b = _mm_loadu_ps(sourceP + 2 * i + 4);
+                __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(leftP + i, _mm_max_ps(_mm_min_ps(left, high), low));
+                _mm_storeu_ps(rightP + i, _mm_max_ps(_mm_min_ps(right, high), low));
+            }
+            for (; i < framesToProcess; ++i)
+            {
+                leftP[i] = std::max(std::min(sourceP[2 * i], *highThresholdP), *lowThresholdP);
+                rightP[i] = std::max(std::min(sourceP[2 * i + 1], *highThresholdP), *lowThresholdP);
+            }
+            return;
+        }
+#endif
+        for (int c = 0; c < channelCount; ++c)
+            vclip(sourceP + c, channelCount, lowThresholdP, highThresholdP, destChannels[c], 1, framesToProcess);
+    }
+
 }  // namespace VectorMath
 
 }  // namespace lab
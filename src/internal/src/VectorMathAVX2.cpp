@@ -0,0 +1,352 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+// AVX2 kernels for VectorMath. This translation unit is compiled with AVX2 and
+// FMA code generation enabled (see cmake/LabSound.cmake), and is only entered
+// once the CPU has been found to support them. So that no AVX2 code can leak
+// into the rest of the library through an inline function the linker happens
+// to pick from this object, it includes nothing but the intrinsics and the
+// kernel table declaration.
+
+#include "internal/VectorMathKernels.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace lab
+{
+
+namespace VectorMath
+{
+
+namespace
+{
+    inline float clip(float value, float low, float high)
+    {
+        return value < low ? low : (value > high ? high : value);
+    }
+
+    inline float horizontalSum(__m256 v)
+    {
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+
+    inline float horizontalMax(__m256 v)
+    {
+        __m128 max = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+        max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+        return _mm_cvtss_f32(max);
+    }
+
+    void avx2_vsma(const float * sourceP, float scale, float * destP, int n)
+    {
+        const __m256 k = _mm256_set1_ps(scale);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_fmadd_ps(_mm256_loadu_ps(sourceP + i), k, _mm256_loadu_ps(destP + i)));
+        for (; i < n; ++i)
+            destP[i] += sourceP[i] * scale;
+    }
+
+    void avx2_vsmul(const float * sourceP, float scale, float * destP, int n)
+    {
+        const __m256 k = _mm256_set1_ps(scale);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_mul_ps(_mm256_loadu_ps(sourceP + i), k));
+        for (; i < n; ++i)
+            destP[i] = sourceP[i] * scale;
+    }
+
+    void avx2_vadd(const float * source1P, const float * source2P, float * destP, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_add_ps(_mm256_loadu_ps(source1P + i), _mm256_loadu_ps(source2P + i)));
+        for (; i < n; ++i)
+            destP[i] = source1P[i] + source2P[i];
+    }
+
+    void avx2_vmul(const float * source1P, const float * source2P, float * destP, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_mul_ps(_mm256_loadu_ps(source1P + i), _mm256_loadu_ps(source2P + i)));
+        for (; i < n; ++i)
+            destP[i] = source1P[i] * source2P[i];
+    }
+
+    void avx2_vma(const float * source1P, const float * source2P, const float * source3P, float * destP, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_fmadd_ps(_mm256_loadu_ps(source1P + i), _mm256_loadu_ps(source2P + i),
+                                                        _mm256_loadu_ps(source3P + i)));
+        for (; i < n; ++i)
+            destP[i] = source1P[i] * source2P[i] + source3P[i];
+    }
+
+    void avx2_zvmul(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                    float * realDestP, float * imagDestP, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 real1 = _mm256_loadu_ps(real1P + i);
+            __m256 imag1 = _mm256_loadu_ps(imag1P + i);
+            __m256 real2 = _mm256_loadu_ps(real2P + i);
+            __m256 imag2 = _mm256_loadu_ps(imag2P + i);
+            __m256 real = _mm256_fmsub_ps(real1, real2, _mm256_mul_ps(imag1, imag2));
+            __m256 imag = _mm256_fmadd_ps(real1, imag2, _mm256_mul_ps(imag1, real2));
+            _mm256_storeu_ps(realDestP + i, real);
+            _mm256_storeu_ps(imagDestP + i, imag);
+        }
+        for (; i < n; ++i)
+        {
+            float realResult = real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+            float imagResult = real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+            realDestP[i] = realResult;
+            imagDestP[i] = imagResult;
+        }
+    }
+
+    void avx2_zvmuladd(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                       float * realAccP, float * imagAccP, int n)
+    {
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 real1 = _mm256_loadu_ps(real1P + i);
+            __m256 imag1 = _mm256_loadu_ps(imag1P + i);
+            __m256 real2 = _mm256_loadu_ps(real2P + i);
+            __m256 imag2 = _mm256_loadu_ps(imag2P + i);
+            __m256 real = _mm256_fmadd_ps(real1, real2, _mm256_loadu_ps(realAccP + i));
+            __m256 imag = _mm256_fmadd_ps(real1, imag2, _mm256_loadu_ps(imagAccP + i));
+            _mm256_storeu_ps(realAccP + i, _mm256_fnmadd_ps(imag1, imag2, real));
+            _mm256_storeu_ps(imagAccP + i, _mm256_fmadd_ps(imag1, real2, imag));
+        }
+        for (; i < n; ++i)
+        {
+            realAccP[i] += real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+            imagAccP[i] += real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+        }
+    }
+
+    float avx2_vsvesq(const float * sourceP, int n)
+    {
+        // two accumulators hide the latency of the fused multiply-add
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m256 a = _mm256_loadu_ps(sourceP + i);
+            __m256 b = _mm256_loadu_ps(sourceP + i + 8);
+            sum0 = _mm256_fmadd_ps(a, a, sum0);
+            sum1 = _mm256_fmadd_ps(b, b, sum1);
+        }
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 a = _mm256_loadu_ps(sourceP + i);
+            sum0 = _mm256_fmadd_ps(a, a, sum0);
+        }
+        float sum = horizontalSum(_mm256_add_ps(sum0, sum1));
+        for (; i < n; ++i)
+            sum += sourceP[i] * sourceP[i];
+        return sum;
+    }
+
+    float avx2_vmaxmgv(const float * sourceP, int n)
+    {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        __m256 max = _mm256_setzero_ps();
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            max = _mm256_max_ps(max, _mm256_and_ps(_mm256_loadu_ps(sourceP + i), absMask));
+        float result = horizontalMax(max);
+        for (; i < n; ++i)
+        {
+            float value = sourceP[i] < 0 ? -sourceP[i] : sourceP[i];
+            if (value > result)
+                result = value;
+        }
+        return result;
+    }
+
+    void avx2_vclip(const float * sourceP, float low, float high, float * destP, int n)
+    {
+        const __m256 mLow = _mm256_set1_ps(low);
+        const __m256 mHigh = _mm256_set1_ps(high);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(sourceP + i), mHigh), mLow));
+        for (; i < n; ++i)
+            destP[i] = clip(sourceP[i], low, high);
+    }
+
+    // the ramp's value for each lane is computed from its index, so error does not accumulate
+    struct Ramp
+    {
+        __m256 start, step, index;
+        const __m256 eight = _mm256_set1_ps(8.f);
+
+        Ramp(float start_, float step_)
+            : start(_mm256_set1_ps(start_))
+            , step(_mm256_set1_ps(step_))
+            , index(_mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f)) {}
+
+        __m256 next()
+        {
+            __m256 value = _mm256_add_ps(start, _mm256_mul_ps(index, step));
+            index = _mm256_add_ps(index, eight);
+            return value;
+        }
+    };
+
+    void avx2_vramp(float start, float step, float * destP, int n)
+    {
+        Ramp ramp(start, step);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, ramp.next());
+        for (; i < n; ++i)
+            destP[i] = start + static_cast<float>(i) * step;
+    }
+
+    void avx2_vrampmul(const float * sourceP, float start, float step, float * destP, int n)
+    {
+        Ramp ramp(start, step);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_mul_ps(_mm256_loadu_ps(sourceP + i), ramp.next()));
+        for (; i < n; ++i)
+            destP[i] = sourceP[i] * (start + static_cast<float>(i) * step);
+    }
+
+    void avx2_vrampmuladd(const float * sourceP, float start, float step, float * destP, int n)
+    {
+        Ramp ramp(start, step);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(destP + i, _mm256_fmadd_ps(_mm256_loadu_ps(sourceP + i), ramp.next(), _mm256_loadu_ps(destP + i)));
+        for (; i < n; ++i)
+            destP[i] += sourceP[i] * (start + static_cast<float>(i) * step);
+    }
+
+    void avx2_vintlvclip(const float * const * sourceChannels, int channelCount, float low, float high, float * destP, int n)
+    {
+        if (channelCount == 1)
+        {
+            avx2_vclip(sourceChannels[0], low, high, destP, n);
+            return;
+        }
+
+        int i = 0;
+        if (channelCount == 2)
+        {
+            const float * leftP = sourceChannels[0];
+            const float * rightP = sourceChannels[1];
+            const __m256 mLow = _mm256_set1_ps(low);
+            const __m256 mHigh = _mm256_set1_ps(high);
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 left = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(leftP + i), mHigh), mLow);
+                __m256 right = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(rightP + i), mHigh), mLow);
+                // l0 r0 l1 r1 | l4 r4 l5 r5, and l2 r2 l3 r3 | l6 r6 l7 r7
+                __m256 lo = _mm256_unpacklo_ps(left, right);
+                __m256 hi = _mm256_unpackhi_ps(left, right);
+                _mm256_storeu_ps(destP + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(destP + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            }
+        }
+
+        for (int c = 0; c < channelCount; ++c)
+        {
+            const float * sourceP = sourceChannels[c];
+            for (int j = i; j < n; ++j)
+                destP[j * channelCount + c] = clip(sourceP[j], low, high);
+        }
+    }
+
+    void avx2_vdeintlvclip(const float * sourceP, int channelCount, float low, float high, float * const * destChannels, int n)
+    {
+        if (channelCount == 1)
+        {
+            avx2_vclip(sourceP, low, high, destChannels[0], n);
+            return;
+        }
+
+        int i = 0;
+        if (channelCount == 2)
+        {
+            float * leftP = destChannels[0];
+            float * rightP = destChannels[1];
+            const __m256 mLow = _mm256_set1_ps(low);
+            const __m256 mHigh = _mm256_set1_ps(high);
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 a = _mm256_loadu_ps(sourceP + 2 * i);
+                __m256 b = _mm256_loadu_ps(sourceP + 2 * i + 8);
+                // l0 l1 l4 l5 | l2 l3 l6 l7, then restore the order of the 64 bit pairs
+                __m256 left = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                __m256 right = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                left = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(left), _MM_SHUFFLE(3, 1, 2, 0)));
+                right = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(right), _MM_SHUFFLE(3, 1, 2, 0)));
+                _mm256_storeu_ps(leftP + i, _mm256_max_ps(_mm256_min_ps(left, mHigh), mLow));
+                _mm256_storeu_ps(rightP + i, _mm256_max_ps(_mm256_min_ps(right, mHigh), mLow));
+            }
+        }
+
+        for (int c = 0; c < channelCount; ++c)
+        {
+            float * destP = destChannels[c];
+            for (int j = i; j < n; ++j)
+                destP[j] = clip(sourceP[j * channelCount + c], low, high);
+        }
+    }
+
+    const Kernels s_avx2Kernels = {
+        avx2_vsma,
+        avx2_vsmul,
+        avx2_vadd,
+        avx2_vmul,
+        avx2_vma,
+        avx2_zvmul,
+        avx2_zvmuladd,
+        avx2_vsvesq,
+        avx2_vmaxmgv,
+        avx2_vclip,
+        avx2_vramp,
+        avx2_vrampmul,
+        avx2_vrampmuladd,
+        avx2_vintlvclip,
+        avx2_vdeintlvclip,
+    };
+}
+
+const Kernels * avx2Kernels()
+{
+    return &s_avx2Kernels;
+}
+
+}  // namespace VectorMath
+
+}  // namespace lab
+
+#else
+
+namespace lab
+{
+namespace VectorMath
+{
+    // this build does not target x86-64, or the compiler was not asked for AVX2
+    const Kernels * avx2Kernels() { return nullptr; }
+}
+}
+
+#endif
@@ -0,0 +1,374 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+// AVX-512 kernels for VectorMath. As with VectorMathAVX2.cpp, this translation
+// unit is compiled for its instruction set, is only entered once the CPU has
+// been found to support it, and includes nothing an inline function could
+// escape from. Partial vectors at the end of a buffer are handled with masked
+// loads and stores rather than a scalar loop.
+
+#include "internal/VectorMathKernels.h"
+
+#if defined(__AVX512F__)
+
+// GCC 12 reports the _mm512_undefined_ps() placeholders inside its own intrinsics
+// as uninitialized once they are inlined (GCC bug 105593)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace lab
+{
+
+namespace VectorMath
+{
+
+namespace
+{
+    inline __mmask16 tailMask(int remaining)
+    {
+        return static_cast<__mmask16>((1u << remaining) - 1u);
+    }
+
+    inline __m512 clip(__m512 v, __m512 low, __m512 high)
+    {
+        return _mm512_max_ps(_mm512_min_ps(v, high), low);
+    }
+
+    // the halves are folded together, then reduced as in VectorMathAVX2.cpp,
+    // rather than with _mm512_reduce_add_ps and _mm512_reduce_max_ps
+    inline __m256 upperHalf(__m512 v)
+    {
+        return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1));
+    }
+
+    inline float horizontalSum(__m512 v)
+    {
+        __m256 half = _mm256_add_ps(_mm512_castps512_ps256(v), upperHalf(v));
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+
+    inline float horizontalMax(__m512 v)
+    {
+        __m256 half = _mm256_max_ps(_mm512_castps512_ps256(v), upperHalf(v));
+        __m128 max = _mm_max_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+        max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+        max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+        return _mm_cvtss_f32(max);
+    }
+
+    void avx512_vsma(const float * sourceP, float scale, float * destP, int n)
+    {
+        const __m512 k = _mm512_set1_ps(scale);
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(destP + i, _mm512_fmadd_ps(_mm512_loadu_ps(sourceP + i), k, _mm512_loadu_ps(destP + i)));
+        if (i < n)
+        {
+            __mmask16 m = tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, sourceP + i), k, _mm512_maskz_loadu_ps(m, destP + i)));
+        }
+    }
+
+    void avx512_vsmul(const float * sourceP, float scale, float * destP, int n)
+    {
+        const __m512 k = _mm512_set1_ps(scale);
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(destP + i, _mm512_mul_ps(_mm512_loadu_ps(sourceP + i), k));
+        if (i < n)
+        {
+            __mmask16 m = tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, sourceP + i), k));
+        }
+    }
+
+    void avx512_vadd(const float * source1P, const float * source2P, float * destP, int n)
+    {
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(destP + i, _mm512_add_ps(_mm512_loadu_ps(source1P + i), _mm512_loadu_ps(source2P + i)));
+        if (i < n)
+        {
+            __mmask16 m = tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, source1P + i), _mm512_maskz_loadu_ps(m, source2P + i)));
+        }
+    }
+
+    void avx512_vmul(const float * source1P, const float * source2P, float * destP, int n)
+    {
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(destP + i, _mm512_mul_ps(_mm512_loadu_ps(source1P + i), _mm512_loadu_ps(source2P + i)));
+        if (i < n)
+        {
+            __mmask16 m = tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, source1P + i), _mm512_maskz_loadu_ps(m, source2P + i)));
+        }
+    }
+
+    void avx512_vma(const float * source1P, const float * source2P, const float * source3P, float * destP, int n)
+    {
+        int i = 0;
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(destP + i, _mm512_fmadd_ps(_mm512_loadu_ps(source1P + i), _mm512_loadu_ps(source2P + i),
+                                                        _mm512_loadu_ps(source3P + i)));
+        if (i < n)
+        {
+            __mmask16 m = tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, source1P + i), _mm512_maskz_loadu_ps(m, source2P + i),
+                                                                _mm512_maskz_loadu_ps(m, source3P + i)));
+        }
+    }
+
+    void avx512_zvmul(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                      float * realDestP, float * imagDestP, int n)
+    {
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            __m512 real1 = _mm512_maskz_loadu_ps(m, real1P + i);
+            __m512 imag1 = _mm512_maskz_loadu_ps(m, imag1P + i);
+            __m512 real2 = _mm512_maskz_loadu_ps(m, real2P + i);
+            __m512 imag2 = _mm512_maskz_loadu_ps(m, imag2P + i);
+            __m512 real = _mm512_fmsub_ps(real1, real2, _mm512_mul_ps(imag1, imag2));
+            __m512 imag = _mm512_fmadd_ps(real1, imag2, _mm512_mul_ps(imag1, real2));
+            _mm512_mask_storeu_ps(realDestP + i, m, real);
+            _mm512_mask_storeu_ps(imagDestP + i, m, imag);
+        }
+    }
+
+    void avx512_zvmuladd(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                         float * realAccP, float * imagAccP, int n)
+    {
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            __m512 real1 = _mm512_maskz_loadu_ps(m, real1P + i);
+            __m512 imag1 = _mm512_maskz_loadu_ps(m, imag1P + i);
+            __m512 real2 = _mm512_maskz_loadu_ps(m, real2P + i);
+            __m512 imag2 = _mm512_maskz_loadu_ps(m, imag2P + i);
+            __m512 real = _mm512_fmadd_ps(real1, real2, _mm512_maskz_loadu_ps(m, realAccP + i));
+            __m512 imag = _mm512_fmadd_ps(real1, imag2, _mm512_maskz_loadu_ps(m, imagAccP + i));
+            _mm512_mask_storeu_ps(realAccP + i, m, _mm512_fnmadd_ps(imag1, imag2, real));
+            _mm512_mask_storeu_ps(imagAccP + i, m, _mm512_fmadd_ps(imag1, real2, imag));
+        }
+    }
+
+    float avx512_vsvesq(const float * sourceP, int n)
+    {
+        __m512 sum0 = _mm512_setzero_ps();
+        __m512 sum1 = _mm512_setzero_ps();
+        int i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            __m512 a = _mm512_loadu_ps(sourceP + i);
+            __m512 b = _mm512_loadu_ps(sourceP + i + 16);
+            sum0 = _mm512_fmadd_ps(a, a, sum0);
+            sum1 = _mm512_fmadd_ps(b, b, sum1);
+        }
+        for (; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            __m512 a = _mm512_maskz_loadu_ps(m, sourceP + i);
+            sum0 = _mm512_fmadd_ps(a, a, sum0);
+        }
+        return horizontalSum(_mm512_add_ps(sum0, sum1));
+    }
+
+    float avx512_vmaxmgv(const float * sourceP, int n)
+    {
+        __m512 max = _mm512_setzero_ps();
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            max = _mm512_max_ps(max, _mm512_abs_ps(_mm512_maskz_loadu_ps(m, sourceP + i)));
+        }
+        return horizontalMax(max);
+    }
+
+    void avx512_vclip(const float * sourceP, float low, float high, float * destP, int n)
+    {
+        const __m512 mLow = _mm512_set1_ps(low);
+        const __m512 mHigh = _mm512_set1_ps(high);
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, clip(_mm512_maskz_loadu_ps(m, sourceP + i), mLow, mHigh));
+        }
+    }
+
+    struct Ramp
+    {
+        __m512 start, step, index;
+        const __m512 sixteen = _mm512_set1_ps(16.f);
+
+        Ramp(float start_, float step_)
+            : start(_mm512_set1_ps(start_))
+            , step(_mm512_set1_ps(step_))
+            , index(_mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f)) {}
+
+        __m512 next()
+        {
+            __m512 value = _mm512_add_ps(start, _mm512_mul_ps(index, step));
+            index = _mm512_add_ps(index, sixteen);
+            return value;
+        }
+    };
+
+    void avx512_vramp(float start, float step, float * destP, int n)
+    {
+        Ramp ramp(start, step);
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, ramp.next());
+        }
+    }
+
+    void avx512_vrampmul(const float * sourceP, float start, float step, float * destP, int n)
+    {
+        Ramp ramp(start, step);
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            _mm512_mask_storeu_ps(destP + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, sourceP + i), ramp.next()));
+        }
+    }
+
+    void avx512_vrampmuladd(const float * sourceP, float start, float step, float * destP, int n)
+    {
+        Ramp ramp(start, step);
+        for (int i = 0; i < n; i += 16)
+        {
+            __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xffff) : tailMask(n - i);
+            __m512 sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, sourceP + i), ramp.next(), _mm512_maskz_loadu_ps(m, destP + i));
+            _mm512_mask_storeu_ps(destP + i, m, sum);
+        }
+    }
+
+    void avx512_vintlvclip(const float * const * sourceChannels, int channelCount, float low, float high, float * destP, int n)
+    {
+        const __m512 mLow = _mm512_set1_ps(low);
+        const __m512 mHigh = _mm512_set1_ps(high);
+
+        if (channelCount == 1)
+        {
+            avx512_vclip(sourceChannels[0], low, high, destP, n);
+            return;
+        }
+
+        int i = 0;
+        if (channelCount == 2)
+        {
+            const float * leftP = sourceChannels[0];
+            const float * rightP = sourceChannels[1];
+            const __m512i loIndex = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+            const __m512i hiIndex = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512 left = clip(_mm512_loadu_ps(leftP + i), mLow, mHigh);
+                __m512 right = clip(_mm512_loadu_ps(rightP + i), mLow, mHigh);
+                _mm512_storeu_ps(destP + 2 * i, _mm512_permutex2var_ps(left, loIndex, right));
+                _mm512_storeu_ps(destP + 2 * i + 16, _mm512_permutex2var_ps(left, hiIndex, right));
+            }
+        }
+
+        for (int c = 0; c < channelCount; ++c)
+        {
+            const float * sourceP = sourceChannels[c];
+            for (int j = i; j < n; ++j)
+            {
+                float value = sourceP[j];
+                destP[j * channelCount + c] = value < low ? low : (value > high ? high : value);
+            }
+        }
+    }
+
+    void avx512_vdeintlvclip(const float * sourceP, int channelCount, float low, float high, float * const * destChannels, int n)
+    {
+        const __m512 mLow = _mm512_set1_ps(low);
+        const __m512 mHigh = _mm512_set1_ps(high);
+
+        if (channelCount == 1)
+        {
+            avx512_vclip(sourceP, low, high, destChannels[0], n);
+            return;
+        }
+
+        int i = 0;
+        if (channelCount == 2)
+        {
+            float * leftP = destChannels[0];
+            float * rightP = destChannels[1];
+            const __m512i evenIndex = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+            const __m512i oddIndex = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512 a = _mm512_loadu_ps(sourceP + 2 * i);
+                __m512 b = _mm512_loadu_ps(sourceP + 2 * i + 16);
+                _mm512_storeu_ps(leftP + i, clip(_mm512_permutex2var_ps(a, evenIndex, b), mLow, mHigh));
+                _mm512_storeu_ps(rightP + i, clip(_mm512_permutex2var_ps(a, oddIndex, b), mLow, mHigh));
+            }
+        }
+
+        for (int c = 0; c < channelCount; ++c)
+        {
+            float * destP = destChannels[c];
+            for (int j = i; j < n; ++j)
+            {
+                float value = sourceP[j * channelCount + c];
+                destP[j] = value < low ? low : (value > high ? high : value);
+            }
+        }
+    }
+
+    const Kernels s_avx512Kernels = {
+        avx512_vsma,
+        avx512_vsmul,
+        avx512_vadd,
+        avx512_vmul,
+        avx512_vma,
+        avx512_zvmul,
+        avx512_zvmuladd,
+        avx512_vsvesq,
+        avx512_vmaxmgv,
+        avx512_vclip,
+        avx512_vramp,
+        avx512_vrampmul,
+        avx512_vrampmuladd,
+        avx512_vintlvclip,
+        avx512_vdeintlvclip,
+    };
+}
+
+const Kernels * avx512Kernels()
+{
+    return &s_avx512Kernels;
+}
+
+}  // namespace VectorMath
+
+}  // namespace lab
+
+#else
+
+namespace lab
+{
+namespace VectorMath
+{
+    // this build does not target x86-64, or the compiler was not asked for AVX-512
+    const Kernels * avx512Kernels() { return nullptr; }
+}
+}
+
+#endif
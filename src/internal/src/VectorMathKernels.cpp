@@ -0,0 +1,326 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/VectorMathKernels.h"
+
+#if defined(LABSOUND_VECTORMATH_X86_DISPATCH)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <math.h>
+
+namespace lab
+{
+
+namespace VectorMath
+{
+
+//-------------------------------------------
+//   scalar kernels
+//-------------------------------------------
+
+// These are the reference implementations, and the point of comparison for
+// the benchmarks. They are plain loops, subject to whatever the compiler makes
+// of them at the baseline instruction set.
+
+namespace
+{
+    void scalar_vsma(const float * sourceP, float scale, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] += sourceP[i] * scale;
+    }
+
+    void scalar_vsmul(const float * sourceP, float scale, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = sourceP[i] * scale;
+    }
+
+    void scalar_vadd(const float * source1P, const float * source2P, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = source1P[i] + source2P[i];
+    }
+
+    void scalar_vmul(const float * source1P, const float * source2P, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = source1P[i] * source2P[i];
+    }
+
+    void scalar_vma(const float * source1P, const float * source2P, const float * source3P, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = source1P[i] * source2P[i] + source3P[i];
+    }
+
+    void scalar_zvmul(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                      float * realDestP, float * imagDestP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            // the destination may be one of the sources
+            float realResult = real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+            float imagResult = real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+            realDestP[i] = realResult;
+            imagDestP[i] = imagResult;
+        }
+    }
+
+    void scalar_zvmuladd(const float * real1P, const float * imag1P, const float * real2P, const float * imag2P,
+                         float * realAccP, float * imagAccP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            realAccP[i] += real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+            imagAccP[i] += real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+        }
+    }
+
+    float scalar_vsvesq(const float * sourceP, int n)
+    {
+        float sum = 0;
+        for (int i = 0; i < n; ++i)
+            sum += sourceP[i] * sourceP[i];
+        return sum;
+    }
+
+    float scalar_vmaxmgv(const float * sourceP, int n)
+    {
+        float max = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            float value = fabsf(sourceP[i]);
+            if (value > max)
+                max = value;
+        }
+        return max;
+    }
+
+    inline float clip(float value, float low, float high)
+    {
+        return value < low ? low : (value > high ? high : value);
+    }
+
+    void scalar_vclip(const float * sourceP, float low, float high, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = clip(sourceP[i], low, high);
+    }
+
+    void scalar_vramp(float start, float step, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = start + static_cast<float>(i) * step;
+    }
+
+    void scalar_vrampmul(const float * sourceP, float start, float step, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] = sourceP[i] * (start + static_cast<float>(i) * step);
+    }
+
+    void scalar_vrampmuladd(const float * sourceP, float start, float step, float * destP, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            destP[i] += sourceP[i] * (start + static_cast<float>(i) * step);
+    }
+
+    void scalar_vintlvclip(const float * const * sourceChannels, int channelCount, float low, float high, float * destP, int n)
+    {
+        for (int c = 0; c < channelCount; ++c)
+        {
+            const float * sourceP = sourceChannels[c];
+            for (int i = 0; i < n; ++i)
+                destP[i * channelCount + c] = clip(sourceP[i], low, high);
+        }
+    }
+
+    void scalar_vdeintlvclip(const float * sourceP, int channelCount, float low, float high, float * const * destChannels, int n)
+    {
+        for (int c = 0; c < channelCount; ++c)
+        {
+            float * destP = destChannels[c];
+            for (int i = 0; i < n; ++i)
+                destP[i] = clip(sourceP[i * channelCount + c], low, high);
+        }
+    }
+
+    const Kernels s_scalarKernels = {
+        scalar_vsma,
+        scalar_vsmul,
+        scalar_vadd,
+        scalar_vmul,
+        scalar_vma,
+        scalar_zvmul,
+        scalar_zvmuladd,
+        scalar_vsvesq,
+        scalar_vmaxmgv,
+        scalar_vclip,
+        scalar_vramp,
+        scalar_vrampmul,
+        scalar_vrampmuladd,
+        scalar_vintlvclip,
+        scalar_vdeintlvclip,
+    };
+
+    // every entry is null, so every call takes the baseline path
+    const Kernels s_baselineKernels = {};
+
+    //-------------------------------------------
+    //   CPU detection
+    //-------------------------------------------
+
+#if defined(LABSOUND_VECTORMATH_X86_DISPATCH)
+    void cpuid(int leaf, int subleaf, uint32_t regs[4])
+    {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuidex(r, leaf, subleaf);
+        for (int i = 0; i < 4; ++i)
+            regs[i] = static_cast<uint32_t>(r[i]);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    // the register state the operating system saves on a context switch
+    uint64_t xgetbv0()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+
+    SimdLevel detectSimdLevel()
+    {
+        uint32_t regs[4];
+        cpuid(0, 0, regs);
+        const uint32_t maxLeaf = regs[0];
+        if (maxLeaf < 7)
+            return SimdLevel::Baseline;
+
+        cpuid(1, 0, regs);
+        const bool fma = (regs[2] & (1u << 12)) != 0;
+        const bool osxsave = (regs[2] & (1u << 27)) != 0;
+        const bool avx = (regs[2] & (1u << 28)) != 0;
+        if (!osxsave || !avx || !fma)
+            return SimdLevel::Baseline;
+
+        // the OS must preserve the xmm and ymm registers, and for AVX-512,
+        // the opmask and zmm registers too
+        const uint64_t xcr0 = xgetbv0();
+        const bool ymmState = (xcr0 & 0x6) == 0x6;
+        const bool zmmState = (xcr0 & 0xe6) == 0xe6;
+        if (!ymmState)
+            return SimdLevel::Baseline;
+
+        cpuid(7, 0, regs);
+        const bool avx2 = (regs[1] & (1u << 5)) != 0;
+        const bool avx512f = (regs[1] & (1u << 16)) != 0;
+
+        if (avx512f && avx2 && zmmState && avx512Kernels())
+            return SimdLevel::AVX512;
+        if (avx2 && avx2Kernels())
+            return SimdLevel::AVX2;
+        return SimdLevel::Baseline;
+    }
+#endif
+
+    const Kernels * kernelsFor(SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::Scalar: return scalarKernels();
+            case SimdLevel::AVX2: return avx2Kernels();
+            case SimdLevel::AVX512: return avx512Kernels();
+            default: return &s_baselineKernels;
+        }
+    }
+
+    std::atomic<const Kernels *> s_activeKernels {nullptr};
+    std::atomic<SimdLevel> s_activeLevel {SimdLevel::Baseline};
+}
+
+const Kernels * scalarKernels()
+{
+    return &s_scalarKernels;
+}
+
+SimdLevel supportedSimdLevel()
+{
+#if defined(LABSOUND_VECTORMATH_X86_DISPATCH)
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+#else
+    return SimdLevel::Baseline;
+#endif
+}
+
+const Kernels & activeKernels()
+{
+    const Kernels * kernels = s_activeKernels.load(std::memory_order_acquire);
+    if (!kernels)
+    {
+        // racing first callers arrive at the same answer
+        SimdLevel level = supportedSimdLevel();
+        kernels = kernelsFor(level);
+        s_activeLevel.store(level);
+        s_activeKernels.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+
+SimdLevel simdLevel()
+{
+    activeKernels();
+    return s_activeLevel.load();
+}
+
+SimdLevel setSimdLevel(SimdLevel level)
+{
+#if defined(__APPLE__)
+    level = SimdLevel::Baseline;
+#else
+    if (level > supportedSimdLevel())
+        level = supportedSimdLevel();
+#endif
+    s_activeLevel.store(level);
+    s_activeKernels.store(kernelsFor(level), std::memory_order_release);
+    return level;
+}
+
+const char * simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::Scalar: return "scalar";
+#if defined(__APPLE__)
+        case SimdLevel::Baseline: return "accelerate";
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        case SimdLevel::Baseline: return "sse2";
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        case SimdLevel::Baseline: return "neon";
+#else
+        case SimdLevel::Baseline: return "baseline";
+#endif
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+}  // namespace VectorMath
+
+}  // namespace lab
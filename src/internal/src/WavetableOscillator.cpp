@@ -0,0 +1,110 @@
+// License: BSD 2 Clause
+// Copyright (C) 2015+, The LabSound Authors. All rights reserved.
+
+#include "internal/WavetableOscillator.h"
+
+#include "LabSound/core/PeriodicWave.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+namespace lab
+{
+
+WavetableOscillator::WavetableOscillator() {}
+
+WavetableOscillator::~WavetableOscillator() {}
+
+void WavetableOscillator::render(const PeriodicWave & wave, const float * frequencies, float * destination, int framesToProcess)
+{
+    const double size = wave.periodicWaveSize();
+    const double rateScale = wave.rateScale();
+
+    // the position in the tables, in frames
+    double position = m_phase * size;
+
+    int indices[SpanFrames];
+    float fractions[SpanFrames];
+
+    for (int offset = 0; offset < framesToProcess; offset += SpanFrames)
+    {
+        const int frames = std::min(static_cast<int>(SpanFrames), framesToProcess - offset);
+        const float * frequency = frequencies + offset;
+        float * out = destination + offset;
+
+        const float * lower;
+        const float * higher;
+        float factor;
+        wave.waveDataForFundamentalFrequency(frequency[0], lower, higher, factor);
+
+        // The positions follow each other; each table frame is followed by the
+        // next, even the last, so a read never wraps
+        for (int i = 0; i < frames; ++i)
+        {
+            const int k = static_cast<int>(position);
+            indices[i] = k;
+            fractions[i] = static_cast<float>(position - k);
+
+            position += frequency[i] * rateScale;
+            if (!(position >= 0 && position < size))
+            {
+                position -= size * std::floor(position / size);
+                if (!(position >= 0 && position < size))
+                    position = 0;
+            }
+        }
+
+        int i = 0;
+
+#if defined(__SSE2__)
+        const __m128 crossFade = _mm_set1_ps(factor);
+        for (; i + 4 <= frames; i += 4)
+        {
+            const int * k = indices + i;
+            const __m128 t = _mm_loadu_ps(fractions + i);
+            const __m128 l0 = _mm_setr_ps(lower[k[0]], lower[k[1]], lower[k[2]], lower[k[3]]);
+            const __m128 l1 = _mm_setr_ps(lower[k[0] + 1], lower[k[1] + 1], lower[k[2] + 1], lower[k[3] + 1]);
+            const __m128 h0 = _mm_setr_ps(higher[k[0]], higher[k[1]], higher[k[2]], higher[k[3]]);
+            const __m128 h1 = _mm_setr_ps(higher[k[0] + 1], higher[k[1] + 1], higher[k[2] + 1], higher[k[3] + 1]);
+            const __m128 l = _mm_add_ps(l0, _mm_mul_ps(t, _mm_sub_ps(l1, l0)));
+            const __m128 h = _mm_add_ps(h0, _mm_mul_ps(t, _mm_sub_ps(h1, h0)));
+            _mm_storeu_ps(out + i, _mm_add_ps(h, _mm_mul_ps(crossFade, _mm_sub_ps(l, h))));
+        }
+#elif defined(ARM_NEON_INTRINSICS)
+        const float32x4_t crossFade = vdupq_n_f32(factor);
+        for (; i + 4 <= frames; i += 4)
+        {
+            const int * k = indices + i;
+            const float lower0[4] = {lower[k[0]], lower[k[1]], lower[k[2]], lower[k[3]]};
+            const float lower1[4] = {lower[k[0] + 1], lower[k[1] + 1], lower[k[2] + 1], lower[k[3] + 1]};
+            const float higher0[4] = {higher[k[0]], higher[k[1]], higher[k[2]], higher[k[3]]};
+            const float higher1[4] = {higher[k[0] + 1], higher[k[1] + 1], higher[k[2] + 1], higher[k[3] + 1]};
+            const float32x4_t t = vld1q_f32(fractions + i);
+            const float32x4_t l0 = vld1q_f32(lower0);
+            const float32x4_t h0 = vld1q_f32(higher0);
+            const float32x4_t l = vmlaq_f32(l0, t, vsubq_f32(vld1q_f32(lower1), l0));
+            const float32x4_t h = vmlaq_f32(h0, t, vsubq_f32(vld1q_f32(higher1), h0));
+            vst1q_f32(out + i, vmlaq_f32(h, crossFade, vsubq_f32(l, h)));
+        }
+#endif
+
+        for (; i < frames; ++i)
+        {
+            const int k = indices[i];
+            const float t = fractions[i];
+            const float l = lower[k] + t * (lower[k + 1] - lower[k]);
+            const float h = higher[k] + t * (higher[k + 1] - higher[k]);
+            out[i] = h + factor * (l - h);
+        }
+    }
+
+    m_phase = position / size;
+}
+
+}  // namespace lab